@@ -0,0 +1,43 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include "Value.hpp"
+#include "types/Array.hpp"
+#include "types/ViewModel.hpp"
+
+using namespace slim;
+
+BENCHMARK(function_args)
+{
+    // Method calls with a few arguments, and blocks, which pass their proc as an extra argument.
+    auto tpl = parse_template(
+        "- @items.each do |x|\n"
+        "  = x.round(1)\n"
+        "  = @items.fetch(2, x)\n"
+        "  = [x, 1, 2].include?(x)\n"
+        "- @items.each_with_index do |x, i|\n"
+        "  = i\n"
+        "= @items.select { |x| x > 500 }.size\n");
+    tpl.set_exec_mode(Template::EXEC_TREE);
+    auto model = create_view_model();
+    std::vector<ObjectPtr> items;
+    for (int i = 0; i < 1000; ++i) items.push_back(make_value(i + 0.25));
+    model->set_attr("items", make_array(items));
+    for (bool arena : {false, true})
+    {
+        tpl.set_render_arena(arena);
+        bench::run(std::string("calls 1000 items tree ") + (arena ? "arena" : "heap"), [&]{
+            bench::do_not_optimize(tpl.render(model));
+        });
+    }
+
+    auto value = make_value(1.0);
+    bench::run("build 3 args 1000", [&]{
+        for (int i = 0; i < 1000; ++i)
+        {
+            FunctionArgs args;
+            args.reserve(3);
+            for (int j = 0; j < 3; ++j) args.push_back(value);
+            bench::do_not_optimize(args);
+        }
+    });
+}
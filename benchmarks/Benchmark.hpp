@@ -0,0 +1,37 @@
+#pragma once
+#include <functional>
+#include <string>
+
+/**@brief Minimal benchmark harness.
+ *
+ * Each BENCHMARK function is run by Main.cpp, optionally filtered by a name substring given on
+ * the command line, and calls bench::run for each measurement.
+ */
+namespace bench
+{
+    /**Runs func repeatedly for a fixed minimum time and prints the mean time per call.
+     * @param bytes If not 0, the number of bytes processed per call, to also print throughput.
+     */
+    void run(const std::string &name, const std::function<void()> &func, size_t bytes = 0);
+
+    /**Prevent the compiler optimising away a result.*/
+    template<class T> inline void do_not_optimize(const T &value)
+    {
+    #if defined(__GNUC__)
+        asm volatile("" : : "r,m"(value) : "memory");
+    #else
+        static volatile const void *sink;
+        sink = &value;
+    #endif
+    }
+
+    struct Registration
+    {
+        Registration(const char *name, void(*func)());
+    };
+}
+
+#define BENCHMARK(name) \
+    static void bench_##name(); \
+    static bench::Registration bench_registration_##name(#name, &bench_##name); \
+    static void bench_##name()
@@ -0,0 +1,74 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include <cstdio>
+#include <fstream>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace slim;
+
+namespace
+{
+    const char *PAGE_TEMPLATE =
+        "html\n"
+        "  head\n"
+        "    title = @title\n"
+        "  body\n"
+        "    h1.title = @title\n"
+        "    - if @items.empty?\n"
+        "      p No items\n"
+        "    - else\n"
+        "      table\n"
+        "        - @items.each do |item|\n"
+        "          tr class=(item[:price] > 50 ? 'expensive' : 'cheap')\n"
+        "            td = item[:id]\n"
+        "            td = item[:name]\n"
+        "            td = item[:price] * 2\n"
+        "            td\n"
+        "              - item[:tags].each do |tag|\n"
+        "                span.tag = tag.upcase\n"
+        "    p Total #{@items.size} items\n";
+
+    /**A directory of N source templates, and their precompiled binaries.*/
+    struct TemplateFiles
+    {
+        std::string dir;
+        std::vector<std::string> sources, binaries;
+
+        explicit TemplateFiles(size_t count)
+        {
+            char buf[] = "/tmp/slim_bench_XXXXXX";
+            if (!mkdtemp(buf)) throw std::runtime_error("mkdtemp failed");
+            dir = buf;
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto name = dir + "/page" + std::to_string(i);
+                sources.push_back(name + ".html.slim");
+                binaries.push_back(name + ".slimb");
+                std::ofstream(sources.back(), std::ios::binary)
+                    << PAGE_TEMPLATE << "    p Page " << i << "\n";
+                save_template_binary_file(parse_template_file(sources.back()), binaries.back());
+            }
+        }
+        ~TemplateFiles()
+        {
+            for (auto &path : sources) remove(path.c_str());
+            for (auto &path : binaries) remove(path.c_str());
+            rmdir(dir.c_str());
+        }
+    };
+}
+
+BENCHMARK(cold_start)
+{
+    for (size_t count : {10, 100})
+    {
+        TemplateFiles files(count);
+        bench::run("load " + std::to_string(count) + " templates parse", [&]{
+            for (auto &path : files.sources) bench::do_not_optimize(parse_template_file(path));
+        });
+        bench::run("load " + std::to_string(count) + " templates binary", [&]{
+            for (auto &path : files.binaries) bench::do_not_optimize(load_template_binary_file(path));
+        });
+    }
+}
@@ -0,0 +1,35 @@
+#include "Benchmark.hpp"
+#include "Value.hpp"
+#include "types/Array.hpp"
+#include "types/Hash.hpp"
+#include "types/String.hpp"
+#include "types/ViewModel.hpp"
+
+using namespace slim;
+
+BENCHMARK(method_dispatch)
+{
+    // find_method without an inline cache, as for megamorphic call sites and Object::call_method.
+    std::vector<SymPtr> names;
+    for (auto name : {"to_s", "size", "each", "map", "include?", "empty?", "first", "upcase",
+        "keys", "fetch", "sort_by", "missing_method"})
+    {
+        names.push_back(symbol(name));
+    }
+    struct Type
+    {
+        const char *name;
+        ObjectPtr obj;
+    };
+    std::vector<Type> types = {
+        { "String", make_value("str") },
+        { "Array", make_array({}) },
+        { "Hash", create_object<Hash>() },
+        { "ViewModel", create_view_model() } };
+    for (auto &type : types)
+    {
+        bench::run(std::string("find 12 methods ") + type.name, [&]{
+            for (auto &name : names) bench::do_not_optimize(type.obj->find_method(name));
+        });
+    }
+}
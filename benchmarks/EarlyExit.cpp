@@ -0,0 +1,38 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include "Value.hpp"
+#include "types/Array.hpp"
+#include "types/ViewModel.hpp"
+#include <thread>
+
+using namespace slim;
+
+BENCHMARK(early_exit)
+{
+    // Enumerable methods that stop iterating once the result is known, with the match early on.
+    auto tpl = parse_template(
+        "- @items.each do |row|\n"
+        "  = row.any? { |x| x > 2 }\n"
+        "  = row.find { |x| x > 3 }\n"
+        "  = row.first(2).size\n"
+        "  = row.include?(4)\n"
+        "  = row.each_with_index.find_index { |x, i| i == 2 }\n");
+    tpl.set_exec_mode(Template::EXEC_TREE);
+    auto model = create_view_model();
+    std::vector<ObjectPtr> row, items;
+    for (int i = 0; i < 100; ++i) row.push_back(make_value((double)i));
+    for (int i = 0; i < 100; ++i) items.push_back(make_array(row));
+    model->set_attr("items", make_array(items));
+
+    for (unsigned threads : {1, 4})
+    {
+        bench::run("render 100 rows " + std::to_string(threads) + " threads", [&]{
+            std::vector<std::thread> workers;
+            for (unsigned i = 0; i < threads; ++i)
+            {
+                workers.emplace_back([&]{ bench::do_not_optimize(tpl.render(model)); });
+            }
+            for (auto &worker : workers) worker.join();
+        });
+    }
+}
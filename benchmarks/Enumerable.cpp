@@ -0,0 +1,59 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include "Value.hpp"
+#include "types/Array.hpp"
+#include "types/Hash.hpp"
+#include "types/Range.hpp"
+#include "types/ViewModel.hpp"
+
+using namespace slim;
+
+BENCHMARK(enumerable)
+{
+    // Enumerable methods over large Array, Hash and Range collections. $ is the block params.
+    const char *methods[][2] = {
+        { "map", "= @items.map { |$| x }.size" },
+        { "select", "= @items.select { |$| x }.size" },
+        { "count", "= @items.count { |$| x }" },
+        { "find_index", "= @items.find_index { |$| false }" },
+        { "reduce", "= @items.reduce(0) { |a, x| a }" },
+        { "group_by", "= @items.group_by { |$| 1 }.size" },
+        { "sort_by", "= @items.sort_by { |x| 1 }.size" },
+    };
+    for (size_t n : {10000, 100000, 1000000})
+    {
+        std::vector<ObjectPtr> values;
+        auto hash = create_object<Hash>();
+        for (size_t i = 0; i < n; ++i)
+        {
+            values.push_back(make_value((double)i));
+            hash->set(values.back(), values.back());
+        }
+        struct Collection
+        {
+            const char *name;
+            ObjectPtr obj;
+            const char *params;
+        };
+        Collection collections[] = {
+            { "Array", make_array(values), "x" },
+            { "Hash", hash, "x, v" },
+            { "Range", create_object<Range>(make_value(0.0), make_value((double)n - 1), false), "x" } };
+        for (auto &collection : collections)
+        {
+            auto model = create_view_model();
+            model->set_attr("items", collection.obj);
+            for (auto &method : methods)
+            {
+                std::string src = method[1];
+                auto param = src.find('$');
+                if (param != std::string::npos) src.replace(param, 1, collection.params);
+                auto tpl = parse_template(src);
+                tpl.set_exec_mode(Template::EXEC_TREE);
+                bench::run(std::string(method[0]) + " " + collection.name + " " + std::to_string(n), [&]{
+                    bench::do_not_optimize(tpl.render(model));
+                });
+            }
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#include "Benchmark.hpp"
+#include "FragmentCache.hpp"
+#include "Template.hpp"
+#include "types/Array.hpp"
+#include "types/ViewModel.hpp"
+#include "Value.hpp"
+
+using namespace slim;
+
+BENCHMARK(fragment_cache)
+{
+    // A large list that rarely changes, inside a page that is rendered for every request.
+    auto source =
+        "h1 = @title\n"
+        "- cache [:items, @version] do\n"
+        "  ul\n"
+        "    - @items.each do |item|\n"
+        "      li.item\n"
+        "        span.name = item\n"
+        "        span.len = item.size\n";
+    std::vector<ObjectPtr> items;
+    for (int i = 0; i < 200; ++i) items.push_back(make_value("item <" + std::to_string(i) + ">"));
+    auto model = create_view_model();
+    model->set_attr("title", make_value("Page"));
+    model->set_attr("version", make_value(1.0));
+    model->set_attr("items", make_array(items));
+    for (auto mode : {Template::EXEC_TREE, Template::EXEC_VM})
+    {
+        const char *mode_name = mode == Template::EXEC_VM ? " vm" : " tree";
+        auto tpl = parse_template(source);
+        tpl.set_exec_mode(mode);
+        bench::run(std::string("uncached") + mode_name, [&]{
+            bench::do_not_optimize(tpl.render(model, false));
+        });
+        tpl.set_fragment_store(std::make_shared<LruFragmentStore>());
+        bench::run(std::string("cached") + mode_name, [&]{
+            bench::do_not_optimize(tpl.render(model, false));
+        });
+    }
+}
@@ -0,0 +1,78 @@
+#include "Benchmark.hpp"
+#include "HtmlEscape.hpp"
+#include "Util.hpp"
+
+namespace
+{
+    /**The original byte at a time switch escaper, for comparison.*/
+    std::string switch_escape(const std::string &str)
+    {
+        std::string buf;
+        buf.reserve(str.size());
+        for (auto c : str)
+        {
+            switch (c)
+            {
+            case '&': buf += "&amp;"; break;
+            case '<': buf += "&lt;"; break;
+            case '>': buf += "&gt;"; break;
+            case '"': buf += "&quot;"; break;
+            case '\'': buf += "&#39;"; break;
+            default: buf += c; break;
+            }
+        }
+        return buf;
+    }
+
+    void run_escapers(const std::string &label, const std::string &input)
+    {
+        std::string out;
+        bench::run(label + " switch", [&]{
+            out += switch_escape(input);
+            bench::do_not_optimize(out);
+            out.clear();
+        }, input.size());
+        bench::run(label + " scalar", [&]{
+            slim::detail::html_escape_append_scalar(out, input.data(), input.size());
+            bench::do_not_optimize(out);
+            out.clear();
+        }, input.size());
+        if (auto f = slim::detail::html_escape_sse2())
+        {
+            bench::run(label + " sse2", [&]{
+                f(out, input.data(), input.size());
+                bench::do_not_optimize(out);
+                out.clear();
+            }, input.size());
+        }
+        if (auto f = slim::detail::html_escape_avx2())
+        {
+            bench::run(label + " avx2", [&]{
+                f(out, input.data(), input.size());
+                bench::do_not_optimize(out);
+                out.clear();
+            }, input.size());
+        }
+    }
+
+    std::string repeat(const std::string &str, size_t len)
+    {
+        std::string out;
+        while (out.size() < len) out += str;
+        out.resize(len);
+        return out;
+    }
+}
+
+BENCHMARK(html_escape)
+{
+    const std::string clean = "The quick brown fox jumps over the lazy dog. ";
+    const std::string dirty = "<a href=\"x\">Tom & Jerry's</a> ";
+    const std::string mixed = "Some ordinary text, then a <tag> & more. ";
+    for (size_t len : {32, 1024, 64 * 1024})
+    {
+        run_escapers("clean " + std::to_string(len), repeat(clean, len));
+        run_escapers("mixed " + std::to_string(len), repeat(mixed, len));
+        run_escapers("dirty " + std::to_string(len), repeat(dirty, len));
+    }
+}
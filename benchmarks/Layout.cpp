@@ -0,0 +1,42 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include "template/OutputSink.hpp"
+#include "types/ViewModel.hpp"
+#include "Value.hpp"
+
+using namespace slim;
+
+BENCHMARK(layout)
+{
+    // Large but cheap to render view content, so that the cost of the layout yielding it shows.
+    auto source =
+        "p.row = @text\n"
+        "= content_for :sidebar do\n"
+        "  li = @text\n";
+    auto layout_source =
+        "html\n"
+        "  head\n"
+        "    title Page\n"
+        "  body\n"
+        "    ul.sidebar = yield :sidebar\n"
+        "    main = yield\n";
+    auto model = create_view_model();
+    model->set_attr("text", make_value(std::string(256 * 1024, 't')));
+    for (auto mode : {Template::EXEC_TREE, Template::EXEC_VM})
+    {
+        const char *mode_name = mode == Template::EXEC_VM ? " vm" : " tree";
+        auto tpl = parse_template(source);
+        auto layout = parse_template(layout_source);
+        tpl.set_exec_mode(mode);
+        layout.set_exec_mode(mode);
+        bench::run(std::string("string") + mode_name, [&]{
+            bench::do_not_optimize(tpl.render_layout(layout, model));
+        });
+        size_t total = 0;
+        CallbackSink sink([&total](const char *, size_t len) { total += len; });
+        bench::run(std::string("sink") + mode_name, [&]{
+            tpl.render_layout(sink, layout, model);
+            bench::do_not_optimize(total);
+        });
+    }
+}
@@ -0,0 +1,30 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include "Value.hpp"
+#include "types/Array.hpp"
+#include "types/ViewModel.hpp"
+
+using namespace slim;
+
+BENCHMARK(lazy)
+{
+    // The first 20 matches of a large collection, eager and lazy, from a template loop.
+    const char *chains[][2] = {
+        { "eager", "- @items.select { |x| x % 7 == 0 }.map { |x| x * 2 }.first(20).each do |x|\n  = x\n" },
+        { "lazy", "- @items.lazy.select { |x| x % 7 == 0 }.map { |x| x * 2 }.take(20).each do |x|\n  = x\n" },
+    };
+    for (size_t n : {10000, 100000, 1000000})
+    {
+        std::vector<ObjectPtr> values;
+        for (size_t i = 0; i < n; ++i) values.push_back(make_value((double)i));
+        auto model = create_view_model();
+        model->set_attr("items", make_array(values));
+        for (auto &chain : chains)
+        {
+            auto tpl = parse_template(chain[1]);
+            bench::run(std::string(chain[0]) + " " + std::to_string(n), [&]{
+                bench::do_not_optimize(tpl.render(model, false));
+            });
+        }
+    }
+}
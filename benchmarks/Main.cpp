@@ -0,0 +1,65 @@
+#include "Benchmark.hpp"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace bench
+{
+    namespace
+    {
+        struct Entry
+        {
+            const char *name;
+            void(*func)();
+        };
+        std::vector<Entry> &registry()
+        {
+            static std::vector<Entry> entries;
+            return entries;
+        }
+    }
+
+    Registration::Registration(const char *name, void(*func)())
+    {
+        registry().push_back({name, func});
+    }
+
+    void run(const std::string &name, const std::function<void()> &func, size_t bytes)
+    {
+        typedef std::chrono::steady_clock Clock;
+        const auto min_time = std::chrono::milliseconds(250);
+        func(); //warm up
+        size_t iterations = 0;
+        size_t batch = 1;
+        auto start = Clock::now();
+        Clock::duration elapsed;
+        do
+        {
+            for (size_t i = 0; i < batch; ++i) func();
+            iterations += batch;
+            batch *= 2;
+            elapsed = Clock::now() - start;
+        }
+        while (elapsed < min_time);
+
+        auto ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (double)iterations;
+        if (bytes)
+        {
+            auto mb_per_sec = ((double)bytes / (1024.0 * 1024.0)) / (ns / 1e9);
+            std::printf("  %-40s %12.1f ns %10.1f MB/s\n", name.c_str(), ns, mb_per_sec);
+        }
+        else std::printf("  %-40s %12.1f ns\n", name.c_str(), ns);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string filter = argc > 1 ? argv[1] : "";
+    for (auto &entry : bench::registry())
+    {
+        if (!filter.empty() && std::string(entry.name).find(filter) == std::string::npos) continue;
+        std::printf("%s\n", entry.name);
+        entry.func();
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include "Benchmark.hpp"
+#include "MemoizingRenderer.hpp"
+#include "Template.hpp"
+#include "types/Array.hpp"
+#include "types/ViewModel.hpp"
+#include "Value.hpp"
+
+using namespace slim;
+
+BENCHMARK(memoize)
+{
+    // A page rendered repeatedly from the same data, with a few attributes that change.
+    auto source =
+        "h1 = @title\n"
+        "ul\n"
+        "  - @items.each do |item|\n"
+        "    li.item\n"
+        "      span.name = item\n"
+        "      span.len = item.size\n"
+        "p = @footer\n";
+    std::vector<ObjectPtr> items;
+    for (int i = 0; i < 200; ++i) items.push_back(make_value("item <" + std::to_string(i) + ">"));
+    std::vector<ViewModelPtr> models;
+    for (int i = 0; i < 4; ++i)
+    {
+        auto model = create_view_model();
+        model->set_attr("title", make_value("Page " + std::to_string(i)));
+        model->set_attr("items", make_array(items));
+        model->set_attr("footer", make_value("Footer"));
+        models.push_back(model);
+    }
+    for (auto mode : {Template::EXEC_TREE, Template::EXEC_VM})
+    {
+        const char *mode_name = mode == Template::EXEC_VM ? " vm" : " tree";
+        auto tpl = std::make_shared<Template>(parse_template(source));
+        tpl->set_exec_mode(mode);
+        MemoizingRenderer renderer(tpl);
+        size_t i = 0;
+        bench::run(std::string("render") + mode_name, [&]{
+            bench::do_not_optimize(tpl->render(models[i++ % models.size()], false));
+        });
+        bench::run(std::string("memoized") + mode_name, [&]{
+            bench::do_not_optimize(renderer.render(models[i++ % models.size()], false));
+        });
+    }
+}
@@ -0,0 +1,53 @@
+#include "Benchmark.hpp"
+#include "CachedMethod.hpp"
+#include "Template.hpp"
+#include "Value.hpp"
+#include "types/Array.hpp"
+#include "types/Hash.hpp"
+#include "types/ViewModel.hpp"
+#include <cstdio>
+#include <thread>
+
+using namespace slim;
+
+BENCHMARK(method_cache)
+{
+    // A call site that sees several types, which a single entry cache would miss on every call.
+    auto tpl = parse_template(
+        "- @items.each do |x|\n"
+        "  = x.to_s.size\n");
+    auto model = create_view_model();
+    std::vector<ObjectPtr> items;
+    for (int i = 0; i < 250; ++i)
+    {
+        items.push_back(make_value((double)i));
+        items.push_back(make_value("str"));
+        items.push_back(make_array({}));
+        items.push_back(NIL_VALUE);
+    }
+    model->set_attr("items", make_array(items));
+
+    auto to_s = symbol("to_s");
+    CachedMethod cache;
+    bench::run("get 1000 mixed types", [&]{
+        for (auto &item : items) bench::do_not_optimize(cache.get(item.get(), to_s));
+    });
+
+    for (auto mode : {Template::EXEC_VM, Template::EXEC_TREE})
+    {
+        tpl.set_exec_mode(mode);
+        std::string mode_name = mode == Template::EXEC_VM ? "vm" : "tree";
+        for (unsigned threads : {1, 4})
+        {
+            bench::run("mixed 1000 items " + mode_name + " " + std::to_string(threads) + " threads", [&]{
+                std::vector<std::thread> workers;
+                for (unsigned i = 0; i < threads; ++i)
+                {
+                    workers.emplace_back([&]{ bench::do_not_optimize(tpl.render(model)); });
+                }
+                for (auto &worker : workers) worker.join();
+            });
+        }
+    }
+    std::printf("%s", tpl.method_cache_stats().c_str());
+}
@@ -0,0 +1,77 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include "template/Lexer.hpp"
+#include "template/Parser.hpp"
+#include "types/ViewModel.hpp"
+#include "Value.hpp"
+
+using namespace slim;
+
+BENCHMARK(optimizer)
+{
+    // Constant output, attributes and conditions, as left by generated or edited templates.
+    std::string source;
+    for (int i = 0; i < 50; ++i)
+    {
+        source +=
+            "p = \"static <text>\"\n"
+            "a href=(\"/base/\" + \"page\") = 60 * 60\n"
+            "- if 1 > 2\n"
+            "  | never\n"
+            "- else\n"
+            "  span = \"#{2 * 4} items\"\n";
+    }
+    auto model = create_view_model();
+    for (bool optimize : {false, true})
+    {
+        tpl::Lexer lexer(source.c_str(), source.c_str() + source.size());
+        tpl::Parser parser(lexer);
+        parser.set_optimize(optimize);
+        auto tpl = parser.parse();
+        for (auto mode : {Template::EXEC_TREE, Template::EXEC_VM})
+        {
+            tpl.set_exec_mode(mode);
+            bench::run(std::string(optimize ? "optimized " : "parsed ") + (mode == Template::EXEC_VM ? "vm" : "tree"), [&]{
+                bench::do_not_optimize(tpl.render(model, false));
+            });
+        }
+    }
+}
+
+BENCHMARK(specialize)
+{
+    // Feature flags and site config registered as constants.
+    std::string source;
+    for (int i = 0; i < 50; ++i)
+    {
+        source +=
+            "- if NEW_HEADER && THEME == 'dark'\n"
+            "  header.dark = SITE_NAME\n"
+            "- elsif BETA\n"
+            "  header.beta = SITE_NAME\n"
+            "- else\n"
+            "  header = SITE_NAME\n"
+            "a href=\"#{BASE_URL}/page\" = @title\n";
+    }
+    auto model = create_view_model();
+    model->add_constant("NEW_HEADER", make_value(true));
+    model->add_constant("BETA", make_value(false));
+    model->add_constant("THEME", make_value("dark"));
+    model->add_constant("SITE_NAME", make_value("Example <Site>"));
+    model->add_constant("BASE_URL", make_value("https://example.com"));
+    model->set_attr("title", make_value("Title"));
+    auto tpl = parse_template(source);
+    auto specialized = specialize_template(tpl, model);
+    for (auto mode : {Template::EXEC_TREE, Template::EXEC_VM})
+    {
+        const char *mode_name = mode == Template::EXEC_VM ? " vm" : " tree";
+        tpl.set_exec_mode(mode);
+        specialized.set_exec_mode(mode);
+        bench::run(std::string("generic") + mode_name, [&]{
+            bench::do_not_optimize(tpl.render(model, false));
+        });
+        bench::run(std::string("specialized") + mode_name, [&]{
+            bench::do_not_optimize(specialized.render(model, false));
+        });
+    }
+}
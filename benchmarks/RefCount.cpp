@@ -0,0 +1,48 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include "Value.hpp"
+#include "types/Array.hpp"
+#include "types/ViewModel.hpp"
+
+using namespace slim;
+
+namespace
+{
+    /**Copies and releases references to obj, as passing arguments does.*/
+    void copy_refs(const ObjectPtr &obj)
+    {
+        FunctionArgs args;
+        args.reserve(100);
+        for (int i = 0; i < 100; ++i) args.push_back(obj);
+        bench::do_not_optimize(args);
+    }
+}
+
+BENCHMARK(ref_count)
+{
+    auto shared = make_value("shared");
+    bench::run("copy 100 refs atomic", [&]{ copy_refs(shared); });
+    {
+        RenderArena::Scope arena;
+        auto local = make_value("local");
+        bench::run("copy 100 refs local", [&]{ copy_refs(local); });
+    }
+
+    // MemberFuncCall::eval and Enumerable::map, where the values created by the render use
+    // plain counts when the render arena is enabled.
+    auto tpl = parse_template(
+        "- @items.map { |x| x.abs.to_s }.each do |s|\n"
+        "  = s.size\n");
+    tpl.set_exec_mode(Template::EXEC_TREE);
+    auto model = create_view_model();
+    std::vector<ObjectPtr> items;
+    for (int i = 0; i < 1000; ++i) items.push_back(make_value((double)-i));
+    model->set_attr("items", make_array(items));
+    for (bool arena : {false, true})
+    {
+        tpl.set_render_arena(arena);
+        bench::run(std::string("map 1000 items tree ") + (arena ? "local" : "atomic"), [&]{
+            bench::do_not_optimize(tpl.render(model));
+        });
+    }
+}
@@ -0,0 +1,138 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include "Value.hpp"
+#include "types/Array.hpp"
+#include "types/Hash.hpp"
+#include "types/ViewModel.hpp"
+#include <algorithm>
+#include <thread>
+
+using namespace slim;
+
+namespace
+{
+    const char *PAGE_TEMPLATE =
+        "html\n"
+        "  head\n"
+        "    title = @title\n"
+        "  body\n"
+        "    h1.title = @title\n"
+        "    - if @items.empty?\n"
+        "      p No items\n"
+        "    - else\n"
+        "      table\n"
+        "        - @items.each do |item|\n"
+        "          tr class=(item[:price] > 50 ? 'expensive' : 'cheap')\n"
+        "            td = item[:id]\n"
+        "            td = item[:name]\n"
+        "            td = item[:price] * 2\n"
+        "            td\n"
+        "              - item[:tags].each do |tag|\n"
+        "                span.tag = tag.upcase\n"
+        "    p Total #{@items.size} items\n";
+
+    ViewModelPtr create_model(size_t count)
+    {
+        std::vector<ObjectPtr> items;
+        for (size_t i = 0; i < count; ++i)
+        {
+            items.push_back(make_hash({
+                symbol("id"), make_value((double)i),
+                symbol("name"), make_value("Item <" + std::to_string(i) + ">"),
+                symbol("price"), make_value((double)(i % 100)),
+                symbol("tags"), make_array({make_value("a"), make_value("b & c")})
+            }));
+        }
+        auto model = create_view_model();
+        model->set_attr("title", make_value("Benchmark"));
+        model->set_attr("items", make_array(std::move(items)));
+        return model;
+    }
+}
+
+BENCHMARK(render)
+{
+    auto tpl = parse_template(PAGE_TEMPLATE);
+    for (size_t count : {10, 1000})
+    {
+        auto model = create_model(count);
+        auto size = tpl.render(model).size();
+        tpl.set_exec_mode(Template::EXEC_TREE);
+        bench::run("render " + std::to_string(count) + " items tree", [&]{
+            bench::do_not_optimize(tpl.render(model));
+        }, size);
+        tpl.set_exec_mode(Template::EXEC_VM);
+        bench::run("render " + std::to_string(count) + " items vm", [&]{
+            bench::do_not_optimize(tpl.render(model));
+        }, size);
+        tpl.set_render_arena(true);
+        bench::run("render " + std::to_string(count) + " items vm arena", [&]{
+            bench::do_not_optimize(tpl.render(model));
+        }, size);
+        tpl.set_render_arena(false);
+    }
+}
+
+BENCHMARK(render_numeric)
+{
+    auto tpl = parse_template(
+        "- (1..@count).each do |i|\n"
+        "  - if i % 3 == 0 && i > 10\n"
+        "    p = i * 2 + @offset / 4\n");
+    auto model = create_view_model();
+    model->set_attr("count", make_value(1000.0));
+    model->set_attr("offset", make_value(10.0));
+    auto size = tpl.render(model).size();
+    tpl.set_exec_mode(Template::EXEC_TREE);
+    bench::run("render numeric 1000 tree", [&]{
+        bench::do_not_optimize(tpl.render(model));
+    }, size);
+    tpl.set_exec_mode(Template::EXEC_VM);
+    bench::run("render numeric 1000 vm", [&]{
+        bench::do_not_optimize(tpl.render(model));
+    }, size);
+}
+
+BENCHMARK(render_threads)
+{
+    auto tpl = parse_template(PAGE_TEMPLATE);
+    auto threads = std::max(2U, std::thread::hardware_concurrency());
+    auto model = create_model(1000);
+    auto size = tpl.render(model).size() * threads;
+    for (bool arena : {false, true})
+    {
+        tpl.set_render_arena(arena);
+        bench::run("render 1000 items " + std::to_string(threads) + " threads" + (arena ? " arena" : ""), [&]{
+            std::vector<std::thread> workers;
+            for (unsigned i = 0; i < threads; ++i)
+            {
+                workers.emplace_back([&]{ bench::do_not_optimize(tpl.render(model)); });
+            }
+            for (auto &worker : workers) worker.join();
+        }, size);
+    }
+}
+
+BENCHMARK(render_scaling)
+{
+    // Many small renders, where per render costs such as creating the root scope are a larger
+    // share of the time. Each thread renders the same template and model.
+    const unsigned RENDERS = 64;
+    auto tpl = parse_template(PAGE_TEMPLATE);
+    auto model = create_model(10);
+    auto size = tpl.render(model).size() * RENDERS;
+    for (unsigned threads : {1, 2, 4, 8, 16, 64})
+    {
+        bench::run("render 10 items x" + std::to_string(RENDERS) + " " + std::to_string(threads) + " threads", [&]{
+            std::vector<std::thread> workers;
+            for (unsigned i = 0; i < threads; ++i)
+            {
+                workers.emplace_back([&]{
+                    for (unsigned j = 0; j < RENDERS / threads; ++j)
+                        bench::do_not_optimize(tpl.render(model));
+                });
+            }
+            for (auto &worker : workers) worker.join();
+        }, size);
+    }
+}
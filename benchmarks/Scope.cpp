@@ -0,0 +1,24 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include "Value.hpp"
+#include "types/Array.hpp"
+#include "types/ViewModel.hpp"
+
+using namespace slim;
+
+BENCHMARK(block_scope)
+{
+    // Block calls create a Scope each, and read variables from the block and enclosing scopes.
+    auto tpl = parse_template(
+        "ruby: base = 10\n"
+        "ruby: scale = 3\n"
+        "- @items.each do |x|\n"
+        "  ruby: y = x * scale\n"
+        "  = [x, y].map { |v| v + base + x + y }.size\n");
+    tpl.set_exec_mode(Template::EXEC_TREE);
+    auto model = create_view_model();
+    std::vector<ObjectPtr> items;
+    for (int i = 0; i < 1000; ++i) items.push_back(make_value((double)i));
+    model->set_attr("items", make_array(items));
+    bench::run("each 1000 items tree", [&]{ bench::do_not_optimize(tpl.render(model)); });
+}
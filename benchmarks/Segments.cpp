@@ -0,0 +1,43 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include "template/OutputSink.hpp"
+#include "template/SegmentedOutput.hpp"
+#include "types/ViewModel.hpp"
+#include "Value.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace slim;
+
+BENCHMARK(segments)
+{
+    // A mostly static page, with a few dynamic values between large blocks of text.
+    std::string source;
+    for (int i = 0; i < 50; ++i)
+    {
+        source += "section\n";
+        source += "  h2 = @title\n";
+        source += "  p " + std::string(1000, 'x') + "\n";
+    }
+    auto model = create_view_model();
+    model->set_attr("title", make_value("Title"));
+    int fd = ::open("/dev/null", O_WRONLY);
+    for (auto mode : {Template::EXEC_TREE, Template::EXEC_VM})
+    {
+        const char *mode_name = mode == Template::EXEC_VM ? " vm" : " tree";
+        auto tpl = parse_template(source);
+        tpl.set_exec_mode(mode);
+        FdSink sink(fd);
+        bench::run(std::string("string write") + mode_name, [&]{
+            auto html = tpl.render(model);
+            sink.write(html.data(), html.size());
+        });
+        bench::run(std::string("fd sink") + mode_name, [&]{
+            tpl.render(sink, model);
+        });
+        bench::run(std::string("render_segments") + mode_name, [&]{
+            tpl.render_segments(model).write(sink);
+        });
+    }
+    ::close(fd);
+}
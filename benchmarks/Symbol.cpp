@@ -0,0 +1,34 @@
+#include "Benchmark.hpp"
+#include "types/Symbol.hpp"
+#include <thread>
+
+using namespace slim;
+
+BENCHMARK(symbol_intern)
+{
+    // Mostly a few hot names, as method tables and templates use, with some rarely used ones.
+    const size_t LOOKUPS = 65536;
+    std::vector<std::string> hot, cold;
+    for (int i = 0; i < 16; ++i) hot.push_back("hot_symbol_" + std::to_string(i));
+    for (int i = 0; i < 4096; ++i) cold.push_back("cold_symbol_" + std::to_string(i));
+    std::vector<const std::string*> names;
+    for (size_t i = 0; i < 4096; ++i)
+    {
+        names.push_back(i % 8 == 0 ? &cold[(i * 7919) % cold.size()] : &hot[i % hot.size()]);
+    }
+    for (auto &name : cold) symbol(name);
+
+    for (unsigned threads : {1, 2, 4, 8})
+    {
+        bench::run("intern " + std::to_string(LOOKUPS) + " " + std::to_string(threads) + " threads", [&]{
+            std::vector<std::thread> workers;
+            for (unsigned i = 0; i < threads; ++i)
+            {
+                workers.emplace_back([&]{
+                    for (size_t j = 0; j < LOOKUPS / threads; ++j) bench::do_not_optimize(symbol(*names[j % names.size()]));
+                });
+            }
+            for (auto &worker : workers) worker.join();
+        });
+    }
+}
@@ -0,0 +1,32 @@
+#include "Benchmark.hpp"
+#include "Template.hpp"
+#include "Value.hpp"
+#include "types/Array.hpp"
+#include "types/HtmlSafeString.hpp"
+#include "types/ViewModel.hpp"
+
+using namespace slim;
+
+BENCHMARK(type_check)
+{
+    std::vector<ObjectPtr> values = {
+        make_value(1.0), make_value("str"), create_object<HtmlSafeString>("safe"), make_array({}) };
+    bench::run("dynamic_cast String 1000", [&]{
+        for (int i = 0; i < 1000; ++i) bench::do_not_optimize(dynamic_cast<String*>(values[i % 4].get()));
+    });
+    bench::run("object_cast String 1000", [&]{
+        for (int i = 0; i < 1000; ++i) bench::do_not_optimize(object_cast<String>(values[i % 4].get()));
+    });
+
+    // Method calls that unpack Number and String arguments, and escaped output of strings.
+    auto tpl = parse_template(
+        "- @items.each do |x|\n"
+        "  p = x.to_s.rjust(6, '0').center(10, '*').sub('0', 'o').include?('1')\n"
+        "  p = x.to_s.ljust(4, ' ') + x.round(1).to_s\n");
+    tpl.set_exec_mode(Template::EXEC_TREE);
+    auto model = create_view_model();
+    std::vector<ObjectPtr> items;
+    for (int i = 0; i < 1000; ++i) items.push_back(make_value((double)i));
+    model->set_attr("items", make_array(items));
+    bench::run("string methods 1000 items tree", [&]{ bench::do_not_optimize(tpl.render(model)); });
+}
@@ -8,7 +8,7 @@ class Vector2 : public slim::Object
 public:
     //Constructors
     Vector2(double x, double y) : x(x), y(y) {}
-    static std::shared_ptr<Vector2> new_instance(slim::Number *x, slim::Number *y)
+    static slim::Ptr<Vector2> new_instance(slim::Number *x, slim::Number *y)
     {
         return slim::create_object<Vector2>(x->get_value(), y->get_value());
     }
@@ -43,7 +43,7 @@ public:
         auto rhs2 = slim::coerce<Vector2>(rhs);
         return slim::create_object<Vector2>(x - rhs2->x, y - rhs2->y);
     }
-    std::shared_ptr<slim::Number> dot(Vector2 *rhs)
+    slim::Ptr<slim::Number> dot(Vector2 *rhs)
     {
         return slim::make_value(x * rhs->x + y * rhs->y);
     }
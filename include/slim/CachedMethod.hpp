@@ -1,84 +1,122 @@
 #pragma once
 #include "Function.hpp"
+#include <atomic>
+#include <cstddef>
 #include <typeinfo>
-#include <cassert>
-#ifdef _WIN32
-    #include <intrin.h>
-#endif
 
 namespace slim
 {
-    /**Caches the result of find_method for the most recent type to avoid method lookups where possible.
+    /**Polymorphic inline cache of find_method results for a call site, to avoid method lookups
+     * where possible.
+     *
+     * Holds up to ENTRIES types. Each entry is filled once and never replaced, so lookups only
+     * read the cache, and call sites that see a few types (such as "to_s" over a mixed Array) do
+     * not evict each other. Once full, other types are looked up every call (megamorphic).
+     *
+     * Misses and megamorphic lookups are always counted. Hits are only counted while
+     * set_count_hits is enabled, so the common path does not write to shared memory.
+     *
      * Thread safe.
      */
     class CachedMethod
     {
     public:
-        const Method *get(Object *obj, const SymPtr &name)
-        {
-            assert(((size_t)(&data) % (sizeof(void*)*2)) == 0);
-            auto cached = atomic_read();
-            // Check
-            auto obj_type = &typeid(*obj);
-            if (obj_type == cached.type)
-                return cached.method;
-            // Update
-            auto method = obj->get_method(name);
-            atomic_write({ method, obj_type });
+        static const size_t ENTRIES = 4;
 
-            return method;
-        }
-    private:
-        #if defined(_WIN32)
-            __declspec(align(sizeof(void*) * 2))
-        #else
-            __attribute__((aligned(sizeof(void*) * 2)))
-        #endif
-        struct Data
+        /**Counters for a call site, see stats.*/
+        struct Stats
         {
-            const Method *method;
-            const std::type_info *type;
+            /**Calls that found the type in the cache, if counted, see set_count_hits.*/
+            size_t hits;
+            /**Calls that added a type to the cache.*/
+            size_t misses;
+            /**Calls that found the cache full, and looked up the method.*/
+            size_t megamorphic;
+            /**Number of types in the cache.*/
+            size_t types;
         };
-        Data data = { nullptr, nullptr };
-        #if defined _WIN64
-        Data atomic_read()
+
+        CachedMethod()
         {
-            // Out always contains the value of data (note, docs for InterlockedCompareExchange128 appear to be wrong)
-            Data out;
-            _InterlockedCompareExchange128((intptr_t*)&data, 0, 0, (intptr_t*)&out);
-            return out;
+            for (auto &entry : entries)
+            {
+                entry.type.store(nullptr, std::memory_order_relaxed);
+                entry.method.store(nullptr, std::memory_order_relaxed);
+            }
         }
-        void atomic_write(const Data &value)
+        CachedMethod(const CachedMethod&) = delete;
+        CachedMethod& operator = (const CachedMethod&) = delete;
+
+        const Method *get(Object *obj, const SymPtr &name)
         {
-            // There is a chance the compare fails and the result is not written, just let the other thread win
-            auto cached = data;
-            _InterlockedCompareExchange128((intptr_t*)&data, (intptr_t)value.type, (intptr_t)value.method, (intptr_t*)&cached);
+            auto obj_type = &typeid(*obj);
+            for (auto &entry : entries)
+            {
+                auto type = entry.type.load(std::memory_order_acquire);
+                if (type == obj_type)
+                {
+                    if (count_hits_enabled()) hits.fetch_add(1, std::memory_order_relaxed);
+                    return entry.method.load(std::memory_order_relaxed);
+                }
+                if (!type) break; // Entries are filled in order
+            }
+            return fill(obj, obj_type, name);
         }
-        #elif defined _WIN32
-        Data atomic_read()
+
+        Stats stats()const
         {
-            auto ret = _InterlockedCompareExchange64((long long*)&data, 0, 0);
-            return *(Data*)&ret;
+            Stats ret;
+            ret.hits = hits.load(std::memory_order_relaxed);
+            ret.misses = misses.load(std::memory_order_relaxed);
+            ret.megamorphic = megamorphic.load(std::memory_order_relaxed);
+            ret.types = 0;
+            for (auto &entry : entries)
+            {
+                auto type = entry.type.load(std::memory_order_relaxed);
+                if (type && type != claimed()) ++ret.types;
+            }
+            return ret;
         }
-        void atomic_write(const Data &value)
+
+        /**Enable counting cache hits for all call sites. Default false.*/
+        static void set_count_hits(bool enable) { count_hits().store(enable, std::memory_order_relaxed); }
+        static bool count_hits_enabled() { return count_hits().load(std::memory_order_relaxed); }
+    private:
+        struct Entry
         {
-            _InterlockedCompareExchange64((long long*)&data, *(const long long*)&value, *(long long*)&data);
-        }
-        #else
-            #if __x86_64__
-                typedef __int128_t AtomicValue;
-            #else
-                typedef long long AtomicValue;
-            #endif
-        Data atomic_read()
+            std::atomic<const std::type_info*> type;
+            /**Written before type is published.*/
+            std::atomic<const Method*> method;
+        };
+        Entry entries[ENTRIES];
+        std::atomic<size_t> hits{0}, misses{0}, megamorphic{0};
+
+        /**Marks an entry being filled by another thread. No script object has this type.*/
+        static const std::type_info *claimed() { return &typeid(void); }
+        static std::atomic<bool> &count_hits()
         {
-            auto ret = __sync_val_compare_and_swap((AtomicValue*)&data, 0, 0);
-            return *(Data*)&ret;
+            static std::atomic<bool> enabled{false};
+            return enabled;
         }
-        void atomic_write(const Data &value)
+
+        const Method *fill(Object *obj, const std::type_info *obj_type, const SymPtr &name)
         {
-            __sync_val_compare_and_swap((AtomicValue*)&data, *(AtomicValue*)&data, *(const AtomicValue*)&value);
+            auto method = obj->get_method(name);
+            for (auto &entry : entries)
+            {
+                const std::type_info *expected = nullptr;
+                if (entry.type.compare_exchange_strong(expected, claimed(), std::memory_order_relaxed))
+                {
+                    entry.method.store(method, std::memory_order_relaxed);
+                    entry.type.store(obj_type, std::memory_order_release);
+                    misses.fetch_add(1, std::memory_order_relaxed);
+                    return method;
+                }
+                // Another thread may have just added this type
+                if (expected == obj_type) return method;
+            }
+            megamorphic.fetch_add(1, std::memory_order_relaxed);
+            return method;
         }
-        #endif
     };
 }
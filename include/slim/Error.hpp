@@ -1,4 +1,5 @@
 #pragma once
+#include "Ptr.hpp"
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -6,44 +7,11 @@ namespace slim
 {
     class Object;
     class Symbol;
-    typedef std::shared_ptr<Object> ObjectPtr;
-    typedef std::shared_ptr<Symbol> SymPtr;
+    typedef Ptr<Object> ObjectPtr;
+    typedef Ptr<Symbol> SymPtr;
 
-    /**These need to return "through" other C++ functions and is not a control flow C++ has
-     * directly (or C, MRI appears to use thread locals and longjmp for these features).
-     *
-     * The other option would be along the lines of passing a context to every method, and then
-     * checking it after every return to see if things like "break" or "return" were invoked by
-     * a block within it.
-     */
-    class ControlFlowException : public std::exception
-    {
-    };
-    //TODO: "break" script keyword is not fully implemented yet
-    /**Used to implement the Ruby "break" statement without passing a context param
-     * through every AST node.
-     */
-    class BreakException : public ControlFlowException
-    {
-    public:
-        ObjectPtr value;
-
-        BreakException();
-        BreakException(ObjectPtr value);
-    };
-    /**Used for "break" and "return" like constructs within pure C++ enumeration code.
-     * Such as in Enumerable.
-     * This is useful because such C++ methods dont set up the same context as blocks do
-     * in regards to what "break" and "return" will exit.
-     */
-    class SpecialFlowException : public ControlFlowException
-    {
-    public:
-        ObjectPtr value;
-
-        SpecialFlowException();
-        SpecialFlowException(ObjectPtr value);
-    };
+    //TODO: "break" script keyword is not implemented yet. It can use Proc::stop, as early exits
+    //from iteration in Enumerable do, rather than an exception.
 
     /**Base type for all exceptions.*/
     class Error : public std::runtime_error
@@ -0,0 +1,144 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace slim
+{
+    /**@brief Storage for the output of template "- cache key do" blocks.
+     *
+     * Renders use the store of the FragmentStore::Scope active on their thread. Template sets one
+     * for each render, see Template::set_fragment_store. Without a store, cache blocks are
+     * always rendered.
+     *
+     * Implementations must be thread safe.
+     */
+    class FragmentStore
+    {
+    public:
+        /**Makes store the store for this thread, until destroyed.*/
+        class Scope
+        {
+        public:
+            /**@param store If null, does nothing.*/
+            explicit Scope(FragmentStore *store) : prev(current_store)
+            {
+                if (store) current_store = store;
+            }
+            ~Scope() { current_store = prev; }
+            Scope(const Scope&) = delete;
+            Scope& operator = (const Scope&) = delete;
+        private:
+            FragmentStore *prev;
+        };
+
+        virtual ~FragmentStore() {}
+
+        /**The store for the render in progress on this thread, or null.*/
+        static FragmentStore *current() { return current_store; }
+
+        /**Gets a stored fragment.
+         * @return False if there is no fragment for key, or it expired.
+         */
+        virtual bool get(const std::string &key, std::string *fragment) = 0;
+        /**Stores a fragment, replacing any existing fragment for key.*/
+        virtual void put(const std::string &key, const std::string &fragment) = 0;
+    private:
+        static thread_local FragmentStore *current_store;
+    };
+
+    /**@brief In memory FragmentStore, removing the least recently used fragments.
+     *
+     * Keys are split between a number of shards, each with its own lock and an equal share of
+     * Options::max_bytes, so renders on different threads rarely wait for each other.
+     *
+     * Hits and misses are counted for each key, to see which fragments are worth caching.
+     */
+    class LruFragmentStore : public FragmentStore
+    {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Options
+        {
+            /**Maximum total size of the stored keys and fragments.*/
+            size_t max_bytes = 64 * 1024 * 1024;
+            /**How long a fragment is used for after being stored. Zero never expires.*/
+            Clock::duration ttl = Clock::duration::zero();
+            size_t shards = 16;
+            /**Maximum number of keys to keep hit and miss counts for. Further keys are only
+             * included in the totals.
+             */
+            size_t max_key_stats = 4096;
+        };
+        struct Stats
+        {
+            uint64_t hits;
+            /**Number of get calls without a fragment, including expired fragments.*/
+            uint64_t misses;
+            /**Number of fragments removed to stay within Options::max_bytes.*/
+            uint64_t evictions;
+            /**Number of fragments found to be older than Options::ttl.*/
+            uint64_t expirations;
+            size_t entries;
+            size_t bytes;
+        };
+        struct KeyStats
+        {
+            std::string key;
+            uint64_t hits;
+            uint64_t misses;
+        };
+
+        LruFragmentStore();
+        explicit LruFragmentStore(const Options &options);
+        LruFragmentStore(const LruFragmentStore&) = delete;
+        LruFragmentStore& operator = (const LruFragmentStore&) = delete;
+
+        virtual bool get(const std::string &key, std::string *fragment)override;
+        virtual void put(const std::string &key, const std::string &fragment)override;
+
+        Stats stats()const;
+        /**Hit and miss counts for each key, most hits first.*/
+        std::vector<KeyStats> key_stats()const;
+        /**Removes all fragments. Statistics are kept.*/
+        void clear();
+    private:
+        struct Entry
+        {
+            std::string key;
+            std::string fragment;
+            Clock::time_point expires;
+        };
+        typedef std::list<Entry> Lru;
+        struct Counts
+        {
+            uint64_t hits;
+            uint64_t misses;
+        };
+        struct Shard
+        {
+            mutable std::mutex lock;
+            /**Most recently used first.*/
+            Lru lru;
+            std::unordered_map<std::string, Lru::iterator> entries;
+            std::unordered_map<std::string, Counts> counts;
+            size_t bytes = 0;
+            uint64_t hits = 0, misses = 0, evictions = 0, expirations = 0;
+        };
+
+        Options options;
+        size_t shard_bytes;
+        std::unique_ptr<Shard[]> shards;
+
+        Shard &shard(const std::string &key);
+        void count(Shard &shard, const std::string &key, bool hit);
+        void remove(Shard &shard, Lru::iterator entry);
+        static size_t entry_size(const Entry &entry);
+    };
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <functional>
 #include <vector>
 #include <unordered_map>
@@ -304,14 +305,21 @@ namespace slim
         SymPtr _name;
     };
 
-    /**The table of named methods for a type.*/
+    /**The table of named methods for a type.
+     *
+     * Methods are kept sorted by Symbol::id, with the ids in their own array, so find is a
+     * binary search over a small contiguous array without any virtual hash or equality calls.
+     * Tables are built once during static initialisation, so adding methods is not optimised.
+     *
+     * A table can not be changed once built, as CachedMethod keeps pointers to its methods.
+     * Methods are only given to the constructors, or to add_all while building a temporary
+     * table, e.g. "static const MethodTable table = MethodTable(base).add_all({...});".
+     */
     class MethodTable
     {
     public:
-        typedef std::unordered_map<SymPtr, Method, ObjHash, ObjEquals> Map;
-
         /**Constructs an empty method table.*/
-        MethodTable() : map() {}
+        MethodTable() : ids(), methods() {}
 
         /**Constructs a method table using the methods in the initializer_list.*/
         MethodTable(std::initializer_list<Method> methods)
@@ -322,36 +330,52 @@ namespace slim
          * Useful when extending types.
          */
         MethodTable(const MethodTable &table, std::initializer_list<Method> methods)
-            : map(table.map)
+            : ids(table.ids), methods(table.methods)
         {
             for (auto &f : methods) add(f);
         }
 
-        /**Adds a method to the table. Overrwrites any existing method with that name.*/
-        MethodTable& add(const Method &func)
-        {
-            map[func.name()] = func;
-            return *this;
-        }
-        /**Adds a list of methods using add.*/
+        /**Adds a list of methods to a table being built. Overwrites any existing methods with
+         * the same names. Only available on temporaries, see the class description.
+         */
         template<class T>
-        MethodTable& add_all(const T &container)
+        MethodTable&& add_all(const T &container)&&
         {
             for (const Method &method : container) add(method);
-            return *this;
+            return std::move(*this);
         }
-        MethodTable& add_all(std::initializer_list<Method> methods)
+        MethodTable&& add_all(std::initializer_list<Method> methods)&&
         {
             for (auto &f : methods) add(f);
-            return *this;
+            return std::move(*this);
         }
         /**Find a method. Returns nullptr if the method is not found.*/
-        const Method *find(SymPtr name)const
+        const Method *find(const SymPtr &name)const
         {
-            auto it = map.find(name);
-            return it != map.end() ? &it->second : nullptr;
+            auto id = name->id();
+            auto it = std::lower_bound(ids.begin(), ids.end(), id);
+            return it != ids.end() && *it == id ? &methods[it - ids.begin()] : nullptr;
         }
+        /**Number of methods.*/
+        size_t size()const { return ids.size(); }
     private:
-        Map map;
+        /**Sorted Symbol::id of each method name.*/
+        std::vector<uint32_t> ids;
+        /**Methods in the same order as ids.*/
+        std::vector<Method> methods;
+
+        /**Adds a method to the table. Overwrites any existing method with that name.*/
+        void add(const Method &func)
+        {
+            auto id = func.name()->id();
+            auto it = std::lower_bound(ids.begin(), ids.end(), id);
+            auto i = it - ids.begin();
+            if (it != ids.end() && *it == id) methods[i] = func;
+            else
+            {
+                ids.insert(it, id);
+                methods.insert(methods.begin() + i, func);
+            }
+        }
     };
 }
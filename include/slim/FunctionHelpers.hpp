@@ -11,7 +11,7 @@ namespace slim
     {
         template<class T> bool try_unpack_arg_number(const ObjectPtr &arg, T *out)
         {
-            auto n = dynamic_cast<Number*>(arg.get());
+            auto n = object_cast<Number>(arg.get());
             if (n)
             {
                 *out = (T)n->get_value();
@@ -23,7 +23,7 @@ namespace slim
     /**Sets out if arg is a String instance.*/
     inline bool try_unpack_arg(const ObjectPtr &arg, std::string *out)
     {
-        auto str = dynamic_cast<String*>(arg.get());
+        auto str = object_cast<String>(arg.get());
         if (str)
         {
             *out = str->get_value();
@@ -69,7 +69,7 @@ namespace slim
     /**Sets out if arg is a Boolean instance.*/
     inline bool try_unpack_arg(const ObjectPtr &arg, bool *out)
     {
-        auto n = dynamic_cast<Boolean*>(arg.get());
+        auto n = object_cast<Boolean>(arg.get());
         if (n)
         {
             *out = n->is_true();
@@ -82,7 +82,7 @@ namespace slim
     template<class T>
     bool try_unpack_arg(const ObjectPtr &arg, T **out)
     {
-        auto ptr = dynamic_cast<T*>(arg.get());
+        auto ptr = object_cast<T>(arg.get());
         if (ptr)
         {
             *out = ptr;
@@ -93,9 +93,9 @@ namespace slim
 
     /**Sets out if arg is an instance of the same type.*/
     template<class T>
-    bool try_unpack_arg(const ObjectPtr &arg, std::shared_ptr<T> *out)
+    bool try_unpack_arg(const ObjectPtr &arg, Ptr<T> *out)
     {
-        auto ptr = std::dynamic_pointer_cast<T>(arg);
+        auto ptr = object_pointer_cast<T>(arg);
         if (ptr)
         {
             *out = std::move(ptr);
@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+
+namespace slim
+{
+    /**The individual html_escape_append implementations.
+     * html_escape_append selects the best supported by the CPU the first time it is called, these
+     * are exposed for testing and benchmarking.
+     */
+    namespace detail
+    {
+        typedef void(*HtmlEscapeFunc)(std::string &out, const char *str, size_t len);
+
+        /**Portable byte at a time implementation.*/
+        void html_escape_append_scalar(std::string &out, const char *str, size_t len);
+        /**Implementation checking 16 bytes at a time, or null if not supported.*/
+        HtmlEscapeFunc html_escape_sse2();
+        /**Implementation checking 32 bytes at a time, or null if not supported.*/
+        HtmlEscapeFunc html_escape_avx2();
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "RenderDependencies.hpp"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace slim
+{
+    class Template;
+    class ViewModel;
+    typedef Ptr<ViewModel> ViewModelPtr;
+
+    /**@brief Renders a template, reusing the output of a previous render with the same inputs.
+     *
+     * Each render records its inputs with RenderDependencies. The output is cached, keyed on the
+     * fingerprints of those inputs. A later render whose model gives the same values for the
+     * same inputs returns the cached output, without rendering. Renders that call an impure
+     * helper, or read a value that can not be fingerprinted (e.g. a custom object), are not
+     * cached.
+     *
+     * Cached outputs are removed least recently used first, to keep within Options::max_bytes.
+     *
+     * All methods are thread safe. The model's inputs are read and fingerprinted without holding
+     * the cache lock, so concurrent renders only wait for each other to look up and store outputs.
+     */
+    class MemoizingRenderer
+    {
+    public:
+        typedef std::shared_ptr<const Template> TemplatePtr;
+
+        struct Options
+        {
+            /**Maximum total size of the cached outputs, their keys, and the recorded inputs.*/
+            size_t max_bytes = 16 * 1024 * 1024;
+            /**Names of view model methods whose result does not only depend on their arguments
+             * and the model's attributes and constants. A render that calls one is not cached.
+             */
+            std::vector<std::string> impure_helpers;
+        };
+        struct Stats
+        {
+            /**Number of renders that used a cached output.*/
+            uint64_t hits;
+            /**Number of renders that rendered the template.*/
+            uint64_t misses;
+            /**Number of misses that could not be cached.*/
+            uint64_t uncacheable;
+            /**Number of cached outputs removed to stay within Options::max_bytes.*/
+            uint64_t evictions;
+            size_t entries;
+            size_t bytes;
+        };
+
+        explicit MemoizingRenderer(TemplatePtr tpl);
+        MemoizingRenderer(TemplatePtr tpl, const Options &options);
+        MemoizingRenderer(const MemoizingRenderer&) = delete;
+        MemoizingRenderer& operator = (const MemoizingRenderer&) = delete;
+
+        /**Same as Template::render.*/
+        std::string render(ViewModelPtr model, bool doctype = true);
+
+        Stats stats()const;
+        /**Removes all cached outputs.*/
+        void clear();
+    private:
+        typedef std::vector<RenderDependencies::Dependency> Dependencies;
+        struct Shape;
+        struct Entry
+        {
+            Shape *shape;
+            std::string values;
+            std::shared_ptr<const std::string> output;
+        };
+        typedef std::list<Entry> Lru;
+        /**A sequence of inputs read by a render, and the cached outputs for their values.*/
+        struct Shape
+        {
+            std::string signature;
+            std::shared_ptr<const Dependencies> deps;
+            std::unordered_map<std::string, Lru::iterator> entries;
+        };
+        /**The signature and inputs of each shape. Replaced rather than modified, so that a render
+         * can read the model's inputs from a copy of the pointer without holding the lock.
+         */
+        typedef std::vector<std::pair<std::string, std::shared_ptr<const Dependencies>>> ShapeList;
+
+        TemplatePtr tpl;
+        Options options;
+        std::unordered_set<std::string> impure;
+        mutable std::mutex lock;
+        /**By signature.*/
+        std::unordered_map<std::string, Shape> shapes;
+        std::shared_ptr<const ShapeList> shape_list;
+        /**Most recently used first.*/
+        Lru lru;
+        size_t bytes;
+        uint64_t hits, misses, uncacheable, evictions;
+
+        /**Fingerprints the model's values for the inputs of each shape that it can provide.
+         * @return Pairs of signature and fingerprints to look up with find.
+         */
+        static std::vector<std::pair<const std::string*, std::string>> fingerprints(
+            const ShapeList &shapes, ViewModel *model);
+        /**Finds a cached output for the fingerprints of a model. Requires the lock.*/
+        std::shared_ptr<const std::string> find(
+            const std::vector<std::pair<const std::string*, std::string>> &keys);
+        /**Caches the output of a render, if allowed. Requires the lock.*/
+        void add(const RenderDependencies &deps, const std::string &output);
+        void evict(Lru::iterator entry);
+        void update_shape_list();
+        static size_t entry_size(const Entry &entry);
+        static size_t shape_size(const Shape &shape);
+    };
+}
@@ -1,9 +1,9 @@
 #pragma once
-#include <memory>
+#include "Ptr.hpp"
 namespace slim
 {
     class Object;
-    typedef std::shared_ptr<Object> ObjectPtr;
+    typedef Ptr<Object> ObjectPtr;
 
     bool eq(const Object *lhs, const Object *rhs);
     int cmp(const Object *lhs, const Object *rhs);
@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <type_traits>
+#include <utility>
+
+namespace slim
+{
+    /**@brief Reference counted pointer to an Object, using the count embedded in the object.
+     *
+     * Similar in use to std::shared_ptr, but without a separate control block or weak
+     * references. Copies call Object::add_ref and Object::release, which use plain counts for
+     * objects confined to the render thread, and atomic counts otherwise. See Object.
+     *
+     * T must be slim::Object or a type derived from it. Only the use of add_ref and release
+     * needs T to be complete, so a Ptr to a forward declared type may be declared.
+     */
+    template<class T> class Ptr
+    {
+    public:
+        typedef T element_type;
+
+        Ptr() : p(nullptr) {}
+        Ptr(std::nullptr_t) : p(nullptr) {}
+        /**Takes a new reference to p.*/
+        explicit Ptr(T *p) : p(p)
+        {
+            if (p) p->add_ref();
+        }
+        Ptr(const Ptr &other) : p(other.p)
+        {
+            if (p) p->add_ref();
+        }
+        Ptr(Ptr &&other) : p(other.p)
+        {
+            other.p = nullptr;
+        }
+        template<class U, class = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+        Ptr(const Ptr<U> &other) : p(other.get())
+        {
+            if (p) p->add_ref();
+        }
+        template<class U, class = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+        Ptr(Ptr<U> &&other) : p(other.detach()) {}
+        /**Takes ownership of an existing reference to p, see detach.*/
+        static Ptr adopt(T *p)
+        {
+            Ptr ret;
+            ret.p = p;
+            return ret;
+        }
+        ~Ptr()
+        {
+            if (p) p->release();
+        }
+
+        Ptr& operator = (const Ptr &other)
+        {
+            Ptr(other).swap(*this);
+            return *this;
+        }
+        Ptr& operator = (Ptr &&other)
+        {
+            Ptr(std::move(other)).swap(*this);
+            return *this;
+        }
+        template<class U> Ptr& operator = (const Ptr<U> &other)
+        {
+            Ptr(other).swap(*this);
+            return *this;
+        }
+        template<class U> Ptr& operator = (Ptr<U> &&other)
+        {
+            Ptr(std::move(other)).swap(*this);
+            return *this;
+        }
+        Ptr& operator = (std::nullptr_t)
+        {
+            reset();
+            return *this;
+        }
+
+        void reset() { Ptr().swap(*this); }
+        void reset(T *ptr) { Ptr(ptr).swap(*this); }
+        void swap(Ptr &other) { std::swap(p, other.p); }
+        /**Release ownership without changing the count, returning the pointer.*/
+        T *detach()
+        {
+            auto ret = p;
+            p = nullptr;
+            return ret;
+        }
+
+        T *get()const { return p; }
+        T &operator *()const { return *p; }
+        T *operator ->()const { return p; }
+        explicit operator bool()const { return p != nullptr; }
+        /**The current reference count, for tests.*/
+        long use_count()const { return p ? (long)p->ref_count() : 0; }
+    private:
+        T *p;
+    };
+
+    template<class T, class U> bool operator == (const Ptr<T> &a, const Ptr<U> &b) { return a.get() == b.get(); }
+    template<class T, class U> bool operator != (const Ptr<T> &a, const Ptr<U> &b) { return a.get() != b.get(); }
+    template<class T, class U> bool operator < (const Ptr<T> &a, const Ptr<U> &b) { return a.get() < b.get(); }
+    template<class T> bool operator == (const Ptr<T> &a, std::nullptr_t) { return !a; }
+    template<class T> bool operator == (std::nullptr_t, const Ptr<T> &a) { return !a; }
+    template<class T> bool operator != (const Ptr<T> &a, std::nullptr_t) { return (bool)a; }
+    template<class T> bool operator != (std::nullptr_t, const Ptr<T> &a) { return (bool)a; }
+
+    template<class CharT, class Traits, class T>
+    std::basic_ostream<CharT, Traits> &operator << (std::basic_ostream<CharT, Traits> &os, const Ptr<T> &ptr)
+    {
+        return os << ptr.get();
+    }
+
+    template<class T, class U> Ptr<T> static_pointer_cast(const Ptr<U> &ptr)
+    {
+        return Ptr<T>(static_cast<T*>(ptr.get()));
+    }
+    template<class T, class U> Ptr<T> static_pointer_cast(Ptr<U> &&ptr)
+    {
+        return Ptr<T>::adopt(static_cast<T*>(ptr.detach()));
+    }
+    template<class T, class U> Ptr<T> dynamic_pointer_cast(const Ptr<U> &ptr)
+    {
+        return Ptr<T>(dynamic_cast<T*>(ptr.get()));
+    }
+    template<class T, class U> Ptr<T> const_pointer_cast(const Ptr<U> &ptr)
+    {
+        return Ptr<T>(const_cast<T*>(ptr.get()));
+    }
+}
+namespace std
+{
+    template<class T> struct hash<slim::Ptr<T>>
+    {
+        size_t operator()(const slim::Ptr<T> &ptr)const
+        {
+            return std::hash<T*>()(ptr.get());
+        }
+    };
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace slim
+{
+    /**@brief Allocator for small script objects created during a single render.
+     *
+     * Memory is taken from large chunks, with freed blocks kept on per size free lists, so most
+     * allocations during a render do not touch the global heap. All chunks are released at once
+     * when the render ends.
+     *
+     * Objects may safely outlive the render, for example values stored into the ViewModel. Each
+     * allocation holds a reference to the arena, and the chunks are only released once the
+     * render has ended and every allocation has been freed. Such an object keeps all of the
+     * chunks alive, so code that knowingly creates long lived objects during a render, such as
+     * global caches, should allocate them with Suspend.
+     *
+     * An arena is only used by the thread that created it. Objects from it may be released on
+     * any thread.
+     */
+    class RenderArena
+    {
+    public:
+        /**Allocations larger than this use the global heap.*/
+        static const size_t MAX_SMALL_SIZE = 256;
+        static const size_t CHUNK_SIZE = 64 * 1024;
+
+        /**Creates an arena and makes it the current arena for this thread, until destroyed.
+         * If there is already a current arena, that one continues to be used instead.
+         */
+        class Scope
+        {
+        public:
+            /**@param enable If false, does nothing.*/
+            explicit Scope(bool enable = true);
+            ~Scope();
+            Scope(const Scope&) = delete;
+            Scope& operator = (const Scope&) = delete;
+        private:
+            RenderArena *arena;
+        };
+        /**Allocates from the global heap on this thread until destroyed.*/
+        class Suspend
+        {
+        public:
+            Suspend() : prev(current_arena) { current_arena = nullptr; }
+            ~Suspend() { current_arena = prev; }
+            Suspend(const Suspend&) = delete;
+            Suspend& operator = (const Suspend&) = delete;
+        private:
+            RenderArena *prev;
+        };
+
+        /**The arena for the render in progress on this thread, or null.*/
+        static RenderArena *current() { return current_arena; }
+
+        void *allocate(size_t size);
+        void deallocate(void *p, size_t size);
+        /**Add a reference that keeps the chunks alive.*/
+        void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+        /**Remove a reference, deleting the arena if it was the last.*/
+        void release()
+        {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+        }
+
+        /**Number of chunks allocated, for tests and benchmarks.*/
+        size_t chunk_count()const { return chunks.size(); }
+    private:
+        static const size_t GRANULARITY = 16;
+        static const size_t NUM_CLASSES = MAX_SMALL_SIZE / GRANULARITY;
+        struct FreeBlock
+        {
+            FreeBlock *next;
+        };
+
+        static thread_local RenderArena *current_arena;
+
+        /**One for the owning Scope, and one for each live allocation.*/
+        std::atomic<size_t> refs;
+        std::vector<std::unique_ptr<char[]>> chunks;
+        char *next, *end;
+        FreeBlock *free_lists[NUM_CLASSES];
+
+        RenderArena();
+        ~RenderArena();
+    };
+
+    /**Standard allocator using the current RenderArena when constructed, else the global heap.*/
+    template<class T> class RenderAllocator
+    {
+    public:
+        typedef T value_type;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        RenderAllocator() : arena(RenderArena::current()) {}
+        explicit RenderAllocator(RenderArena *arena) : arena(arena) {}
+        template<class U> RenderAllocator(const RenderAllocator<U> &other) : arena(other.get_arena()) {}
+
+        T *allocate(size_t n)
+        {
+            if (!arena) return static_cast<T*>(::operator new(n * sizeof(T)));
+            arena->retain();
+            return static_cast<T*>(arena->allocate(n * sizeof(T)));
+        }
+        void deallocate(T *p, size_t n)
+        {
+            if (!arena) return ::operator delete(p);
+            arena->deallocate(p, n * sizeof(T));
+            arena->release();
+        }
+        /**Copies of a container allocate from the current arena, not the original.*/
+        RenderAllocator select_on_container_copy_construction()const { return RenderAllocator(); }
+
+        RenderArena *get_arena()const { return arena; }
+        template<class U> bool operator == (const RenderAllocator<U> &rhs)const { return arena == rhs.get_arena(); }
+        template<class U> bool operator != (const RenderAllocator<U> &rhs)const { return arena != rhs.get_arena(); }
+    private:
+        RenderArena *arena;
+    };
+}
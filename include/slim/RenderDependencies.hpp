@@ -0,0 +1,90 @@
+#pragma once
+#include "Ptr.hpp"
+#include <string>
+#include <vector>
+
+namespace slim
+{
+    class Object;
+    class Symbol;
+    class ViewModel;
+    typedef Ptr<Symbol> SymPtr;
+
+    /**@brief Records the inputs that a render reads from its ViewModel.
+     *
+     * While a Scope is active on a thread, reads by ViewModel::get_attr and
+     * ViewModel::get_constant on the recorded model, and calls of the model's methods (helpers)
+     * by a template, are recorded in order. The values read are fingerprinted as they are read.
+     *
+     * A render is deterministic given these inputs, if the helpers it calls only depend on their
+     * arguments and the model's attributes and constants. A helper that does not (for example it
+     * uses the current time, or has side effects) must call uncacheable, or be listed as impure
+     * for MemoizingRenderer.
+     */
+    class RenderDependencies
+    {
+    public:
+        enum Kind : char
+        {
+            ATTR = 'a',
+            CONSTANT = 'c',
+            CALL = 'm'
+        };
+        struct Dependency
+        {
+            Kind kind;
+            SymPtr name;
+        };
+
+        /**Makes deps the dependencies recorded for this thread, until destroyed.*/
+        class Scope
+        {
+        public:
+            explicit Scope(RenderDependencies &deps) : prev(current_deps) { current_deps = &deps; }
+            ~Scope() { current_deps = prev; }
+            Scope(const Scope&) = delete;
+            Scope& operator = (const Scope&) = delete;
+        private:
+            RenderDependencies *prev;
+        };
+
+        /**@param model Only reads from this model are recorded.*/
+        explicit RenderDependencies(const ViewModel *model);
+
+        /**The dependencies being recorded on this thread, or null.*/
+        static RenderDependencies *current() { return current_deps; }
+        /**Marks the render in progress on this thread, if any, as depending on something other
+         * than its recorded inputs, so its output must not be reused.
+         */
+        static void uncacheable()
+        {
+            if (current_deps) current_deps->cacheable = false;
+        }
+
+        /**Records a read of an attribute or constant.*/
+        void read(const ViewModel *model, Kind kind, const SymPtr &name, Object *value);
+        /**Records a call of a method of self from a template.*/
+        void call(const ViewModel *self, const SymPtr &name);
+
+        /**The inputs read, in order.*/
+        const std::vector<Dependency> &dependencies()const { return deps; }
+        /**The fingerprints of the values read, in order.*/
+        const std::string &values()const { return _values; }
+        /**False if uncacheable was called, or a value could not be fingerprinted.*/
+        bool is_cacheable()const { return cacheable; }
+
+        /**Appends a representation of value to out, which is equal for two values only if they
+         * are equal and of the same type. Supports nil, booleans, numbers, strings
+         * (including HtmlSafeString), symbols, and arrays and hashes of these.
+         * @return False if value, or a nested value, is not supported.
+         */
+        static bool fingerprint(std::string &out, Object *value);
+    private:
+        static thread_local RenderDependencies *current_deps;
+
+        const ViewModel *model;
+        std::vector<Dependency> deps;
+        std::string _values;
+        bool cacheable;
+    };
+}
@@ -0,0 +1,315 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace slim
+{
+    /**@brief A vector that stores up to N elements inline before allocating.
+     *
+     * Provides the commonly used subset of the std::vector interface. Used for FunctionArgs, so
+     * that most method calls do not allocate for their arguments. Iterators are plain pointers,
+     * and like std::vector are invalidated when the capacity changes, including moving from
+     * inline to allocated storage.
+     */
+    template<class T, size_t N, class Alloc = std::allocator<T>>
+    class SmallVector
+    {
+    public:
+        typedef T value_type;
+        typedef Alloc allocator_type;
+        typedef size_t size_type;
+        typedef ptrdiff_t difference_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef T *pointer;
+        typedef const T *const_pointer;
+        typedef T *iterator;
+        typedef const T *const_iterator;
+
+        SmallVector() : b(inline_data()), e(b), cap(b + N), alloc() {}
+        explicit SmallVector(const Alloc &alloc) : b(inline_data()), e(b), cap(b + N), alloc(alloc) {}
+        explicit SmallVector(size_t n) : SmallVector()
+        {
+            resize(n);
+        }
+        SmallVector(size_t n, const T &value) : SmallVector()
+        {
+            resize(n, value);
+        }
+        SmallVector(std::initializer_list<T> list) : SmallVector()
+        {
+            append(list.begin(), list.end());
+        }
+        template<class It, class = typename std::enable_if<!std::is_integral<It>::value>::type>
+        SmallVector(It first, It last) : SmallVector()
+        {
+            append(first, last);
+        }
+        SmallVector(const SmallVector &other)
+            : b(inline_data()), e(b), cap(b + N)
+            , alloc(std::allocator_traits<Alloc>::select_on_container_copy_construction(other.alloc))
+        {
+            append(other.begin(), other.end());
+        }
+        SmallVector(SmallVector &&other) : b(inline_data()), e(b), cap(b + N), alloc(std::move(other.alloc))
+        {
+            take(other);
+        }
+        ~SmallVector()
+        {
+            clear();
+            free_storage();
+        }
+
+        SmallVector &operator = (const SmallVector &other)
+        {
+            if (this != &other)
+            {
+                clear();
+                append(other.begin(), other.end());
+            }
+            return *this;
+        }
+        SmallVector &operator = (SmallVector &&other)
+        {
+            if (this != &other)
+            {
+                clear();
+                free_storage();
+                b = e = inline_data();
+                cap = b + N;
+                alloc = std::move(other.alloc);
+                take(other);
+            }
+            return *this;
+        }
+        SmallVector &operator = (std::initializer_list<T> list)
+        {
+            clear();
+            append(list.begin(), list.end());
+            return *this;
+        }
+
+        allocator_type get_allocator()const { return alloc; }
+
+        size_t size()const { return (size_t)(e - b); }
+        bool empty()const { return b == e; }
+        size_t capacity()const { return (size_t)(cap - b); }
+        /**True if the elements are in the inline storage.*/
+        bool is_inline()const { return b == inline_data(); }
+
+        T *data() { return b; }
+        const T *data()const { return b; }
+        iterator begin() { return b; }
+        iterator end() { return e; }
+        const_iterator begin()const { return b; }
+        const_iterator end()const { return e; }
+        const_iterator cbegin()const { return b; }
+        const_iterator cend()const { return e; }
+
+        T &operator[](size_t i) { assert(i < size()); return b[i]; }
+        const T &operator[](size_t i)const { assert(i < size()); return b[i]; }
+        T &at(size_t i)
+        {
+            if (i >= size()) throw std::out_of_range("SmallVector::at");
+            return b[i];
+        }
+        const T &at(size_t i)const
+        {
+            if (i >= size()) throw std::out_of_range("SmallVector::at");
+            return b[i];
+        }
+        T &front() { assert(!empty()); return *b; }
+        const T &front()const { assert(!empty()); return *b; }
+        T &back() { assert(!empty()); return e[-1]; }
+        const T &back()const { assert(!empty()); return e[-1]; }
+
+        void reserve(size_t n)
+        {
+            if (n > capacity()) grow(n);
+        }
+        void push_back(const T &value)
+        {
+            emplace_back(value);
+        }
+        void push_back(T &&value)
+        {
+            emplace_back(std::move(value));
+        }
+        template<class... Args> T &emplace_back(Args && ... args)
+        {
+            if (e == cap)
+            {
+                // value may refer to an existing element, so construct it before moving them
+                T tmp(std::forward<Args>(args)...);
+                grow(next_capacity(size() + 1));
+                new (e) T(std::move(tmp));
+            }
+            else new (e) T(std::forward<Args>(args)...);
+            return *e++;
+        }
+        void pop_back()
+        {
+            assert(!empty());
+            (--e)->~T();
+        }
+        void clear()
+        {
+            destroy(b, e);
+            e = b;
+        }
+        void resize(size_t n)
+        {
+            reserve(n);
+            while (size() < n) new (e++) T();
+            if (size() > n) erase(b + n, e);
+        }
+        void resize(size_t n, const T &value)
+        {
+            if (n > size() && n > capacity())
+            {
+                T tmp(value);
+                reserve(n);
+                while (size() < n) new (e++) T(tmp);
+            }
+            else
+            {
+                while (size() < n) new (e++) T(value);
+            }
+            if (size() > n) erase(b + n, e);
+        }
+
+        iterator insert(const_iterator pos, const T &value)
+        {
+            return insert(pos, T(value));
+        }
+        iterator insert(const_iterator pos, T &&value)
+        {
+            auto i = pos - b;
+            emplace_back(std::move(value));
+            std::rotate(b + i, e - 1, e);
+            return b + i;
+        }
+        template<class It, class = typename std::enable_if<!std::is_integral<It>::value>::type>
+        iterator insert(const_iterator pos, It first, It last)
+        {
+            auto i = pos - b;
+            auto old_size = size();
+            append(first, last);
+            std::rotate(b + i, b + old_size, e);
+            return b + i;
+        }
+        iterator erase(const_iterator pos)
+        {
+            return erase(pos, pos + 1);
+        }
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            auto p = b + (first - b);
+            auto new_end = std::move(b + (last - b), e, p);
+            destroy(new_end, e);
+            e = new_end;
+            return p;
+        }
+
+        void swap(SmallVector &other)
+        {
+            SmallVector tmp(std::move(other));
+            other = std::move(*this);
+            *this = std::move(tmp);
+        }
+
+        bool operator == (const SmallVector &rhs)const
+        {
+            return size() == rhs.size() && std::equal(b, e, rhs.b);
+        }
+        bool operator != (const SmallVector &rhs)const { return !(*this == rhs); }
+    private:
+        T *b, *e, *cap;
+        Alloc alloc;
+        typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type buffer;
+
+        T *inline_data() { return reinterpret_cast<T*>(&buffer); }
+        const T *inline_data()const { return reinterpret_cast<const T*>(&buffer); }
+
+        static void destroy(T *first, T *last)
+        {
+            for (; first != last; ++first) first->~T();
+        }
+        size_t next_capacity(size_t min)const
+        {
+            return std::max(min, capacity() * 2);
+        }
+        /**Move the elements to new allocated storage with capacity n.*/
+        void grow(size_t n)
+        {
+            auto p = std::allocator_traits<Alloc>::allocate(alloc, n);
+            auto count = size();
+            for (size_t i = 0; i < count; ++i) new (p + i) T(std::move(b[i]));
+            destroy(b, e);
+            free_storage();
+            b = p;
+            e = p + count;
+            cap = p + n;
+        }
+        void free_storage()
+        {
+            if (!is_inline()) std::allocator_traits<Alloc>::deallocate(alloc, b, capacity());
+        }
+        template<class It> void append(It first, It last)
+        {
+            append(first, last, typename std::iterator_traits<It>::iterator_category());
+        }
+        template<class It> void append(It first, It last, std::input_iterator_tag)
+        {
+            for (; first != last; ++first) emplace_back(*first);
+        }
+        template<class It> void append(It first, It last, std::forward_iterator_tag)
+        {
+            auto n = size() + (size_t)std::distance(first, last);
+            if (n > capacity())
+            {
+                // The range may be within this vector, so copy it before freeing the old storage
+                auto p = std::allocator_traits<Alloc>::allocate(alloc, n);
+                auto count = size();
+                auto out = p + count;
+                for (; first != last; ++first) new (out++) T(*first);
+                for (size_t i = 0; i < count; ++i) new (p + i) T(std::move(b[i]));
+                destroy(b, e);
+                free_storage();
+                b = p;
+                e = out;
+                cap = p + n;
+            }
+            else
+            {
+                for (; first != last; ++first) new (e++) T(*first);
+            }
+        }
+        /**Moves the contents of other, which must have an empty buffer itself.*/
+        void take(SmallVector &other)
+        {
+            if (other.is_inline())
+            {
+                for (auto &x : other) new (e++) T(std::move(x));
+                other.clear();
+            }
+            else
+            {
+                b = other.b;
+                e = other.e;
+                cap = other.cap;
+                other.b = other.e = other.inline_data();
+                other.cap = other.b + N;
+            }
+        }
+    };
+}
@@ -13,4 +13,31 @@ namespace slim
     Template parse_template(const std::string &source, const std::vector<std::string> &local_vars);
     /**Parses a template from a source file.*/
     Template parse_template_file(const std::string &path);
+
+    /**Creates a copy of a template specialized for a fixed set of constants.
+     * Constant lookups that the constants model resolves are replaced by their values. Conditions
+     * and output that then become constant are evaluated once, see tpl::optimize.
+     * The copy must only be rendered with models whose constants match. Values of constants are
+     * shared with the copy, not copied, and one that is not a literal type (e.g. an Array) means
+     * the copy can not be passed to save_template_binary.
+     * The copy has the same exec mode, render arena and fragment store settings.
+     */
+    Template specialize_template(const Template &tpl, ViewModelPtr constants);
+
+    /**Serializes a parsed template to the precompiled binary format, see tpl::binary.
+     * Loading the binary skips lexing and parsing, but it can only be loaded by the same
+     * version of the library on the same architecture.
+     * @throws Error If the template contains a literal that can not be saved.
+     */
+    std::string save_template_binary(const Template &tpl);
+    /**Serializes a parsed template to a binary file.*/
+    void save_template_binary_file(const Template &tpl, const std::string &path);
+    /**Loads a template from save_template_binary data.
+     * @throws Error If the data is not a valid template binary for this version.
+     */
+    Template load_template_binary(const char *data, size_t len);
+    /**Loads a template from a save_template_binary_file file, which is mapped into memory
+     * rather than read where supported.
+     */
+    Template load_template_binary_file(const std::string &path);
 }
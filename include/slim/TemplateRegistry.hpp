@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace slim
+{
+    class Template;
+
+    /**@brief Loads templates from a directory by logical name, and shares them between threads.
+     *
+     * Each template is parsed once on first use. Other threads getting the same template while
+     * it is being parsed wait for the result, rather than parsing it again. On Linux, a background thread watches the
+     * template directories with inotify and reparses changed templates, otherwise the file
+     * modification time is checked on access at most once per TemplateRegistry::Options::check_interval.
+     *
+     * A reloaded template replaces the previous version atomically. get returns a shared
+     * pointer, so renders already in progress keep using the version they started with, and
+     * the old version is freed once they complete. If a changed template fails to parse, the
+     * previous version remains in use.
+     *
+     * All methods are thread safe.
+     */
+    class TemplateRegistry
+    {
+    public:
+        typedef std::shared_ptr<const Template> TemplatePtr;
+
+        struct Options
+        {
+            /**Appended to logical names to get the file name.*/
+            std::string extension = ".html.slim";
+            /**Watch for changes with inotify in a background thread, where supported.*/
+            bool watch = true;
+            /**If not watching, how often get checks the modification time of a template. Also
+             * used for templates in a directory that could not be watched, for example once the
+             * inotify watch limit is reached.
+             * Zero checks on every access, and a negative value never checks.
+             */
+            std::chrono::milliseconds check_interval = std::chrono::milliseconds(1000);
+        };
+        struct Stats
+        {
+            /**Number of get calls for an already loaded template.*/
+            uint64_t hits;
+            /**Number of get calls that loaded a template.*/
+            uint64_t misses;
+            /**Number of times a changed template was reloaded.*/
+            uint64_t reloads;
+            /**Number of times a changed template failed to reload.*/
+            uint64_t reload_errors;
+        };
+
+        /**@param root Directory that logical names are relative to.*/
+        explicit TemplateRegistry(const std::string &root);
+        TemplateRegistry(const std::string &root, const Options &options);
+        ~TemplateRegistry();
+        TemplateRegistry(const TemplateRegistry&) = delete;
+        TemplateRegistry& operator = (const TemplateRegistry&) = delete;
+
+        /**Get a template by logical name, such as "users/show" for
+         * "<root>/users/show.html.slim". Loads the template if not already loaded.
+         * @throws std::runtime_error, SyntaxError If the template could not be loaded, or the
+         * name is absolute or contains a ".." component.
+         */
+        TemplatePtr get(const std::string &name);
+        /**Check all loaded templates now, and reload any that changed.
+         * @return The number of templates reloaded.
+         */
+        size_t refresh();
+
+        Stats stats()const;
+        /**True if a background thread is watching for changes.*/
+        bool is_watching()const { return watcher.joinable() && !watch_failed.load(); }
+    private:
+        struct FileTime
+        {
+            int64_t sec, nsec, size;
+            bool operator == (const FileTime &rhs)const
+            {
+                return sec == rhs.sec && nsec == rhs.nsec && size == rhs.size;
+            }
+            bool operator != (const FileTime &rhs)const { return !(*this == rhs); }
+        };
+        struct Entry
+        {
+            std::string path;
+            /**Read and written with std::atomic_load and std::atomic_store.
+             * Null until first loaded successfully.
+             */
+            TemplatePtr tpl;
+            /**Protects loading, reloading and mtime, so the entry is only parsed once per change.*/
+            std::mutex reload_lock;
+            FileTime mtime;
+            std::atomic<int64_t> next_check;
+            /**The directory is watched with inotify, so get does not need to check mtime.*/
+            std::atomic<bool> watched;
+        };
+
+        std::string root;
+        Options options;
+        mutable std::shared_timed_mutex lock;
+        std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+        std::atomic<uint64_t> hits, misses, reloads, reload_errors;
+
+        int inotify_fd;
+        /**Wakes the watcher to stop it.*/
+        int stop_fds[2];
+        /**inotify watch descriptor to directory.*/
+        std::unordered_map<int, std::string> watched_dirs;
+        std::thread watcher;
+        /**Set if the watcher stopped on an error, so get checks modification times instead.*/
+        std::atomic<bool> watch_failed;
+
+        /**Load an entry for the first time, unless another thread already did.*/
+        TemplatePtr load(Entry &entry);
+        /**Reload an entry if the file changed. Returns true if reloaded.*/
+        bool reload(Entry &entry);
+        /**Watch the directory of a template file. Returns false if it could not be watched.*/
+        bool watch_dir(const std::string &path);
+        void watch_thread();
+        /**Reload any entries for a changed file path.*/
+        void file_changed(const std::string &path);
+        static bool file_time(const std::string &path, FileTime *time);
+        /**Throws if a logical name could refer to a file outside of root.*/
+        static void check_name(const std::string &name);
+        static int64_t now_ms();
+    };
+}
@@ -2,6 +2,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include "Ptr.hpp"
 
 namespace slim
 {
@@ -13,11 +14,22 @@ namespace slim
         return std::unique_ptr<T>(new T(std::forward<ARGS>(args)...));
     }
 
+    /**Appends str to out, encoding '&', '<', '>', '"' and '\'' to entities.
+     * Uses SSE2 or AVX2 to check many bytes at a time when supported by the CPU.
+     */
+    void html_escape_append(std::string &out, const char *str, size_t len);
+    inline void html_escape_append(std::string &out, const std::string &str)
+    {
+        html_escape_append(out, str.data(), str.size());
+    }
+    /**Appends obj->to_string() to out, encoding it if not a HtmlSafeString.*/
+    void html_escape_append(std::string &out, const Object *obj);
+
     /**Encodes '&', '<', '>', '"' and '\'' to entities.*/
     std::string html_escape(const std::string &str);
     /**Encodes if not a HtmlSafeString.*/
     std::string html_escape(const Object *obj);
-    inline std::string html_escape(const std::shared_ptr<Object> &obj)
+    inline std::string html_escape(const Ptr<Object> &obj)
     {
         return html_escape(obj.get());
     }
@@ -4,6 +4,10 @@
 #include <string>
 namespace slim
 {
+    namespace tpl
+    {
+        class Optimizer;
+    }
     namespace expr
     {
         class Scope;
@@ -37,7 +41,9 @@ namespace slim
                 return std::string("(") + symbol() + arg->to_string() + ")";
             }
             virtual const char *symbol()const = 0;
+            const ExpressionNodePtr &get_arg()const { return arg; }
         protected:
+            friend class tpl::Optimizer;
             ExpressionNodePtr arg;
         };
         /**Abstract base for any binary operators.*/
@@ -52,7 +58,10 @@ namespace slim
                 return "(" + lhs->to_string() + " " + symbol() + " " + rhs->to_string() + ")";
             }
             virtual const char *symbol()const = 0;
+            const ExpressionNodePtr &get_lhs()const { return lhs; }
+            const ExpressionNodePtr &get_rhs()const { return rhs; }
         protected:
+            friend class tpl::Optimizer;
             ExpressionNodePtr lhs, rhs;
         };
     }
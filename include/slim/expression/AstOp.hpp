@@ -7,6 +7,7 @@ namespace slim
     namespace tpl
     {
         class TemplatePart;
+        class Optimizer;
     }
     namespace expr
     {
@@ -23,26 +24,33 @@ namespace slim
             virtual ObjectPtr eval(Scope &scope)const override;
             ObjectPtr value;
         };
-        /**Gets a variable value.*/
+        /**Gets a variable value.
+         * depth and slot are the position resolved by LocalVarNames::resolve, see Scope.
+         */
         class Variable : public ExpressionNode
         {
         public:
-            Variable(const SymPtr &name) : name(name) {}
+            Variable(const SymPtr &name, uint32_t depth = 0xFFFFFFFF, uint32_t slot = 0xFFFFFFFF)
+                : name(name), depth(depth), slot(slot)
+            {}
             virtual std::string to_string()const override { return name->str(); }
             virtual ObjectPtr eval(Scope &scope)const override;
             SymPtr name;
+            uint32_t depth;
+            uint32_t slot;
         };
-        /**Assigns a variable value.*/
+        /**Assigns a variable value, in slot of the current scope.*/
         class Assignment : public ExpressionNode
         {
         public:
-            Assignment(const SymPtr &name, ExpressionNodePtr &&expr)
-                : name(name), expr(std::move(expr))
+            Assignment(const SymPtr &name, ExpressionNodePtr &&expr, uint32_t slot = 0xFFFFFFFF)
+                : name(name), expr(std::move(expr)), slot(slot)
             {}
             virtual std::string to_string()const override;
             virtual ObjectPtr eval(Scope &scope)const override;
             SymPtr name;
             ExpressionNodePtr expr;
+            uint32_t slot;
         };
         /**Gets an attribute value (on "self").*/
         class Attribute : public ExpressionNode
@@ -186,11 +194,23 @@ namespace slim
         public:
             Block(std::vector<SymPtr> &&param_names, std::unique_ptr<ExpressionNode> &&code)
                 : param_names(std::move(param_names)), code(std::move(code))
+            {
+                locals = this->param_names;
+            }
+            Block(std::vector<SymPtr> &&param_names, std::vector<SymPtr> &&locals, std::unique_ptr<ExpressionNode> &&code)
+                : param_names(std::move(param_names)), locals(std::move(locals)), code(std::move(code))
             {}
             virtual std::string to_string()const override;
             virtual ObjectPtr eval(Scope &scope)const override;
+
+            const std::vector<SymPtr> &get_param_names()const { return param_names; }
+            const std::vector<SymPtr> &get_locals()const { return locals; }
+            const std::unique_ptr<ExpressionNode> &get_code()const { return code; }
         private:
+            friend class tpl::Optimizer;
             std::vector<SymPtr> param_names;
+            /**Variables in the scope for each call, starting with param_names.*/
+            std::vector<SymPtr> locals;
             std::unique_ptr<ExpressionNode> code;
         };
 
@@ -206,7 +226,12 @@ namespace slim
             {}
             virtual std::string to_string()const override;
             virtual ObjectPtr eval(Scope &scope)const override;
+
+            const std::unique_ptr<ExpressionNode> &get_cond()const { return cond; }
+            const std::unique_ptr<ExpressionNode> &get_true_expr()const { return true_expr; }
+            const std::unique_ptr<ExpressionNode> &get_false_expr()const { return false_expr; }
         private:
+            friend class tpl::Optimizer;
             std::unique_ptr<ExpressionNode> cond;
             std::unique_ptr<ExpressionNode> true_expr;
             std::unique_ptr<ExpressionNode> false_expr;
@@ -241,7 +266,10 @@ namespace slim
             InterpolatedString(Nodes &&nodes) : nodes(std::move(nodes)) {}
             virtual std::string to_string()const override;
             virtual ObjectPtr eval(Scope &scope)const override;
+
+            const Nodes &get_nodes()const { return nodes; }
         private:
+            friend class tpl::Optimizer;
             Nodes nodes;
         };
         /**Regex literal using an InterpolatedString.*/
@@ -253,7 +281,11 @@ namespace slim
             {}
             virtual std::string to_string()const override;
             virtual ObjectPtr eval(Scope &scope)const override;
+
+            const std::unique_ptr<InterpolatedString> &get_src()const { return src; }
+            int get_opts()const { return opts; }
         private:
+            friend class tpl::Optimizer;
             std::unique_ptr<InterpolatedString> src;
             int opts;
         };
@@ -5,29 +5,51 @@
 #include "../types/Symbol.hpp"
 #include "../types/ViewModel.hpp"
 #include "../Function.hpp"
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace slim { namespace expr
 {
-    /**Variable scope. */
+    /**Variable scope.
+     *
+     * Each scope is a frame of variables in slots, with the first few stored inline so that
+     * creating a scope for a block call does not allocate. The parser assigns each Variable
+     * and Assignment a (depth, slot) position using LocalVarNames, where depth is the number
+     * of parent scopes to go up. Lookups by position still check the name, and fall back to a
+     * search by name if it does not match or a variable was added by name only, so any scope
+     * built at runtime (such as by the VM) still behaves the same.
+     */
     class Scope
     {
     public:
-        typedef std::unordered_map<SymPtr, ObjectPtr, ObjHash, ObjEquals> Map;
+        typedef std::pair<SymPtr, ObjectPtr> Var;
+        /**Slot value for nodes not resolved by the parser, which always look up by name.*/
+        static const uint32_t NO_SLOT = 0xFFFFFFFF;
 
         /**Constructs the root scope, with no variables except "self".*/
         explicit Scope(ViewModelPtr self)
-            : parent(nullptr), _self(self), map()
+            : parent(nullptr), _self(self), vars(inline_vars), count(0), dynamic(false)
         {
-            map[symbol("self")] = _self;
+            set(0, syms::self, _self);
         }
         /**Constructs an inner scope (such as the one created by a "{|params| expr}" block.
          * The new scope includes all of the variables from the parent, but new variables are not
          * added to the parent.
          */
         explicit Scope(Scope &parent)
-            : parent(&parent), _self(parent._self), map() {}
+            : parent(&parent), _self(parent._self), vars(inline_vars), count(0), dynamic(false)
+        {}
+        /**Constructs an inner scope with slots for the variables in layout, see Block::locals.*/
+        Scope(Scope &parent, const std::vector<SymPtr> &layout)
+            : parent(&parent), _self(parent._self), vars(inline_vars), count(0), dynamic(false)
+        {
+            resize(layout.size());
+            for (size_t i = 0; i < layout.size(); ++i) vars[i].first = layout[i];
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator = (const Scope&) = delete;
 
         /**Sets the value of a variable.
          * Note that currently this is only used for block "|params|", and will never set a
@@ -35,7 +57,14 @@ namespace slim { namespace expr
          */
         void set(const SymPtr &name, ObjectPtr val)
         {
-            map[name] = val;
+            if (auto var = find(name, false))
+            {
+                var->second = std::move(val);
+                return;
+            }
+            dynamic = true;
+            resize(count + 1);
+            vars[count - 1] = Var(name, std::move(val));
         }
         void set(const std::string &name, ObjectPtr val)
         {
@@ -52,53 +81,131 @@ namespace slim { namespace expr
                 else set(i.first->to_string(), i.second);
             }
         }
+        /**Sets the value of a variable in slot of this scope, as resolved by LocalVarNames.*/
+        void set(uint32_t slot, const SymPtr &name, ObjectPtr val)
+        {
+            if (slot == NO_SLOT) return set(name, std::move(val));
+            if (slot >= count) resize(slot + 1);
+            auto &var = vars[slot];
+            if (var.first == name || !var.first)
+            {
+                var.first = name;
+                var.second = std::move(val);
+            }
+            else set(name, std::move(val));
+        }
         /**Gets a variable from this or any parent scope.*/
         ObjectPtr get(const SymPtr &name)
         {
-            auto it = map.find(name);
-            if (it !=  map.end()) return it->second;
-            else if (parent) return parent->get(name);
-            else
+            for (auto scope = this; scope; scope = scope->parent)
             {
-                //Since the script parser uses the existance of variables to call a method if a
-                //variable does not exist, this should really never happen.
-                throw std::runtime_error("Attempted to access an undefined variable");
+                if (auto var = scope->find(name, true)) return var->second;
             }
+            //Since the script parser uses the existance of variables to call a method if a
+            //variable does not exist, this should really never happen.
+            throw std::runtime_error("Attempted to access an undefined variable");
+        }
+        /**Gets a variable from slot of the scope depth levels up, as resolved by LocalVarNames.*/
+        ObjectPtr get(uint32_t depth, uint32_t slot, const SymPtr &name)
+        {
+            auto scope = this;
+            for (; depth > 0 && scope; --depth)
+            {
+                if (scope->dynamic) return get(name);
+                scope = scope->parent;
+            }
+            if (scope && slot < scope->count)
+            {
+                auto &var = scope->vars[slot];
+                if (var.first == name && var.second) return var.second;
+            }
+            return get(name);
         }
 
         /**Get the "self" variable. */
         ViewModelPtr self() { return _self; }
 
         /**Begin iterator for all variables in this scope (not including parents).
-         * Used for tests and debugging.
+         * Used for tests and debugging. Slots that were never assigned have a null name.
          */
-        Map::iterator begin() { return map.begin(); }
+        Var *begin() { return vars; }
         /**End iterator. See begin.*/
-        Map::iterator end() { return map.end(); }
+        Var *end() { return vars + count; }
     private:
+        static const size_t INLINE_VARS = 4;
+        typedef std::vector<Var, RenderAllocator<Var>> VarList;
+
         Scope *parent;
         ViewModelPtr _self;
-        Map map;
+        /**inline_vars, or heap_vars.data() once there are more than INLINE_VARS.*/
+        Var *vars;
+        uint32_t count;
+        /**A variable was added by name, rather than in the slot the parser expected.*/
+        bool dynamic;
+        Var inline_vars[INLINE_VARS];
+        VarList heap_vars;
+
+        /**Finds a variable in this scope only, optionally skipping slots not yet assigned.*/
+        Var *find(const SymPtr &name, bool assigned)
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if (vars[i].first == name && (vars[i].second || !assigned)) return vars + i;
+            }
+            return nullptr;
+        }
+        void resize(size_t n)
+        {
+            if (vars == inline_vars)
+            {
+                if (n <= INLINE_VARS)
+                {
+                    if (n > count) count = (uint32_t)n;
+                    return;
+                }
+                heap_vars.reserve(n * 2);
+                for (uint32_t i = 0; i < count; ++i) heap_vars.push_back(std::move(inline_vars[i]));
+            }
+            if (n > heap_vars.size()) heap_vars.resize(n);
+            vars = heap_vars.data();
+            count = (uint32_t)heap_vars.size();
+        }
     };
     /**Local variable symbol names in scope. Used to tell at parse time if a symbol refers
      * to a local variable or a global/self method.
      *
-     * Unlike the Scope object this is used at parse time, and so no values are known.
+     * Unlike the Scope object this is used at parse time, and so no values are known. Names
+     * are grouped into frames matching the Scope objects created at runtime, so that variables
+     * can be resolved to a (depth, slot) position.
      *
      * Note that the variable "self" is always defined (as variable 0).
      */
     class LocalVarNames
     {
     public:
+        /**All names, in frame order. A name may appear in more than one frame.*/
         std::vector<std::string> names;
+        /**Index in names of the first name of each frame.*/
+        std::vector<size_t> frames;
         LocalVarNames()
         {
+            frames.push_back(0);
             names.push_back("self");
         }
 
+        /**Start a new frame, for the Scope created by a block call.*/
+        void begin_frame()
+        {
+            frames.push_back(names.size());
+        }
+        /**Adds a variable to the current frame, if not already there.*/
         void add(const std::string &name)
         {
-            if (!is_var(name)) names.push_back(name);
+            for (auto i = frames.back(); i < names.size(); ++i)
+            {
+                if (names[i] == name) return;
+            }
+            names.push_back(name);
         }
         void add(const std::vector<std::string> &names)
         {
@@ -109,6 +216,29 @@ namespace slim { namespace expr
             for (auto &x : names) if (x == name) return true;
             return false;
         }
+        /**Finds the innermost variable with name.
+         * @return False if not a variable, in which case depth and slot are Scope::NO_SLOT.
+         */
+        bool resolve(const std::string &name, uint32_t *depth, uint32_t *slot)const
+        {
+            for (size_t i = names.size(); i-- > 0;)
+            {
+                if (names[i] != name) continue;
+                size_t frame = frames.size() - 1;
+                while (frames[frame] > i) --frame;
+                *depth = (uint32_t)(frames.size() - 1 - frame);
+                *slot = (uint32_t)(i - frames[frame]);
+                return true;
+            }
+            *depth = *slot = Scope::NO_SLOT;
+            return false;
+        }
+        /**The names in the current frame, as a layout for Scope.*/
+        std::vector<SymPtr> frame_layout()const
+        {
+            std::vector<SymPtr> out;
+            for (auto i = frames.back(); i < names.size(); ++i) out.push_back(symbol(names[i]));
+            return out;
+        }
     };
 }}
-
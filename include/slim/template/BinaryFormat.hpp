@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+namespace slim
+{
+    namespace tpl
+    {
+        class TemplatePart;
+        /**@brief Precompiled template binary format, see save_template_binary.
+         *
+         * A file is a header, a symbol table, then the TemplatePart tree in pre-order. Each part or
+         * expression node is a one byte tag followed by its fields. Integers and doubles are
+         * stored in native byte order, and files are not portable between architectures, which
+         * the header records.
+         *
+         *     header:  "SLIMTPL\0", uint32 version, uint32 byte order mark (0x01020304)
+         *     symbols: uint32 count, then each as a string
+         *     string:  uint32 length, then the bytes
+         *     root:    part
+         */
+        namespace binary
+        {
+            static const char MAGIC[8] = { 'S', 'L', 'I', 'M', 'T', 'P', 'L', '\0' };
+            /**Incremented on any incompatible change, older versions are rejected.*/
+            static const uint32_t VERSION = 2;
+            static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+            /**Deepest nesting of parts and expressions that is loaded. Deeper data is rejected
+             * as invalid, rather than overflowing the stack while reading it.
+             */
+            static const uint32_t MAX_DEPTH = 1000;
+
+            enum PartTag : uint8_t
+            {
+                PART_LIST = 1,
+                PART_TEXT,
+                PART_FLUSH,
+                PART_OUTPUT,
+                PART_CODE,
+                PART_EACH,
+                PART_ATTR,
+                PART_SPLAT_ATTRS,
+                PART_FOR,
+                PART_IF,
+                PART_CACHE
+            };
+            enum NodeTag : uint8_t
+            {
+                NODE_LITERAL = 1,
+                NODE_VARIABLE,
+                NODE_ASSIGNMENT,
+                NODE_ATTRIBUTE,
+                NODE_GLOBAL_CONSTANT,
+                NODE_CONSTANT_NAV,
+                NODE_GLOBAL_FUNC_CALL,
+                NODE_MEMBER_FUNC_CALL,
+                NODE_SAFE_NAV_MEMBER_FUNC_CALL,
+                NODE_ELEMENT_REF,
+                NODE_ARRAY_LITERAL,
+                NODE_HASH_LITERAL,
+                NODE_INCLUSIVE_RANGE,
+                NODE_EXCLUSIVE_RANGE,
+                NODE_BLOCK,
+                NODE_CONDITIONAL,
+                NODE_INTERPOLATED_STRING,
+                NODE_INTERPOLATED_REGEX,
+                NODE_TEMPLATE_CAPTURE_BLOCK,
+                NODE_TEMPLATE_OUTPUT_BLOCK,
+                //Unary operators
+                NODE_NEGATIVE,
+                NODE_NOT,
+                NODE_LOGICAL_NOT,
+                //Binary operators
+                NODE_MUL,
+                NODE_DIV,
+                NODE_MOD,
+                NODE_POW,
+                NODE_ADD,
+                NODE_SUB,
+                NODE_LSHIFT,
+                NODE_RSHIFT,
+                NODE_AND,
+                NODE_OR,
+                NODE_XOR,
+                NODE_EQ,
+                NODE_NE,
+                NODE_CMP,
+                NODE_LT,
+                NODE_LE,
+                NODE_GT,
+                NODE_GE,
+                NODE_LOGICAL_AND,
+                NODE_LOGICAL_OR
+            };
+            enum ValueTag : uint8_t
+            {
+                VALUE_NIL = 1,
+                VALUE_TRUE,
+                VALUE_FALSE,
+                VALUE_NUMBER,
+                VALUE_STRING,
+                VALUE_SYMBOL,
+                VALUE_REGEXP,
+                /**Index into the object table of copy_tree, for any other value. Never in files.*/
+                VALUE_OBJECT
+            };
+
+            /**Creates a deep copy of a template tree, by writing and reading it.
+             * Unlike a file, literals of any type are copied, by reference.
+             */
+            std::unique_ptr<TemplatePart> copy_tree(const TemplatePart &root);
+        }
+    }
+}
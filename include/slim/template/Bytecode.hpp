@@ -0,0 +1,222 @@
+#pragma once
+#include "../CachedMethod.hpp"
+#include "../types/Object.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+namespace slim
+{
+    namespace expr
+    {
+        class ExpressionNode;
+    }
+    namespace tpl
+    {
+        class TemplatePart;
+        class TemplateTagAttr;
+        class TemplateTagSplatAttrs;
+
+        /**A single VM instruction.
+         *
+         * The VM is a stack machine. Expressions push their result on to the operand stack, and
+         * instructions consuming values pop them. The meaning of the a and b operands depends on
+         * the op, as documented for each.
+         */
+        struct Instruction
+        {
+            enum Op : uint8_t
+            {
+                /**Append Program::text[a] to the output.*/
+                TEXT,
+                /**Template flush point.*/
+                FLUSH,
+                /**Pop a value and append it to the output, HTML escaped.*/
+                OUTPUT,
+                /**Pop a value and discard it.*/
+                POP,
+                /**Return from the current block or template. If a, return the popped value.*/
+                RETURN,
+
+                /**Push Program::constants[a].*/
+                PUSH_CONST,
+                /**Push the ViewModel "self".*/
+                PUSH_SELF,
+                /**Push the OutputBuffer for the current block (the "output_buffer" local).*/
+                PUSH_OUTPUT_BUFFER,
+                /**Push local variable slot a. If not yet assigned, reads the variable named
+                 * Program::slot_names[a] from the Scope the template is being rendered with.
+                 */
+                LOAD_SLOT,
+                /**Store the top value (without popping) to local variable slot a.*/
+                STORE_SLOT,
+                /**Push the Scope variable Program::symbols[a].*/
+                LOAD_VAR,
+                /**Push the self attribute Program::symbols[a].*/
+                LOAD_ATTR,
+                /**Push the self constant Program::symbols[a].*/
+                LOAD_CONSTANT,
+                /**Replace the top value with its constant Program::symbols[a].*/
+                CONST_NAV,
+
+                /**Pop b arguments and call method site a on self.*/
+                CALL_SELF,
+                /**Pop b arguments and then the receiver, and call method site a.*/
+                CALL,
+                /**Pop b arguments and then the receiver, and call Object::el_ref.*/
+                EL_REF,
+                /**Pop b values and push them as an Array.*/
+                MAKE_ARRAY,
+                /**Pop b key-value values and push them as a Hash.*/
+                MAKE_HASH,
+                /**Pop end then begin, and push a Range. Exclusive if a.*/
+                MAKE_RANGE,
+                /**Pop a String and push a Regexp with options a.*/
+                MAKE_REGEX,
+                /**Pop b values and push the concatenation of their to_string.*/
+                CONCAT,
+                /**Push a Proc for block a.*/
+                MAKE_BLOCK,
+
+                NEGATE,
+                BIT_NOT,
+                LOGICAL_NOT,
+                MUL,
+                DIV,
+                MOD,
+                POW,
+                ADD,
+                SUB,
+                LSHIFT,
+                RSHIFT,
+                BIT_AND,
+                BIT_OR,
+                BIT_XOR,
+                EQ,
+                NE,
+                CMP,
+                LT,
+                LE,
+                GT,
+                GE,
+
+                /**Jump to a.*/
+                JUMP,
+                /**Pop a value, and jump to a if false.*/
+                JUMP_IF_FALSE,
+                /**If the top value is false jump to a, else pop it.*/
+                JUMP_IF_FALSE_KEEP,
+                /**If the top value is true jump to a, else pop it.*/
+                JUMP_IF_TRUE_KEEP,
+                /**If the top value is nil jump to a.*/
+                JUMP_IF_NIL_KEEP,
+
+                /**Pop a collection and start iterating it with block a, which starts at the next
+                 * instruction. Array, Hash and Range are iterated directly with ITER_NEXT
+                 * jumping back to the block. Anything else has its "each" method called with a
+                 * Proc for the block. Continues at b once complete.
+                 */
+                ITER_BEGIN,
+                /**End of each block a. Jumps back to b for the next element if there is one,
+                 * or returns if the block was called as a Proc.
+                 */
+                ITER_NEXT,
+
+                /**Render Program::attrs[a] with b values popped for its expressions.*/
+                ATTR,
+                /**Render Program::splat_attrs[a] with b values popped for its expressions.*/
+                SPLAT_ATTRS,
+                /**Pop the body Proc and then the key of a TemplateCacheBlock, and render it with
+                 * digest Program::text[a].
+                 */
+                CACHE,
+
+                /**Push the result of the tree walking interpreter evaluating Program::nodes[a],
+                 * with the local variable slots listed in Program::visible_slots[b].
+                 */
+                EVAL_NODE,
+                /**Render Program::parts[a] with the tree walking interpreter, with the local
+                 * variable slots listed in Program::visible_slots[b].
+                 */
+                RENDER_PART
+            };
+
+            Op op;
+            uint32_t a;
+            uint32_t b;
+
+            Instruction(Op op, uint32_t a = 0, uint32_t b = 0) : op(op), a(a), b(b) {}
+        };
+
+        /**@brief A template compiled to a flat instruction stream for the VM.
+         *
+         * Created by compile(). The program references, but does not own, any parts of the
+         * original template it could not compile, so must not outlive it.
+         *
+         * A program is immutable once compiled, apart from the method caches, and can be run
+         * by any number of threads at once.
+         */
+        class Program
+        {
+        public:
+            static const uint32_t NO_SLOT = 0xFFFFFFFF;
+
+            enum BlockKind
+            {
+                /**Script "{|params| expr}" block, returns the value of expr.*/
+                BLOCK_EXPR,
+                /**Template block returning its output as a HtmlSafeString.*/
+                BLOCK_CAPTURE,
+                /**Template block writing to the output of the code that created it.*/
+                BLOCK_OUTPUT
+            };
+            /**A block within the program, which can be called as a Proc.*/
+            struct Block
+            {
+                BlockKind kind;
+                /**First instruction.*/
+                uint32_t entry;
+                /**Slot for each parameter.*/
+                std::vector<uint32_t> params;
+                /**All slots local to the block, which are reset on each call.
+                 * Each is a pair of the slot and the outer slot to initialise it from, or NO_SLOT.
+                 * A block local variable initialised from an outer slot is an assignment that
+                 * shadows an outer variable, which remains visible until assigned.
+                 */
+                std::vector<std::pair<uint32_t, uint32_t>> locals;
+                /**For each blocks, the method site for calling "each" on types without native
+                 * iteration.
+                 */
+                uint32_t each_site;
+            };
+
+            Program();
+            ~Program();
+
+            std::vector<Instruction> code;
+            /**Static template text.*/
+            std::vector<std::string> text;
+            std::vector<ObjectPtr> constants;
+            std::vector<SymPtr> symbols;
+            /**The variable name of each local variable slot.*/
+            std::vector<SymPtr> slot_names;
+            std::vector<Block> blocks;
+            /**Method name for each method call site.*/
+            std::vector<SymPtr> site_names;
+            /**Inline method cache for each method call site.*/
+            std::unique_ptr<CachedMethod[]> site_caches;
+            std::vector<const TemplateTagAttr*> attrs;
+            std::vector<const TemplateTagSplatAttrs*> splat_attrs;
+            /**Expressions and parts evaluated by the tree walking interpreter.*/
+            std::vector<const expr::ExpressionNode*> nodes;
+            std::vector<const TemplatePart*> parts;
+            /**Lists of local variable slots in scope for EVAL_NODE and RENDER_PART.*/
+            std::vector<std::vector<uint32_t>> visible_slots;
+
+            /**Number of local variable slots.*/
+            size_t slot_count()const { return slot_names.size(); }
+            /**Human readable listing of the instructions, for debugging.*/
+            std::string disassemble()const;
+        };
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "Bytecode.hpp"
+#include <memory>
+namespace slim
+{
+    namespace tpl
+    {
+        class TemplatePart;
+
+        /**Compile a parsed template to bytecode for the VM.
+         *
+         * Template parts and expression nodes are lowered in to a single instruction stream.
+         * Local variables assigned or declared as block parameters within the template are given
+         * fixed slots, each method call gets an inline cache, and if/each/&& etc. become jumps.
+         *
+         * Any part or node type the compiler does not know (such as custom TemplatePart or
+         * ExpressionNode types) is referenced by the program and run by the tree walking
+         * interpreter, so root must outlive the returned Program.
+         */
+        std::unique_ptr<Program> compile(const TemplatePart &root);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+namespace slim
+{
+    class Template;
+    namespace tpl
+    {
+        /**Options for generate_cpp.*/
+        struct CppOptions
+        {
+            /**Name of the generated render function.*/
+            std::string function_name;
+            /**Namespace for the render function, such as "app::views". Optional.*/
+            std::string name_space;
+            /**Header for the generated source to include, such as from generate_cpp_header.
+             * Optional.
+             */
+            std::string header;
+            /**If true, every render also renders the original source with the tree walking
+             * interpreter, and throws slim::Error if the output differs.
+             */
+            bool test_mode = false;
+        };
+
+        /**Generate a C++ source file that renders a template.
+         *
+         * The generated function has the same signature and output as Template::render:
+         *
+         *     std::string function_name(slim::ViewModelPtr model, bool doctype = true);
+         *
+         * It is generated from the compiled bytecode, with static text as constant appends,
+         * control flow as gotos, and expressions as direct calls to the Object API, and the
+         * template does not need to be parsed at runtime.
+         *
+         * @param source The template source, needed for CppOptions::test_mode.
+         * @throws Error If the template contains something that can only be run by the
+         * interpreter, such as a custom TemplatePart.
+         */
+        std::string generate_cpp(const Template &tpl, const std::string &source, const CppOptions &options);
+        /**Generate a C++ header declaring the function generated by generate_cpp.*/
+        std::string generate_cpp_header(const CppOptions &options);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+#include <string>
+namespace slim
+{
+    class ViewModel;
+    namespace expr
+    {
+        class ExpressionNode;
+    }
+    namespace tpl
+    {
+        class TemplatePart;
+
+        /**Simplifies a parsed template tree, before it is used to create a Template.
+         *
+         * - Constant subexpressions (operators, conditionals and interpolated strings over
+         *   literals) are folded into a single expr::Literal.
+         * - Output of constant expressions and attributes is escaped once, and becomes text.
+         * - if/elsif/else branches with a constant condition are taken or removed.
+         * - Nested part lists are flattened, and adjacent text merged.
+         *
+         * Expressions that raise an error are left for the render to raise.
+         *
+         * @param constants If not null, GlobalConstant and ConstantNav lookups that succeed
+         * against it are replaced by their value, for specialize_template. The template must then
+         * only be rendered with models having the same constants.
+         */
+        std::unique_ptr<TemplatePart> optimize(std::unique_ptr<TemplatePart> &&part, ViewModel *constants = nullptr);
+        /**Folds the constant subexpressions of an expression, see optimize.*/
+        std::unique_ptr<expr::ExpressionNode> fold_constants(std::unique_ptr<expr::ExpressionNode> &&node);
+
+        /**Gets an indented listing of the parts in a template tree, one per line, for
+         * debugging. Expressions use their to_string form.
+         */
+        std::string dump_tree(const TemplatePart &part);
+    }
+}
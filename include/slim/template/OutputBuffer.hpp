@@ -0,0 +1,179 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Util.hpp"
+#include "template/OutputSink.hpp"
+#include "types/HtmlSafeString.hpp"
+namespace slim
+{
+    namespace tpl
+    {
+        /**@brief The output of a template render.
+         *
+         * Rendered content is appended to an internal string. If the buffer was constructed with
+         * an OutputSink, then the buffered content is written to the sink at each flush point, or
+         * once it grows past the write threshold, rather than being kept until the render is
+         * complete.
+         *
+         * With set_link_content, large HtmlSafeString output, such as a layout's "yield" of the
+         * view content, is not copied. Instead the buffer keeps a reference to it as a slot, and
+         * the output is made up of segments alternating between the buffered text and slots.
+         * Similarly with set_link_static, static template text is linked, pointing directly at
+         * the template's own storage, so that only dynamic output is copied. This is enabled when
+         * writing to a sink that gathers segments, see OutputSink::gathers.
+         */
+        class OutputBuffer
+        {
+        public:
+            /**Buffered data size at which it is written to the sink without waiting for a flush
+             * point.
+             */
+            static const size_t DEFAULT_WRITE_THRESHOLD = 64 * 1024;
+            /**Minimum size of content to link rather than copy, see set_link_content.*/
+            static const size_t LINK_MIN_SIZE = 1024;
+            /**Minimum size of static text to link rather than copy, see set_link_static.
+             * Shorter text is cheaper to copy than to write as a separate segment.
+             */
+            static const size_t STATIC_LINK_MIN_SIZE = 64;
+
+            /**Content referenced by the output, inserted at an offset in the buffered text.*/
+            struct Slot
+            {
+                size_t offset;
+                const char *data;
+                size_t len;
+                /**Keeps linked content alive. Null for static text.*/
+                Ptr<const HtmlSafeString> content;
+            };
+
+            /**Buffer without a sink. All output is kept, and may be retrieved with str or take.*/
+            OutputBuffer()
+                : buf(), sink(nullptr), write_threshold(0), slots(), linked_size(0)
+                , link_content(false), link_static(false)
+            {}
+            /**Buffer that writes to sink.
+             * Static text is linked if the sink gathers segments, see OutputSink::gathers.
+             * @param write_threshold Buffered size at which output is written to the sink
+             * even without a flush point. 0 to only write at flush points.
+             */
+            explicit OutputBuffer(OutputSink *sink, size_t write_threshold = DEFAULT_WRITE_THRESHOLD);
+            OutputBuffer(const OutputBuffer &) = delete;
+            OutputBuffer& operator = (const OutputBuffer &) = delete;
+            ~OutputBuffer() {}
+
+            OutputBuffer& operator += (const std::string &str)
+            {
+                buf += str;
+                check_threshold();
+                return *this;
+            }
+            OutputBuffer& operator += (const char *str)
+            {
+                buf += str;
+                check_threshold();
+                return *this;
+            }
+            OutputBuffer& operator += (char c)
+            {
+                buf += c;
+                return *this;
+            }
+            void append(const char *str, size_t len)
+            {
+                buf.append(str, len);
+                check_threshold();
+            }
+            /**Append text that will remain valid and unchanged until the output is complete,
+             * such as the static text of the template being rendered. It may be linked rather
+             * than copied, see set_link_static.
+             */
+            void append_static(const char *str, size_t len)
+            {
+                if (link_static && len >= STATIC_LINK_MIN_SIZE)
+                {
+                    slots.push_back({buf.size(), str, len, nullptr});
+                    linked_size += len;
+                }
+                else buf.append(str, len);
+                check_threshold();
+            }
+            void append_static(const std::string &str)
+            {
+                append_static(str.data(), str.size());
+            }
+
+            /**Append obj->to_string(), HTML escaped unless obj is a HtmlSafeString.*/
+            void append_escaped(const Object *obj)
+            {
+                auto safe = link_content ? object_cast<HtmlSafeString>(obj) : nullptr;
+                if (safe && safe->get_value().size() >= LINK_MIN_SIZE) link(safe);
+                else html_escape_append(buf, obj);
+                check_threshold();
+            }
+            /**Append content by reference as a slot, without copying it.*/
+            void link(const HtmlSafeString *content)
+            {
+                auto &value = content->get_value();
+                slots.push_back({buf.size(), value.data(), value.size(), Ptr<const HtmlSafeString>(content)});
+                linked_size += value.size();
+            }
+            /**If true, append_escaped links HtmlSafeString objects of at least LINK_MIN_SIZE
+             * rather than copying them. Default false.
+             */
+            void set_link_content(bool enable) { link_content = enable; }
+            /**If true, append_static links text of at least STATIC_LINK_MIN_SIZE rather than
+             * copying it. Default false unless writing to a sink that gathers segments.
+             */
+            void set_link_static(bool enable) { link_static = enable; }
+
+            /**A flush point. Writes all buffered output to the sink, then flushes the sink.
+             * Does nothing if there is no sink.
+             */
+            void flush();
+
+            /**True if output is being written to an OutputSink.*/
+            bool has_sink()const { return sink != nullptr; }
+            /**The buffered text that has not yet been written to a sink, not including slots.*/
+            std::string &str() { return buf; }
+            const std::string &str()const { return buf; }
+            /**The linked content not yet written to a sink, in order.*/
+            const std::vector<Slot> &get_slots()const { return slots; }
+            /**Calls f(const char *data, size_t len) for each non-empty segment of the output not
+             * yet written to a sink, in order.
+             */
+            template<class F> void for_each_segment(F f)const
+            {
+                size_t pos = 0;
+                for (auto &slot : slots)
+                {
+                    if (slot.offset > pos) f(buf.data() + pos, slot.offset - pos);
+                    pos = slot.offset;
+                    if (slot.len) f(slot.data, slot.len);
+                }
+                if (buf.size() > pos) f(buf.data() + pos, buf.size() - pos);
+            }
+            /**Total size of the output not yet written to a sink, including slots.*/
+            size_t size()const { return buf.size() + linked_size; }
+            /**Move the buffered output out of the buffer, with any slots filled in.*/
+            std::string take();
+        private:
+            std::string buf;
+            OutputSink *sink;
+            size_t write_threshold;
+            std::vector<Slot> slots;
+            /**Total size of the slots.*/
+            size_t linked_size;
+            bool link_content;
+            bool link_static;
+            /**Reused by write_buffered.*/
+            std::vector<OutputSegment> segments;
+
+            void check_threshold()
+            {
+                if (write_threshold && size() >= write_threshold) write_buffered();
+            }
+            /**Write the buffer contents to the sink, without flushing the sink.*/
+            void write_buffered();
+        };
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace slim
+{
+    /**A piece of rendered output, as for a POSIX iovec.*/
+    struct OutputSegment
+    {
+        const char *data;
+        size_t len;
+    };
+
+    /**@brief Destination for rendered template output.
+     *
+     * Template::render normally builds and returns a complete std::string. When rendering to an
+     * OutputSink, the output is instead written in pieces at each flush point of the template
+     * (such as after the HTML "head", or a "- flush" control line), allowing the start of a
+     * page to be sent while the rest is still being rendered.
+     */
+    class OutputSink
+    {
+    public:
+        virtual ~OutputSink() {}
+        /**Write len bytes of rendered output. Called with the output in order.*/
+        virtual void write(const char *data, size_t len) = 0;
+        /**Write a number of segments of rendered output, in order.
+         * The default calls write for each segment.
+         */
+        virtual void write_segments(const OutputSegment *segments, size_t count);
+        /**True if write_segments is efficient for many segments, such as with a single writev
+         * call. Static template text is then passed to the sink by reference, rather than being
+         * copied into the rendered output first. The default is false.
+         */
+        virtual bool gathers()const { return false; }
+        /**Called after each flush point, once all output up to that point has been written.
+         * The default does nothing.
+         */
+        virtual void flush() {}
+    };
+
+    /**OutputSink that forwards to std::function callbacks.*/
+    class CallbackSink : public OutputSink
+    {
+    public:
+        typedef std::function<void(const char *data, size_t len)> WriteFunc;
+        typedef std::function<void()> FlushFunc;
+
+        explicit CallbackSink(WriteFunc write_func, FlushFunc flush_func = nullptr)
+            : write_func(std::move(write_func)), flush_func(std::move(flush_func))
+        {}
+
+        virtual void write(const char *data, size_t len)override;
+        virtual void flush()override;
+    private:
+        WriteFunc write_func;
+        FlushFunc flush_func;
+    };
+
+    /**OutputSink that writes to a std::ostream, and calls std::ostream::flush at flush points.*/
+    class OStreamSink : public OutputSink
+    {
+    public:
+        explicit OStreamSink(std::ostream &os) : os(os) {}
+
+        virtual void write(const char *data, size_t len)override;
+        virtual void flush()override;
+    private:
+        std::ostream &os;
+    };
+
+    /**OutputSink that writes to a raw file descriptor, such as a socket or pipe.
+     * Segments are written with writev, so a render makes one system call for each flush point,
+     * without copying the template's static text.
+     * The descriptor is not closed by the sink.
+     * @throws std::system_error if a write fails.
+     */
+    class FdSink : public OutputSink
+    {
+    public:
+        explicit FdSink(int fd) : fd(fd) {}
+
+        virtual void write(const char *data, size_t len)override;
+        virtual void write_segments(const OutputSegment *segments, size_t count)override;
+        virtual bool gathers()const override;
+    private:
+        int fd;
+    };
+}
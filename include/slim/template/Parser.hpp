@@ -27,6 +27,8 @@ namespace slim
             ~Parser();
 
             Template parse();
+            /**If true (default), parse simplifies the tree with tpl::optimize.*/
+            void set_optimize(bool enable) { optimize_tree = enable; }
         private:
             //TODO: output_stack is not actually used as a stack yet, since control blocks are not
             //implemented. This is a placeholder ready for them, and currently all output is simply
@@ -49,6 +51,7 @@ namespace slim
              * internally by parse_control_code().
              */
             expr::LocalVarNames local_vars;
+            bool optimize_tree;
 
             int current_indent();
 
@@ -0,0 +1,38 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "template/OutputSink.hpp"
+namespace slim
+{
+    namespace tpl
+    {
+        class OutputBuffer;
+    }
+
+    /**@brief Rendered output kept as a list of segments, see Template::render_segments.
+     *
+     * Static text segments point directly at the storage of the rendered template, and only the
+     * dynamic output is held by this object. The template must not be destroyed or modified
+     * while the output is in use.
+     */
+    class SegmentedOutput
+    {
+    public:
+        explicit SegmentedOutput(std::unique_ptr<tpl::OutputBuffer> &&buffer);
+        SegmentedOutput(SegmentedOutput &&);
+        SegmentedOutput& operator = (SegmentedOutput &&);
+        ~SegmentedOutput();
+
+        /**The segments of the output, in order, suitable for writev or sendmsg.*/
+        std::vector<OutputSegment> segments()const;
+        /**Total size of the output.*/
+        size_t size()const;
+        /**Copies the output into a single string.*/
+        std::string str()const;
+        /**Writes the output with OutputSink::write_segments, then calls OutputSink::flush.*/
+        void write(OutputSink &sink)const;
+    private:
+        std::unique_ptr<tpl::OutputBuffer> buffer;
+    };
+}
@@ -2,6 +2,7 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include "../Ptr.hpp"
 
 namespace slim
 {
@@ -13,14 +14,28 @@ namespace slim
     namespace tpl
     {
         class TemplatePart;
+        class OutputBuffer;
+        class Program;
     }
     class ViewModel;
-    typedef std::shared_ptr<ViewModel> ViewModelPtr;
+    class OutputSink;
+    class SegmentedOutput;
+    class FragmentStore;
+    typedef Ptr<ViewModel> ViewModelPtr;
 
     /**@brief A parsed template, ready to be rendered using variables in a ViewModel.*/
     class Template
     {
     public:
+        /**How the template is executed by the render methods.*/
+        enum ExecMode
+        {
+            /**Run the bytecode compiled from the template (default).*/
+            EXEC_VM,
+            /**Walk the parsed TemplatePart and ExpressionNode tree.*/
+            EXEC_TREE
+        };
+
         Template(std::unique_ptr<tpl::TemplatePart> &&root);
         Template(Template &&);
         Template& operator = (Template &&);
@@ -34,6 +49,18 @@ namespace slim
          * @param doctype If true, prefix the HTML5 doctype.
          */
         std::string render(ViewModelPtr model, bool doctype = true)const;
+        /**Render this template to an OutputSink.
+         * Output is written to the sink at each flush point within the template, and any
+         * remaining output once the render completes, after which OutputSink::flush is called.
+         * If an exception is thrown, output before the last flush point may have been written.
+         */
+        void render(OutputSink &sink, ViewModelPtr model, bool doctype = true)const;
+        /**Render this template as a list of segments, without copying static text.
+         * The output refers to this template, so it must not be destroyed or modified while the
+         * output is in use. Pass the output to a FdSink, or its segments to writev, to write it
+         * to a file descriptor without first joining it into a single string.
+         */
+        SegmentedOutput render_segments(ViewModelPtr model, bool doctype = true)const;
         /**Render this template with an existing variable scope.
          * Used for partials (the "locals" hash param).
          */
@@ -41,8 +68,16 @@ namespace slim
         /**Render this template with a layout template.
          * This template will be rendered first, and its output, and any "content_for" blocks will
          * then be used for the layouts "yield" output.
+         * Large yielded content is linked into the layout output, rather than copied as it is
+         * rendered, see tpl::OutputBuffer::set_link_content.
          */
         std::string render_layout(Template &layout, ViewModelPtr model, bool doctype = true)const;
+        /**Render this template with a layout template to an OutputSink.
+         * This template is fully rendered first, then the layout is streamed to the sink, so
+         * flush points within this template have no effect. Large yielded content is written to
+         * the sink directly, without being copied.
+         */
+        void render_layout(OutputSink &sink, Template &layout, ViewModelPtr model, bool doctype = true)const;
 
         /**Converts the template part into a string representation, mainly for debugging.
          * Because the origenal template structure has all ready been lost, as it was converted
@@ -50,8 +85,41 @@ namespace slim
          * without any whitespace formatting.
          */
         std::string to_string()const;
+        /**Gets a listing of the compiled bytecode, mainly for debugging.*/
+        std::string disassemble()const;
+        /**Gets the CachedMethod::Stats of each method call site that has been called, one per
+         * line, to find call sites that see many types.
+         * Includes both the bytecode call sites and the MethodCall nodes of the parsed tree.
+         */
+        std::string method_cache_stats()const;
+        /**The bytecode compiled from this template, e.g. for slimc to generate C++ from.*/
+        const tpl::Program &get_program()const { return *program; }
+        /**The parsed template tree, e.g. for save_template_binary.*/
+        const tpl::TemplatePart &get_root()const { return *root; }
+
+        ExecMode get_exec_mode()const { return exec_mode; }
+        void set_exec_mode(ExecMode mode) { exec_mode = mode; }
+        /**If true, script objects created by each render are allocated from a RenderArena,
+         * rather than individually from the global heap, and released together at the end of
+         * the render. These objects also use non-atomic reference counts, see Object.
+         * Default false.
+         */
+        bool get_render_arena()const { return render_arena; }
+        void set_render_arena(bool enable) { render_arena = enable; }
+        /**Where "- cache" blocks store their output. If null, the store already active on the
+         * thread is used, if any, see FragmentStore::Scope. Default null.
+         */
+        const std::shared_ptr<FragmentStore> &get_fragment_store()const { return fragment_store; }
+        void set_fragment_store(std::shared_ptr<FragmentStore> store) { fragment_store = std::move(store); }
     private:
         /**The root TemplatePart part. Most likely a TemplatePartsList, but this is not garunteed.*/
         std::unique_ptr<tpl::TemplatePart> root;
+        /**Bytecode compiled from root.*/
+        std::unique_ptr<tpl::Program> program;
+        ExecMode exec_mode;
+        bool render_arena;
+        std::shared_ptr<FragmentStore> fragment_store;
+
+        void render_root(tpl::OutputBuffer &buffer, expr::Scope &scope)const;
     };
 }
@@ -6,6 +6,27 @@ namespace slim
     namespace tpl
     {
         class TemplatePart;
+        class OutputBuffer;
+
+        /**Script object holding the OutputBuffer being rendered to, for TemplateOutputBlock.
+         * Only valid for the duration of the render that created it.
+         */
+        class OutputBufferObject : public Object
+        {
+        public:
+            explicit OutputBufferObject(OutputBuffer &buffer) : buffer(buffer) {}
+
+            static const std::string &name()
+            {
+                static const std::string TYPE_NAME = "OutputBuffer";
+                return TYPE_NAME;
+            }
+            virtual const std::string& type_name()const override { return name(); }
+
+            OutputBuffer &get_buffer() { return buffer; }
+        private:
+            OutputBuffer &buffer;
+        };
 
         /**A block which contains a template fragment. Can be used to create a expr::Block.*/
         class TemplateBlock : public expr::ExpressionNode
@@ -14,7 +35,7 @@ namespace slim
             TemplateBlock(std::unique_ptr<TemplatePart> &&tpl);
             ~TemplateBlock();
             virtual std::string to_string()const override;
-        protected:
+
             std::unique_ptr<TemplatePart> tpl;
         };
         /**When evaluated returns a HtmlSafeString.*/
@@ -32,14 +53,18 @@ namespace slim
             virtual ObjectPtr eval(expr::Scope &scope)const override;
         };
 
-        /**Creates a expr::Block node containing a TemplateCaptureBlock.*/
+        /**Creates a expr::Block node containing a TemplateCaptureBlock.
+         * locals is the Block::locals frame layout, starting with param_names.
+         */
         std::unique_ptr<expr::ExpressionNode> create_tpl_capture_block(
             std::vector<SymPtr> &&param_names,
+            std::vector<SymPtr> &&locals,
             std::unique_ptr<TemplatePart> &&tpl);
 
         /**Creates a expr::Block node containing a TemplateOutputBlock.*/
         std::unique_ptr<expr::ExpressionNode> create_tpl_output_block(
             std::vector<SymPtr> &&param_names,
+            std::vector<SymPtr> &&locals,
             std::unique_ptr<TemplatePart> &&tpl);
     }
 }
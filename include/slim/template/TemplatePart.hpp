@@ -8,6 +8,7 @@ namespace slim
     }
     namespace tpl
     {
+        class OutputBuffer;
         /**@brief A part of a template.
          * This is essentially an abstract syntax tree with all the adjacent plain text nodes merged.
          */
@@ -19,7 +20,7 @@ namespace slim
             /**See Template::to_string. */
             virtual std::string to_string()const = 0;
             /**Renders this part to the buffer, using the specified variable scope.*/
-            virtual void render(std::string &buffer, expr::Scope &scope)const = 0;
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const = 0;
         };
     }
 }
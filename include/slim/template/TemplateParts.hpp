@@ -1,11 +1,15 @@
 #pragma once
 #include "TemplatePart.hpp"
+#include "OutputBuffer.hpp"
 #include "../expression/Expression.hpp"
 namespace slim
 {
+    class Proc;
     class Symbol;
     namespace tpl
     {
+        class Optimizer;
+
         /**List of parts within a single block for sequential evaluation. */
         class TemplatePartsList : public TemplatePart
         {
@@ -19,12 +23,15 @@ namespace slim
                 for (auto &part : parts) out += part->to_string();
                 return out;
             }
-            virtual void render(std::string &buffer, expr::Scope &scope)const override
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const override
             {
                 for (auto &part : parts)
                     part->render(buffer, scope);
             }
+
+            const std::vector<std::unique_ptr<TemplatePart>> &get_parts()const { return parts; }
         private:
+            friend class Optimizer;
             std::vector<std::unique_ptr<TemplatePart>> parts;
         };
 
@@ -34,13 +41,28 @@ namespace slim
         public:
             TemplateText(std::string &&text) : text(std::move(text)) {}
             virtual std::string to_string()const override { return text; }
-            virtual void render(std::string &buffer, expr::Scope &scope)const override
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const override
             {
-                buffer += text;
+                buffer.append_static(text);
             }
+
+            const std::string &get_text()const { return text; }
         private:
+            friend class Optimizer;
             std::string text;
         };
+        /**A flush point, where the output so far is written to the render OutputSink.
+         * Added after the HTML "head" element, and by "- flush" control lines.
+         */
+        class TemplateFlush : public TemplatePart
+        {
+        public:
+            virtual std::string to_string()const override { return "<% flush %>"; }
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const override
+            {
+                buffer.flush();
+            }
+        };
         /**A script expression to evaulate and write the result. */
         class TemplateOutputExpr : public TemplatePart
         {
@@ -49,8 +71,11 @@ namespace slim
             ~TemplateOutputExpr();
 
             virtual std::string to_string()const override;
-            virtual void render(std::string &buffer, expr::Scope &scope)const override;
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const override;
+
+            const std::unique_ptr<Expression> &get_expression()const { return expression; }
         protected:
+            friend class Optimizer;
             std::unique_ptr<Expression> expression;
         };
         /**A script expression block to evaulate, but does not output anything.*/
@@ -61,11 +86,17 @@ namespace slim
             ~TemplateCodeBlock();
 
             virtual std::string to_string()const override;
-            virtual void render(std::string &buffer, expr::Scope &scope)const override;
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const override;
+
+            const std::unique_ptr<Expression> &get_expression()const { return expression; }
         protected:
+            friend class Optimizer;
             std::unique_ptr<Expression> expression;
         };
-        /**A script enumeration expression where the block writes to the buffer.*/
+        /**A script enumeration expression where the block writes to the buffer.
+         * The buffer is made available to the block (a TemplateOutputBlock) as the
+         * "output_buffer" local variable.
+         */
         class TemplateEachExpr : public TemplatePart
         {
         public:
@@ -73,8 +104,11 @@ namespace slim
             ~TemplateEachExpr();
 
             virtual std::string to_string()const override;
-            virtual void render(std::string &buffer, expr::Scope &scope)const override;
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const override;
+
+            const std::unique_ptr<Expression> &get_expression()const { return expression; }
         protected:
+            friend class Optimizer;
             std::unique_ptr<Expression> expression;
         };
         /**Attribute with dynamic value.
@@ -91,8 +125,25 @@ namespace slim
             ~TemplateTagAttr();
 
             virtual std::string to_string()const override;
-            virtual void render(std::string &buffer, expr::Scope &scope)const override;
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const override;
+            /**Render with already evaluated dynamic_values.
+             * @param values Array of dynamic_values.size() results, in order.
+             */
+            void render_values(OutputBuffer &buffer, const ObjectPtr *values)const;
+            /**Render an attribute from its parts, for code generated by slimc.
+             * @param values Array of count dynamic values.
+             */
+            static void render_attr(
+                OutputBuffer &buffer,
+                const std::string &attr,
+                const std::vector<std::string> &static_values,
+                const ObjectPtr *values, size_t count);
+
+            const std::string &get_attr()const { return attr; }
+            const std::vector<std::string> &get_static_values()const { return static_values; }
+            const std::vector<std::unique_ptr<Expression>> &get_dynamic_values()const { return dynamic_values; }
         protected:
+            friend class Optimizer;
             std::string attr;
             std::vector<std::string> static_values;
             std::vector<std::unique_ptr<Expression>> dynamic_values;
@@ -112,8 +163,29 @@ namespace slim
             ~TemplateTagSplatAttrs();
 
             virtual std::string to_string()const override;
-            virtual void render(std::string &buffer, expr::Scope &scope)const override;
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const override;
+            /**Render with already evaluated expressions.
+             * @param values Results of each dynamic_attrs expression in iteration order, followed
+             * by the results of each splat_attrs expression.
+             */
+            void render_values(OutputBuffer &buffer, const ObjectPtr *values)const;
+            /**Render attributes from their parts, for code generated by slimc.
+             * @param static_attrs The static_attrs, in the order of the original Static map.
+             * @param dynamic_names The dynamic_attrs names, in the order of the original Dynamic map.
+             * @param values As for render_values.
+             */
+            static void render_attrs(
+                OutputBuffer &buffer,
+                const std::vector<std::pair<std::string, std::string>> &static_attrs,
+                const std::vector<std::string> &dynamic_names,
+                size_t splat_count,
+                const ObjectPtr *values);
+
+            const Static &get_static_attrs()const { return static_attrs; }
+            const Dynamic &get_dynamic_attrs()const { return dynamic_attrs; }
+            const Splat &get_splat_attrs()const { return splat_attrs; }
         private:
+            friend class Optimizer;
             Static static_attrs;
             Dynamic dynamic_attrs;
             Splat splat_attrs;
@@ -125,15 +197,20 @@ namespace slim
             TemplateForExpr(
                 std::unique_ptr<Expression> &&expr,
                 std::unique_ptr<TemplatePart> &&body,
-                std::vector<std::shared_ptr<Symbol>> &&param_names);
+                std::vector<Ptr<Symbol>> &&param_names);
             ~TemplateForExpr();
 
             virtual std::string to_string()const override;
-            virtual void render(std::string &buffer, expr::Scope &scope)const override;
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const override;
+
+            const std::unique_ptr<Expression> &get_expr()const { return expr; }
+            const std::unique_ptr<TemplatePart> &get_body()const { return body; }
+            const std::vector<Ptr<Symbol>> &get_param_names()const { return param_names; }
         protected:
+            friend class Optimizer;
             std::unique_ptr<Expression> expr;
             std::unique_ptr<TemplatePart> body;
-            std::vector<std::shared_ptr<Symbol>> param_names;
+            std::vector<Ptr<Symbol>> param_names;
         };
         struct TemplateCondExpr
         {
@@ -160,11 +237,53 @@ namespace slim
             ~TemplateIfExpr();
 
             virtual std::string to_string()const override;
-            virtual void render(std::string &buffer, expr::Scope &scope)const override;
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const override;
+
+            const TemplateCondExpr &get_if_expr()const { return if_expr; }
+            const std::vector<TemplateCondExpr> &get_elseif_exprs()const { return elseif_exprs; }
+            const std::unique_ptr<TemplatePart> &get_else_body()const { return else_body; }
         protected:
+            friend class Optimizer;
             TemplateCondExpr if_expr;
             std::vector<TemplateCondExpr> elseif_exprs;
             std::unique_ptr<TemplatePart> else_body;
         };
+        /**A "- cache key do" block.
+         * The output of the body is stored in the FragmentStore for the render, and later renders
+         * with an equal key output the stored fragment without evaluating the body.
+         */
+        class TemplateCacheBlock : public TemplatePart
+        {
+        public:
+            /**@param body An expr::Block containing a TemplateCaptureBlock, see create_tpl_capture_block.
+             * @param digest Prefix of the store keys, see body_digest.
+             */
+            TemplateCacheBlock(
+                std::unique_ptr<Expression> &&key,
+                std::unique_ptr<Expression> &&body,
+                std::string &&digest);
+            ~TemplateCacheBlock();
+
+            virtual std::string to_string()const override;
+            virtual void render(OutputBuffer &buffer, expr::Scope &scope)const override;
+            /**Render with an already evaluated key and body block, for the VM.
+             * body is only called if there is no stored fragment.
+             */
+            static void render_fragment(OutputBuffer &buffer, const std::string &digest, Object *key, Proc *body);
+            /**Identifies a body template by its content, so that cache blocks with different
+             * bodies never share fragments, and editing a template replaces its fragments.
+             */
+            static std::string body_digest(const TemplatePart &body);
+
+            const std::unique_ptr<Expression> &get_key()const { return key; }
+            /**The expr::Block containing the body template.*/
+            const std::unique_ptr<Expression> &get_body()const { return body; }
+            const std::string &get_digest()const { return digest; }
+        private:
+            friend class Optimizer;
+            std::unique_ptr<Expression> key;
+            std::unique_ptr<Expression> body;
+            std::string digest;
+        };
     }
 }
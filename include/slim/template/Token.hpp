@@ -62,6 +62,10 @@ namespace slim
                 ELSIF,
                 /** 'else' */
                 ELSE,
+                /** 'flush' */
+                FLUSH,
+                /** 'cache' */
+                CACHE,
                 /** '' */
                 EACH_START,
                 /** Filter block start. e.g. ruby: or css: */
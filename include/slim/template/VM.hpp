@@ -0,0 +1,90 @@
+#pragma once
+#include "Bytecode.hpp"
+#include "../Function.hpp"
+#include "../types/TaggedValue.hpp"
+#include <vector>
+namespace slim
+{
+    class ViewModel;
+    namespace expr
+    {
+        class Scope;
+    }
+    namespace tpl
+    {
+        class OutputBuffer;
+
+        /**@brief Runs a compiled template Program.
+         *
+         * A VM holds the state for a single render (local variable slots, the operand stack and
+         * active loops), and is not thread safe. The operand stack and slots hold TaggedValue, so
+         * numeric expressions and Range loops do not allocate. Procs created for template blocks reference the
+         * VM, so like BlockProc and its Scope, must not be called after the render completes.
+         */
+        class VM
+        {
+        public:
+            /**@param scope The variables to render with. Any variable not local to the template
+             * is read from here, and its self is the template self.
+             */
+            VM(const Program &program, expr::Scope &scope);
+            virtual ~VM();
+            VM(const VM&) = delete;
+            VM& operator = (const VM&) = delete;
+
+            /**Render the program.*/
+            void render(OutputBuffer &buffer);
+            /**Call a block, such as from a Proc.
+             * @param buffer The output buffer for BLOCK_OUTPUT blocks.
+             */
+            ObjectPtr call_block(uint32_t block, const FunctionArgs &args, OutputBuffer *buffer);
+        protected:
+            /**Iteration state for ITER_BEGIN/ITER_NEXT.*/
+            struct Iteration
+            {
+                enum Kind { ARRAY, HASH, RANGE };
+                Kind kind = ARRAY;
+                ObjectPtr collection;
+                size_t index = 0;
+                /**RANGE only.*/
+                double value = 0, end = 0;
+                bool exclude_end = false;
+            };
+            const Program &program;
+            expr::Scope &scope;
+            Ptr<ViewModel> self;
+            std::vector<TaggedValue> slots;
+
+            /**Run instructions from pc until RETURN, or ITER_NEXT for block.
+             * Code generated by slimc overrides this to run the same program as native code.
+             */
+            virtual ObjectPtr run(uint32_t pc, OutputBuffer &buffer, uint32_t block);
+            /**Load a local variable slot, falling back to the scope if not assigned.*/
+            ObjectPtr load_slot(uint32_t slot);
+            /**Create a Proc for a block.*/
+            ObjectPtr make_block(uint32_t block, OutputBuffer *buffer);
+            /**ITER_BEGIN. Returns true if the block body should be run for the first element,
+             * or false if there was nothing to iterate or the loop was run by calling "each".
+             */
+            bool iter_begin(uint32_t block, ObjectPtr collection, OutputBuffer &buffer);
+            /**ITER_NEXT. Returns true if the block body should be run for the next element.*/
+            bool iter_next(uint32_t block);
+        private:
+            std::vector<TaggedValue> stack;
+            std::vector<Iteration> iterations;
+            /**Number of active calls of each block.*/
+            std::vector<unsigned> active;
+
+            /**Reset the block locals, and assign the parameters.*/
+            template<class T> void enter_block(const Program::Block &block, const T *args);
+            /**Start native iteration, returns false if the type has no native iteration.*/
+            bool begin_iteration(ObjectPtr collection, const Program::Block &block, Iteration *it);
+            /**Load the next element in to the block parameters. Returns false at the end.*/
+            bool next_iteration(Iteration &it, const Program::Block &block);
+            TaggedValue load_slot_value(uint32_t slot);
+            /**Pop count values as boxed objects.*/
+            FunctionArgs pop_args(uint32_t count);
+            TaggedValue pop();
+        };
+    }
+}
@@ -11,6 +11,7 @@ namespace slim
     class Array : public Object, public Enumerable
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_ARRAY;
         typedef std::vector<ObjectPtr> List;
         typedef List::iterator iterator;
 
@@ -53,86 +54,117 @@ namespace slim
 
         //[]=. <<
         //any?
-        std::shared_ptr<Object> assoc(const Object *a);
-        std::shared_ptr<Object> at(const Number *n);
+        Ptr<Object> assoc(const Object *a);
+        Ptr<Object> at(const Number *n);
         //bsearch
         //combination
-        std::shared_ptr<Array> compact();
+        Ptr<Array> compact();
         //concat
-        std::shared_ptr<Number> count(const FunctionArgs &args);
+        Ptr<Number> count(const FunctionArgs &args);
         //cycle
         //delete, delete_at, delete_if, drop, drop_while
         virtual ObjectPtr each(const FunctionArgs &args)override;
         //each_index
-        std::shared_ptr<Boolean> empty_q();
-        std::shared_ptr<Object> fetch(const FunctionArgs &args);
+        Ptr<Boolean> empty_q();
+        Ptr<Object> fetch(const FunctionArgs &args);
         //fill
-        std::shared_ptr<Object> first(const FunctionArgs &args);
-        std::shared_ptr<Array> flatten(const FunctionArgs &args);
+        Ptr<Object> first(const FunctionArgs &args);
+        Ptr<Array> flatten(const FunctionArgs &args);
         void flatten_imp(std::vector<ObjectPtr> &out, int level);
-        std::shared_ptr<Boolean> frozen_q();
+        Ptr<Boolean> frozen_q();
         //hash
         bool include_q_imp(const Object *obj);
-        std::shared_ptr<Boolean> include_q(const Object *obj);
-        //std::shared_ptr<Object> index(const FunctionArgs &args);
+        Ptr<Boolean> include_q(const Object *obj);
+        //Ptr<Object> index(const FunctionArgs &args);
         //initialize_copy
         //insert
-        std::shared_ptr<String> join(const String *sep);
+        Ptr<String> join(const String *sep);
         //keep_if
-        std::shared_ptr<Object> last(const FunctionArgs &args);
+        Ptr<Object> last(const FunctionArgs &args);
         /**Also length */
-        std::shared_ptr<Number> size();
+        Ptr<Number> size();
         //pack
         //permutation
         //pop
         //product
         //push
-        std::shared_ptr<Object> rassoc(const Object *a);
+        Ptr<Object> rassoc(const Object *a);
         //reject
         //repeated_combination
         //repeated_permutation
         //replace
-        std::shared_ptr<Array> reverse();
+        Ptr<Array> reverse();
         ObjectPtr reverse_each(const FunctionArgs &args);
-        std::shared_ptr<Object> rindex(const Object *obj);
-        //std::shared_ptr<Object> rindex(const FunctionArgs &args);
-        std::shared_ptr<Array> rotate(const FunctionArgs &args);
+        Ptr<Object> rindex(const Object *obj);
+        //Ptr<Object> rindex(const FunctionArgs &args);
+        Ptr<Array> rotate(const FunctionArgs &args);
         //sample
         //select
         //shift
         //shuffle
-        std::shared_ptr<Object> slice(const FunctionArgs &args);
+        Ptr<Object> slice(const FunctionArgs &args);
         Ptr<Array> sort(const FunctionArgs &args);
         ObjectPtr sort_by(const FunctionArgs &args);
         //sort_by
-        std::shared_ptr<Array> take(const Number *n);
+        Ptr<Array> take(const Number *n);
         //take_while
         //to_ary
         //transpose
-        std::shared_ptr<Array> uniq();
+        Ptr<Array> uniq();
         //unshift
-        std::shared_ptr<Array> values_at(const FunctionArgs &args);
+        Ptr<Array> values_at(const FunctionArgs &args);
         //zip
     protected:
         virtual const MethodTable &method_table()const;
+        virtual void share_refs()override;
     private:
         List arr;
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<Array> : std::integral_constant<uint16_t, Object::TYPE_ARRAY> {};
+        template<> struct NativeEach<Array>
+        {
+            template<class F> static bool each(Array *self, F f)
+            {
+                auto &arr = self->get_value();
+                FunctionArgs args(1);
+                // By index, as f may add elements
+                for (size_t i = 0; i < arr.size(); ++i)
+                {
+                    args[0] = arr[i];
+                    if (!f(args)) return false;
+                }
+                return true;
+            }
+        };
+    }
 
-    inline std::shared_ptr<Array> make_value(std::vector<ObjectPtr> &&arr)
+    inline Ptr<Array> make_value(std::vector<ObjectPtr> &&arr)
     {
         return create_object<Array>(std::move(arr));
     }
-    inline std::shared_ptr<Array> make_array(std::vector<ObjectPtr> &&arr)
+    inline Ptr<Array> make_array(std::vector<ObjectPtr> &&arr)
     {
         return create_object<Array>(std::move(arr));
     }
-    inline std::shared_ptr<Array> make_value(const std::vector<ObjectPtr> &arr)
+    inline Ptr<Array> make_value(const std::vector<ObjectPtr> &arr)
     {
         return create_object<Array>(arr);
     }
-    inline std::shared_ptr<Array> make_array(const std::vector<ObjectPtr> &arr)
+    inline Ptr<Array> make_array(const std::vector<ObjectPtr> &arr)
     {
         return create_object<Array>(arr);
     }
+    /**Array from FunctionArgs. A template so that braced lists still use the overloads above.*/
+    template<class Args, typename std::enable_if<std::is_same<Args, FunctionArgs>::value, int>::type = 0>
+    inline Ptr<Array> make_value(const Args &args)
+    {
+        return create_object<Array>(std::vector<ObjectPtr>(args.begin(), args.end()));
+    }
+    template<class Args, typename std::enable_if<std::is_same<Args, FunctionArgs>::value, int>::type = 0>
+    inline Ptr<Array> make_array(const Args &args)
+    {
+        return create_object<Array>(std::vector<ObjectPtr>(args.begin(), args.end()));
+    }
 }
@@ -3,14 +3,15 @@
 namespace slim
 {
     class Boolean;
-    extern const std::shared_ptr<Boolean> TRUE_VALUE;
-    extern const std::shared_ptr<Boolean> FALSE_VALUE;
+    extern const Ptr<Boolean> TRUE_VALUE;
+    extern const Ptr<Boolean> FALSE_VALUE;
     /**Script Boolean type.*/
     class Boolean : public Object
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_BOOLEAN;
         template<class T>
-        static std::shared_ptr<T> create(bool b)
+        static Ptr<T> create(bool b)
         {
             return b ? TRUE_VALUE : FALSE_VALUE;
         }
@@ -36,15 +37,19 @@ namespace slim
         {
             return (b ? 1 : 0) - (((const Boolean*)rhs)->b ? 1 : 0);
         }
-        std::shared_ptr<Number> to_f();
-        std::shared_ptr<Number> to_i();
+        Ptr<Number> to_f();
+        Ptr<Number> to_i();
     protected:
         virtual const MethodTable &method_table()const;
     private:
         bool b;
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<Boolean> : std::integral_constant<uint16_t, Object::TYPE_BOOLEAN> {};
+    }
 
-    inline std::shared_ptr<Boolean> make_value(bool b)
+    inline Ptr<Boolean> make_value(bool b)
     {
         return create_object<Boolean>(b);
     }
@@ -9,6 +9,17 @@ namespace slim
     class Hash;
     class Proc;
 
+    namespace detail
+    {
+        /**Iterates the elements of an Enumerable type directly, for the Enumerable methods.
+         *
+         * Specializations provide "template<class F> static bool each(T *self, F f)", which calls
+         * f(const FunctionArgs &args) for each element until it returns false, and returns false
+         * if stopped. args is only valid during the call. See Enumerable::for_each.
+         */
+        template<class T> struct NativeEach;
+    }
+
     /**Enumerable mixin module.*/
     class Enumerable
     {
@@ -34,6 +45,26 @@ namespace slim
         {
             return each_single({}, func);
         }
+        /**Like each2, but stops the iteration once func returns false. See Proc::stop.*/
+        ObjectPtr each_while(
+            const FunctionArgs &args,
+            std::function<bool(const FunctionArgs &args)> func);
+        /**Like each_single, but stops the iteration once func returns false.*/
+        ObjectPtr each_single_while(
+            const FunctionArgs &args,
+            std::function<bool(Object *arg)> func);
+        ObjectPtr each_single_while(std::function<bool(Object *arg)> func)
+        {
+            return each_single_while({}, func);
+        }
+        /**Like each_single, for methods that pass each element on to proc, such as
+         * each_with_index. The result of func is returned to the iteration, which stops once
+         * proc is stopped.
+         */
+        ObjectPtr each_single_forward(
+            const FunctionArgs &args,
+            Proc *proc,
+            std::function<ObjectPtr(Object *arg)> func);
 
         Ptr<Boolean> all_q(const FunctionArgs &args);
         Ptr<Boolean> any_q(const FunctionArgs &args);
@@ -57,7 +88,7 @@ namespace slim
         //grep_v
         ObjectPtr group_by(const FunctionArgs &args);
         Ptr<Boolean> include_q(Object *obj);
-        //lazy
+        ObjectPtr lazy();
         ObjectPtr map(const FunctionArgs &args);
         ObjectPtr max(const FunctionArgs &args);
         ObjectPtr max_by(const FunctionArgs &args);
@@ -83,6 +114,21 @@ namespace slim
         Ptr<Hash> to_h(const FunctionArgs &args);
         //zip
 
+    private:
+        /**Calls f(const FunctionArgs &args) for each element until it returns false, returning
+         * the result of each, or nil if stopped. args are passed to each.
+         *
+         * Array, Hash and Range without args use detail::NativeEach, so the loop is inlined with
+         * no Proc or FunctionArgs per element. Types derived from them may override each, so
+         * call each.
+         */
+        template<class F> ObjectPtr for_each(const FunctionArgs &args, F f);
+        /**for_each with each element as a single Object, see each_single.*/
+        template<class F> ObjectPtr for_each_single(const FunctionArgs &args, F f);
+        /**Adds a Proc for func to args then calls each. func is given the proc to stop it.*/
+        ObjectPtr each_stoppable(
+            const FunctionArgs &args,
+            std::function<ObjectPtr(Proc *self, const FunctionArgs &args)> func);
     protected:
         template<class Implementor>
         static std::vector<Method> get_methods()
@@ -104,6 +150,7 @@ namespace slim
                 { method<Implementor>(&Enumerable::group_by), "group_by" },
                 { method<Implementor>(&Enumerable::include_q), "include?" },
                 { method<Implementor>(&Enumerable::include_q), "member?" },
+                { method<Implementor>(&Enumerable::lazy), "lazy" },
                 { method<Implementor>(&Enumerable::map), "map" },
                 { method<Implementor>(&Enumerable::max), "max" },
                 { method<Implementor>(&Enumerable::max_by), "max_by" },
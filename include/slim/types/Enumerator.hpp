@@ -3,6 +3,7 @@
 #include "Object.hpp"
 #include "Function.hpp"
 #include <functional>
+#include <vector>
 namespace slim
 {
     class Array;
@@ -11,6 +12,7 @@ namespace slim
     class Enumerator : public Enumerable, public Object
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_ENUMERATOR;
         static const std::string &name()
         {
             static const std::string TYPE_NAME = "Enumerator";
@@ -25,6 +27,66 @@ namespace slim
     protected:
         const MethodTable &method_table()const override;
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<Enumerator> : std::integral_constant<uint16_t, Object::TYPE_ENUMERATOR> {};
+    }
+    /**Lazy enumerator, from Enumerable#lazy.
+     *
+     * map, select, reject, take, take_while, flat_map and with_index return a new lazy
+     * enumerator with the operation added, rather than building an Array. each runs all the
+     * operations on each source element in one pass, and stops the source iteration once a
+     * take or take_while is done, so taking the first N results does not visit the rest.
+     */
+    class LazyEnumerator : public Enumerator
+    {
+    public:
+        static const std::string &name()
+        {
+            static const std::string TYPE_NAME = "Enumerator::Lazy";
+            return TYPE_NAME;
+        }
+        virtual const std::string& type_name()const override { return name(); }
+
+        /**@param source_obj Keeps source alive.*/
+        LazyEnumerator(ObjectPtr source_obj, Enumerable *source);
+
+        virtual ObjectPtr each(const FunctionArgs &args)override;
+
+        Ptr<Array> force();
+        Ptr<LazyEnumerator> flat_map(const FunctionArgs &args);
+        Ptr<LazyEnumerator> lazy();
+        Ptr<LazyEnumerator> map(const FunctionArgs &args);
+        Ptr<LazyEnumerator> reject(const FunctionArgs &args);
+        Ptr<LazyEnumerator> select(const FunctionArgs &args);
+        Ptr<LazyEnumerator> take(Number *n);
+        Ptr<LazyEnumerator> take_while(const FunctionArgs &args);
+        Ptr<LazyEnumerator> with_index(const FunctionArgs &args);
+    protected:
+        const MethodTable &method_table()const override;
+        virtual void share_refs()override;
+    private:
+        struct Stage
+        {
+            enum Kind { MAP, SELECT, REJECT, TAKE, TAKE_WHILE, FLAT_MAP, WITH_INDEX };
+            Kind kind;
+            /**Block for the operation, optional for WITH_INDEX.*/
+            Ptr<Proc> proc;
+            /**Count for TAKE, or offset for WITH_INDEX.*/
+            int n;
+        };
+
+        ObjectPtr source_obj;
+        Enumerable *source;
+        std::vector<Stage> stages;
+
+        Ptr<LazyEnumerator> add_stage(Stage::Kind kind, Ptr<Proc> proc, int n = 0);
+        /**Passes an element through stages from i, then to out.
+         * @param counts Elements seen by each stage during this each.
+         * @return False to stop iterating.
+         */
+        bool push(size_t i, const FunctionArgs &args, std::vector<int> &counts, Proc *out);
+    };
     /**Script method enumerator.*/
     class MethodEnumerator : public Enumerator
     {
@@ -34,7 +96,7 @@ namespace slim
         {}
         virtual ObjectPtr each(const FunctionArgs &args)override;
     protected:
-
+        virtual void share_refs()override;
     private:
         ObjectPtr forward_self;
         Method forward;
@@ -48,6 +110,8 @@ namespace slim
         FunctionEnumerator(Func func, const FunctionArgs &args = {})
             : func(func), args(args) {}
         virtual ObjectPtr each(const FunctionArgs &args)override;
+    protected:
+        virtual void share_refs()override;
     private:
         Func func;
         FunctionArgs args;
@@ -13,6 +13,7 @@ namespace slim
     class Hash : public Object, public Enumerable
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_HASH;
         typedef std::vector<std::pair<ObjectPtr, ObjectPtr>> List;
         typedef List::iterator const_iterator;
 
@@ -64,7 +65,7 @@ namespace slim
         std::string get_str(const std::string &key, const std::string &def);
 
         /**Shallow copy this hash.*/
-        std::shared_ptr<Hash> dup();
+        Ptr<Hash> dup();
 
         //any?
         //assoc
@@ -78,19 +79,19 @@ namespace slim
         ObjectPtr empty_q();
         //eql?
         ObjectPtr fetch(const FunctionArgs &args);
-        std::shared_ptr<Array> flatten(const FunctionArgs &args);
+        Ptr<Array> flatten(const FunctionArgs &args);
         /**Alias key?, include?, member? */
         ObjectPtr has_key_q(Object *obj);
         /**Alias value? */
         ObjectPtr has_value_q(const Object *obj);
-        std::shared_ptr<Hash> invert();
+        Ptr<Hash> invert();
         //keep_if
         ObjectPtr key(const Object *val);
-        std::shared_ptr<Array> keys();
-        std::shared_ptr<Array> values();
+        Ptr<Array> keys();
+        Ptr<Array> values();
         /**Alias length*/
         ObjectPtr size();
-        std::shared_ptr<Hash> merge(Hash *other_hash);
+        Ptr<Hash> merge(Hash *other_hash);
         //merge!
         //rassoc
         //rehash
@@ -99,12 +100,13 @@ namespace slim
         //select, select!
         //shift
         //store
-        std::shared_ptr<Array> to_a();
-        std::shared_ptr<Hash> to_h();
+        Ptr<Array> to_a();
+        Ptr<Hash> to_h();
         //update
         //values_at
     protected:
         virtual const MethodTable &method_table()const;
+        virtual void share_refs()override;
     private:
         typedef std::unordered_map<ObjectPtr, size_t, ObjHash, ObjEquals> Map;
 
@@ -112,8 +114,27 @@ namespace slim
         Map map;
         List list;
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<Hash> : std::integral_constant<uint16_t, Object::TYPE_HASH> {};
+        template<> struct NativeEach<Hash>
+        {
+            template<class F> static bool each(Hash *self, F f)
+            {
+                FunctionArgs args(2);
+                for (auto &i : *self)
+                {
+                    args[0] = i.first;
+                    args[1] = i.second;
+                    if (!f(args)) return false;
+                }
+                return true;
+            }
+        };
+    }
 
-    inline std::shared_ptr<Hash> make_hash(const std::vector<ObjectPtr> &arr)
+    /**Hash from a list of alternating keys and values.*/
+    template<class List> inline Ptr<Hash> make_hash_from_list(const List &arr)
     {
         assert(arr.size() % 2 == 0);
         auto out = create_object<Hash>();
@@ -125,4 +146,14 @@ namespace slim
         }
         return out;
     }
+    inline Ptr<Hash> make_hash(const std::vector<ObjectPtr> &arr)
+    {
+        return make_hash_from_list(arr);
+    }
+    /**Hash from FunctionArgs. A template so that braced lists still use the overload above.*/
+    template<class Args, typename std::enable_if<std::is_same<Args, FunctionArgs>::value, int>::type = 0>
+    inline Ptr<Hash> make_hash(const Args &args)
+    {
+        return make_hash_from_list(args);
+    }
 }
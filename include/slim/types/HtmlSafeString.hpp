@@ -8,6 +8,7 @@ namespace slim
     class HtmlSafeString : public String
     {
     public:
+        static const uint16_t TYPE_FLAGS = String::TYPE_FLAGS | TYPE_HTML_SAFE_STRING;
         using String::String;
 
         static const std::string &name()
@@ -17,4 +18,8 @@ namespace slim
         }
         virtual const std::string& type_name()const override { return name(); }
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<HtmlSafeString> : std::integral_constant<uint16_t, Object::TYPE_HTML_SAFE_STRING> {};
+    }
 }
@@ -5,7 +5,7 @@ namespace slim
     class Array;
     class Boolean;
     class Number;
-    typedef std::shared_ptr<Number> NumberPtr;
+    typedef Ptr<Number> NumberPtr;
     /**The Math module. Implements the static math methods and constants.*/
     class Math : public Type
     {
@@ -49,7 +49,7 @@ namespace slim
         NumberPtr gamma(Number *n);
         NumberPtr hypot(Number *x, Number *y);
         NumberPtr ldexp(Number *x, Number *exp);
-        std::shared_ptr<Array> lgamma(Number *n);
+        Ptr<Array> lgamma(Number *n);
     protected:
         virtual const MethodTable &method_table()const override;
     };
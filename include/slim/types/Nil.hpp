@@ -3,7 +3,7 @@
 namespace slim
 {
     class Nil;
-    extern const std::shared_ptr<Nil> NIL_VALUE;
+    extern const Ptr<Nil> NIL_VALUE;
     /**The "nil" singleton type.
      * Additional instances should not be created, only the global slim::NIL_VALUE instance should
      * be used.
@@ -11,8 +11,9 @@ namespace slim
     class Nil : public Object
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_NIL;
         template<class T>
-        static std::shared_ptr<T> create()
+        static Ptr<T> create()
         {
             return NIL_VALUE;
         }
@@ -29,9 +30,13 @@ namespace slim
         virtual std::string inspect()const override  { return "nil"; }
         virtual bool is_true()const override { return false; }
         virtual size_t hash()const { return 0; }
-        std::shared_ptr<Number> to_f();
-        std::shared_ptr<Number> to_i();
+        Ptr<Number> to_f();
+        Ptr<Number> to_i();
     protected:
         virtual const MethodTable &method_table()const;
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<Nil> : std::integral_constant<uint16_t, Object::TYPE_NIL> {};
+    }
 }
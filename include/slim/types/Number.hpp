@@ -10,6 +10,7 @@ namespace slim
     class Number : public Object
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_NUMBER;
         explicit Number(double v) : v(v) {}
 
         static const std::string &name()
@@ -18,6 +19,8 @@ namespace slim
             return TYPE_NAME;
         }
         virtual const std::string& type_name()const override { return name(); }
+        /**Formats a number as to_string does.*/
+        static std::string format(double v);
         virtual std::string to_string()const override;
         virtual std::string inspect()const { return to_string(); }
         virtual bool eq(const Object *rhs)const override
@@ -49,16 +52,16 @@ namespace slim
         virtual ObjectPtr bit_xor(Object *rhs)override;
         virtual ObjectPtr bit_not()override;
 
-        std::shared_ptr<Number> to_f();
-        std::shared_ptr<Number> to_i();
-        std::shared_ptr<Number> next_float();
-        std::shared_ptr<Number> prev_float();
+        Ptr<Number> to_f();
+        Ptr<Number> to_i();
+        Ptr<Number> next_float();
+        Ptr<Number> prev_float();
 
-        std::shared_ptr<Number> ceil();
-        std::shared_ptr<Number> floor();
-        std::shared_ptr<Number> round(const FunctionArgs &args);
+        Ptr<Number> ceil();
+        Ptr<Number> floor();
+        Ptr<Number> round(const FunctionArgs &args);
 
-        std::shared_ptr<Number> abs();
+        Ptr<Number> abs();
         //Ptr<Number> abs2();
         //angle, arg
         //coerce
@@ -95,13 +98,17 @@ namespace slim
     private:
         double v;
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<Number> : std::integral_constant<uint16_t, Object::TYPE_NUMBER> {};
+    }
 
-    inline std::shared_ptr<Number> make_value(double v)
+    inline Ptr<Number> make_value(double v)
     {
         return create_object<Number>(v);
     }
-    std::shared_ptr<Number> make_value(int v);
-    std::shared_ptr<Number> make_value(unsigned v);
-    std::shared_ptr<Number> make_value(long long v);
-    std::shared_ptr<Number> make_value(unsigned long long v);
+    Ptr<Number> make_value(int v);
+    Ptr<Number> make_value(unsigned v);
+    Ptr<Number> make_value(long long v);
+    Ptr<Number> make_value(unsigned long long v);
 }
@@ -1,22 +1,31 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <unordered_map>
 #include "../Error.hpp"
 #include "../Operators.hpp"
+#include "../Ptr.hpp"
+#include "../RenderArena.hpp"
+#include "../SmallVector.hpp"
 
 namespace slim
 {
     class Object;
     class Boolean;
     class Number;
-    typedef std::shared_ptr<Object> ObjectPtr;
-    typedef std::shared_ptr<const Object> CObjectPtr;
+    typedef Ptr<Object> ObjectPtr;
+    typedef Ptr<const Object> CObjectPtr;
     class Symbol;
-    typedef std::shared_ptr<Symbol> SymPtr;
+    typedef Ptr<Symbol> SymPtr;
 
-    typedef std::vector<ObjectPtr> FunctionArgs;
+    /**Arguments for a function call. Up to 4 arguments are stored inline, so most calls do not
+     * allocate, larger lists are allocated from the RenderArena during a render.
+     */
+    typedef SmallVector<ObjectPtr, 4, RenderAllocator<ObjectPtr>> FunctionArgs;
     class Method;
     class MethodTable;
 
@@ -27,28 +36,106 @@ namespace slim
     class Number;
     class String;
 
-    template<class T> using Ptr = std::shared_ptr<T>;
-
-    /**Base abstract object for the expression script interpreter.*/
-    class Object : public std::enable_shared_from_this<Object>
+    /**Base abstract object for the expression script interpreter.
+     *
+     * Objects are reference counted by Ptr, with the count stored in the object. Objects created
+     * during a render with a RenderArena are allocated from the arena, and are assumed to be
+     * confined to the render thread, so use plain non-atomic counts. All other objects use
+     * atomic counts. An object from a render that will be used by several threads at once, such
+     * as a value placed in a global cache, must first be marked with share.
+     *
+     * Objects that live for the whole process, such as symbols and the nil, true and false
+     * singletons, are marked with set_permanent and are not counted at all, so threads using
+     * them do not contend on the count.
+     *
+     * Objects created by create also record which built-in types they are an instance of, see
+     * TypeFlag and object_cast.
+     */
+    class Object
     {
     public:
+        /**Bits for the built-in types, so that object_cast can check for them without RTTI.*/
+        enum TypeFlag : uint16_t
+        {
+            /**type_flags was set when the object was created, see init_type_flags.*/
+            TYPE_KNOWN = 1 << 0,
+            TYPE_NIL = 1 << 1,
+            TYPE_BOOLEAN = 1 << 2,
+            TYPE_NUMBER = 1 << 3,
+            TYPE_STRING = 1 << 4,
+            TYPE_HTML_SAFE_STRING = 1 << 5,
+            TYPE_SYMBOL = 1 << 6,
+            TYPE_ARRAY = 1 << 7,
+            TYPE_HASH = 1 << 8,
+            TYPE_RANGE = 1 << 9,
+            TYPE_PROC = 1 << 10,
+            TYPE_ENUMERATOR = 1 << 11,
+            TYPE_VIEW_MODEL = 1 << 12,
+            TYPE_REGEXP = 1 << 13,
+            TYPE_TIME = 1 << 14
+        };
+        /**The TypeFlag bits of this type and its bases. Built-in types redefine this, other
+         * types inherit it.
+         */
+        static const uint16_t TYPE_FLAGS = 0;
+
         /**Create an instance of this object.
          *
          * Used by slim::create_object<T> via T::create.
          *
-         * The default implementation simply uses std::make_shared and forwards to the constructor,
-         * but types may provide an alternative implementation. For example Null and Boolean are
-         * immutable types, and always return a reference to singleton null, true and false
-         * instances.
+         * The default implementation forwards to the constructor. Types may provide an
+         * alternative implementation. For example Null and Boolean are immutable types, and
+         * always return a reference to singleton null, true and false instances.
          */
         template<class T, class... Args>
-        static std::shared_ptr<T> create(Args && ... args)
+        static Ptr<T> create(Args && ... args)
+        {
+            return Ptr<T>(init_type_flags(new T(std::forward<Args>(args)...)));
+        }
+        /**Sets the type_flags of a new object of exactly type T, for objects not created by
+         * create. Without this object_cast uses dynamic_cast for the object.
+         */
+        template<class T> static T *init_type_flags(T *obj)
         {
-            return std::make_shared<T>(std::forward<Args>(args)...);
+            static_cast<Object*>(obj)->type_flags = T::TYPE_FLAGS | TYPE_KNOWN;
+            return obj;
         }
+        /**Allocates from the current RenderArena during a render, else the global heap.*/
+        static void *operator new(size_t size);
+        static void operator delete(void *p, size_t size);
 
+        Object() : refs(0), ref_policy(RenderArena::current() ? REFS_LOCAL : REFS_ATOMIC), type_flags(0) {}
+        /**Copies get their own count, with the policy for the thread creating the copy.*/
+        Object(const Object &) : Object() {}
+        Object& operator = (const Object &) { return *this; }
         virtual ~Object() {}
+
+        /**Get a new reference to this object.*/
+        ObjectPtr shared_from_this() { return ObjectPtr(this); }
+        CObjectPtr shared_from_this()const { return CObjectPtr(this); }
+        /**True if other threads may use this object, see share.*/
+        bool is_shared()const { return ref_policy != REFS_LOCAL; }
+        /**Use an atomic reference count from now on, so that other threads may use this object
+         * concurrently. Must be called before the object is made available to other threads.
+         * ViewModel calls this for the values stored in it.
+         *
+         * Also shares the objects referenced by this one, such as Array elements, see share_refs.
+         * Objects that are already shared are not visited again, so an object that is modified
+         * after being shared must share any new values itself.
+         */
+        void share()
+        {
+            if (ref_policy != REFS_LOCAL) return;
+            ref_policy = REFS_ATOMIC;
+            share_refs();
+        }
+        /**Stop counting references, so this object is never freed.
+         * Must be called before the object is made available to other threads.
+         */
+        void set_permanent() { ref_policy = REFS_NONE; }
+        /**The TypeFlag bits for this object, 0 if not known.*/
+        uint16_t get_type_flags()const { return type_flags; }
+
         /**Returns the type name of this object.
          * Should vary by class only, not instances such that a comparison of type_name strings
          * is equivalent to comparing the typeid of the instances.
@@ -59,7 +146,7 @@ namespace slim
         /**Convert this instance to a displayable representation of this object.*/
         virtual std::string inspect()const;
         /**Convert this instance to a displayable string object. The default uses to_string. */
-        virtual std::shared_ptr<String> to_string_obj();
+        virtual Ptr<String> to_string_obj();
         /**Convert this instance to a displayable representation of this object.
          * The default uses inspect.
          */
@@ -114,11 +201,51 @@ namespace slim
     protected:
         /**Get a function table for the default implementation of call_method.*/
         virtual const MethodTable &method_table()const;
+        /**Called by share to share the objects this one holds references to.
+         * Types that hold other objects override this.
+         */
+        virtual void share_refs() {}
 
         template<class T> Ptr<T> this_ptr()
         {
-            return std::static_pointer_cast<T>(shared_from_this());
+            return Ptr<T>(static_cast<T*>(this));
+        }
+    private:
+        template<class T> friend class Ptr;
+
+        enum RefPolicy : uint8_t
+        {
+            /**Plain count, confined to one thread.*/
+            REFS_LOCAL,
+            REFS_ATOMIC,
+            /**Not counted, see set_permanent.*/
+            REFS_NONE
+        };
+        mutable std::atomic<uint32_t> refs;
+        RefPolicy ref_policy;
+        uint16_t type_flags;
+
+        void add_ref()const
+        {
+            if (ref_policy == REFS_LOCAL)
+                refs.store(refs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            else if (ref_policy == REFS_ATOMIC)
+                refs.fetch_add(1, std::memory_order_relaxed);
         }
+        void release()const
+        {
+            if (ref_policy == REFS_LOCAL)
+            {
+                auto n = refs.load(std::memory_order_relaxed) - 1;
+                if (n == 0) delete this;
+                else refs.store(n, std::memory_order_relaxed);
+            }
+            else if (ref_policy == REFS_ATOMIC)
+            {
+                if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+            }
+        }
+        uint32_t ref_count()const { return refs.load(std::memory_order_relaxed); }
     };
 
     /**Create an instance of an object of type T.
@@ -128,11 +255,48 @@ namespace slim
      * See Object::create for details on providing custom implementations.
      */
     template<class T, class... Args>
-    std::shared_ptr<T> create_object(Args && ... args)
+    Ptr<T> create_object(Args && ... args)
     {
         return T::template create<T>(std::forward<Args>(args)...);
     }
 
+    namespace detail
+    {
+        /**The Object::TypeFlag bit of exactly type T, or 0 if T is not a built-in type.
+         * Specialised next to each built-in type.
+         */
+        template<class T> struct TypeFlagOf : std::integral_constant<uint16_t, 0> {};
+
+        template<class T> T *object_cast(Object *obj, std::true_type)
+        {
+            if (!obj) return nullptr;
+            auto flags = obj->get_type_flags();
+            if (flags & Object::TYPE_KNOWN)
+                return (flags & TypeFlagOf<T>::value) ? static_cast<T*>(obj) : nullptr;
+            return dynamic_cast<T*>(obj);
+        }
+        template<class T> T *object_cast(Object *obj, std::false_type)
+        {
+            return dynamic_cast<T*>(obj);
+        }
+    }
+    /**Same as dynamic_cast<T*>(obj), but checks Object::get_type_flags for the built-in types
+     * rather than using RTTI.
+     */
+    template<class T> T *object_cast(Object *obj)
+    {
+        return detail::object_cast<T>(obj, std::integral_constant<bool, detail::TypeFlagOf<T>::value != 0>());
+    }
+    template<class T> const T *object_cast(const Object *obj)
+    {
+        return object_cast<T>(const_cast<Object*>(obj));
+    }
+    /**Same as dynamic_pointer_cast, using object_cast.*/
+    template<class T, class U> Ptr<T> object_pointer_cast(const Ptr<U> &ptr)
+    {
+        return Ptr<T>(object_cast<T>(ptr.get()));
+    }
+
     double as_number(const Object *obj);
     inline double as_number(const ObjectPtr &obj)
     {
@@ -142,25 +306,25 @@ namespace slim
 
     template<class T> T *coerce(Object *obj)
     {
-        auto obj2 = dynamic_cast<T*>(obj);
+        auto obj2 = object_cast<T>(obj);
         if (obj2) return obj2;
         else throw TypeError(obj, T::name());
     }
     template<class T> const T *coerce(const Object *obj)
     {
-        auto obj2 = dynamic_cast<const T*>(obj);
+        auto obj2 = object_cast<T>(obj);
         if (obj2) return obj2;
         else throw TypeError(obj, T::name());
     }
-    template<class T> std::shared_ptr<T>coerce(const std::shared_ptr<Object> &obj)
+    template<class T> Ptr<T> coerce(const ObjectPtr &obj)
     {
-        auto obj2 = std::dynamic_pointer_cast<T>(obj);
+        auto obj2 = object_pointer_cast<T>(obj);
         if (obj2) return obj2;
         else throw TypeError(obj.get(), T::name());
     }
-    template<class T> std::shared_ptr<const T> coerce(const std::shared_ptr<const Object> &obj)
+    template<class T> Ptr<const T> coerce(const CObjectPtr &obj)
     {
-        auto obj2 = std::dynamic_pointer_cast<const T>(obj);
+        auto obj2 = Ptr<const T>(object_cast<T>(obj.get()));
         if (obj2) return obj2;
         else throw TypeError(obj.get(), T::name());
     }
@@ -10,10 +10,16 @@ namespace slim
         class ExpressionNode;
         class Scope;
     }
-    /**Callable proc object. This is as callable object used for blocks.*/
+    /**Callable proc object. This is as callable object used for blocks.
+     *
+     * Methods that iterate, such as each, call the proc with iterate, and stop once it returns
+     * false. A proc stops the iteration by calling stop from within call, so early exits such as
+     * any? and find do not unwind through the iterating methods with an exception.
+     */
     class Proc : public Object
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_PROC;
         static const std::string &name()
         {
             static const std::string TYPE_NAME = "Proc";
@@ -22,9 +28,36 @@ namespace slim
         virtual const std::string& type_name()const override { return name(); }
 
         virtual ObjectPtr call(const FunctionArgs &args)=0;
+
+        /**Calls the proc for an iteration, returning false if the iteration should stop.*/
+        bool iterate(const FunctionArgs &args)
+        {
+            call(args);
+            return !_stopped;
+        }
+        /**Stop the iteration calling this proc once the current call returns.
+         * The iterating method returns value, or nil.
+         */
+        void stop(ObjectPtr value = nullptr)
+        {
+            _stopped = true;
+            stop_value = value;
+        }
+        bool stopped()const { return _stopped; }
+        /**Called by the iterating method once done. Clears the stop, and returns the value to
+         * return from the iterating method, which is ret if the iteration was not stopped.
+         */
+        ObjectPtr end_iteration(ObjectPtr ret);
     protected:
         virtual const MethodTable &method_table()const override;
+    private:
+        bool _stopped = false;
+        ObjectPtr stop_value;
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<Proc> : std::integral_constant<uint16_t, Object::TYPE_PROC> {};
+    }
     /**Proc object for a script code block.*/
     class BlockProc : public Proc
     {
@@ -33,11 +66,18 @@ namespace slim
             const expr::ExpressionNode &code,
             const std::vector<SymPtr> &param_names,
             expr::Scope &scope);
+        /**locals is the layout of the scope created for each call, starting with param_names.*/
+        BlockProc(
+            const expr::ExpressionNode &code,
+            const std::vector<SymPtr> &param_names,
+            const std::vector<SymPtr> &locals,
+            expr::Scope &scope);
 
         virtual ObjectPtr call(const FunctionArgs &args)override;
     private:
         const expr::ExpressionNode &code;
         const std::vector<SymPtr> &param_names;
+        const std::vector<SymPtr> &locals;
         expr::Scope &scope;
     };
     /**Proc object for a c++ function object.*/
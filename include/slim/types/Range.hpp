@@ -1,6 +1,7 @@
 #pragma once
 #include "Object.hpp"
 #include "Enumerable.hpp"
+#include "Number.hpp"
 namespace slim
 {
     class Boolean;
@@ -9,6 +10,7 @@ namespace slim
     class Range : public Object, public Enumerable
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_RANGE;
         Range(Ptr<Number> begin, Ptr<Number> end, Boolean *exclude_end);
         Range(Ptr<Number> begin, Ptr<Number> end, bool exclude_end);
         Range(Ptr<Object> begin, Ptr<Object> end, bool exclude_end);
@@ -33,6 +35,10 @@ namespace slim
          */
         bool get_beg_len(int *range_begin, int *range_len, int seq_len);
 
+        double get_begin()const { return _begin; }
+        double get_end()const { return _end; }
+        bool get_exclude_end()const { return exclude_end; }
+
         //bsearch
         Ptr<Object> begin();
         bool cover_q(Object *obj);
@@ -50,4 +56,23 @@ namespace slim
         double _begin, _end;
         bool exclude_end;
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<Range> : std::integral_constant<uint16_t, Object::TYPE_RANGE> {};
+        template<> struct NativeEach<Range>
+        {
+            template<class F> static bool each(Range *self, F f)
+            {
+                auto end = self->get_end();
+                auto exclude_end = self->get_exclude_end();
+                FunctionArgs args(1);
+                for (auto i = self->get_begin(); exclude_end ? i < end : i <= end; i += 1)
+                {
+                    args[0] = make_value(i);
+                    if (!f(args)) return false;
+                }
+                return true;
+            }
+        };
+    }
 }
@@ -41,6 +41,7 @@ namespace slim
         Ptr<Array> values_at(const FunctionArgs &args);
     protected:
         virtual const MethodTable &method_table()const;
+        virtual void share_refs()override;
     private:
         friend class Regexp;
         Ptr<Regexp> regex;
@@ -58,6 +59,7 @@ namespace slim
     class Regexp : public Object
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_REGEXP;
         static const int IGNORECASE = 1;
         static const int EXTENDED = 2;
         static const int MULTILINE = 4;
@@ -115,6 +117,10 @@ namespace slim
         int opts;
         std::regex regex;
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<Regexp> : std::integral_constant<uint16_t, Object::TYPE_REGEXP> {};
+    }
 
     class RegexpType : public SimpleClass<Regexp>
     {
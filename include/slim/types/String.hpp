@@ -9,6 +9,7 @@ namespace slim
     class String : public Object
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_STRING;
         explicit String(std::string &&v) : v(std::move(v)) {}
         explicit String(const std::string &v) : v(v) {}
         explicit String() : v() {}
@@ -21,9 +22,9 @@ namespace slim
         virtual const std::string& type_name()const override { return name(); }
         virtual std::string to_string()const override { return v; }
         virtual std::string inspect()const override;
-        virtual std::shared_ptr<String> to_string_obj()override
+        virtual Ptr<String> to_string_obj()override
         {
-            return std::static_pointer_cast<String>(shared_from_this());
+            return static_pointer_cast<String>(shared_from_this());
         }
         virtual bool eq(const Object *rhs)const override
         {
@@ -41,12 +42,12 @@ namespace slim
         //% * << =~
         virtual ObjectPtr el_ref(const FunctionArgs &args)override;
 
-        std::shared_ptr<Number> to_f();
-        std::shared_ptr<Number> to_i();
+        Ptr<Number> to_f();
+        Ptr<Number> to_i();
         /** Also intern */
-        std::shared_ptr<Symbol> to_sym();
+        Ptr<Symbol> to_sym();
         /** Return a copy as a HtmlSafeString. */
-        std::shared_ptr<String> html_safe();
+        Ptr<String> html_safe();
 
         //static try_convert
 
@@ -54,7 +55,7 @@ namespace slim
         //b, force_encoding, encode, encoding
         //each_byte, each_char, each_codepoint
         //setbyte
-        std::shared_ptr<Boolean> ascii_only_q();
+        Ptr<Boolean> ascii_only_q();
         Ptr<Array> bytes();
         Ptr<Object> byteslice(const FunctionArgs &args);
         Ptr<Array> chars();
@@ -65,11 +66,11 @@ namespace slim
         Ptr<String> scrub(const FunctionArgs &args);
         //scrub!
 
-        std::shared_ptr<String> capitalize();
+        Ptr<String> capitalize();
         //capitalize!
         ObjectPtr casecmp(String *rhs);
-        std::shared_ptr<String> center(const FunctionArgs &args);
-        std::shared_ptr<String> chomp(const FunctionArgs &args);
+        Ptr<String> center(const FunctionArgs &args);
+        Ptr<String> chomp(const FunctionArgs &args);
         //chomp!
         //chop!
         //clear
@@ -78,50 +79,50 @@ namespace slim
         //crypt
         //Ptr<String> delete
         //delete!
-        std::shared_ptr<String> downcase();
+        Ptr<String> downcase();
         //downcase!
         //dump
         Ptr<Object> each_byte(const FunctionArgs &args);
         Ptr<Object> each_char(const FunctionArgs &args);
         Ptr<Object> each_codepoint(const FunctionArgs &args);
         ObjectPtr each_line(const FunctionArgs &args);
-        std::shared_ptr<Boolean> empty_q();
+        Ptr<Boolean> empty_q();
         //encode, encode!
-        std::shared_ptr<Boolean> end_with_q(const FunctionArgs &args);
+        Ptr<Boolean> end_with_q(const FunctionArgs &args);
         //eql?
         Ptr<String> gsub(const FunctionArgs &args);
         //gsub!
-        std::shared_ptr<Number> hex();
-        std::shared_ptr<Boolean> include_q(const String *rhs);
+        Ptr<Number> hex();
+        Ptr<Boolean> include_q(const String *rhs);
         ObjectPtr index(const FunctionArgs &args);
         //insert
-        std::shared_ptr<Array> lines(const FunctionArgs &args);
-        std::shared_ptr<String> ljust(const FunctionArgs &args);
-        std::shared_ptr<String> lstrip();
+        Ptr<Array> lines(const FunctionArgs &args);
+        Ptr<String> ljust(const FunctionArgs &args);
+        Ptr<String> lstrip();
         //lstrip!
         Ptr<Object> match(const FunctionArgs &args);
         //next, next!
         //oct
-        std::shared_ptr<Number> ord();
-        std::shared_ptr<Array> partition(Object *obj);
+        Ptr<Number> ord();
+        Ptr<Array> partition(Object *obj);
         //prepend
         //replace
-        std::shared_ptr<String> reverse();
-        std::shared_ptr<String> rjust(const FunctionArgs &args);
-        std::shared_ptr<Array> rpartition(Object *obj);
-        std::shared_ptr<String> rstrip();
+        Ptr<String> reverse();
+        Ptr<String> rjust(const FunctionArgs &args);
+        Ptr<Array> rpartition(Object *obj);
+        Ptr<String> rstrip();
         //rstrip!
         //reverse!
         ObjectPtr rindex(const FunctionArgs &args);
         //scan
 
         /** Also length */
-        std::shared_ptr<Number> size();
+        Ptr<Number> size();
         //slice!
         Ptr<Array> split(const FunctionArgs &args);
-        //std::shared_ptr<String> squeeze(const FunctionArgs &args);
-        std::shared_ptr<Boolean> start_with_q(const FunctionArgs &args);
-        std::shared_ptr<String> strip();
+        //Ptr<String> squeeze(const FunctionArgs &args);
+        Ptr<Boolean> start_with_q(const FunctionArgs &args);
+        Ptr<String> strip();
         //strip!
         Ptr<String> substitute(const FunctionArgs &args);
         //sub!
@@ -129,12 +130,12 @@ namespace slim
         //sum
         //swapcase, sawpcase!
         //to_c, to_r
-        //std::shared_ptr<String> tr(const String *from_str, const String *to_str);
+        //Ptr<String> tr(const String *from_str, const String *to_str);
         //tr!
-        //std::shared_ptr<String> tr_s(const String *from_str, const String *to_str);
+        //Ptr<String> tr_s(const String *from_str, const String *to_str);
         //tr_s!
         //unpack
-        std::shared_ptr<String> upcase();
+        Ptr<String> upcase();
         //upcase!
         //upto
         //valid_encoding?
@@ -144,13 +145,17 @@ namespace slim
     private:
         std::string v;
 
-        std::shared_ptr<Array> do_partition(bool reverse, Object *sep);
+        Ptr<Array> do_partition(bool reverse, Object *sep);
         ObjectPtr do_slice(int start, int length);
         Ptr<String> do_sub(const FunctionArgs &args, bool global);
         std::vector<std::string> split_lines()const;
         std::vector<std::string> split_lines(const std::string &sep)const;
     };
-    typedef std::shared_ptr<String> StringPtr;
+    namespace detail
+    {
+        template<> struct TypeFlagOf<String> : std::integral_constant<uint16_t, Object::TYPE_STRING> {};
+    }
+    typedef Ptr<String> StringPtr;
 
     inline StringPtr make_value(std::string &&v)
     {
@@ -30,6 +30,7 @@ namespace slim
     class Symbol : public Object
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_SYMBOL;
         ~Symbol();
 
         static const std::string &name()
@@ -44,20 +45,53 @@ namespace slim
         virtual size_t hash()const override;
         virtual int cmp(const Object *rhs)const override;
 
-        const std::shared_ptr<String> &str_obj()const { return _str; }
+        const Ptr<String> &str_obj()const { return _str; }
         const std::string &str()const;
         const char *c_str()const;
+        /**Unique sequential number for this symbol, assigned when it is first created.
+         * Used as a compact key, e.g. by MethodTable.
+         */
+        uint32_t id()const { return _id; }
 
         Ptr<Proc> to_proc();
     protected:
         virtual const MethodTable &method_table()const;
     private:
-        explicit Symbol(std::shared_ptr<String> str);
-        std::shared_ptr<String> _str;
+        explicit Symbol(Ptr<String> str);
+        Ptr<String> _str;
+        uint32_t _id;
 
-        friend std::shared_ptr<Symbol> symbol(const std::string &str);
+        friend Ptr<Symbol> symbol(const std::string &str);
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<Symbol> : std::integral_constant<uint16_t, Object::TYPE_SYMBOL> {};
+    }
 
     SymPtr symbol(const std::string &str);
-    SymPtr symbol(std::shared_ptr<String> str);
+    SymPtr symbol(Ptr<String> str);
+
+    /**Symbols used by the interpreter itself, resolved once during static initialisation so that
+     * rendering never needs to call slim::symbol for them.
+     */
+    namespace syms
+    {
+        /**The root "self" variable.*/
+        extern const SymPtr self;
+        /**Variable holding the OutputBuffer for template blocks.*/
+        extern const SymPtr output_buffer;
+        extern const SymPtr to_proc;
+        //Method names for enumerators created without a block
+        extern const SymPtr each;
+        extern const SymPtr each_byte;
+        extern const SymPtr each_char;
+        extern const SymPtr each_codepoint;
+        extern const SymPtr each_key;
+        extern const SymPtr each_line;
+        extern const SymPtr each_value;
+        extern const SymPtr reverse_each;
+        extern const SymPtr sort_by;
+        extern const SymPtr step;
+        extern const SymPtr with_index;
+    }
 }
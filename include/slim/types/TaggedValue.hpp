@@ -0,0 +1,161 @@
+#pragma once
+#include "Object.hpp"
+#include "Boolean.hpp"
+#include "Nil.hpp"
+#include "Number.hpp"
+#include <cstdint>
+#include <new>
+#include <typeinfo>
+namespace slim
+{
+    /**@brief A script value that stores numbers, booleans and nil inline.
+     *
+     * Used by the VM operand stack and local variables, so that arithmetic, comparisons and
+     * loop counters do not allocate a Number for every intermediate result. Any other value is
+     * held as an ObjectPtr. box converts back to an ObjectPtr where an Object is required, such
+     * as for method calls, allocating a Number for an inline number.
+     *
+     * A default constructed TaggedValue is empty, like a null ObjectPtr, which is distinct from
+     * nil.
+     */
+    class TaggedValue
+    {
+    public:
+        enum Tag : uint8_t
+        {
+            TAG_EMPTY,
+            TAG_NIL,
+            TAG_TRUE,
+            TAG_FALSE,
+            /**Inline double.*/
+            TAG_NUMBER,
+            /**Any Object, including a Number not created by the VM.*/
+            TAG_OBJECT
+        };
+
+        TaggedValue() : tag(TAG_EMPTY), num(0) {}
+        TaggedValue(std::nullptr_t) : tag(TAG_EMPTY), num(0) {}
+        TaggedValue(double v) : tag(TAG_NUMBER), num(v) {}
+        /**Boolean and Nil singletons are stored inline, anything else is kept as an object.*/
+        TaggedValue(ObjectPtr o) : tag(TAG_OBJECT), num(0)
+        {
+            if (!o) tag = TAG_EMPTY;
+            else if (o == NIL_VALUE) tag = TAG_NIL;
+            else if (o == TRUE_VALUE) tag = TAG_TRUE;
+            else if (o == FALSE_VALUE) tag = TAG_FALSE;
+            else new (&obj) ObjectPtr(std::move(o));
+        }
+        template<class T> TaggedValue(Ptr<T> o) : TaggedValue(ObjectPtr(std::move(o))) {}
+        static TaggedValue nil() { TaggedValue v; v.tag = TAG_NIL; return v; }
+        static TaggedValue from_bool(bool b) { TaggedValue v; v.tag = b ? TAG_TRUE : TAG_FALSE; return v; }
+
+        TaggedValue(const TaggedValue &other) : tag(other.tag)
+        {
+            if (tag == TAG_OBJECT) new (&obj) ObjectPtr(other.obj);
+            else num = other.num;
+        }
+        TaggedValue(TaggedValue &&other) : tag(other.tag)
+        {
+            if (tag == TAG_OBJECT) new (&obj) ObjectPtr(std::move(other.obj));
+            else num = other.num;
+        }
+        TaggedValue& operator = (const TaggedValue &other)
+        {
+            if (this != &other)
+            {
+                if (tag == TAG_OBJECT && other.tag == TAG_OBJECT) obj = other.obj;
+                else
+                {
+                    reset();
+                    if (other.tag == TAG_OBJECT) new (&obj) ObjectPtr(other.obj);
+                    else num = other.num;
+                    tag = other.tag;
+                }
+            }
+            return *this;
+        }
+        TaggedValue& operator = (TaggedValue &&other)
+        {
+            if (this != &other)
+            {
+                if (tag == TAG_OBJECT && other.tag == TAG_OBJECT) obj = std::move(other.obj);
+                else
+                {
+                    reset();
+                    if (other.tag == TAG_OBJECT) new (&obj) ObjectPtr(std::move(other.obj));
+                    else num = other.num;
+                    tag = other.tag;
+                }
+            }
+            return *this;
+        }
+        ~TaggedValue() { reset(); }
+
+        Tag get_tag()const { return tag; }
+        /**False if empty.*/
+        explicit operator bool()const { return tag != TAG_EMPTY; }
+        bool is_nil()const { return tag == TAG_NIL; }
+        /**True for inline numbers, and Number objects.*/
+        bool is_number()const
+        {
+            return tag == TAG_NUMBER || (tag == TAG_OBJECT && typeid(*obj) == typeid(Number));
+        }
+        /**The value of a number. is_number must be true.*/
+        double number()const
+        {
+            return tag == TAG_NUMBER ? num : static_cast<const Number*>(obj.get())->get_value();
+        }
+        /**Truthiness, as Object::is_true.*/
+        bool is_true()const
+        {
+            switch (tag)
+            {
+            case TAG_NIL: case TAG_FALSE: return false;
+            case TAG_OBJECT: return obj->is_true();
+            default: return true;
+            }
+        }
+        /**Get as an ObjectPtr. Allocates a Number for an inline number.*/
+        ObjectPtr box()const
+        {
+            switch (tag)
+            {
+            case TAG_EMPTY: return nullptr;
+            case TAG_NIL: return NIL_VALUE;
+            case TAG_TRUE: return TRUE_VALUE;
+            case TAG_FALSE: return FALSE_VALUE;
+            case TAG_NUMBER: return make_value(num);
+            default: return obj;
+            }
+        }
+        /**Get as an Object without boxing. Must not be an inline number or empty.*/
+        Object *get()const
+        {
+            switch (tag)
+            {
+            case TAG_NIL: return NIL_VALUE.get();
+            case TAG_TRUE: return TRUE_VALUE.get();
+            case TAG_FALSE: return FALSE_VALUE.get();
+            default: return obj.get();
+            }
+        }
+        /**Object::to_string, without boxing.*/
+        std::string to_string()const
+        {
+            return tag == TAG_NUMBER ? Number::format(num) : get()->to_string();
+        }
+    private:
+        Tag tag;
+        union
+        {
+            double num;
+            ObjectPtr obj;
+        };
+
+        void reset()
+        {
+            if (tag == TAG_OBJECT) obj.~ObjectPtr();
+            tag = TAG_EMPTY;
+        }
+    };
+}
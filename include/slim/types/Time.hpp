@@ -16,6 +16,7 @@ namespace slim
     class Time : public Object
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_TIME;
         static const int TICKS_SECOND = 1;
         static const int TICKS_MIN = TICKS_SECOND * 60;
         static const int TICKS_HOUR = TICKS_MIN * 60;
@@ -96,6 +97,10 @@ namespace slim
     private:
         time_t v;
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<Time> : std::integral_constant<uint16_t, Object::TYPE_TIME> {};
+    }
 
     class TimeType : public Type
     {
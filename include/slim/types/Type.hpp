@@ -16,7 +16,7 @@ namespace slim
 
         virtual ObjectPtr get_constant(SymPtr name)override
         {
-            ObjectPtr key = std::static_pointer_cast<Object>(name);
+            ObjectPtr key = static_pointer_cast<Object>(name);
             auto it = constants.find(key);
             if (it != constants.end()) return it->second;
             else throw NoConstantError(this, name);
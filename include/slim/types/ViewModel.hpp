@@ -11,6 +11,7 @@ namespace slim
     class ViewModel : public Object
     {
     public:
+        static const uint16_t TYPE_FLAGS = TYPE_VIEW_MODEL;
         ViewModel();
         ~ViewModel();
 
@@ -31,22 +32,27 @@ namespace slim
         void set_attr(SymPtr name, ObjectPtr value);
         void set_attr(const std::string &name, ObjectPtr value);
 
-        void content_for(SymPtr name, std::shared_ptr<Proc> proc);
-        std::shared_ptr<HtmlSafeString> yield(const FunctionArgs &args);
+        void content_for(SymPtr name, Ptr<Proc> proc);
+        Ptr<HtmlSafeString> yield(const FunctionArgs &args);
         /**Used by Template to store the content for the layout Template.*/
-        void set_main_content(std::shared_ptr<HtmlSafeString> content);
+        void set_main_content(Ptr<HtmlSafeString> content);
     protected:
         ObjectMap attrs;
         ObjectMap constants;
         /**Content from the main view for a "yield" in layout.*/
-        std::shared_ptr<HtmlSafeString> main_content;
+        Ptr<HtmlSafeString> main_content;
         /**Save all the rendered content_for blocks for yield.*/
         ObjectMap content_for_store;
 
         virtual const MethodTable &method_table()const override;
+        virtual void share_refs()override;
     };
+    namespace detail
+    {
+        template<> struct TypeFlagOf<ViewModel> : std::integral_constant<uint16_t, Object::TYPE_VIEW_MODEL> {};
+    }
 
-    typedef std::shared_ptr<ViewModel> ViewModelPtr;
+    typedef Ptr<ViewModel> ViewModelPtr;
     inline ViewModelPtr create_view_model()
     {
         return create_object<ViewModel>();
@@ -0,0 +1,132 @@
+#include "Template.hpp"
+#include "template/CppGenerator.hpp"
+#include "template/Lexer.hpp"
+#include "template/Optimizer.hpp"
+#include "template/Parser.hpp"
+#include "Error.hpp"
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    void usage()
+    {
+        std::cerr <<
+            "Usage: slimc [options] <input.slim>\n"
+            "Compiles a Slim template to a C++ source file.\n"
+            "\n"
+            "  -o <file>          Output source file (default stdout)\n"
+            "  --header <file>    Also write a header declaring the render function\n"
+            "  --name <name>      Render function name (default render_<input name>)\n"
+            "  --namespace <ns>   Namespace for the render function\n"
+            "  --test             Check each render against the interpreted template\n"
+            "  --dump-ast         Print the parsed template tree before and after optimization\n";
+    }
+
+    std::string read_file(const std::string &path)
+    {
+        std::ifstream is(path, std::ios::in | std::ios::binary);
+        if (!is) throw std::runtime_error("Failed to open " + path);
+        std::stringstream ss;
+        ss << is.rdbuf();
+        return ss.str();
+    }
+    void write_file(const std::string &path, const std::string &data)
+    {
+        std::ofstream os(path, std::ios::out | std::ios::binary);
+        if (!os) throw std::runtime_error("Failed to open " + path);
+        os.write(data.data(), (std::streamsize)data.size());
+        if (!os) throw std::runtime_error("Failed to write " + path);
+    }
+
+    /**"views/index.html.slim" to "render_index".*/
+    std::string default_name(const std::string &path)
+    {
+        auto start = path.find_last_of("/\\");
+        auto name = path.substr(start == std::string::npos ? 0 : start + 1);
+        name = name.substr(0, name.find('.'));
+        for (auto &c : name) if (!std::isalnum((unsigned char)c)) c = '_';
+        return "render_" + name;
+    }
+
+    std::string dump_ast(const std::string &source, bool optimize)
+    {
+        slim::tpl::Lexer lexer(source.c_str(), source.c_str() + source.size());
+        slim::tpl::Parser parser(lexer);
+        parser.set_optimize(optimize);
+        return slim::tpl::dump_tree(parser.parse().get_root());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string input, output, header;
+    slim::tpl::CppOptions options;
+    bool dump = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                usage();
+                exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "-o") output = value();
+        else if (arg == "--header") header = value();
+        else if (arg == "--name") options.function_name = value();
+        else if (arg == "--namespace") options.name_space = value();
+        else if (arg == "--test") options.test_mode = true;
+        else if (arg == "--dump-ast") dump = true;
+        else if (arg == "-h" || arg == "--help")
+        {
+            usage();
+            return 0;
+        }
+        else if (input.empty() && arg[0] != '-') input = arg;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (input.empty())
+    {
+        usage();
+        return 2;
+    }
+    if (options.function_name.empty()) options.function_name = default_name(input);
+
+    try
+    {
+        auto source = read_file(input);
+        if (dump)
+        {
+            std::cout << "# parsed\n" << dump_ast(source, false)
+                << "# optimized\n" << dump_ast(source, true);
+            return 0;
+        }
+        auto tpl = slim::parse_template(source);
+        if (!header.empty())
+        {
+            //Include by file name, the build adds the output directory to the include path
+            auto start = header.find_last_of("/\\");
+            options.header = header.substr(start == std::string::npos ? 0 : start + 1);
+            write_file(header, slim::tpl::generate_cpp_header(options));
+        }
+        auto cpp = slim::tpl::generate_cpp(tpl, source, options);
+        if (output.empty()) std::cout << cpp;
+        else write_file(output, cpp);
+        return 0;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << input << ": " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,40 @@
+# slim_compile_templates(<target> [NAMESPACE <namespace>] [TEST] TEMPLATES <file.slim>...)
+#
+# Compiles each Slim template to C++ with slimc at build time, and adds the sources to target.
+# For "views/index.html.slim" this generates "index.html.cpp" and "index.html.hpp", which
+# declares:
+#
+#     std::string render_index(slim::ViewModelPtr model, bool doctype = true);
+#
+# The same as slim::Template::render, without needing to parse the template at runtime.
+#
+# TEST makes every render also render the template with the interpreter, and throw slim::Error
+# if the output differs.
+function(slim_compile_templates TARGET)
+    cmake_parse_arguments(SLIM "TEST" "NAMESPACE" "TEMPLATES" ${ARGN})
+    set(OUT_DIR "${CMAKE_CURRENT_BINARY_DIR}/slim_templates/${TARGET}")
+    set(SLIMC_ARGS)
+    if(SLIM_NAMESPACE)
+        list(APPEND SLIMC_ARGS --namespace ${SLIM_NAMESPACE})
+    endif()
+    if(SLIM_TEST)
+        list(APPEND SLIMC_ARGS --test)
+    endif()
+    foreach(TEMPLATE ${SLIM_TEMPLATES})
+        get_filename_component(TEMPLATE_PATH "${TEMPLATE}" ABSOLUTE)
+        get_filename_component(TEMPLATE_NAME "${TEMPLATE}" NAME)
+        string(REGEX REPLACE "\\.slim$" "" OUT_NAME "${TEMPLATE_NAME}")
+        set(OUT_CPP "${OUT_DIR}/${OUT_NAME}.cpp")
+        set(OUT_HPP "${OUT_DIR}/${OUT_NAME}.hpp")
+        add_custom_command(
+            OUTPUT "${OUT_CPP}" "${OUT_HPP}"
+            COMMAND ${CMAKE_COMMAND} -E make_directory "${OUT_DIR}"
+            COMMAND slimc ${SLIMC_ARGS} -o "${OUT_CPP}" --header "${OUT_HPP}" "${TEMPLATE_PATH}"
+            DEPENDS slimc "${TEMPLATE_PATH}"
+            COMMENT "Compiling Slim template ${TEMPLATE_NAME}"
+            VERBATIM
+        )
+        target_sources(${TARGET} PRIVATE "${OUT_CPP}" "${OUT_HPP}")
+    endforeach()
+    target_include_directories(${TARGET} PRIVATE "${OUT_DIR}")
+endfunction()
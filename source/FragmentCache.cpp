@@ -0,0 +1,140 @@
+#include "FragmentCache.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace slim
+{
+    thread_local FragmentStore *FragmentStore::current_store = nullptr;
+
+    LruFragmentStore::LruFragmentStore()
+        : LruFragmentStore(Options())
+    {}
+    LruFragmentStore::LruFragmentStore(const Options &options)
+        : options(options), shard_bytes(0), shards()
+    {
+        if (this->options.shards == 0) this->options.shards = 1;
+        shard_bytes = this->options.max_bytes / this->options.shards;
+        shards.reset(new Shard[this->options.shards]);
+    }
+
+    bool LruFragmentStore::get(const std::string &key, std::string *fragment)
+    {
+        auto &shard = this->shard(key);
+        std::unique_lock<std::mutex> guard(shard.lock);
+        auto it = shard.entries.find(key);
+        bool hit = false;
+        if (it != shard.entries.end())
+        {
+            if (options.ttl != Clock::duration::zero() && Clock::now() >= it->second->expires)
+            {
+                ++shard.expirations;
+                remove(shard, it->second);
+            }
+            else
+            {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                *fragment = shard.lru.front().fragment;
+                hit = true;
+            }
+        }
+        count(shard, key, hit);
+        return hit;
+    }
+
+    void LruFragmentStore::put(const std::string &key, const std::string &fragment)
+    {
+        auto &shard = this->shard(key);
+        auto expires = options.ttl != Clock::duration::zero() ? Clock::now() + options.ttl : Clock::time_point();
+        std::unique_lock<std::mutex> guard(shard.lock);
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end()) remove(shard, it->second);
+        // Too large to store, but the previous fragment is still removed as it is out of date
+        if (key.size() + fragment.size() > shard_bytes) return;
+
+        shard.lru.push_front({key, fragment, expires});
+        shard.entries[key] = shard.lru.begin();
+        shard.bytes += entry_size(shard.lru.front());
+        while (shard.bytes > shard_bytes)
+        {
+            ++shard.evictions;
+            remove(shard, std::prev(shard.lru.end()));
+        }
+    }
+
+    LruFragmentStore::Stats LruFragmentStore::stats()const
+    {
+        Stats stats = {};
+        for (size_t i = 0; i < options.shards; ++i)
+        {
+            auto &shard = shards[i];
+            std::unique_lock<std::mutex> guard(shard.lock);
+            stats.hits += shard.hits;
+            stats.misses += shard.misses;
+            stats.evictions += shard.evictions;
+            stats.expirations += shard.expirations;
+            stats.entries += shard.lru.size();
+            stats.bytes += shard.bytes;
+        }
+        return stats;
+    }
+
+    std::vector<LruFragmentStore::KeyStats> LruFragmentStore::key_stats()const
+    {
+        std::vector<KeyStats> out;
+        for (size_t i = 0; i < options.shards; ++i)
+        {
+            auto &shard = shards[i];
+            std::unique_lock<std::mutex> guard(shard.lock);
+            for (auto &count : shard.counts)
+                out.push_back({count.first, count.second.hits, count.second.misses});
+        }
+        std::sort(out.begin(), out.end(), [](const KeyStats &a, const KeyStats &b) {
+            return a.hits != b.hits ? a.hits > b.hits : a.key < b.key;
+        });
+        return out;
+    }
+
+    void LruFragmentStore::clear()
+    {
+        for (size_t i = 0; i < options.shards; ++i)
+        {
+            auto &shard = shards[i];
+            std::unique_lock<std::mutex> guard(shard.lock);
+            shard.lru.clear();
+            shard.entries.clear();
+            shard.bytes = 0;
+        }
+    }
+
+    LruFragmentStore::Shard &LruFragmentStore::shard(const std::string &key)
+    {
+        return shards[std::hash<std::string>()(key) % options.shards];
+    }
+
+    void LruFragmentStore::count(Shard &shard, const std::string &key, bool hit)
+    {
+        if (hit) ++shard.hits;
+        else ++shard.misses;
+
+        auto it = shard.counts.find(key);
+        if (it == shard.counts.end())
+        {
+            if (shard.counts.size() * options.shards >= options.max_key_stats) return;
+            it = shard.counts.emplace(key, Counts{0, 0}).first;
+        }
+        if (hit) ++it->second.hits;
+        else ++it->second.misses;
+    }
+
+    void LruFragmentStore::remove(Shard &shard, Lru::iterator entry)
+    {
+        shard.bytes -= entry_size(*entry);
+        shard.entries.erase(entry->key);
+        shard.lru.erase(entry);
+    }
+
+    size_t LruFragmentStore::entry_size(const Entry &entry)
+    {
+        return entry.key.size() + entry.fragment.size();
+    }
+}
@@ -0,0 +1,197 @@
+#include "HtmlEscape.hpp"
+#include "Util.hpp"
+#include "types/HtmlSafeString.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+    #define SLIM_HTML_ESCAPE_SSE2
+    #include <immintrin.h>
+    #if defined(__GNUC__)
+        //GCC and Clang can compile AVX2 functions without -mavx2, and check the CPU at runtime
+        #define SLIM_HTML_ESCAPE_AVX2
+        #define SLIM_TARGET_AVX2 __attribute__((target("avx2")))
+    #elif defined(__AVX2__)
+        #define SLIM_HTML_ESCAPE_AVX2
+        #define SLIM_TARGET_AVX2
+    #endif
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+namespace slim
+{
+    namespace detail
+    {
+        namespace
+        {
+            inline bool needs_escape(char c)
+            {
+                return c == '&' || c == '<' || c == '>' || c == '"' || c == '\'';
+            }
+            inline void append_entity(std::string &out, char c)
+            {
+                switch (c)
+                {
+                case '&': out.append("&amp;", 5); break;
+                case '<': out.append("&lt;", 4); break;
+                case '>': out.append("&gt;", 4); break;
+                case '"': out.append("&quot;", 6); break;
+                default: out.append("&#39;", 5); break;
+                }
+            }
+            /**Escape [p, end), where [run, p) is pending clean text not yet appended.*/
+            inline void escape_tail(std::string &out, const char *run, const char *p, const char *end)
+            {
+                for (; p != end; ++p)
+                {
+                    if (needs_escape(*p))
+                    {
+                        out.append(run, (size_t)(p - run));
+                        append_entity(out, *p);
+                        run = p + 1;
+                    }
+                }
+                out.append(run, (size_t)(end - run));
+            }
+
+#ifdef SLIM_HTML_ESCAPE_SSE2
+            inline unsigned count_trailing_zeros(unsigned mask)
+            {
+            #ifdef _MSC_VER
+                unsigned long i;
+                _BitScanForward(&i, mask);
+                return (unsigned)i;
+            #else
+                return (unsigned)__builtin_ctz(mask);
+            #endif
+            }
+            /**Append the clean text before, and the entities for, each set bit in mask.*/
+            inline void escape_mask(std::string &out, const char *&run, const char *p, unsigned mask)
+            {
+                while (mask)
+                {
+                    auto c = p + count_trailing_zeros(mask);
+                    out.append(run, (size_t)(c - run));
+                    append_entity(out, *c);
+                    run = c + 1;
+                    mask &= mask - 1;
+                }
+            }
+
+            void html_escape_append_sse2(std::string &out, const char *str, size_t len)
+            {
+                auto end = str + len;
+                auto run = str;
+                auto p = str;
+                const __m128i amp = _mm_set1_epi8('&');
+                const __m128i lt = _mm_set1_epi8('<');
+                const __m128i gt = _mm_set1_epi8('>');
+                const __m128i quot = _mm_set1_epi8('"');
+                const __m128i apos = _mm_set1_epi8('\'');
+                for (; end - p >= 16; p += 16)
+                {
+                    auto v = _mm_loadu_si128((const __m128i*)p);
+                    auto m = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, lt)),
+                        _mm_or_si128(
+                            _mm_or_si128(_mm_cmpeq_epi8(v, gt), _mm_cmpeq_epi8(v, quot)),
+                            _mm_cmpeq_epi8(v, apos)));
+                    auto mask = (unsigned)_mm_movemask_epi8(m);
+                    if (mask) escape_mask(out, run, p, mask);
+                }
+                escape_tail(out, run, p, end);
+            }
+#endif
+
+#ifdef SLIM_HTML_ESCAPE_AVX2
+            SLIM_TARGET_AVX2
+            void html_escape_append_avx2(std::string &out, const char *str, size_t len)
+            {
+                auto end = str + len;
+                auto run = str;
+                auto p = str;
+                const __m256i amp = _mm256_set1_epi8('&');
+                const __m256i lt = _mm256_set1_epi8('<');
+                const __m256i gt = _mm256_set1_epi8('>');
+                const __m256i quot = _mm256_set1_epi8('"');
+                const __m256i apos = _mm256_set1_epi8('\'');
+                for (; end - p >= 32; p += 32)
+                {
+                    auto v = _mm256_loadu_si256((const __m256i*)p);
+                    auto m = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, amp), _mm256_cmpeq_epi8(v, lt)),
+                        _mm256_or_si256(
+                            _mm256_or_si256(_mm256_cmpeq_epi8(v, gt), _mm256_cmpeq_epi8(v, quot)),
+                            _mm256_cmpeq_epi8(v, apos)));
+                    auto mask = (unsigned)_mm256_movemask_epi8(m);
+                    if (mask) escape_mask(out, run, p, mask);
+                }
+                escape_tail(out, run, p, end);
+            }
+
+            bool cpu_has_avx2()
+            {
+            #if defined(__GNUC__)
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") != 0;
+            #else
+                return true; //compiled with /arch:AVX2
+            #endif
+            }
+#endif
+
+            HtmlEscapeFunc select_html_escape()
+            {
+                if (auto f = html_escape_avx2()) return f;
+                if (auto f = html_escape_sse2()) return f;
+                return &html_escape_append_scalar;
+            }
+        }
+
+        void html_escape_append_scalar(std::string &out, const char *str, size_t len)
+        {
+            escape_tail(out, str, str, str + len);
+        }
+
+        HtmlEscapeFunc html_escape_sse2()
+        {
+        #ifdef SLIM_HTML_ESCAPE_SSE2
+            return &html_escape_append_sse2;
+        #else
+            return nullptr;
+        #endif
+        }
+
+        HtmlEscapeFunc html_escape_avx2()
+        {
+        #ifdef SLIM_HTML_ESCAPE_AVX2
+            static const bool supported = cpu_has_avx2();
+            return supported ? &html_escape_append_avx2 : nullptr;
+        #else
+            return nullptr;
+        #endif
+        }
+    }
+
+    void html_escape_append(std::string &out, const char *str, size_t len)
+    {
+        static const detail::HtmlEscapeFunc impl = detail::select_html_escape();
+        impl(out, str, len);
+    }
+
+    void html_escape_append(std::string &out, const Object *obj)
+    {
+        if (auto safe = object_cast<HtmlSafeString>(obj))
+        {
+            out += safe->get_value();
+        }
+        else if (auto str = object_cast<String>(obj))
+        {
+            html_escape_append(out, str->get_value());
+        }
+        else
+        {
+            html_escape_append(out, obj->to_string());
+        }
+    }
+}
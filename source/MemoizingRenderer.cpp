@@ -0,0 +1,238 @@
+#include "MemoizingRenderer.hpp"
+#include "template/Template.hpp"
+#include "types/Symbol.hpp"
+#include "types/ViewModel.hpp"
+#include "Error.hpp"
+
+namespace slim
+{
+    namespace
+    {
+        std::string signature(const std::vector<RenderDependencies::Dependency> &deps)
+        {
+            std::string sig;
+            for (auto &dep : deps)
+            {
+                auto &name = dep.name->str();
+                auto n = (uint32_t)name.size();
+                sig += (char)dep.kind;
+                sig.append((const char*)&n, sizeof(n));
+                sig += name;
+            }
+            return sig;
+        }
+    }
+
+    MemoizingRenderer::MemoizingRenderer(TemplatePtr tpl)
+        : MemoizingRenderer(tpl, Options())
+    {}
+    MemoizingRenderer::MemoizingRenderer(TemplatePtr tpl, const Options &options)
+        : tpl(tpl), options(options)
+        , impure(options.impure_helpers.begin(), options.impure_helpers.end())
+        , lock(), shapes(), shape_list(std::make_shared<ShapeList>()), lru(), bytes(0)
+        , hits(0), misses(0), uncacheable(0), evictions(0)
+    {}
+
+    std::string MemoizingRenderer::render(ViewModelPtr model, bool doctype)
+    {
+        std::string output;
+        if (doctype) output = "<!DOCTYPE html>\n";
+
+        std::shared_ptr<const ShapeList> list;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            list = shape_list;
+        }
+        auto keys = fingerprints(*list, model.get());
+        std::shared_ptr<const std::string> cached;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            cached = find(keys);
+            if (cached) ++hits;
+            else ++misses;
+        }
+        if (cached)
+        {
+            output += *cached;
+            return output;
+        }
+
+        RenderDependencies deps(model.get());
+        std::string body;
+        {
+            RenderDependencies::Scope scope(deps);
+            body = tpl->render(model, false);
+        }
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            add(deps, body);
+        }
+        output += body;
+        return output;
+    }
+
+    MemoizingRenderer::Stats MemoizingRenderer::stats()const
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        Stats stats;
+        stats.hits = hits;
+        stats.misses = misses;
+        stats.uncacheable = uncacheable;
+        stats.evictions = evictions;
+        stats.entries = lru.size();
+        stats.bytes = bytes;
+        return stats;
+    }
+
+    void MemoizingRenderer::clear()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        shapes.clear();
+        shape_list = std::make_shared<ShapeList>();
+        lru.clear();
+        bytes = 0;
+    }
+
+    std::vector<std::pair<const std::string*, std::string>> MemoizingRenderer::fingerprints(
+        const ShapeList &shapes, ViewModel *model)
+    {
+        std::vector<std::pair<const std::string*, std::string>> keys;
+        std::string values;
+        for (auto &shape : shapes)
+        {
+            values.clear();
+            bool ok = true;
+            for (auto &dep : *shape.second)
+            {
+                if (dep.kind == RenderDependencies::CALL) continue;
+                ObjectPtr value;
+                if (dep.kind == RenderDependencies::ATTR) value = model->get_attr(dep.name);
+                else
+                {
+                    try
+                    {
+                        value = model->get_constant(dep.name);
+                    }
+                    catch (const ScriptError &)
+                    {
+                        ok = false;
+                        break;
+                    }
+                }
+                if (!RenderDependencies::fingerprint(values, value.get()))
+                {
+                    ok = false;
+                    break;
+                }
+            }
+            if (ok) keys.emplace_back(&shape.first, values);
+        }
+        return keys;
+    }
+
+    std::shared_ptr<const std::string> MemoizingRenderer::find(
+        const std::vector<std::pair<const std::string*, std::string>> &keys)
+    {
+        // A render only reads its next input based on the values of those before, so at most one
+        // shape can match the model. Shapes evicted since the keys were made are skipped.
+        for (auto &key : keys)
+        {
+            auto shape = shapes.find(*key.first);
+            if (shape == shapes.end()) continue;
+            auto it = shape->second.entries.find(key.second);
+            if (it != shape->second.entries.end())
+            {
+                lru.splice(lru.begin(), lru, it->second);
+                return it->second->output;
+            }
+        }
+        return nullptr;
+    }
+
+    void MemoizingRenderer::add(const RenderDependencies &deps, const std::string &output)
+    {
+        bool cacheable = deps.is_cacheable();
+        for (auto &dep : deps.dependencies())
+        {
+            if (dep.kind == RenderDependencies::CALL && impure.count(dep.name->str()))
+                cacheable = false;
+        }
+        if (!cacheable)
+        {
+            ++uncacheable;
+            return;
+        }
+
+        auto sig = signature(deps.dependencies());
+        auto shape_it = shapes.find(sig);
+        if (shape_it == shapes.end())
+        {
+            Shape shape;
+            shape.signature = sig;
+            shape.deps = std::make_shared<Dependencies>(deps.dependencies());
+            auto size = shape_size(shape) + deps.values().size() + output.size();
+            if (size > options.max_bytes) return;
+            shape_it = shapes.emplace(sig, std::move(shape)).first;
+            bytes += shape_size(shape_it->second);
+            update_shape_list();
+        }
+        else
+        {
+            auto size = shape_size(shape_it->second) + deps.values().size() + output.size();
+            if (size > options.max_bytes) return;
+        }
+        auto &shape = shape_it->second;
+        auto it = shape.entries.find(deps.values());
+        if (it != shape.entries.end())
+        {
+            // Another thread rendered the same inputs first
+            lru.splice(lru.begin(), lru, it->second);
+            return;
+        }
+
+        lru.push_front({&shape, deps.values(), std::make_shared<const std::string>(output)});
+        shape.entries[deps.values()] = lru.begin();
+        bytes += entry_size(lru.front());
+        while (bytes > options.max_bytes)
+        {
+            ++evictions;
+            evict(std::prev(lru.end()));
+        }
+    }
+
+    void MemoizingRenderer::evict(Lru::iterator entry)
+    {
+        auto shape = entry->shape;
+        bytes -= entry_size(*entry);
+        shape->entries.erase(entry->values);
+        lru.erase(entry);
+        if (shape->entries.empty())
+        {
+            bytes -= shape_size(*shape);
+            shapes.erase(shape->signature);
+            update_shape_list();
+        }
+    }
+
+    void MemoizingRenderer::update_shape_list()
+    {
+        // Renders may still be reading the previous list, so replace it rather than modify it
+        auto list = std::make_shared<ShapeList>();
+        list->reserve(shapes.size());
+        for (auto &shape : shapes) list->emplace_back(shape.first, shape.second.deps);
+        shape_list = std::move(list);
+    }
+
+    size_t MemoizingRenderer::entry_size(const Entry &entry)
+    {
+        return entry.values.size() + entry.output->size();
+    }
+
+    size_t MemoizingRenderer::shape_size(const Shape &shape)
+    {
+        // The signature is held as the shapes key, by the shape, and by the shape list
+        size_t size = shape.signature.size() * 3;
+        for (auto &dep : *shape.deps) size += sizeof(dep) + dep.name->str().size();
+        return size;
+    }
+}
@@ -0,0 +1,67 @@
+#include "RenderArena.hpp"
+#include <cstring>
+
+namespace slim
+{
+    const size_t RenderArena::MAX_SMALL_SIZE;
+    const size_t RenderArena::CHUNK_SIZE;
+    thread_local RenderArena *RenderArena::current_arena = nullptr;
+
+    RenderArena::Scope::Scope(bool enable)
+        : arena(nullptr)
+    {
+        if (enable && !current_arena)
+        {
+            arena = new RenderArena();
+            current_arena = arena;
+        }
+    }
+    RenderArena::Scope::~Scope()
+    {
+        if (arena)
+        {
+            current_arena = nullptr;
+            arena->release();
+        }
+    }
+
+    RenderArena::RenderArena()
+        : refs(1), chunks(), next(nullptr), end(nullptr)
+    {
+        memset(free_lists, 0, sizeof(free_lists));
+    }
+    RenderArena::~RenderArena()
+    {}
+
+    void *RenderArena::allocate(size_t size)
+    {
+        if (size > MAX_SMALL_SIZE) return ::operator new(size);
+        auto cls = (size + GRANULARITY - 1) / GRANULARITY - 1;
+        if (auto block = free_lists[cls])
+        {
+            free_lists[cls] = block->next;
+            return block;
+        }
+        size = (cls + 1) * GRANULARITY;
+        if ((size_t)(end - next) < size)
+        {
+            chunks.emplace_back(new char[CHUNK_SIZE]);
+            next = chunks.back().get();
+            end = next + CHUNK_SIZE;
+        }
+        auto p = next;
+        next += size;
+        return p;
+    }
+    void RenderArena::deallocate(void *p, size_t size)
+    {
+        if (size > MAX_SMALL_SIZE) return ::operator delete(p);
+        //Blocks freed after the render, or on another thread, are not reused. They are released
+        //with the chunks.
+        if (current_arena != this) return;
+        auto cls = (size + GRANULARITY - 1) / GRANULARITY - 1;
+        auto block = static_cast<FreeBlock*>(p);
+        block->next = free_lists[cls];
+        free_lists[cls] = block;
+    }
+}
@@ -0,0 +1,85 @@
+#include "RenderDependencies.hpp"
+#include "types/Array.hpp"
+#include "types/Boolean.hpp"
+#include "types/Hash.hpp"
+#include "types/HtmlSafeString.hpp"
+#include "types/Nil.hpp"
+#include "types/Number.hpp"
+#include "types/String.hpp"
+#include "types/Symbol.hpp"
+#include <cstring>
+#include <typeinfo>
+
+namespace slim
+{
+    thread_local RenderDependencies *RenderDependencies::current_deps = nullptr;
+
+    namespace
+    {
+        void append_size(std::string &out, size_t size)
+        {
+            auto n = (uint32_t)size;
+            out.append((const char*)&n, sizeof(n));
+        }
+        void append_str(std::string &out, char tag, const std::string &str)
+        {
+            out += tag;
+            append_size(out, str.size());
+            out += str;
+        }
+    }
+
+    RenderDependencies::RenderDependencies(const ViewModel *model)
+        : model(model), deps(), _values(), cacheable(true)
+    {}
+
+    void RenderDependencies::read(const ViewModel *model, Kind kind, const SymPtr &name, Object *value)
+    {
+        if (model != this->model) return;
+        deps.push_back({kind, name});
+        if (cacheable && !fingerprint(_values, value)) cacheable = false;
+    }
+    void RenderDependencies::call(const ViewModel *self, const SymPtr &name)
+    {
+        if (self != model) return;
+        deps.push_back({CALL, name});
+    }
+
+    bool RenderDependencies::fingerprint(std::string &out, Object *value)
+    {
+        auto &type = typeid(*value);
+        if (type == typeid(Nil)) out += 'n';
+        else if (type == typeid(Boolean)) out += value->is_true() ? 't' : 'f';
+        else if (type == typeid(Number))
+        {
+            auto x = static_cast<Number*>(value)->get_value();
+            out += 'd';
+            out.append((const char*)&x, sizeof(x));
+        }
+        else if (type == typeid(String)) append_str(out, 's', static_cast<String*>(value)->get_value());
+        else if (type == typeid(HtmlSafeString)) append_str(out, 'h', static_cast<String*>(value)->get_value());
+        else if (type == typeid(Symbol)) append_str(out, 'y', static_cast<Symbol*>(value)->str());
+        else if (type == typeid(Array))
+        {
+            auto &arr = static_cast<Array*>(value)->get_value();
+            out += 'A';
+            append_size(out, arr.size());
+            for (auto &x : arr)
+            {
+                if (!fingerprint(out, x.get())) return false;
+            }
+        }
+        else if (type == typeid(Hash))
+        {
+            auto hash = static_cast<Hash*>(value);
+            out += 'H';
+            append_size(out, (size_t)(hash->end() - hash->begin()));
+            for (auto &x : *hash)
+            {
+                if (!fingerprint(out, x.first.get()) || !fingerprint(out, x.second.get())) return false;
+            }
+        }
+        else return false;
+        return true;
+    }
+}
@@ -1,13 +1,22 @@
 #include "Template.hpp"
 #include "expression/Scope.hpp"
+#include "template/BinaryFormat.hpp"
 #include "template/Lexer.hpp"
+#include "template/Optimizer.hpp"
 #include "template/Parser.hpp"
+#include "template/TemplatePart.hpp"
+#include "types/ViewModel.hpp"
+#include "RenderArena.hpp"
 #include <fstream>
 
 namespace slim
 {
+    // Templates are long lived and shared between threads, so even when loaded during a render
+    // their objects must not come from its RenderArena, see RenderArena::Suspend.
+
     Template parse_template(const char *str, size_t len)
     {
+        RenderArena::Suspend suspend;
         tpl::Lexer lexer(str, str + len);
         tpl::Parser parser(lexer);
         return parser.parse();
@@ -15,6 +24,7 @@ namespace slim
 
     Template parse_template(const std::string &source, const std::vector<std::string> &local_vars)
     {
+        RenderArena::Suspend suspend;
         expr::LocalVarNames vars;
         vars.add(local_vars);
         tpl::Lexer lexer(source.c_str(), source.c_str() + source.size());
@@ -28,6 +38,7 @@ namespace slim
 
     Template parse_template_file(const std::string &path)
     {
+        RenderArena::Suspend suspend;
         std::ifstream is(path, std::ios::in | std::ios::binary);
         is.seekg(0, std::ios::end);
         size_t size = is.tellg();
@@ -42,4 +53,15 @@ namespace slim
         tpl::Parser parser(lexer);
         return parser.parse();
     }
+
+    Template specialize_template(const Template &tpl, ViewModelPtr constants)
+    {
+        RenderArena::Suspend suspend;
+        auto root = tpl::binary::copy_tree(tpl.get_root());
+        Template ret(tpl::optimize(std::move(root), constants.get()));
+        ret.set_exec_mode(tpl.get_exec_mode());
+        ret.set_render_arena(tpl.get_render_arena());
+        ret.set_fragment_store(tpl.get_fragment_store());
+        return ret;
+    }
 }
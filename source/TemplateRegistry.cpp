@@ -0,0 +1,280 @@
+#include "TemplateRegistry.hpp"
+#include "Template.hpp"
+#include <cerrno>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef __linux__
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace slim
+{
+    TemplateRegistry::TemplateRegistry(const std::string &root)
+        : TemplateRegistry(root, Options())
+    {}
+    TemplateRegistry::TemplateRegistry(const std::string &root, const Options &options)
+        : root(root), options(options), lock(), entries()
+        , hits(0), misses(0), reloads(0), reload_errors(0)
+        , inotify_fd(-1), stop_fds{-1, -1}, watched_dirs(), watcher(), watch_failed(false)
+    {
+        if (this->root.empty()) this->root = "./";
+        else if (this->root.back() != '/') this->root += '/';
+    #ifdef __linux__
+        if (options.watch)
+        {
+            inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+            if (inotify_fd >= 0 && pipe(stop_fds) == 0)
+            {
+                watcher = std::thread(&TemplateRegistry::watch_thread, this);
+            }
+            else if (inotify_fd >= 0)
+            {
+                //Fall back to checking modification times
+                close(inotify_fd);
+                inotify_fd = -1;
+            }
+        }
+    #endif
+    }
+
+    TemplateRegistry::~TemplateRegistry()
+    {
+    #ifdef __linux__
+        if (watcher.joinable())
+        {
+            //The watcher uses the file descriptors until it returns, so always wait for it
+            char c = 0;
+            while (write(stop_fds[1], &c, 1) < 0 && errno == EINTR);
+            watcher.join();
+            close(stop_fds[0]);
+            close(stop_fds[1]);
+        }
+        if (inotify_fd >= 0) close(inotify_fd);
+    #endif
+    }
+
+    TemplateRegistry::TemplatePtr TemplateRegistry::get(const std::string &name)
+    {
+        Entry *entry = nullptr;
+        {
+            std::shared_lock<std::shared_timed_mutex> read_lock(lock);
+            auto it = entries.find(name);
+            if (it != entries.end()) entry = it->second.get();
+        }
+        if (entry)
+        {
+            bool watched = entry->watched.load() && !watch_failed.load();
+            if (!watched && options.check_interval.count() >= 0)
+            {
+                auto now = now_ms();
+                auto next = entry->next_check.load(std::memory_order_relaxed);
+                if (now >= next && entry->next_check.compare_exchange_strong(next, now + options.check_interval.count()))
+                {
+                    reload(*entry);
+                }
+            }
+            if (auto tpl = std::atomic_load(&entry->tpl))
+            {
+                ++hits;
+                return tpl;
+            }
+        }
+        else
+        {
+            check_name(name);
+            //Add an unloaded entry, so that only one thread parses the template
+            std::unique_lock<std::shared_timed_mutex> write_lock(lock);
+            auto &slot = entries[name];
+            if (!slot)
+            {
+                slot.reset(new Entry());
+                slot->path = root + name + options.extension;
+                slot->mtime = {0, 0, 0};
+                slot->next_check = 0;
+                slot->watched = false;
+            }
+            entry = slot.get();
+        }
+        return load(*entry);
+    }
+
+    TemplateRegistry::TemplatePtr TemplateRegistry::load(Entry &entry)
+    {
+        //Load outside of the registry lock, so other templates are not blocked while parsing
+        TemplatePtr tpl;
+        {
+            std::unique_lock<std::mutex> entry_lock(entry.reload_lock);
+            tpl = std::atomic_load(&entry.tpl);
+            if (tpl)
+            {
+                //Another thread loaded it first
+                ++hits;
+                return tpl;
+            }
+            //Watch before reading the file, so that a change while parsing is not missed. The
+            //watcher's reload waits for this lock, then sees the new mtime.
+            if (!entry.watched) entry.watched = watch_dir(entry.path);
+            //If this fails the entry stays unloaded, and the next get tries again
+            FileTime mtime;
+            if (!file_time(entry.path, &mtime))
+                throw std::runtime_error("Template not found " + entry.path);
+            tpl = std::make_shared<const Template>(parse_template_file(entry.path));
+            entry.mtime = mtime;
+            entry.next_check = now_ms() + options.check_interval.count();
+            std::atomic_store(&entry.tpl, tpl);
+            ++misses;
+        }
+        return tpl;
+    }
+
+    size_t TemplateRegistry::refresh()
+    {
+        std::vector<Entry*> all;
+        {
+            std::shared_lock<std::shared_timed_mutex> read_lock(lock);
+            for (auto &i : entries) all.push_back(i.second.get());
+        }
+        size_t count = 0;
+        for (auto entry : all)
+        {
+            if (reload(*entry)) ++count;
+        }
+        return count;
+    }
+
+    TemplateRegistry::Stats TemplateRegistry::stats()const
+    {
+        return { hits.load(), misses.load(), reloads.load(), reload_errors.load() };
+    }
+
+    bool TemplateRegistry::reload(Entry &entry)
+    {
+        std::unique_lock<std::mutex> entry_lock(entry.reload_lock);
+        if (!std::atomic_load(&entry.tpl)) return false; //Never loaded, get will load it
+        FileTime mtime;
+        if (!file_time(entry.path, &mtime) || mtime == entry.mtime) return false;
+        entry.mtime = mtime;
+        try
+        {
+            auto tpl = std::make_shared<const Template>(parse_template_file(entry.path));
+            std::atomic_store(&entry.tpl, TemplatePtr(std::move(tpl)));
+            ++reloads;
+            return true;
+        }
+        catch (const std::exception &)
+        {
+            //Keep the previous version, until the file is changed again
+            ++reload_errors;
+            return false;
+        }
+    }
+
+    bool TemplateRegistry::watch_dir(const std::string &path)
+    {
+    #ifdef __linux__
+        if (inotify_fd < 0) return false;
+        auto slash = path.find_last_of('/');
+        auto dir = slash == std::string::npos ? "." : path.substr(0, slash);
+        std::unique_lock<std::shared_timed_mutex> write_lock(lock);
+        for (auto &i : watched_dirs) if (i.second == dir) return true;
+        //Watch the directory rather than the file, since editors often replace the file.
+        //Not IN_CREATE, since a created file is still empty until written and closed.
+        auto wd = inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0) return false;
+        watched_dirs[wd] = dir;
+        return true;
+    #else
+        (void)path;
+        return false;
+    #endif
+    }
+
+    void TemplateRegistry::watch_thread()
+    {
+    #ifdef __linux__
+        alignas(inotify_event) char buffer[4096];
+        while (true)
+        {
+            pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {stop_fds[0], POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0)
+            {
+                if (errno == EINTR) continue;
+                //Stop rather than spin, get checks modification times from now on
+                watch_failed = true;
+                return;
+            }
+            if (fds[1].revents) return;
+            if (!(fds[0].revents & POLLIN)) continue;
+
+            auto len = read(inotify_fd, buffer, sizeof(buffer));
+            for (ssize_t i = 0; i < len;)
+            {
+                auto event = (const inotify_event*)(buffer + i);
+                i += (ssize_t)(sizeof(inotify_event) + event->len);
+                if (!event->len) continue;
+                std::string path;
+                {
+                    std::shared_lock<std::shared_timed_mutex> read_lock(lock);
+                    auto dir = watched_dirs.find(event->wd);
+                    if (dir == watched_dirs.end()) continue;
+                    path = dir->second + "/" + event->name;
+                }
+                file_changed(path);
+            }
+        }
+    #endif
+    }
+
+    void TemplateRegistry::file_changed(const std::string &path)
+    {
+        std::vector<Entry*> changed;
+        {
+            std::shared_lock<std::shared_timed_mutex> read_lock(lock);
+            for (auto &i : entries)
+            {
+                if (i.second->path == path) changed.push_back(i.second.get());
+            }
+        }
+        for (auto entry : changed) reload(*entry);
+    }
+
+    bool TemplateRegistry::file_time(const std::string &path, FileTime *time)
+    {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) return false;
+        time->sec = (int64_t)st.st_mtime;
+    #ifdef __linux__
+        time->nsec = (int64_t)st.st_mtim.tv_nsec;
+    #else
+        time->nsec = 0;
+    #endif
+        time->size = (int64_t)st.st_size;
+        return true;
+    }
+
+    void TemplateRegistry::check_name(const std::string &name)
+    {
+        bool absolute = !name.empty() && (name[0] == '/' || name[0] == '\\');
+    #ifdef _WIN32
+        if (name.size() >= 2 && name[1] == ':') absolute = true;
+    #endif
+        if (absolute) throw std::runtime_error("Template name must be relative " + name);
+        size_t start = 0;
+        while (start <= name.size())
+        {
+            auto end = name.find_first_of("/\\", start);
+            if (end == std::string::npos) end = name.size();
+            if (name.compare(start, end - start, "..") == 0)
+                throw std::runtime_error("Template name must not contain '..' " + name);
+            start = end + 1;
+        }
+    }
+
+    int64_t TemplateRegistry::now_ms()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
@@ -6,30 +6,21 @@ namespace slim
     {
         std::string buf;
         buf.reserve(str.size());
-        for (auto c : str)
-        {
-            switch (c)
-            {
-            case '&': buf += "&amp;"; break;
-            case '<': buf += "&lt;"; break;
-            case '>': buf += "&gt;"; break;
-            case '"': buf += "&quot;"; break;
-            case '\'': buf += "&#39;"; break;
-            default: buf += c; break;
-            }
-        }
+        html_escape_append(buf, str);
         return buf;
     }
 
     std::string html_escape(const Object *obj)
     {
-        if (auto safe = dynamic_cast<const HtmlSafeString*>(obj))
+        if (auto safe = object_cast<HtmlSafeString>(obj))
         {
             return safe->get_value();
         }
         else
         {
-            return html_escape(obj->to_string());
+            std::string buf;
+            html_escape_append(buf, obj);
+            return buf;
         }
     }
 }
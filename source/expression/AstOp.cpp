@@ -9,6 +9,7 @@
 #include "types/Range.hpp"
 #include "types/String.hpp"
 #include "template/Template.hpp"
+#include "RenderDependencies.hpp"
 #include <sstream>
 namespace slim
 {
@@ -25,7 +26,7 @@ namespace slim
 
         ObjectPtr Variable::eval(Scope & scope) const
         {
-            return scope.get(name);
+            return scope.get(depth, slot, name);
         }
 
         std::string Assignment::to_string()const
@@ -35,7 +36,7 @@ namespace slim
         ObjectPtr Assignment::eval(Scope &scope)const
         {
             auto val = expr->eval(scope);
-            scope.set(name, val);
+            scope.set(slot, name, val);
             return val;
         }
 
@@ -70,6 +71,7 @@ namespace slim
         FunctionArgs FuncCall::eval_args(Scope & scope) const
         {
             FunctionArgs ret;
+            ret.reserve(args.size());
             for (auto &arg : args) ret.push_back(arg->eval(scope));
             return ret;
         }
@@ -87,6 +89,7 @@ namespace slim
         {
             auto self = scope.self();
             auto args = eval_args(scope);
+            if (auto deps = RenderDependencies::current()) deps->call(self.get(), name);
             return (*method(self.get()))(self.get(), args);
         }
 
@@ -182,7 +185,7 @@ namespace slim
         }
         ObjectPtr Block::eval(Scope & scope) const
         {
-            return std::make_shared<BlockProc>(*code, param_names, scope);
+            return create_object<BlockProc>(*code, param_names, locals, scope);
         }
 
         std::string Conditional::to_string() const
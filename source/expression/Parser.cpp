@@ -55,11 +55,14 @@ namespace slim
                 {
                     auto name = current_token.str;
                     vars.add(name);
+                    uint32_t depth, slot;
+                    vars.resolve(name, &depth, &slot);
+                    assert(depth == 0);
 
                     next();
                     auto rhs = full_expression();
 
-                    return slim::make_unique<Assignment>(symbol(name), std::move(rhs));
+                    return slim::make_unique<Assignment>(symbol(name), std::move(rhs), slot);
                 }
                 else lexer.restore_pos(saved);
             }
@@ -141,7 +144,9 @@ namespace slim
                     else if (vars.is_var(name))
                     {   //variables take priority over methods if they exist
                         assert(!is_constant(name)); //should not be possible to create such a constant
-                        return slim::make_unique<Variable>(symbol(name));
+                        uint32_t depth, slot;
+                        vars.resolve(name, &depth, &slot);
+                        return slim::make_unique<Variable>(symbol(name), depth, slot);
                     }
                     else if (is_constant(name))
                     {
@@ -412,6 +417,7 @@ namespace slim
 
             std::vector<SymPtr> params = param_list();
             auto old_vars = vars; //save the current variable set, new variables will only exist within the block
+            vars.begin_frame();
             for (auto &param : params)
                 vars.add(param->str());
 
@@ -614,7 +620,7 @@ namespace slim
                 case Token::AND:
                     next();
                     rhs = unary_op(in_cond_op);
-                    return slim::make_unique<MemberFuncCall>(std::move(rhs), symbol("to_proc"), FuncCall::Args());
+                    return slim::make_unique<MemberFuncCall>(std::move(rhs), syms::to_proc, FuncCall::Args());
                 default: return pow_op(in_cond_op);
                 }
             }
@@ -0,0 +1,819 @@
+#include "Template.hpp"
+#include "template/BinaryFormat.hpp"
+#include "template/TemplateBlock.hpp"
+#include "template/TemplateParts.hpp"
+#include "expression/ArithmeticOp.hpp"
+#include "expression/AstOp.hpp"
+#include "expression/CmpOp.hpp"
+#include "expression/LogicalOp.hpp"
+#include "types/Boolean.hpp"
+#include "types/Nil.hpp"
+#include "types/Number.hpp"
+#include "types/Regexp.hpp"
+#include "types/String.hpp"
+#include "types/Symbol.hpp"
+#include "Error.hpp"
+#include "RenderArena.hpp"
+#include "Util.hpp"
+#include "Value.hpp"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <typeindex>
+#include <unordered_map>
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace slim
+{
+    namespace tpl
+    {
+        namespace binary
+        {
+            namespace
+            {
+                const std::unordered_map<std::type_index, NodeTag> OP_TAGS = {
+                    { typeid(expr::Negative), NODE_NEGATIVE },
+                    { typeid(expr::Not), NODE_NOT },
+                    { typeid(expr::LogicalNot), NODE_LOGICAL_NOT },
+                    { typeid(expr::Mul), NODE_MUL },
+                    { typeid(expr::Div), NODE_DIV },
+                    { typeid(expr::Mod), NODE_MOD },
+                    { typeid(expr::Pow), NODE_POW },
+                    { typeid(expr::Add), NODE_ADD },
+                    { typeid(expr::Sub), NODE_SUB },
+                    { typeid(expr::Lshift), NODE_LSHIFT },
+                    { typeid(expr::Rshift), NODE_RSHIFT },
+                    { typeid(expr::And), NODE_AND },
+                    { typeid(expr::Or), NODE_OR },
+                    { typeid(expr::Xor), NODE_XOR },
+                    { typeid(expr::Eq), NODE_EQ },
+                    { typeid(expr::Ne), NODE_NE },
+                    { typeid(expr::Cmp), NODE_CMP },
+                    { typeid(expr::Lt), NODE_LT },
+                    { typeid(expr::Le), NODE_LE },
+                    { typeid(expr::Gt), NODE_GT },
+                    { typeid(expr::Ge), NODE_GE },
+                    { typeid(expr::LogicalAnd), NODE_LOGICAL_AND },
+                    { typeid(expr::LogicalOr), NODE_LOGICAL_OR }
+                };
+
+                class Writer
+                {
+                public:
+                    /**@param objects If not null, literals that can not be saved are added to it.*/
+                    explicit Writer(std::vector<ObjectPtr> *objects = nullptr) : objects(objects) {}
+
+                    std::string write(const TemplatePart &root)
+                    {
+                        //Symbols are collected while writing the tree, then placed before it
+                        std::string tree;
+                        out = &tree;
+                        write_part(root);
+
+                        std::string file(MAGIC, sizeof(MAGIC));
+                        out = &file;
+                        write_u32(VERSION);
+                        write_u32(BYTE_ORDER_MARK);
+                        write_u32((uint32_t)symbols.size());
+                        for (auto &sym : symbols) write_str(sym);
+                        file += tree;
+                        return file;
+                    }
+                private:
+                    std::string *out;
+                    std::vector<ObjectPtr> *objects;
+                    std::vector<std::string> symbols;
+                    std::unordered_map<std::string, uint32_t> symbol_ids;
+
+                    void write_u8(uint8_t x) { out->push_back((char)x); }
+                    void write_u32(uint32_t x) { out->append((const char*)&x, sizeof(x)); }
+                    void write_f64(double x) { out->append((const char*)&x, sizeof(x)); }
+                    void write_str(const std::string &str)
+                    {
+                        write_u32((uint32_t)str.size());
+                        out->append(str);
+                    }
+                    void write_sym(const SymPtr &sym)
+                    {
+                        auto ret = symbol_ids.emplace(sym->str(), (uint32_t)symbols.size());
+                        if (ret.second) symbols.push_back(sym->str());
+                        write_u32(ret.first->second);
+                    }
+                    void write_syms(const std::vector<SymPtr> &syms)
+                    {
+                        write_u32((uint32_t)syms.size());
+                        for (auto &sym : syms) write_sym(sym);
+                    }
+
+                    void write_part(const TemplatePart &part)
+                    {
+                        if (auto list = dynamic_cast<const TemplatePartsList*>(&part))
+                        {
+                            write_u8(PART_LIST);
+                            write_u32((uint32_t)list->get_parts().size());
+                            for (auto &child : list->get_parts()) write_part(*child);
+                        }
+                        else if (auto text = dynamic_cast<const TemplateText*>(&part))
+                        {
+                            write_u8(PART_TEXT);
+                            write_str(text->get_text());
+                        }
+                        else if (dynamic_cast<const TemplateFlush*>(&part))
+                        {
+                            write_u8(PART_FLUSH);
+                        }
+                        else if (auto output = dynamic_cast<const TemplateOutputExpr*>(&part))
+                        {
+                            write_u8(PART_OUTPUT);
+                            write_node(*output->get_expression());
+                        }
+                        else if (auto code = dynamic_cast<const TemplateCodeBlock*>(&part))
+                        {
+                            write_u8(PART_CODE);
+                            write_node(*code->get_expression());
+                        }
+                        else if (auto each = dynamic_cast<const TemplateEachExpr*>(&part))
+                        {
+                            write_u8(PART_EACH);
+                            write_node(*each->get_expression());
+                        }
+                        else if (auto attr = dynamic_cast<const TemplateTagAttr*>(&part))
+                        {
+                            write_u8(PART_ATTR);
+                            write_str(attr->get_attr());
+                            write_u32((uint32_t)attr->get_static_values().size());
+                            for (auto &value : attr->get_static_values()) write_str(value);
+                            write_nodes(attr->get_dynamic_values());
+                        }
+                        else if (auto splat = dynamic_cast<const TemplateTagSplatAttrs*>(&part))
+                        {
+                            write_u8(PART_SPLAT_ATTRS);
+                            write_u32((uint32_t)splat->get_static_attrs().size());
+                            for (auto &i : splat->get_static_attrs())
+                            {
+                                write_str(i.first);
+                                write_str(i.second);
+                            }
+                            write_u32((uint32_t)splat->get_dynamic_attrs().size());
+                            for (auto &i : splat->get_dynamic_attrs())
+                            {
+                                write_str(i.first);
+                                write_node(*i.second);
+                            }
+                            write_nodes(splat->get_splat_attrs());
+                        }
+                        else if (auto for_expr = dynamic_cast<const TemplateForExpr*>(&part))
+                        {
+                            write_u8(PART_FOR);
+                            write_node(*for_expr->get_expr());
+                            write_part(*for_expr->get_body());
+                            write_syms(for_expr->get_param_names());
+                        }
+                        else if (auto if_expr = dynamic_cast<const TemplateIfExpr*>(&part))
+                        {
+                            write_u8(PART_IF);
+                            write_u32((uint32_t)if_expr->get_elseif_exprs().size());
+                            write_node(*if_expr->get_if_expr().expr);
+                            write_part(*if_expr->get_if_expr().body);
+                            for (auto &elseif : if_expr->get_elseif_exprs())
+                            {
+                                write_node(*elseif.expr);
+                                write_part(*elseif.body);
+                            }
+                            write_u8(if_expr->get_else_body() ? 1 : 0);
+                            if (if_expr->get_else_body()) write_part(*if_expr->get_else_body());
+                        }
+                        else if (auto cache = dynamic_cast<const TemplateCacheBlock*>(&part))
+                        {
+                            write_u8(PART_CACHE);
+                            write_str(cache->get_digest());
+                            write_node(*cache->get_key());
+                            write_node(*cache->get_body());
+                        }
+                        else throw Error(std::string("Can not save template part ") + typeid(part).name());
+                    }
+
+                    void write_nodes(const std::vector<std::unique_ptr<expr::ExpressionNode>> &nodes)
+                    {
+                        write_u32((uint32_t)nodes.size());
+                        for (auto &node : nodes) write_node(*node);
+                    }
+                    void write_node(const expr::ExpressionNode &node)
+                    {
+                        using namespace expr;
+                        if (auto literal = dynamic_cast<const Literal*>(&node))
+                        {
+                            write_u8(NODE_LITERAL);
+                            write_value(literal->value);
+                        }
+                        else if (auto var = dynamic_cast<const Variable*>(&node))
+                        {
+                            write_u8(NODE_VARIABLE);
+                            write_sym(var->name);
+                            write_u32(var->depth);
+                            write_u32(var->slot);
+                        }
+                        else if (auto assign = dynamic_cast<const Assignment*>(&node))
+                        {
+                            write_u8(NODE_ASSIGNMENT);
+                            write_sym(assign->name);
+                            write_u32(assign->slot);
+                            write_node(*assign->expr);
+                        }
+                        else if (auto attr = dynamic_cast<const Attribute*>(&node))
+                        {
+                            write_u8(NODE_ATTRIBUTE);
+                            write_sym(attr->name);
+                        }
+                        else if (auto constant = dynamic_cast<const GlobalConstant*>(&node))
+                        {
+                            write_u8(NODE_GLOBAL_CONSTANT);
+                            write_sym(constant->name);
+                        }
+                        else if (auto nav = dynamic_cast<const ConstantNav*>(&node))
+                        {
+                            write_u8(NODE_CONSTANT_NAV);
+                            write_node(*nav->lhs);
+                            write_sym(nav->name);
+                        }
+                        else if (auto call = dynamic_cast<const MemberFuncCall*>(&node))
+                        {
+                            bool safe_nav = dynamic_cast<const SafeNavMemberFuncCall*>(call) != nullptr;
+                            write_u8(safe_nav ? NODE_SAFE_NAV_MEMBER_FUNC_CALL : NODE_MEMBER_FUNC_CALL);
+                            write_node(*call->lhs);
+                            write_sym(call->name);
+                            write_nodes(call->args);
+                        }
+                        else if (auto call = dynamic_cast<const GlobalFuncCall*>(&node))
+                        {
+                            write_u8(NODE_GLOBAL_FUNC_CALL);
+                            write_sym(call->name);
+                            write_nodes(call->args);
+                        }
+                        else if (auto ref = dynamic_cast<const ElementRefOp*>(&node))
+                        {
+                            write_u8(NODE_ELEMENT_REF);
+                            write_node(*ref->lhs);
+                            write_nodes(ref->args);
+                        }
+                        else if (auto arr = dynamic_cast<const ArrayLiteral*>(&node))
+                        {
+                            write_u8(NODE_ARRAY_LITERAL);
+                            write_nodes(arr->args);
+                        }
+                        else if (auto hash = dynamic_cast<const HashLiteral*>(&node))
+                        {
+                            write_u8(NODE_HASH_LITERAL);
+                            write_nodes(hash->args);
+                        }
+                        else if (auto range = dynamic_cast<const RangeOp*>(&node))
+                        {
+                            bool exclusive = dynamic_cast<const ExclusiveRangeOp*>(range) != nullptr;
+                            write_u8(exclusive ? NODE_EXCLUSIVE_RANGE : NODE_INCLUSIVE_RANGE);
+                            write_node(*range->get_lhs());
+                            write_node(*range->get_rhs());
+                        }
+                        else if (auto block = dynamic_cast<const Block*>(&node))
+                        {
+                            write_u8(NODE_BLOCK);
+                            write_syms(block->get_param_names());
+                            write_syms(block->get_locals());
+                            write_node(*block->get_code());
+                        }
+                        else if (auto cond = dynamic_cast<const Conditional*>(&node))
+                        {
+                            write_u8(NODE_CONDITIONAL);
+                            write_node(*cond->get_cond());
+                            write_node(*cond->get_true_expr());
+                            write_node(*cond->get_false_expr());
+                        }
+                        else if (auto str = dynamic_cast<const InterpolatedString*>(&node))
+                        {
+                            write_u8(NODE_INTERPOLATED_STRING);
+                            write_interp(*str);
+                        }
+                        else if (auto regex = dynamic_cast<const InterpolatedRegex*>(&node))
+                        {
+                            write_u8(NODE_INTERPOLATED_REGEX);
+                            write_u32((uint32_t)regex->get_opts());
+                            write_interp(*regex->get_src());
+                        }
+                        else if (auto capture = dynamic_cast<const TemplateCaptureBlock*>(&node))
+                        {
+                            write_u8(NODE_TEMPLATE_CAPTURE_BLOCK);
+                            write_part(*capture->tpl);
+                        }
+                        else if (auto output = dynamic_cast<const TemplateOutputBlock*>(&node))
+                        {
+                            write_u8(NODE_TEMPLATE_OUTPUT_BLOCK);
+                            write_part(*output->tpl);
+                        }
+                        else if (OP_TAGS.count(typeid(node)))
+                        {
+                            write_u8(OP_TAGS.at(typeid(node)));
+                            if (auto unary = dynamic_cast<const UnaryOp*>(&node))
+                            {
+                                write_node(*unary->get_arg());
+                            }
+                            else
+                            {
+                                auto &binary = dynamic_cast<const BinaryOp&>(node);
+                                write_node(*binary.get_lhs());
+                                write_node(*binary.get_rhs());
+                            }
+                        }
+                        else throw Error(std::string("Can not save expression ") + typeid(node).name());
+                    }
+                    void write_interp(const expr::InterpolatedString &str)
+                    {
+                        write_u32((uint32_t)str.get_nodes().size());
+                        for (auto &node : str.get_nodes())
+                        {
+                            if (node.expr)
+                            {
+                                write_u8(1);
+                                write_node(*node.expr);
+                            }
+                            else
+                            {
+                                write_u8(0);
+                                write_str(node.literal_text);
+                            }
+                        }
+                    }
+                    void write_value(const ObjectPtr &value)
+                    {
+                        if (value == NIL_VALUE) write_u8(VALUE_NIL);
+                        else if (value == TRUE_VALUE) write_u8(VALUE_TRUE);
+                        else if (value == FALSE_VALUE) write_u8(VALUE_FALSE);
+                        else if (auto num = dynamic_cast<const Number*>(value.get()))
+                        {
+                            write_u8(VALUE_NUMBER);
+                            write_f64(num->get_value());
+                        }
+                        else if (auto str = dynamic_cast<const String*>(value.get()))
+                        {
+                            write_u8(VALUE_STRING);
+                            write_str(str->get_value());
+                        }
+                        else if (auto sym = dynamic_pointer_cast<Symbol>(value))
+                        {
+                            write_u8(VALUE_SYMBOL);
+                            write_sym(sym);
+                        }
+                        else if (auto regex = dynamic_cast<Regexp*>(value.get()))
+                        {
+                            write_u8(VALUE_REGEXP);
+                            write_u32((uint32_t)regex->options()->get_value());
+                            write_str(regex->source()->get_value());
+                        }
+                        else if (objects)
+                        {
+                            write_u8(VALUE_OBJECT);
+                            write_u32((uint32_t)objects->size());
+                            objects->push_back(value);
+                        }
+                        else throw Error("Can not save literal of type " + value->type_name());
+                    }
+                };
+
+                class Reader
+                {
+                public:
+                    /**@param objects The object table from Writer, if any.*/
+                    Reader(const char *data, size_t len, const std::vector<ObjectPtr> *objects = nullptr)
+                        : p(data), end(data + len), objects(objects), depth(0)
+                    {}
+
+                    std::unique_ptr<TemplatePart> read()
+                    {
+                        if ((size_t)(end - p) < sizeof(MAGIC) || memcmp(p, MAGIC, sizeof(MAGIC)) != 0)
+                            error("not a template binary");
+                        p += sizeof(MAGIC);
+                        auto version = read_u32();
+                        if (version != VERSION)
+                            error("unsupported version " + std::to_string(version));
+                        if (read_u32() != BYTE_ORDER_MARK) error("byte order mismatch");
+
+                        auto count = read_count(sizeof(uint32_t));
+                        symbols.reserve(count);
+                        for (uint32_t i = 0; i < count; ++i) symbols.push_back(symbol(read_str()));
+
+                        auto root = read_part();
+                        if (p != end) error("unexpected data after end");
+                        return root;
+                    }
+                private:
+                    const char *p, *end;
+                    const std::vector<ObjectPtr> *objects;
+                    std::vector<SymPtr> symbols;
+                    /**Current nesting of read_part and read_node.*/
+                    uint32_t depth;
+
+                    /**Counts a level of nesting for its lifetime, see MAX_DEPTH.*/
+                    class Nested
+                    {
+                    public:
+                        explicit Nested(Reader &reader) : reader(reader)
+                        {
+                            if (reader.depth >= MAX_DEPTH) reader.error("nesting too deep");
+                            ++reader.depth;
+                        }
+                        ~Nested() { --reader.depth; }
+                        Nested(const Nested&) = delete;
+                        Nested& operator = (const Nested&) = delete;
+                    private:
+                        Reader &reader;
+                    };
+
+                    [[noreturn]] void error(const std::string &msg)
+                    {
+                        throw Error("Invalid template binary, " + msg);
+                    }
+                    void need(size_t n)
+                    {
+                        if ((size_t)(end - p) < n) error("unexpected end of data");
+                    }
+                    uint8_t read_u8()
+                    {
+                        need(1);
+                        return (uint8_t)*p++;
+                    }
+                    uint32_t read_u32()
+                    {
+                        uint32_t x;
+                        need(sizeof(x));
+                        memcpy(&x, p, sizeof(x));
+                        p += sizeof(x);
+                        return x;
+                    }
+                    double read_f64()
+                    {
+                        double x;
+                        need(sizeof(x));
+                        memcpy(&x, p, sizeof(x));
+                        p += sizeof(x);
+                        return x;
+                    }
+                    /**Read an element count, checking it against the remaining data so that a
+                     * corrupt count can not cause a huge allocation.
+                     */
+                    uint32_t read_count(size_t min_element_size)
+                    {
+                        auto count = read_u32();
+                        if ((size_t)(end - p) / min_element_size < count) error("unexpected end of data");
+                        return count;
+                    }
+                    std::string read_str()
+                    {
+                        auto len = read_u32();
+                        need(len);
+                        std::string str(p, len);
+                        p += len;
+                        return str;
+                    }
+                    SymPtr read_sym()
+                    {
+                        auto i = read_u32();
+                        if (i >= symbols.size()) error("invalid symbol index");
+                        return symbols[i];
+                    }
+                    std::vector<SymPtr> read_syms()
+                    {
+                        auto count = read_count(sizeof(uint32_t));
+                        std::vector<SymPtr> syms;
+                        syms.reserve(count);
+                        for (uint32_t i = 0; i < count; ++i) syms.push_back(read_sym());
+                        return syms;
+                    }
+                    /**Read a variable slot. A scope has a slot for "self" and for each distinct
+                     * name, so a larger slot is corrupt, and would make Scope::set allocate that
+                     * many slots.
+                     */
+                    uint32_t read_slot()
+                    {
+                        auto slot = read_u32();
+                        if (slot != expr::Scope::NO_SLOT && slot > symbols.size())
+                            error("invalid variable slot " + std::to_string(slot));
+                        return slot;
+                    }
+
+                    std::unique_ptr<TemplatePart> read_part()
+                    {
+                        Nested nested(*this);
+                        auto tag = read_u8();
+                        switch (tag)
+                        {
+                        case PART_LIST:
+                        {
+                            auto count = read_count(1);
+                            std::vector<std::unique_ptr<TemplatePart>> parts;
+                            parts.reserve(count);
+                            for (uint32_t i = 0; i < count; ++i) parts.push_back(read_part());
+                            return slim::make_unique<TemplatePartsList>(std::move(parts));
+                        }
+                        case PART_TEXT: return slim::make_unique<TemplateText>(read_str());
+                        case PART_FLUSH: return slim::make_unique<TemplateFlush>();
+                        case PART_OUTPUT: return slim::make_unique<TemplateOutputExpr>(read_node());
+                        case PART_CODE: return slim::make_unique<TemplateCodeBlock>(read_node());
+                        case PART_EACH: return slim::make_unique<TemplateEachExpr>(read_node());
+                        case PART_ATTR:
+                        {
+                            auto attr = read_str();
+                            auto count = read_count(sizeof(uint32_t));
+                            std::vector<std::string> static_values;
+                            static_values.reserve(count);
+                            for (uint32_t i = 0; i < count; ++i) static_values.push_back(read_str());
+                            auto dynamic_values = read_nodes();
+                            return slim::make_unique<TemplateTagAttr>(
+                                attr, std::move(static_values), std::move(dynamic_values));
+                        }
+                        case PART_SPLAT_ATTRS:
+                        {
+                            TemplateTagSplatAttrs::Static static_attrs;
+                            auto count = read_count(sizeof(uint32_t) * 2);
+                            for (uint32_t i = 0; i < count; ++i)
+                            {
+                                auto name = read_str();
+                                static_attrs.emplace(std::move(name), read_str());
+                            }
+                            TemplateTagSplatAttrs::Dynamic dynamic_attrs;
+                            count = read_count(sizeof(uint32_t) + 1);
+                            for (uint32_t i = 0; i < count; ++i)
+                            {
+                                auto name = read_str();
+                                dynamic_attrs.emplace(std::move(name), read_node());
+                            }
+                            auto splat_attrs = read_nodes();
+                            return slim::make_unique<TemplateTagSplatAttrs>(
+                                std::move(static_attrs), std::move(dynamic_attrs), std::move(splat_attrs));
+                        }
+                        case PART_FOR:
+                        {
+                            auto expr = read_node();
+                            auto body = read_part();
+                            auto params = read_syms();
+                            return slim::make_unique<TemplateForExpr>(std::move(expr), std::move(body), std::move(params));
+                        }
+                        case PART_IF:
+                        {
+                            auto count = read_count(2);
+                            auto expr = read_node();
+                            TemplateCondExpr if_expr(std::move(expr), read_part());
+                            std::vector<TemplateCondExpr> elseif_exprs;
+                            elseif_exprs.reserve(count);
+                            for (uint32_t i = 0; i < count; ++i)
+                            {
+                                expr = read_node();
+                                elseif_exprs.emplace_back(std::move(expr), read_part());
+                            }
+                            std::unique_ptr<TemplatePart> else_body;
+                            if (read_u8()) else_body = read_part();
+                            return slim::make_unique<TemplateIfExpr>(
+                                std::move(if_expr), std::move(elseif_exprs), std::move(else_body));
+                        }
+                        case PART_CACHE:
+                        {
+                            auto digest = read_str();
+                            auto key = read_node();
+                            auto body = read_node();
+                            auto block = dynamic_cast<const expr::Block*>(body.get());
+                            if (!block || !dynamic_cast<const TemplateCaptureBlock*>(block->get_code().get()))
+                                error("cache body is not a template block");
+                            return slim::make_unique<TemplateCacheBlock>(std::move(key), std::move(body), std::move(digest));
+                        }
+                        default: error("unknown template part " + std::to_string(tag));
+                        }
+                    }
+
+                    expr::FuncCall::Args read_nodes()
+                    {
+                        auto count = read_count(1);
+                        expr::FuncCall::Args nodes;
+                        nodes.reserve(count);
+                        for (uint32_t i = 0; i < count; ++i) nodes.push_back(read_node());
+                        return nodes;
+                    }
+                    template<class T> expr::ExpressionNodePtr read_unary()
+                    {
+                        return slim::make_unique<T>(read_node());
+                    }
+                    template<class T> expr::ExpressionNodePtr read_binary()
+                    {
+                        auto lhs = read_node();
+                        return slim::make_unique<T>(std::move(lhs), read_node());
+                    }
+                    expr::ExpressionNodePtr read_node()
+                    {
+                        using namespace expr;
+                        Nested nested(*this);
+                        auto tag = read_u8();
+                        switch (tag)
+                        {
+                        case NODE_LITERAL: return slim::make_unique<Literal>(read_value());
+                        case NODE_VARIABLE:
+                        {
+                            auto name = read_sym();
+                            auto depth = read_u32();
+                            return slim::make_unique<Variable>(name, depth, read_slot());
+                        }
+                        case NODE_ASSIGNMENT:
+                        {
+                            auto name = read_sym();
+                            auto slot = read_slot();
+                            auto expr = read_node();
+                            return slim::make_unique<Assignment>(name, std::move(expr), slot);
+                        }
+                        case NODE_ATTRIBUTE: return slim::make_unique<Attribute>(read_sym());
+                        case NODE_GLOBAL_CONSTANT: return slim::make_unique<GlobalConstant>(read_sym());
+                        case NODE_CONSTANT_NAV:
+                        {
+                            auto lhs = read_node();
+                            return slim::make_unique<ConstantNav>(std::move(lhs), read_sym());
+                        }
+                        case NODE_GLOBAL_FUNC_CALL:
+                        {
+                            auto name = read_sym();
+                            return slim::make_unique<GlobalFuncCall>(name, read_nodes());
+                        }
+                        case NODE_MEMBER_FUNC_CALL:
+                        case NODE_SAFE_NAV_MEMBER_FUNC_CALL:
+                        {
+                            auto lhs = read_node();
+                            auto name = read_sym();
+                            auto args = read_nodes();
+                            if (tag == NODE_SAFE_NAV_MEMBER_FUNC_CALL)
+                                return slim::make_unique<SafeNavMemberFuncCall>(std::move(lhs), name, std::move(args));
+                            return slim::make_unique<MemberFuncCall>(std::move(lhs), name, std::move(args));
+                        }
+                        case NODE_ELEMENT_REF:
+                        {
+                            auto lhs = read_node();
+                            return slim::make_unique<ElementRefOp>(std::move(lhs), read_nodes());
+                        }
+                        case NODE_ARRAY_LITERAL: return slim::make_unique<ArrayLiteral>(read_nodes());
+                        case NODE_HASH_LITERAL: return slim::make_unique<HashLiteral>(read_nodes());
+                        case NODE_INCLUSIVE_RANGE: return read_binary<InclusiveRangeOp>();
+                        case NODE_EXCLUSIVE_RANGE: return read_binary<ExclusiveRangeOp>();
+                        case NODE_BLOCK:
+                        {
+                            auto params = read_syms();
+                            auto locals = read_syms();
+                            if (locals.size() < params.size()) error("block locals do not include params");
+                            return slim::make_unique<Block>(std::move(params), std::move(locals), read_node());
+                        }
+                        case NODE_CONDITIONAL:
+                        {
+                            auto cond = read_node();
+                            auto true_expr = read_node();
+                            return slim::make_unique<Conditional>(std::move(cond), std::move(true_expr), read_node());
+                        }
+                        case NODE_INTERPOLATED_STRING: return read_interp();
+                        case NODE_INTERPOLATED_REGEX:
+                        {
+                            auto opts = (int)read_u32();
+                            return slim::make_unique<InterpolatedRegex>(read_interp(), opts);
+                        }
+                        case NODE_TEMPLATE_CAPTURE_BLOCK: return slim::make_unique<TemplateCaptureBlock>(read_part());
+                        case NODE_TEMPLATE_OUTPUT_BLOCK: return slim::make_unique<TemplateOutputBlock>(read_part());
+                        case NODE_NEGATIVE: return read_unary<Negative>();
+                        case NODE_NOT: return read_unary<Not>();
+                        case NODE_LOGICAL_NOT: return read_unary<LogicalNot>();
+                        case NODE_MUL: return read_binary<Mul>();
+                        case NODE_DIV: return read_binary<Div>();
+                        case NODE_MOD: return read_binary<Mod>();
+                        case NODE_POW: return read_binary<Pow>();
+                        case NODE_ADD: return read_binary<Add>();
+                        case NODE_SUB: return read_binary<Sub>();
+                        case NODE_LSHIFT: return read_binary<Lshift>();
+                        case NODE_RSHIFT: return read_binary<Rshift>();
+                        case NODE_AND: return read_binary<And>();
+                        case NODE_OR: return read_binary<Or>();
+                        case NODE_XOR: return read_binary<Xor>();
+                        case NODE_EQ: return read_binary<Eq>();
+                        case NODE_NE: return read_binary<Ne>();
+                        case NODE_CMP: return read_binary<Cmp>();
+                        case NODE_LT: return read_binary<Lt>();
+                        case NODE_LE: return read_binary<Le>();
+                        case NODE_GT: return read_binary<Gt>();
+                        case NODE_GE: return read_binary<Ge>();
+                        case NODE_LOGICAL_AND: return read_binary<LogicalAnd>();
+                        case NODE_LOGICAL_OR: return read_binary<LogicalOr>();
+                        default: error("unknown expression " + std::to_string(tag));
+                        }
+                    }
+                    std::unique_ptr<expr::InterpolatedString> read_interp()
+                    {
+                        auto count = read_count(1);
+                        expr::InterpolatedString::Nodes nodes;
+                        nodes.reserve(count);
+                        for (uint32_t i = 0; i < count; ++i)
+                        {
+                            if (read_u8()) nodes.emplace_back(read_node());
+                            else nodes.emplace_back(read_str());
+                        }
+                        return slim::make_unique<expr::InterpolatedString>(std::move(nodes));
+                    }
+                    ObjectPtr read_value()
+                    {
+                        auto tag = read_u8();
+                        switch (tag)
+                        {
+                        case VALUE_NIL: return NIL_VALUE;
+                        case VALUE_TRUE: return TRUE_VALUE;
+                        case VALUE_FALSE: return FALSE_VALUE;
+                        case VALUE_NUMBER: return make_value(read_f64());
+                        case VALUE_STRING: return make_value(read_str());
+                        case VALUE_SYMBOL: return read_sym();
+                        case VALUE_REGEXP:
+                        {
+                            auto opts = (int)read_u32();
+                            return create_object<Regexp>(read_str(), opts);
+                        }
+                        case VALUE_OBJECT:
+                        {
+                            auto i = read_u32();
+                            if (!objects || i >= objects->size()) error("invalid object " + std::to_string(i));
+                            return (*objects)[i];
+                        }
+                        default: error("unknown literal " + std::to_string(tag));
+                        }
+                    }
+                };
+            }
+        }
+    }
+
+    namespace tpl
+    {
+        namespace binary
+        {
+            std::unique_ptr<TemplatePart> copy_tree(const TemplatePart &root)
+            {
+                std::vector<ObjectPtr> objects;
+                auto data = Writer(&objects).write(root);
+                return Reader(data.data(), data.size(), &objects).read();
+            }
+        }
+    }
+
+    std::string save_template_binary(const Template &tpl)
+    {
+        return tpl::binary::Writer().write(tpl.get_root());
+    }
+    void save_template_binary_file(const Template &tpl, const std::string &path)
+    {
+        auto data = save_template_binary(tpl);
+        std::ofstream os(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        os.write(data.data(), (std::streamsize)data.size());
+        os.close();
+        if (!os) throw std::runtime_error("Failed to write " + path);
+    }
+
+    Template load_template_binary(const char *data, size_t len)
+    {
+        RenderArena::Suspend suspend; // See parse_template
+        return Template(tpl::binary::Reader(data, len).read());
+    }
+    Template load_template_binary_file(const std::string &path)
+    {
+    #ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::runtime_error("Failed to load " + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Failed to load " + path);
+        }
+        auto size = (size_t)st.st_size;
+        if (size == 0)
+        {
+            close(fd);
+            return load_template_binary(nullptr, 0);
+        }
+        void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) throw std::runtime_error("Failed to load " + path);
+        struct Unmap
+        {
+            void *data;
+            size_t size;
+            ~Unmap() { munmap(data, size); }
+        } unmap{data, size};
+        return load_template_binary((const char*)data, size);
+    #else
+        std::ifstream is(path, std::ios::in | std::ios::binary);
+        if (!is) throw std::runtime_error("Failed to load " + path);
+        std::stringstream ss;
+        ss << is.rdbuf();
+        auto data = ss.str();
+        return load_template_binary(data.data(), data.size());
+    #endif
+    }
+}
@@ -0,0 +1,158 @@
+#include "template/Bytecode.hpp"
+#include "template/TemplateParts.hpp"
+#include "expression/Ast.hpp"
+#include "types/String.hpp"
+#include "types/Symbol.hpp"
+#include <iomanip>
+#include <sstream>
+namespace slim
+{
+    namespace tpl
+    {
+        namespace
+        {
+            const char *op_name(Instruction::Op op)
+            {
+                switch (op)
+                {
+                case Instruction::TEXT: return "TEXT";
+                case Instruction::FLUSH: return "FLUSH";
+                case Instruction::OUTPUT: return "OUTPUT";
+                case Instruction::POP: return "POP";
+                case Instruction::RETURN: return "RETURN";
+                case Instruction::PUSH_CONST: return "PUSH_CONST";
+                case Instruction::PUSH_SELF: return "PUSH_SELF";
+                case Instruction::PUSH_OUTPUT_BUFFER: return "PUSH_OUTPUT_BUFFER";
+                case Instruction::LOAD_SLOT: return "LOAD_SLOT";
+                case Instruction::STORE_SLOT: return "STORE_SLOT";
+                case Instruction::LOAD_VAR: return "LOAD_VAR";
+                case Instruction::LOAD_ATTR: return "LOAD_ATTR";
+                case Instruction::LOAD_CONSTANT: return "LOAD_CONSTANT";
+                case Instruction::CONST_NAV: return "CONST_NAV";
+                case Instruction::CALL_SELF: return "CALL_SELF";
+                case Instruction::CALL: return "CALL";
+                case Instruction::EL_REF: return "EL_REF";
+                case Instruction::MAKE_ARRAY: return "MAKE_ARRAY";
+                case Instruction::MAKE_HASH: return "MAKE_HASH";
+                case Instruction::MAKE_RANGE: return "MAKE_RANGE";
+                case Instruction::MAKE_REGEX: return "MAKE_REGEX";
+                case Instruction::CONCAT: return "CONCAT";
+                case Instruction::MAKE_BLOCK: return "MAKE_BLOCK";
+                case Instruction::NEGATE: return "NEGATE";
+                case Instruction::BIT_NOT: return "BIT_NOT";
+                case Instruction::LOGICAL_NOT: return "LOGICAL_NOT";
+                case Instruction::MUL: return "MUL";
+                case Instruction::DIV: return "DIV";
+                case Instruction::MOD: return "MOD";
+                case Instruction::POW: return "POW";
+                case Instruction::ADD: return "ADD";
+                case Instruction::SUB: return "SUB";
+                case Instruction::LSHIFT: return "LSHIFT";
+                case Instruction::RSHIFT: return "RSHIFT";
+                case Instruction::BIT_AND: return "BIT_AND";
+                case Instruction::BIT_OR: return "BIT_OR";
+                case Instruction::BIT_XOR: return "BIT_XOR";
+                case Instruction::EQ: return "EQ";
+                case Instruction::NE: return "NE";
+                case Instruction::CMP: return "CMP";
+                case Instruction::LT: return "LT";
+                case Instruction::LE: return "LE";
+                case Instruction::GT: return "GT";
+                case Instruction::GE: return "GE";
+                case Instruction::JUMP: return "JUMP";
+                case Instruction::JUMP_IF_FALSE: return "JUMP_IF_FALSE";
+                case Instruction::JUMP_IF_FALSE_KEEP: return "JUMP_IF_FALSE_KEEP";
+                case Instruction::JUMP_IF_TRUE_KEEP: return "JUMP_IF_TRUE_KEEP";
+                case Instruction::JUMP_IF_NIL_KEEP: return "JUMP_IF_NIL_KEEP";
+                case Instruction::ITER_BEGIN: return "ITER_BEGIN";
+                case Instruction::ITER_NEXT: return "ITER_NEXT";
+                case Instruction::ATTR: return "ATTR";
+                case Instruction::SPLAT_ATTRS: return "SPLAT_ATTRS";
+                case Instruction::CACHE: return "CACHE";
+                case Instruction::EVAL_NODE: return "EVAL_NODE";
+                case Instruction::RENDER_PART: return "RENDER_PART";
+                }
+                return "?";
+            }
+        }
+
+        const uint32_t Program::NO_SLOT;
+
+        Program::Program() {}
+        Program::~Program() {}
+
+        std::string Program::disassemble()const
+        {
+            std::stringstream ss;
+            for (size_t i = 0; i < blocks.size(); ++i)
+            {
+                auto &block = blocks[i];
+                ss << "block " << i << " entry " << block.entry << " params";
+                for (auto slot : block.params) ss << ' ' << slot_names[slot]->str();
+                ss << '\n';
+            }
+            for (size_t i = 0; i < code.size(); ++i)
+            {
+                auto &ins = code[i];
+                ss << std::setw(4) << std::setfill('0') << i << ' ' << op_name(ins.op);
+                switch (ins.op)
+                {
+                case Instruction::TEXT:
+                case Instruction::CACHE:
+                    ss << ' ' << make_value(text[ins.a])->inspect();
+                    break;
+                case Instruction::PUSH_CONST:
+                    ss << ' ' << constants[ins.a]->inspect();
+                    break;
+                case Instruction::LOAD_SLOT:
+                case Instruction::STORE_SLOT:
+                    ss << ' ' << ins.a << " (" << slot_names[ins.a]->str() << ")";
+                    break;
+                case Instruction::LOAD_VAR:
+                case Instruction::LOAD_ATTR:
+                case Instruction::LOAD_CONSTANT:
+                case Instruction::CONST_NAV:
+                    ss << ' ' << symbols[ins.a]->str();
+                    break;
+                case Instruction::CALL_SELF:
+                case Instruction::CALL:
+                    ss << ' ' << site_names[ins.a]->str() << " argc " << ins.b;
+                    break;
+                case Instruction::EL_REF:
+                case Instruction::MAKE_ARRAY:
+                case Instruction::MAKE_HASH:
+                case Instruction::CONCAT:
+                    ss << ' ' << ins.b;
+                    break;
+                case Instruction::RETURN:
+                case Instruction::MAKE_RANGE:
+                case Instruction::MAKE_REGEX:
+                case Instruction::MAKE_BLOCK:
+                case Instruction::JUMP:
+                case Instruction::JUMP_IF_FALSE:
+                case Instruction::JUMP_IF_FALSE_KEEP:
+                case Instruction::JUMP_IF_TRUE_KEEP:
+                case Instruction::JUMP_IF_NIL_KEEP:
+                    ss << ' ' << ins.a;
+                    break;
+                case Instruction::ITER_BEGIN:
+                case Instruction::ITER_NEXT:
+                case Instruction::ATTR:
+                case Instruction::SPLAT_ATTRS:
+                    ss << ' ' << ins.a << ' ' << ins.b;
+                    break;
+                case Instruction::EVAL_NODE:
+                    ss << ' ' << nodes[ins.a]->to_string();
+                    break;
+                case Instruction::RENDER_PART:
+                    ss << ' ' << parts[ins.a]->to_string();
+                    break;
+                default:
+                    break;
+                }
+                ss << '\n';
+            }
+            return ss.str();
+        }
+    }
+}
@@ -0,0 +1,487 @@
+#include "template/Compiler.hpp"
+#include "template/TemplateBlock.hpp"
+#include "template/TemplateParts.hpp"
+#include "expression/ArithmeticOp.hpp"
+#include "expression/AstOp.hpp"
+#include "expression/CmpOp.hpp"
+#include "expression/LogicalOp.hpp"
+#include "types/String.hpp"
+#include "types/Symbol.hpp"
+#include "RenderArena.hpp"
+#include "Util.hpp"
+#include <typeindex>
+#include <unordered_map>
+namespace slim
+{
+    namespace tpl
+    {
+        namespace
+        {
+            typedef Instruction I;
+
+            const std::unordered_map<std::type_index, I::Op> BINARY_OPS = {
+                { typeid(expr::Mul), I::MUL },
+                { typeid(expr::Div), I::DIV },
+                { typeid(expr::Mod), I::MOD },
+                { typeid(expr::Pow), I::POW },
+                { typeid(expr::Add), I::ADD },
+                { typeid(expr::Sub), I::SUB },
+                { typeid(expr::Lshift), I::LSHIFT },
+                { typeid(expr::Rshift), I::RSHIFT },
+                { typeid(expr::And), I::BIT_AND },
+                { typeid(expr::Or), I::BIT_OR },
+                { typeid(expr::Xor), I::BIT_XOR },
+                { typeid(expr::Eq), I::EQ },
+                { typeid(expr::Ne), I::NE },
+                { typeid(expr::Cmp), I::CMP },
+                { typeid(expr::Lt), I::LT },
+                { typeid(expr::Le), I::LE },
+                { typeid(expr::Gt), I::GT },
+                { typeid(expr::Ge), I::GE }
+            };
+            const std::unordered_map<std::type_index, I::Op> UNARY_OPS = {
+                { typeid(expr::Negative), I::NEGATE },
+                { typeid(expr::Not), I::BIT_NOT },
+                { typeid(expr::LogicalNot), I::LOGICAL_NOT }
+            };
+
+            class Compiler
+            {
+            public:
+                Compiler() : program(slim::make_unique<Program>()) {}
+
+                std::unique_ptr<Program> compile(const TemplatePart &root)
+                {
+                    scopes.push_back({ NO_BLOCK, {} });
+                    compile_part(root);
+                    emit(I::RETURN);
+                    program->site_caches.reset(new CachedMethod[program->site_names.size()]);
+                    return std::move(program);
+                }
+            private:
+                static const uint32_t NO_BLOCK = 0xFFFFFFFF;
+                /**Compile time view of a variable scope.*/
+                struct CompileScope
+                {
+                    /**Block index, or NO_BLOCK for the template root.*/
+                    uint32_t block;
+                    /**Local variables declared so far, and their slots.*/
+                    std::vector<std::pair<SymPtr, uint32_t>> vars;
+                };
+
+                std::unique_ptr<Program> program;
+                std::vector<CompileScope> scopes;
+                std::unordered_map<const Symbol*, uint32_t> symbol_indices;
+
+                size_t emit(I::Op op, uint32_t a = 0, uint32_t b = 0)
+                {
+                    program->code.emplace_back(op, a, b);
+                    return program->code.size() - 1;
+                }
+                /**Set the jump target of instruction i to the next instruction.*/
+                void patch(size_t i)
+                {
+                    program->code[i].a = here();
+                }
+                uint32_t here()const
+                {
+                    return (uint32_t)program->code.size();
+                }
+
+                uint32_t constant(ObjectPtr value)
+                {
+                    program->constants.push_back(value);
+                    return (uint32_t)program->constants.size() - 1;
+                }
+                uint32_t sym(const SymPtr &name)
+                {
+                    auto ret = symbol_indices.emplace(name.get(), (uint32_t)program->symbols.size());
+                    if (ret.second) program->symbols.push_back(name);
+                    return ret.first->second;
+                }
+                uint32_t site(const SymPtr &name)
+                {
+                    program->site_names.push_back(name);
+                    return (uint32_t)program->site_names.size() - 1;
+                }
+                uint32_t new_slot(const SymPtr &name)
+                {
+                    program->slot_names.push_back(name);
+                    return (uint32_t)program->slot_names.size() - 1;
+                }
+                /**All slots currently in scope, for the tree walker fallbacks.*/
+                uint32_t visible_slots()
+                {
+                    std::vector<uint32_t> slots;
+                    for (auto &scope : scopes)
+                        for (auto &var : scope.vars) slots.push_back(var.second);
+                    program->visible_slots.push_back(std::move(slots));
+                    return (uint32_t)program->visible_slots.size() - 1;
+                }
+
+                /**Find the slot for a local variable, searching from the scope at depth down.*/
+                uint32_t resolve(const SymPtr &name, size_t depth)
+                {
+                    for (auto scope = scopes.rend() - (ptrdiff_t)depth; scope != scopes.rend(); ++scope)
+                    {
+                        for (auto var = scope->vars.rbegin(); var != scope->vars.rend(); ++var)
+                        {
+                            if (var->first == name) return var->second;
+                        }
+                    }
+                    return Program::NO_SLOT;
+                }
+                uint32_t resolve(const SymPtr &name)
+                {
+                    return resolve(name, scopes.size());
+                }
+                /**Get the slot to assign a variable in the innermost scope, which like Scope::set
+                 * does not assign to variables in outer scopes.
+                 */
+                uint32_t assign_slot(const SymPtr &name)
+                {
+                    auto &scope = scopes.back();
+                    for (auto &var : scope.vars)
+                    {
+                        if (var.first == name) return var.second;
+                    }
+                    auto slot = new_slot(name);
+                    scope.vars.emplace_back(name, slot);
+                    if (scope.block != NO_BLOCK)
+                    {
+                        auto outer = resolve(name, scopes.size() - 1);
+                        program->blocks[scope.block].locals.emplace_back(slot, outer);
+                    }
+                    return slot;
+                }
+
+                uint32_t begin_block(Program::BlockKind kind, const std::vector<SymPtr> &params)
+                {
+                    auto k = (uint32_t)program->blocks.size();
+                    Program::Block block;
+                    block.kind = kind;
+                    block.entry = here();
+                    block.each_site = Program::NO_SLOT;
+                    program->blocks.push_back(std::move(block));
+                    scopes.push_back({ k, {} });
+                    for (auto &param : params)
+                    {
+                        auto slot = new_slot(param);
+                        scopes.back().vars.emplace_back(param, slot);
+                        program->blocks[k].params.push_back(slot);
+                        program->blocks[k].locals.emplace_back(slot, Program::NO_SLOT);
+                    }
+                    return k;
+                }
+                void end_block()
+                {
+                    scopes.pop_back();
+                }
+
+                //Template parts
+                void compile_part(const TemplatePart &part)
+                {
+                    if (auto list = dynamic_cast<const TemplatePartsList*>(&part))
+                    {
+                        for (auto &child : list->get_parts()) compile_part(*child);
+                    }
+                    else if (auto text = dynamic_cast<const TemplateText*>(&part))
+                    {
+                        if (text->get_text().empty()) return;
+                        program->text.push_back(text->get_text());
+                        emit(I::TEXT, (uint32_t)program->text.size() - 1);
+                    }
+                    else if (dynamic_cast<const TemplateFlush*>(&part))
+                    {
+                        emit(I::FLUSH);
+                    }
+                    else if (auto output = dynamic_cast<const TemplateOutputExpr*>(&part))
+                    {
+                        compile_expr(*output->get_expression());
+                        emit(I::OUTPUT);
+                    }
+                    else if (auto code = dynamic_cast<const TemplateCodeBlock*>(&part))
+                    {
+                        compile_expr(*code->get_expression());
+                        emit(I::POP);
+                    }
+                    else if (auto each = dynamic_cast<const TemplateEachExpr*>(&part))
+                    {
+                        compile_each(*each);
+                    }
+                    else if (auto if_expr = dynamic_cast<const TemplateIfExpr*>(&part))
+                    {
+                        compile_if(*if_expr);
+                    }
+                    else if (auto cache = dynamic_cast<const TemplateCacheBlock*>(&part))
+                    {
+                        compile_expr(*cache->get_key());
+                        compile_expr(*cache->get_body());
+                        program->text.push_back(cache->get_digest());
+                        emit(I::CACHE, (uint32_t)program->text.size() - 1);
+                    }
+                    else if (auto attr = dynamic_cast<const TemplateTagAttr*>(&part))
+                    {
+                        for (auto &expr : attr->get_dynamic_values()) compile_expr(*expr);
+                        program->attrs.push_back(attr);
+                        emit(I::ATTR, (uint32_t)program->attrs.size() - 1, (uint32_t)attr->get_dynamic_values().size());
+                    }
+                    else if (auto splat = dynamic_cast<const TemplateTagSplatAttrs*>(&part))
+                    {
+                        for (auto &i : splat->get_dynamic_attrs()) compile_expr(*i.second);
+                        for (auto &expr : splat->get_splat_attrs()) compile_expr(*expr);
+                        program->splat_attrs.push_back(splat);
+                        emit(I::SPLAT_ATTRS, (uint32_t)program->splat_attrs.size() - 1,
+                            (uint32_t)(splat->get_dynamic_attrs().size() + splat->get_splat_attrs().size()));
+                    }
+                    else
+                    {
+                        program->parts.push_back(&part);
+                        emit(I::RENDER_PART, (uint32_t)program->parts.size() - 1, visible_slots());
+                    }
+                }
+
+                void compile_each(const TemplateEachExpr &each)
+                {
+                    //"- collection.each do |params|" becomes a loop, other block calls
+                    //(e.g. each_with_index) are compiled as a normal method call with a block
+                    auto call = dynamic_cast<const expr::MemberFuncCall*>(each.get_expression().get());
+                    const expr::Block *block = nullptr;
+                    const TemplateOutputBlock *body = nullptr;
+                    if (call && !dynamic_cast<const expr::SafeNavMemberFuncCall*>(call) &&
+                        call->name->str() == "each" && call->args.size() == 1)
+                    {
+                        block = dynamic_cast<const expr::Block*>(call->args[0].get());
+                        if (block) body = dynamic_cast<const TemplateOutputBlock*>(block->get_code().get());
+                    }
+                    if (!body)
+                    {
+                        compile_expr(*each.get_expression());
+                        emit(I::POP);
+                        return;
+                    }
+
+                    compile_expr(*call->lhs);
+                    auto begin = emit(I::ITER_BEGIN);
+                    auto k = begin_block(Program::BLOCK_OUTPUT, block->get_param_names());
+                    program->blocks[k].each_site = site(call->name);
+                    compile_part(*body->tpl);
+                    emit(I::ITER_NEXT, k, program->blocks[k].entry);
+                    end_block();
+                    program->code[begin].a = k;
+                    program->code[begin].b = here();
+                }
+
+                void compile_if(const TemplateIfExpr &if_expr)
+                {
+                    std::vector<size_t> end_jumps;
+                    auto cond = [&](const TemplateCondExpr &cond, bool last) {
+                        compile_expr(*cond.expr);
+                        auto skip = emit(I::JUMP_IF_FALSE);
+                        compile_part(*cond.body);
+                        if (!last) end_jumps.push_back(emit(I::JUMP));
+                        patch(skip);
+                    };
+                    bool has_else = if_expr.get_else_body() != nullptr;
+                    cond(if_expr.get_if_expr(), !has_else && if_expr.get_elseif_exprs().empty());
+                    for (size_t i = 0; i < if_expr.get_elseif_exprs().size(); ++i)
+                    {
+                        cond(if_expr.get_elseif_exprs()[i], !has_else && i + 1 == if_expr.get_elseif_exprs().size());
+                    }
+                    if (has_else) compile_part(*if_expr.get_else_body());
+                    for (auto jump : end_jumps) patch(jump);
+                }
+
+                //Expressions
+                void compile_args(const expr::FuncCall::Args &args)
+                {
+                    for (auto &arg : args) compile_expr(*arg);
+                }
+
+                void compile_expr(const expr::ExpressionNode &node)
+                {
+                    using namespace expr;
+                    if (auto literal = dynamic_cast<const Literal*>(&node))
+                    {
+                        emit(I::PUSH_CONST, constant(literal->value));
+                    }
+                    else if (auto var = dynamic_cast<const Variable*>(&node))
+                    {
+                        compile_variable(var->name);
+                    }
+                    else if (auto assign = dynamic_cast<const Assignment*>(&node))
+                    {
+                        compile_expr(*assign->expr);
+                        emit(I::STORE_SLOT, assign_slot(assign->name));
+                    }
+                    else if (auto attr = dynamic_cast<const Attribute*>(&node))
+                    {
+                        emit(I::LOAD_ATTR, sym(attr->name));
+                    }
+                    else if (auto constant = dynamic_cast<const GlobalConstant*>(&node))
+                    {
+                        emit(I::LOAD_CONSTANT, sym(constant->name));
+                    }
+                    else if (auto nav = dynamic_cast<const ConstantNav*>(&node))
+                    {
+                        compile_expr(*nav->lhs);
+                        emit(I::CONST_NAV, sym(nav->name));
+                    }
+                    else if (auto call = dynamic_cast<const SafeNavMemberFuncCall*>(&node))
+                    {
+                        compile_expr(*call->lhs);
+                        auto skip = emit(I::JUMP_IF_NIL_KEEP);
+                        compile_args(call->args);
+                        emit(I::CALL, site(call->name), (uint32_t)call->args.size());
+                        patch(skip);
+                    }
+                    else if (auto call = dynamic_cast<const MemberFuncCall*>(&node))
+                    {
+                        compile_expr(*call->lhs);
+                        compile_args(call->args);
+                        emit(I::CALL, site(call->name), (uint32_t)call->args.size());
+                    }
+                    else if (auto call = dynamic_cast<const GlobalFuncCall*>(&node))
+                    {
+                        compile_args(call->args);
+                        emit(I::CALL_SELF, site(call->name), (uint32_t)call->args.size());
+                    }
+                    else if (auto ref = dynamic_cast<const ElementRefOp*>(&node))
+                    {
+                        compile_expr(*ref->lhs);
+                        compile_args(ref->args);
+                        emit(I::EL_REF, 0, (uint32_t)ref->args.size());
+                    }
+                    else if (auto arr = dynamic_cast<const ArrayLiteral*>(&node))
+                    {
+                        compile_args(arr->args);
+                        emit(I::MAKE_ARRAY, 0, (uint32_t)arr->args.size());
+                    }
+                    else if (auto hash = dynamic_cast<const HashLiteral*>(&node))
+                    {
+                        compile_args(hash->args);
+                        emit(I::MAKE_HASH, 0, (uint32_t)hash->args.size());
+                    }
+                    else if (auto range = dynamic_cast<const RangeOp*>(&node))
+                    {
+                        compile_expr(*range->get_lhs());
+                        compile_expr(*range->get_rhs());
+                        emit(I::MAKE_RANGE, dynamic_cast<const ExclusiveRangeOp*>(range) ? 1 : 0);
+                    }
+                    else if (auto block = dynamic_cast<const Block*>(&node))
+                    {
+                        compile_block(*block);
+                    }
+                    else if (auto cond = dynamic_cast<const Conditional*>(&node))
+                    {
+                        compile_expr(*cond->get_cond());
+                        auto skip_true = emit(I::JUMP_IF_FALSE);
+                        compile_expr(*cond->get_true_expr());
+                        auto skip_false = emit(I::JUMP);
+                        patch(skip_true);
+                        compile_expr(*cond->get_false_expr());
+                        patch(skip_false);
+                    }
+                    else if (auto str = dynamic_cast<const InterpolatedString*>(&node))
+                    {
+                        compile_interpolated(*str);
+                    }
+                    else if (auto regex = dynamic_cast<const InterpolatedRegex*>(&node))
+                    {
+                        compile_interpolated(*regex->get_src());
+                        emit(I::MAKE_REGEX, (uint32_t)regex->get_opts());
+                    }
+                    else if (auto op = dynamic_cast<const LogicalAnd*>(&node))
+                    {
+                        compile_expr(*op->get_lhs());
+                        auto skip = emit(I::JUMP_IF_FALSE_KEEP);
+                        compile_expr(*op->get_rhs());
+                        patch(skip);
+                    }
+                    else if (auto op = dynamic_cast<const LogicalOr*>(&node))
+                    {
+                        compile_expr(*op->get_lhs());
+                        auto skip = emit(I::JUMP_IF_TRUE_KEEP);
+                        compile_expr(*op->get_rhs());
+                        patch(skip);
+                    }
+                    else if (BINARY_OPS.count(typeid(node)))
+                    {
+                        auto &op = static_cast<const BinaryOp&>(node);
+                        compile_expr(*op.get_lhs());
+                        compile_expr(*op.get_rhs());
+                        emit(BINARY_OPS.at(typeid(node)));
+                    }
+                    else if (UNARY_OPS.count(typeid(node)))
+                    {
+                        auto &op = static_cast<const UnaryOp&>(node);
+                        compile_expr(*op.get_arg());
+                        emit(UNARY_OPS.at(typeid(node)));
+                    }
+                    else
+                    {
+                        program->nodes.push_back(&node);
+                        emit(I::EVAL_NODE, (uint32_t)program->nodes.size() - 1, visible_slots());
+                    }
+                }
+
+                void compile_variable(const SymPtr &name)
+                {
+                    auto slot = resolve(name);
+                    if (slot != Program::NO_SLOT) emit(I::LOAD_SLOT, slot);
+                    else if (name->str() == "self") emit(I::PUSH_SELF);
+                    else if (name->str() == "output_buffer") emit(I::PUSH_OUTPUT_BUFFER);
+                    else emit(I::LOAD_VAR, sym(name));
+                }
+
+                void compile_interpolated(const expr::InterpolatedString &str)
+                {
+                    for (auto &node : str.get_nodes())
+                    {
+                        if (node.expr) compile_expr(*node.expr);
+                        else emit(I::PUSH_CONST, constant(make_value(node.literal_text)));
+                    }
+                    emit(I::CONCAT, 0, (uint32_t)str.get_nodes().size());
+                }
+
+                void compile_block(const expr::Block &block)
+                {
+                    auto kind = Program::BLOCK_EXPR;
+                    const TemplatePart *tpl = nullptr;
+                    if (auto capture = dynamic_cast<const TemplateCaptureBlock*>(block.get_code().get()))
+                    {
+                        kind = Program::BLOCK_CAPTURE;
+                        tpl = capture->tpl.get();
+                    }
+                    else if (auto output = dynamic_cast<const TemplateOutputBlock*>(block.get_code().get()))
+                    {
+                        kind = Program::BLOCK_OUTPUT;
+                        tpl = output->tpl.get();
+                    }
+                    //Block body is placed inline, and skipped over when creating the Proc
+                    auto skip = emit(I::JUMP);
+                    auto k = begin_block(kind, block.get_param_names());
+                    if (tpl)
+                    {
+                        compile_part(*tpl);
+                        emit(I::RETURN, 0);
+                    }
+                    else
+                    {
+                        compile_expr(*block.get_code());
+                        emit(I::RETURN, 1);
+                    }
+                    end_block();
+                    patch(skip);
+                    emit(I::MAKE_BLOCK, k);
+                }
+            };
+        }
+
+        std::unique_ptr<Program> compile(const TemplatePart &root)
+        {
+            RenderArena::Suspend suspend; // Program constants are kept by the template
+            return Compiler().compile(root);
+        }
+    }
+}
@@ -0,0 +1,615 @@
+#include "template/CppGenerator.hpp"
+#include "template/Bytecode.hpp"
+#include "template/Template.hpp"
+#include "template/TemplateParts.hpp"
+#include "types/Boolean.hpp"
+#include "types/Nil.hpp"
+#include "types/Number.hpp"
+#include "types/Regexp.hpp"
+#include "types/String.hpp"
+#include "types/Symbol.hpp"
+#include "Error.hpp"
+#include <cmath>
+#include <cstdio>
+#include <set>
+#include <sstream>
+namespace slim
+{
+    namespace tpl
+    {
+        namespace
+        {
+            typedef Instruction I;
+
+            /**C++ string literal for str. Long strings are split over multiple lines.*/
+            std::string cpp_string(const std::string &str)
+            {
+                std::string out = "\"";
+                size_t line = 0;
+                for (auto c : str)
+                {
+                    if (line >= 100)
+                    {
+                        out += "\"\n        \"";
+                        line = 0;
+                    }
+                    switch (c)
+                    {
+                    case '"': out += "\\\""; break;
+                    case '\\': out += "\\\\"; break;
+                    case '?': out += "\\?"; break;
+                    case '\n': out += "\\n"; break;
+                    case '\r': out += "\\r"; break;
+                    case '\t': out += "\\t"; break;
+                    default:
+                        if ((unsigned char)c < 0x20 || (unsigned char)c >= 0x7F)
+                        {
+                            //Octal escapes are at most 3 digits, unlike hex
+                            char buf[8];
+                            snprintf(buf, sizeof(buf), "\\%03o", (unsigned)(unsigned char)c);
+                            out += buf;
+                        }
+                        else out += c;
+                        break;
+                    }
+                    ++line;
+                }
+                out += '"';
+                return out;
+            }
+            /**Expression constructing a std::string, which may contain null characters.*/
+            std::string cpp_std_string(const std::string &str)
+            {
+                return "std::string(" + cpp_string(str) + ", " + std::to_string(str.size()) + ")";
+            }
+            std::string cpp_double(double value)
+            {
+                if (!std::isfinite(value)) throw Error("slimc: Non-finite number constant");
+                char buf[32];
+                snprintf(buf, sizeof(buf), "%.17g", value);
+                std::string str = buf;
+                if (str.find_first_of(".e") == std::string::npos) str += ".0";
+                return str;
+            }
+            /**Expression recreating a literal constant.*/
+            std::string cpp_constant(const ObjectPtr &value)
+            {
+                if (value == NIL_VALUE) return "NIL_VALUE";
+                if (value == TRUE_VALUE) return "TRUE_VALUE";
+                if (value == FALSE_VALUE) return "FALSE_VALUE";
+                if (auto num = dynamic_cast<Number*>(value.get()))
+                    return "make_value(" + cpp_double(num->get_value()) + ")";
+                if (auto str = dynamic_cast<String*>(value.get()))
+                    return "make_value(" + cpp_std_string(str->get_value()) + ")";
+                if (auto sym = dynamic_cast<Symbol*>(value.get()))
+                    return "symbol(" + cpp_std_string(sym->str()) + ")";
+                if (auto regex = dynamic_cast<Regexp*>(value.get()))
+                {
+                    return "create_object<Regexp>(" + cpp_std_string(regex->source()->get_value()) + ", " +
+                        std::to_string((int)regex->options()->get_value()) + ")";
+                }
+                throw Error("slimc: Unsupported constant type " + value->type_name());
+            }
+            std::string cpp_symbol(const SymPtr &sym)
+            {
+                return "symbol(" + cpp_std_string(sym->str()) + ")";
+            }
+
+            /**Generates the body of VM::run for a Program.*/
+            class RunGenerator
+            {
+            public:
+                RunGenerator(const Program &program, std::stringstream &out)
+                    : program(program), out(out), depths(program.code.size(), -1), max_depth(1)
+                {}
+
+                void generate()
+                {
+                    find_depths();
+                    out << "        auto &d = data();\n";
+                    out << "        (void)d;\n";
+                    out << "        (void)block;\n";
+                    out << "        ObjectPtr r[" << max_depth << "];\n";
+                    out << "        switch (pc)\n";
+                    out << "        {\n";
+                    for (auto entry : entries) out << "        case " << entry << ": goto L" << entry << ";\n";
+                    out << "        default: throw std::logic_error(\"Invalid entry point\");\n";
+                    out << "        }\n";
+                    for (uint32_t pc = 0; pc < program.code.size(); ++pc)
+                    {
+                        if (depths[pc] < 0) continue; //unreachable
+                        if (labels.count(pc)) out << "    L" << pc << ":\n";
+                        instruction(program.code[pc], (uint32_t)depths[pc]);
+                    }
+                }
+            private:
+                const Program &program;
+                std::stringstream &out;
+                /**Operand stack depth before each instruction, or -1 if unreachable.*/
+                std::vector<int> depths;
+                std::set<uint32_t> entries;
+                std::set<uint32_t> labels;
+                int max_depth;
+
+                /**Determine the stack depth at every reachable instruction, so that each stack
+                 * position can be a fixed local variable.
+                 */
+                void find_depths()
+                {
+                    std::vector<std::pair<uint32_t, int>> pending;
+                    entries.insert(0);
+                    for (auto &block : program.blocks) entries.insert(block.entry);
+                    for (auto entry : entries)
+                    {
+                        labels.insert(entry);
+                        pending.emplace_back(entry, 0);
+                    }
+                    while (!pending.empty())
+                    {
+                        auto pc = pending.back().first;
+                        auto depth = pending.back().second;
+                        pending.pop_back();
+                        while (true)
+                        {
+                            if (pc >= program.code.size()) throw Error("slimc: Code runs past end of program");
+                            if (depths[pc] >= 0)
+                            {
+                                if (depths[pc] != depth) throw Error("slimc: Inconsistent stack depth");
+                                break;
+                            }
+                            depths[pc] = depth;
+                            auto &ins = program.code[pc];
+                            int after = depth + stack_effect(ins);
+                            if (after < 0) throw Error("slimc: Stack underflow");
+                            max_depth = std::max(max_depth, std::max(depth, after));
+
+                            uint32_t target = 0;
+                            int target_depth = after;
+                            bool jumps = true, falls = true;
+                            switch (ins.op)
+                            {
+                            case I::RETURN: jumps = falls = false; break;
+                            case I::JUMP: target = ins.a; falls = false; break;
+                            case I::JUMP_IF_FALSE: target = ins.a; break;
+                            case I::JUMP_IF_FALSE_KEEP:
+                            case I::JUMP_IF_TRUE_KEEP:
+                                target = ins.a;
+                                target_depth = depth;
+                                break;
+                            case I::JUMP_IF_NIL_KEEP: target = ins.a; break;
+                            case I::ITER_BEGIN: target = ins.b; break;
+                            case I::ITER_NEXT: target = ins.b; break;
+                            default: jumps = false; break;
+                            }
+                            if (jumps)
+                            {
+                                labels.insert(target);
+                                pending.emplace_back(target, target_depth);
+                            }
+                            if (!falls) break;
+                            ++pc;
+                            depth = after;
+                        }
+                    }
+                }
+                static int stack_effect(const Instruction &ins)
+                {
+                    int b = (int)ins.b;
+                    switch (ins.op)
+                    {
+                    case I::OUTPUT: case I::POP: case I::JUMP_IF_FALSE: case I::ITER_BEGIN:
+                    case I::JUMP_IF_FALSE_KEEP: case I::JUMP_IF_TRUE_KEEP:
+                    case I::MAKE_RANGE:
+                    case I::MUL: case I::DIV: case I::MOD: case I::POW: case I::ADD: case I::SUB:
+                    case I::LSHIFT: case I::RSHIFT: case I::BIT_AND: case I::BIT_OR: case I::BIT_XOR:
+                    case I::EQ: case I::NE: case I::CMP: case I::LT: case I::LE: case I::GT: case I::GE:
+                        return -1;
+                    case I::PUSH_CONST: case I::PUSH_SELF: case I::PUSH_OUTPUT_BUFFER:
+                    case I::LOAD_SLOT: case I::LOAD_VAR: case I::LOAD_ATTR: case I::LOAD_CONSTANT:
+                    case I::MAKE_BLOCK:
+                        return 1;
+                    case I::CALL_SELF: case I::MAKE_ARRAY: case I::MAKE_HASH: case I::CONCAT:
+                        return 1 - b;
+                    case I::CALL: case I::EL_REF: case I::ATTR: case I::SPLAT_ATTRS:
+                        return -b;
+                    case I::CACHE:
+                        return -2;
+                    case I::EVAL_NODE: case I::RENDER_PART:
+                        throw Error("slimc: Template contains parts only supported by the interpreter");
+                    default:
+                        return 0;
+                    }
+                }
+
+                static std::string reg(uint32_t i)
+                {
+                    return "r[" + std::to_string(i) + "]";
+                }
+                /**FunctionArgs initializer for count values ending before depth.*/
+                static std::string args(uint32_t depth, uint32_t count)
+                {
+                    std::string out = "{";
+                    for (uint32_t i = depth - count; i < depth; ++i)
+                    {
+                        if (i != depth - count) out += ", ";
+                        out += reg(i);
+                    }
+                    return out + "}";
+                }
+                static std::string method(uint32_t site, const std::string &obj)
+                {
+                    return "(*d.program.site_caches[" + std::to_string(site) + "].get(" + obj +
+                        ", d.program.site_names[" + std::to_string(site) + "]))";
+                }
+
+                void instruction(const Instruction &ins, uint32_t depth)
+                {
+                    auto top = depth ? reg(depth - 1) : "";
+                    auto lhs = depth > 1 ? reg(depth - 2) : "";
+                    auto binary = [&](const char *method) {
+                        out << "        " << lhs << " = " << lhs << "->" << method << "(" << top << ".get());\n";
+                    };
+                    auto compare = [&](const char *func) {
+                        out << "        " << lhs << " = " << func << "(" << lhs << ".get(), " << top << ".get());\n";
+                    };
+                    switch (ins.op)
+                    {
+                    case I::TEXT:
+                    {
+                        auto &text = program.text[ins.a];
+                        out << "        buffer.append_static(" << cpp_string(text) << ", " << text.size() << ");\n";
+                        break;
+                    }
+                    case I::FLUSH:
+                        out << "        buffer.flush();\n";
+                        break;
+                    case I::OUTPUT:
+                        out << "        buffer.append_escaped(" << top << ".get());\n";
+                        break;
+                    case I::POP:
+                        break;
+                    case I::RETURN:
+                        out << "        return " << (ins.a ? top : "NIL_VALUE") << ";\n";
+                        break;
+
+                    case I::PUSH_CONST:
+                        out << "        " << reg(depth) << " = d.program.constants[" << ins.a << "];\n";
+                        break;
+                    case I::PUSH_SELF:
+                        out << "        " << reg(depth) << " = self;\n";
+                        break;
+                    case I::PUSH_OUTPUT_BUFFER:
+                        out << "        " << reg(depth) << " = create_object<OutputBufferObject>(buffer);\n";
+                        break;
+                    case I::LOAD_SLOT:
+                        out << "        " << reg(depth) << " = load_slot(" << ins.a << ");\n";
+                        break;
+                    case I::STORE_SLOT:
+                        out << "        slots[" << ins.a << "] = " << top << ";\n";
+                        break;
+                    case I::LOAD_VAR:
+                        out << "        " << reg(depth) << " = scope.get(d.program.symbols[" << ins.a << "]);\n";
+                        break;
+                    case I::LOAD_ATTR:
+                        out << "        " << reg(depth) << " = self->get_attr(d.program.symbols[" << ins.a << "]);\n";
+                        break;
+                    case I::LOAD_CONSTANT:
+                        out << "        " << reg(depth) << " = self->get_constant(d.program.symbols[" << ins.a << "]);\n";
+                        break;
+                    case I::CONST_NAV:
+                        out << "        " << top << " = " << top << "->get_constant(d.program.symbols[" << ins.a << "]);\n";
+                        break;
+
+                    case I::CALL_SELF:
+                        out << "        if (auto deps = RenderDependencies::current()) deps->call(self.get(), d.program.site_names[" <<
+                            ins.a << "]);\n";
+                        out << "        " << reg(depth - ins.b) << " = " << method(ins.a, "self.get()") <<
+                            "(self.get(), " << args(depth, ins.b) << ");\n";
+                        break;
+                    case I::CALL:
+                    {
+                        auto obj = reg(depth - ins.b - 1);
+                        out << "        " << obj << " = " << method(ins.a, obj + ".get()") <<
+                            "(" << obj << ".get(), " << args(depth, ins.b) << ");\n";
+                        break;
+                    }
+                    case I::EL_REF:
+                    {
+                        auto obj = reg(depth - ins.b - 1);
+                        out << "        " << obj << " = " << obj << "->el_ref(" << args(depth, ins.b) << ");\n";
+                        break;
+                    }
+                    case I::MAKE_ARRAY:
+                        out << "        " << reg(depth - ins.b) << " = make_array(std::vector<ObjectPtr>" << args(depth, ins.b) << ");\n";
+                        break;
+                    case I::MAKE_HASH:
+                        out << "        " << reg(depth - ins.b) << " = make_hash(std::vector<ObjectPtr>" << args(depth, ins.b) << ");\n";
+                        break;
+                    case I::MAKE_RANGE:
+                        out << "        " << lhs << " = create_object<Range>(" << lhs << ", " << top << ", " <<
+                            (ins.a ? "true" : "false") << ");\n";
+                        break;
+                    case I::MAKE_REGEX:
+                        out << "        " << top << " = create_object<Regexp>(coerce<String>(" << top << ")->get_value(), " << ins.a << ");\n";
+                        break;
+                    case I::CONCAT:
+                        out << "        {\n";
+                        out << "            std::string str;\n";
+                        for (uint32_t i = depth - ins.b; i < depth; ++i)
+                            out << "            str += " << reg(i) << "->to_string();\n";
+                        out << "            " << reg(depth - ins.b) << " = make_value(std::move(str));\n";
+                        out << "        }\n";
+                        break;
+                    case I::MAKE_BLOCK:
+                        out << "        " << reg(depth) << " = make_block(" << ins.a << ", &buffer);\n";
+                        break;
+
+                    case I::NEGATE:
+                        out << "        " << top << " = " << top << "->negate();\n";
+                        break;
+                    case I::BIT_NOT:
+                        out << "        " << top << " = " << top << "->bit_not();\n";
+                        break;
+                    case I::LOGICAL_NOT:
+                        out << "        " << top << " = op_not(" << top << ".get());\n";
+                        break;
+                    case I::MUL: binary("mul"); break;
+                    case I::DIV: binary("div"); break;
+                    case I::MOD: binary("mod"); break;
+                    case I::POW: binary("pow"); break;
+                    case I::ADD: binary("add"); break;
+                    case I::SUB: binary("sub"); break;
+                    case I::LSHIFT: binary("bit_lshift"); break;
+                    case I::RSHIFT: binary("bit_rshift"); break;
+                    case I::BIT_AND: binary("bit_and"); break;
+                    case I::BIT_OR: binary("bit_or"); break;
+                    case I::BIT_XOR: binary("bit_xor"); break;
+                    case I::EQ: compare("op_eq"); break;
+                    case I::NE: compare("op_ne"); break;
+                    case I::CMP: compare("op_cmp"); break;
+                    case I::LT: compare("op_lt"); break;
+                    case I::LE: compare("op_le"); break;
+                    case I::GT: compare("op_gt"); break;
+                    case I::GE: compare("op_ge"); break;
+
+                    case I::JUMP:
+                        out << "        goto L" << ins.a << ";\n";
+                        break;
+                    case I::JUMP_IF_FALSE:
+                    case I::JUMP_IF_FALSE_KEEP:
+                        out << "        if (!" << top << "->is_true()) goto L" << ins.a << ";\n";
+                        break;
+                    case I::JUMP_IF_TRUE_KEEP:
+                        out << "        if (" << top << "->is_true()) goto L" << ins.a << ";\n";
+                        break;
+                    case I::JUMP_IF_NIL_KEEP:
+                        out << "        if (" << top << " == NIL_VALUE) goto L" << ins.a << ";\n";
+                        break;
+                    case I::ITER_BEGIN:
+                        out << "        if (!iter_begin(" << ins.a << ", std::move(" << top << "), buffer)) goto L" << ins.b << ";\n";
+                        break;
+                    case I::ITER_NEXT:
+                        out << "        if (block == " << ins.a << ") return NIL_VALUE;\n";
+                        out << "        if (iter_next(" << ins.a << ")) goto L" << ins.b << ";\n";
+                        break;
+
+                    case I::ATTR:
+                        out << "        TemplateTagAttr::render_attr(buffer, d.attrs[" << ins.a << "].first, d.attrs[" << ins.a <<
+                            "].second, &" << reg(depth - ins.b) << ", " << ins.b << ");\n";
+                        break;
+                    case I::SPLAT_ATTRS:
+                    {
+                        auto &splat = *program.splat_attrs[ins.a];
+                        out << "        TemplateTagSplatAttrs::render_attrs(buffer, d.splat_static[" << ins.a <<
+                            "], d.splat_dynamic[" << ins.a << "], " << splat.get_splat_attrs().size() << ", &" <<
+                            reg(depth - ins.b) << ");\n";
+                        break;
+                    }
+
+                    case I::CACHE:
+                        out << "        {\n";
+                        out << "            static const std::string digest = " << cpp_std_string(program.text[ins.a]) << ";\n";
+                        out << "            TemplateCacheBlock::render_fragment(buffer, digest, " << lhs <<
+                            ".get(), coerce<Proc>(" << top << ").get());\n";
+                        out << "        }\n";
+                        break;
+
+                    case I::EVAL_NODE:
+                    case I::RENDER_PART:
+                        throw Error("slimc: Template contains parts only supported by the interpreter");
+                    }
+                }
+            };
+
+            void generate_data(const Program &program, std::stringstream &out)
+            {
+                out << "    /**Program data for the VM, and attribute parts.*/\n";
+                out << "    struct Data\n";
+                out << "    {\n";
+                out << "        Program program;\n";
+                out << "        std::vector<std::pair<std::string, std::vector<std::string>>> attrs;\n";
+                out << "        std::vector<std::vector<std::pair<std::string, std::string>>> splat_static;\n";
+                out << "        std::vector<std::vector<std::string>> splat_dynamic;\n";
+                out << "\n";
+                out << "        Data()\n";
+                out << "        {\n";
+                for (auto &constant : program.constants)
+                    out << "            program.constants.push_back(" << cpp_constant(constant) << ");\n";
+                for (auto &sym : program.symbols)
+                    out << "            program.symbols.push_back(" << cpp_symbol(sym) << ");\n";
+                for (auto &sym : program.slot_names)
+                    out << "            program.slot_names.push_back(" << cpp_symbol(sym) << ");\n";
+                for (auto &sym : program.site_names)
+                    out << "            program.site_names.push_back(" << cpp_symbol(sym) << ");\n";
+                out << "            program.site_caches.reset(new CachedMethod[" << std::max<size_t>(program.site_names.size(), 1) << "]);\n";
+                for (auto &block : program.blocks)
+                {
+                    static const char *KINDS[] = { "Program::BLOCK_EXPR", "Program::BLOCK_CAPTURE", "Program::BLOCK_OUTPUT" };
+                    out << "            program.blocks.push_back({" << KINDS[block.kind] << ", " << block.entry << ", {";
+                    for (size_t i = 0; i < block.params.size(); ++i)
+                        out << (i ? ", " : "") << block.params[i];
+                    out << "}, {";
+                    for (size_t i = 0; i < block.locals.size(); ++i)
+                    {
+                        auto &local = block.locals[i];
+                        out << (i ? ", " : "") << "{" << local.first << ", ";
+                        if (local.second == Program::NO_SLOT) out << "Program::NO_SLOT}";
+                        else out << local.second << "}";
+                    }
+                    out << "}, " << block.each_site << "});\n";
+                }
+                for (auto attr : program.attrs)
+                {
+                    out << "            attrs.push_back({" << cpp_std_string(attr->get_attr()) << ", {";
+                    for (size_t i = 0; i < attr->get_static_values().size(); ++i)
+                        out << (i ? ", " : "") << cpp_std_string(attr->get_static_values()[i]);
+                    out << "}});\n";
+                }
+                for (auto splat : program.splat_attrs)
+                {
+                    //In the original iteration order, which determines the output order
+                    out << "            splat_static.push_back({";
+                    bool first = true;
+                    for (auto &i : splat->get_static_attrs())
+                    {
+                        out << (first ? "" : ", ") << "{" << cpp_std_string(i.first) << ", " << cpp_std_string(i.second) << "}";
+                        first = false;
+                    }
+                    out << "});\n";
+                    out << "            splat_dynamic.push_back({";
+                    first = true;
+                    for (auto &i : splat->get_dynamic_attrs())
+                    {
+                        out << (first ? "" : ", ") << cpp_std_string(i.first);
+                        first = false;
+                    }
+                    out << "});\n";
+                }
+                out << "        }\n";
+                out << "    };\n";
+                out << "    const Data &data()\n";
+                out << "    {\n";
+                out << "        static const Data data;\n";
+                out << "        return data;\n";
+                out << "    }\n";
+            }
+
+            void open_namespace(const std::string &name_space, std::stringstream &out)
+            {
+                if (!name_space.empty()) out << "namespace " << name_space << "\n{\n";
+            }
+            void close_namespace(const std::string &name_space, std::stringstream &out)
+            {
+                if (!name_space.empty()) out << "}\n";
+            }
+            std::string signature(const CppOptions &options, bool defaults)
+            {
+                return "std::string " + options.function_name + "(slim::ViewModelPtr model, bool doctype" +
+                    (defaults ? " = true" : "") + ")";
+            }
+        }
+
+        std::string generate_cpp(const Template &tpl, const std::string &source, const CppOptions &options)
+        {
+            auto &program = tpl.get_program();
+            std::stringstream out;
+            out << "//Generated by slimc, do not edit.\n";
+            if (!options.header.empty()) out << "#include " << cpp_string(options.header) << "\n";
+            out <<
+                "#include \"template/Bytecode.hpp\"\n"
+                "#include \"template/OutputBuffer.hpp\"\n"
+                "#include \"template/Template.hpp\"\n"
+                "#include \"template/TemplateBlock.hpp\"\n"
+                "#include \"template/TemplateParts.hpp\"\n"
+                "#include \"template/VM.hpp\"\n"
+                "#include \"expression/Scope.hpp\"\n"
+                "#include \"types/Array.hpp\"\n"
+                "#include \"types/Hash.hpp\"\n"
+                "#include \"types/Range.hpp\"\n"
+                "#include \"types/Regexp.hpp\"\n"
+                "#include \"types/String.hpp\"\n"
+                "#include \"types/Symbol.hpp\"\n"
+                "#include \"types/ViewModel.hpp\"\n"
+                "#include \"CachedMethod.hpp\"\n"
+                "#include \"Error.hpp\"\n"
+                "#include \"Operators.hpp\"\n"
+                "#include \"RenderDependencies.hpp\"\n"
+                "#include \"Template.hpp\"\n"
+                "#include <stdexcept>\n"
+                "\n"
+                "using namespace slim;\n"
+                "using namespace slim::tpl;\n"
+                "\n";
+            open_namespace(options.name_space, out);
+            out << "namespace\n{\n";
+            generate_data(program, out);
+            out << "\n";
+            out << "    class Renderer : public VM\n";
+            out << "    {\n";
+            out << "    public:\n";
+            out << "        using VM::VM;\n";
+            out << "    protected:\n";
+            out << "        virtual ObjectPtr run(uint32_t pc, OutputBuffer &buffer, uint32_t block)override;\n";
+            out << "    };\n";
+            out << "    ObjectPtr Renderer::run(uint32_t pc, OutputBuffer &buffer, uint32_t block)\n";
+            out << "    {\n";
+            RunGenerator(program, out).generate();
+            out << "    }\n";
+            if (options.test_mode)
+            {
+                out << "\n";
+                out << "    const char SOURCE[] = " << cpp_string(source) << ";\n";
+                out << "    /**Test mode, compare with the tree walking interpreter.*/\n";
+                out << "    void check(ViewModelPtr model, bool doctype, const std::string &result)\n";
+                out << "    {\n";
+                out << "        static const Template tpl = [] {\n";
+                out << "            auto tpl = parse_template(SOURCE, sizeof(SOURCE) - 1);\n";
+                out << "            tpl.set_exec_mode(Template::EXEC_TREE);\n";
+                out << "            return tpl;\n";
+                out << "        }();\n";
+                out << "        if (tpl.render(model, doctype) != result)\n";
+                out << "            throw Error(" << cpp_string("slimc: " + options.function_name +
+                    " output differs from the interpreted template") << ");\n";
+                out << "    }\n";
+            }
+            out << "}\n";
+            out << "\n";
+            out << signature(options, false) << "\n";
+            out << "{\n";
+            out << "    OutputBuffer buffer;\n";
+            out << "    if (doctype) buffer += \"<!DOCTYPE html>\\n\";\n";
+            out << "    expr::Scope scope(model);\n";
+            out << "    Renderer renderer(data().program, scope);\n";
+            out << "    renderer.render(buffer);\n";
+            if (options.test_mode)
+            {
+                out << "    auto result = buffer.take();\n";
+                out << "    check(model, doctype, result);\n";
+                out << "    return result;\n";
+            }
+            else out << "    return buffer.take();\n";
+            out << "}\n";
+            close_namespace(options.name_space, out);
+            return out.str();
+        }
+
+        std::string generate_cpp_header(const CppOptions &options)
+        {
+            std::stringstream out;
+            out << "//Generated by slimc, do not edit.\n";
+            out << "#pragma once\n";
+            out << "#include <string>\n";
+            out << "#include \"Ptr.hpp\"\n";
+            out << "namespace slim\n";
+            out << "{\n";
+            out << "    class ViewModel;\n";
+            out << "    typedef Ptr<ViewModel> ViewModelPtr;\n";
+            out << "}\n";
+            open_namespace(options.name_space, out);
+            out << "/**Render the template, as slim::Template::render.*/\n";
+            out << signature(options, true) << ";\n";
+            close_namespace(options.name_space, out);
+            return out.str();
+        }
+    }
+}
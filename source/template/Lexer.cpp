@@ -326,7 +326,16 @@ namespace slim
             else if (starts_with("elsif ")) t.type = Token::ELSIF;
             else if (starts_with("else")) t.type = Token::ELSE;
             else if (starts_with("unless ")) t.type = Token::UNLESS;
-            else t.type = Token::EACH_START;
+            else if (starts_with("cache ")) t.type = Token::CACHE;
+            else if (starts_with("flush") && (p >= end || *p == ' ' || *p == '\r' || *p == '\n'))
+            {
+                t.type = Token::FLUSH;
+            }
+            else
+            {
+                p = t.pos; //undo any partial "flush" match, e.g. "flush_all.each do"
+                t.type = Token::EACH_START;
+            }
             return t;
         }
 
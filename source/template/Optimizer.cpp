@@ -0,0 +1,401 @@
+#include "template/Optimizer.hpp"
+#include "template/OutputBuffer.hpp"
+#include "template/TemplateBlock.hpp"
+#include "template/TemplateParts.hpp"
+#include "expression/AstOp.hpp"
+#include "expression/LogicalOp.hpp"
+#include "types/Boolean.hpp"
+#include "types/Nil.hpp"
+#include "types/Number.hpp"
+#include "types/String.hpp"
+#include "types/Symbol.hpp"
+#include "types/ViewModel.hpp"
+#include "Error.hpp"
+#include "RenderArena.hpp"
+#include <sstream>
+#include <typeinfo>
+namespace slim
+{
+    namespace tpl
+    {
+        namespace
+        {
+            using namespace expr;
+
+            /**The immutable types that an expr::Literal may hold, and save_template_binary saves.
+             * Exact types only, e.g. a HtmlSafeString must keep its type.
+             */
+            bool is_literal_value(const Object *value)
+            {
+                auto &type = typeid(*value);
+                return type == typeid(Nil) || type == typeid(Boolean) || type == typeid(Number) ||
+                    type == typeid(String) || type == typeid(Symbol);
+            }
+            Literal *as_literal(const ExpressionNodePtr &node)
+            {
+                return dynamic_cast<Literal*>(node.get());
+            }
+            /**A Literal with a literal value. Inlined constants may be any object, which are not
+             * used by folding in case they are mutable (e.g. "<<").
+             */
+            Literal *as_constant(const ExpressionNodePtr &node)
+            {
+                auto literal = as_literal(node);
+                return literal && is_literal_value(literal->value.get()) ? literal : nullptr;
+            }
+        }
+
+        /**Rewrites a tree for optimize and fold_constants, taking the children of the parts and
+         * nodes it replaces. A friend of those classes.
+         */
+        class Optimizer
+        {
+        public:
+            explicit Optimizer(ViewModel *constants = nullptr)
+                : scope(create_view_model()), constants(constants)
+            {}
+
+            std::unique_ptr<TemplatePart> part(std::unique_ptr<TemplatePart> &&part)
+            {
+                if (auto list = dynamic_cast<TemplatePartsList*>(part.get()))
+                {
+                    std::vector<std::unique_ptr<TemplatePart>> parts;
+                    for (auto &child : list->parts) add_part(parts, this->part(std::move(child)));
+                    return make_list(std::move(parts));
+                }
+                else if (auto output = dynamic_cast<TemplateOutputExpr*>(part.get()))
+                {
+                    output->expression = node(std::move(output->expression));
+                    if (auto literal = as_constant(output->expression))
+                    {
+                        OutputBuffer buffer;
+                        buffer.append_escaped(literal->value.get());
+                        return slim::make_unique<TemplateText>(buffer.take());
+                    }
+                }
+                else if (auto code = dynamic_cast<TemplateCodeBlock*>(part.get()))
+                {
+                    code->expression = node(std::move(code->expression));
+                    if (as_literal(code->expression)) return empty();
+                }
+                else if (auto each = dynamic_cast<TemplateEachExpr*>(part.get()))
+                {
+                    each->expression = node(std::move(each->expression));
+                }
+                else if (auto attr = dynamic_cast<TemplateTagAttr*>(part.get()))
+                {
+                    std::vector<ObjectPtr> values;
+                    for (auto &value : attr->dynamic_values)
+                    {
+                        value = node(std::move(value));
+                        if (auto literal = as_constant(value)) values.push_back(literal->value);
+                    }
+                    if (values.size() == attr->dynamic_values.size())
+                    {
+                        OutputBuffer buffer;
+                        attr->render_values(buffer, values.data());
+                        return slim::make_unique<TemplateText>(buffer.take());
+                    }
+                }
+                else if (auto splat = dynamic_cast<TemplateTagSplatAttrs*>(part.get()))
+                {
+                    for (auto &i : splat->dynamic_attrs) i.second = node(std::move(i.second));
+                    for (auto &i : splat->splat_attrs) i = node(std::move(i));
+                }
+                else if (auto for_expr = dynamic_cast<TemplateForExpr*>(part.get()))
+                {
+                    for_expr->expr = node(std::move(for_expr->expr));
+                    for_expr->body = this->part(std::move(for_expr->body));
+                }
+                else if (auto if_expr = dynamic_cast<TemplateIfExpr*>(part.get()))
+                {
+                    return this->if_expr(*if_expr);
+                }
+                else if (auto cache = dynamic_cast<TemplateCacheBlock*>(part.get()))
+                {
+                    cache->key = node(std::move(cache->key));
+                    cache->body = node(std::move(cache->body));
+                }
+                return std::move(part);
+            }
+
+            ExpressionNodePtr node(ExpressionNodePtr &&node)
+            {
+                if (auto unary = dynamic_cast<UnaryOp*>(node.get()))
+                {
+                    unary->arg = this->node(std::move(unary->arg));
+                    if (as_constant(unary->arg)) return fold(std::move(node));
+                }
+                else if (auto range = dynamic_cast<RangeOp*>(node.get()))
+                {
+                    //Creates a new Range each time
+                    range->lhs = this->node(std::move(range->lhs));
+                    range->rhs = this->node(std::move(range->rhs));
+                }
+                else if (auto binary = dynamic_cast<BinaryOp*>(node.get()))
+                {
+                    binary->lhs = this->node(std::move(binary->lhs));
+                    binary->rhs = this->node(std::move(binary->rhs));
+                    auto lhs = as_literal(binary->lhs);
+                    if (as_constant(binary->lhs) && as_constant(binary->rhs)) return fold(std::move(node));
+                    if (lhs && dynamic_cast<LogicalAnd*>(binary))
+                        return lhs->value->is_true() ? std::move(binary->rhs) : std::move(binary->lhs);
+                    if (lhs && dynamic_cast<LogicalOr*>(binary))
+                        return lhs->value->is_true() ? std::move(binary->lhs) : std::move(binary->rhs);
+                }
+                else if (auto cond = dynamic_cast<Conditional*>(node.get()))
+                {
+                    cond->cond = this->node(std::move(cond->cond));
+                    cond->true_expr = this->node(std::move(cond->true_expr));
+                    cond->false_expr = this->node(std::move(cond->false_expr));
+                    if (auto literal = as_literal(cond->cond))
+                        return literal->value->is_true() ? std::move(cond->true_expr) : std::move(cond->false_expr);
+                }
+                else if (auto str = dynamic_cast<InterpolatedString*>(node.get()))
+                {
+                    string_nodes(*str);
+                    if (str->nodes.empty()) return slim::make_unique<Literal>(make_value(std::string()));
+                    if (str->nodes.size() == 1 && !str->nodes[0].expr)
+                        return slim::make_unique<Literal>(make_value(std::move(str->nodes[0].literal_text)));
+                }
+                else if (auto regex = dynamic_cast<InterpolatedRegex*>(node.get()))
+                {
+                    string_nodes(*regex->src);
+                }
+                else if (auto call = dynamic_cast<FuncCall*>(node.get()))
+                {
+                    for (auto &arg : call->args) arg = this->node(std::move(arg));
+                    if (auto member = dynamic_cast<MemberFuncCall*>(call)) member->lhs = this->node(std::move(member->lhs));
+                    else if (auto ref = dynamic_cast<ElementRefOp*>(call)) ref->lhs = this->node(std::move(ref->lhs));
+                }
+                else if (auto constant = dynamic_cast<GlobalConstant*>(node.get()))
+                {
+                    if (constants) return lookup(std::move(node), constants, constant->name);
+                }
+                else if (auto nav = dynamic_cast<ConstantNav*>(node.get()))
+                {
+                    nav->lhs = this->node(std::move(nav->lhs));
+                    auto lhs = as_literal(nav->lhs);
+                    if (constants && lhs) return lookup(std::move(node), lhs->value.get(), nav->name);
+                }
+                else if (auto assign = dynamic_cast<Assignment*>(node.get())) assign->expr = this->node(std::move(assign->expr));
+                else if (auto block = dynamic_cast<Block*>(node.get())) block->code = this->node(std::move(block->code));
+                else if (auto tpl_block = dynamic_cast<TemplateBlock*>(node.get())) tpl_block->tpl = part(std::move(tpl_block->tpl));
+                return std::move(node);
+            }
+        private:
+            /**Scope for evaluating constant expressions, which do not use it.*/
+            Scope scope;
+            ViewModel *constants;
+
+            static std::unique_ptr<TemplatePart> empty()
+            {
+                return slim::make_unique<TemplateText>(std::string());
+            }
+            /**Adds part to parts, merging lists and text.*/
+            static void add_part(std::vector<std::unique_ptr<TemplatePart>> &parts, std::unique_ptr<TemplatePart> &&part)
+            {
+                if (auto list = dynamic_cast<TemplatePartsList*>(part.get()))
+                {
+                    for (auto &child : list->parts) add_part(parts, std::move(child));
+                }
+                else if (auto text = dynamic_cast<TemplateText*>(part.get()))
+                {
+                    if (text->text.empty()) return;
+                    auto prev = parts.empty() ? nullptr : dynamic_cast<TemplateText*>(parts.back().get());
+                    if (prev) prev->text += text->text;
+                    else parts.push_back(std::move(part));
+                }
+                else parts.push_back(std::move(part));
+            }
+            static std::unique_ptr<TemplatePart> make_list(std::vector<std::unique_ptr<TemplatePart>> &&parts)
+            {
+                if (parts.empty()) return empty();
+                else if (parts.size() == 1) return std::move(parts[0]);
+                else return slim::make_unique<TemplatePartsList>(std::move(parts));
+            }
+
+            /**Evaluates node, which has only literal operands, to a Literal.*/
+            ExpressionNodePtr fold(ExpressionNodePtr &&node)
+            {
+                ObjectPtr value;
+                try
+                {
+                    value = node->eval(scope);
+                }
+                catch (const ScriptError &)
+                {
+                    return std::move(node);
+                }
+                if (!is_literal_value(value.get())) return std::move(node);
+                return slim::make_unique<Literal>(value);
+            }
+            /**Replaces node with the constant name of obj, if it has one.*/
+            ExpressionNodePtr lookup(ExpressionNodePtr &&node, Object *obj, const SymPtr &name)
+            {
+                try
+                {
+                    return slim::make_unique<Literal>(obj->get_constant(name));
+                }
+                catch (const ScriptError &)
+                {
+                    return std::move(node);
+                }
+            }
+            /**Folds the expressions of an interpolated string, and merges constant parts.*/
+            void string_nodes(InterpolatedString &str)
+            {
+                InterpolatedString::Nodes nodes;
+                for (auto &i : str.nodes)
+                {
+                    std::string text;
+                    if (i.expr)
+                    {
+                        i.expr = node(std::move(i.expr));
+                        auto literal = as_constant(i.expr);
+                        if (!literal)
+                        {
+                            nodes.push_back(std::move(i));
+                            continue;
+                        }
+                        text = literal->value->to_string();
+                    }
+                    else text = std::move(i.literal_text);
+                    if (!nodes.empty() && !nodes.back().expr) nodes.back().literal_text += text;
+                    else nodes.emplace_back(std::move(text));
+                }
+                str.nodes = std::move(nodes);
+            }
+            /**Removes branches with a constant false condition, and everything after one
+             * with a constant true condition, which becomes the else.
+             */
+            std::unique_ptr<TemplatePart> if_expr(TemplateIfExpr &if_expr)
+            {
+                std::vector<TemplateCondExpr> branches;
+                branches.push_back(std::move(if_expr.if_expr));
+                for (auto &i : if_expr.elseif_exprs) branches.push_back(std::move(i));
+                auto else_body = std::move(if_expr.else_body);
+
+                std::vector<TemplateCondExpr> kept;
+                for (auto &branch : branches)
+                {
+                    branch.expr = node(std::move(branch.expr));
+                    if (auto literal = as_literal(branch.expr))
+                    {
+                        if (!literal->value->is_true()) continue;
+                        else_body = std::move(branch.body);
+                        break;
+                    }
+                    branch.body = part(std::move(branch.body));
+                    kept.push_back(std::move(branch));
+                }
+                if (else_body) else_body = part(std::move(else_body));
+
+                if (kept.empty()) return else_body ? std::move(else_body) : empty();
+                auto first = std::move(kept.front());
+                kept.erase(kept.begin());
+                return slim::make_unique<TemplateIfExpr>(std::move(first), std::move(kept), std::move(else_body));
+            }
+        };
+
+        namespace
+        {
+            class TreeDumper
+            {
+            public:
+                explicit TreeDumper(std::ostream &os) : os(os) {}
+
+                void part(const TemplatePart &part, int depth)
+                {
+                    indent(depth);
+                    if (auto list = dynamic_cast<const TemplatePartsList*>(&part))
+                    {
+                        os << "list\n";
+                        for (auto &child : list->get_parts()) this->part(*child, depth + 1);
+                    }
+                    else if (auto text = dynamic_cast<const TemplateText*>(&part))
+                    {
+                        os << "text ";
+                        quoted(text->get_text());
+                        os << '\n';
+                    }
+                    else if (dynamic_cast<const TemplateFlush*>(&part)) os << "flush\n";
+                    else if (auto output = dynamic_cast<const TemplateOutputExpr*>(&part))
+                        os << "output " << output->get_expression()->to_string() << '\n';
+                    else if (auto code = dynamic_cast<const TemplateCodeBlock*>(&part))
+                        os << "code " << code->get_expression()->to_string() << '\n';
+                    else if (auto each = dynamic_cast<const TemplateEachExpr*>(&part))
+                        os << "each " << each->get_expression()->to_string() << '\n';
+                    else if (auto for_expr = dynamic_cast<const TemplateForExpr*>(&part))
+                    {
+                        os << "for " << for_expr->get_expr()->to_string() << " |";
+                        for (size_t i = 0; i < for_expr->get_param_names().size(); ++i)
+                            os << (i ? ", " : "") << for_expr->get_param_names()[i]->str();
+                        os << "|\n";
+                        this->part(*for_expr->get_body(), depth + 1);
+                    }
+                    else if (auto if_expr = dynamic_cast<const TemplateIfExpr*>(&part))
+                    {
+                        os << "if " << if_expr->get_if_expr().expr->to_string() << '\n';
+                        this->part(*if_expr->get_if_expr().body, depth + 1);
+                        for (auto &elseif : if_expr->get_elseif_exprs())
+                        {
+                            indent(depth);
+                            os << "elsif " << elseif.expr->to_string() << '\n';
+                            this->part(*elseif.body, depth + 1);
+                        }
+                        if (if_expr->get_else_body())
+                        {
+                            indent(depth);
+                            os << "else\n";
+                            this->part(*if_expr->get_else_body(), depth + 1);
+                        }
+                    }
+                    else if (auto cache = dynamic_cast<const TemplateCacheBlock*>(&part))
+                    {
+                        os << "cache " << cache->get_key()->to_string() << '\n';
+                        auto block = static_cast<const expr::Block*>(cache->get_body().get());
+                        this->part(*static_cast<const TemplateBlock*>(block->get_code().get())->tpl, depth + 1);
+                    }
+                    else os << part.to_string() << '\n';
+                }
+            private:
+                std::ostream &os;
+
+                void indent(int depth)
+                {
+                    for (int i = 0; i < depth; ++i) os << "  ";
+                }
+                void quoted(const std::string &str)
+                {
+                    os << '"';
+                    for (auto c : str)
+                    {
+                        if (c == '\n') os << "\\n";
+                        else if (c == '"' || c == '\\') os << '\\' << c;
+                        else os << c;
+                    }
+                    os << '"';
+                }
+            };
+        }
+
+        std::unique_ptr<TemplatePart> optimize(std::unique_ptr<TemplatePart> &&part, ViewModel *constants)
+        {
+            RenderArena::Suspend suspend; // Folded values are kept by the template
+            return Optimizer(constants).part(std::move(part));
+        }
+        std::unique_ptr<expr::ExpressionNode> fold_constants(std::unique_ptr<expr::ExpressionNode> &&node)
+        {
+            RenderArena::Suspend suspend;
+            return Optimizer().node(std::move(node));
+        }
+
+        std::string dump_tree(const TemplatePart &part)
+        {
+            std::stringstream ss;
+            TreeDumper(ss).part(part, 0);
+            return ss.str();
+        }
+    }
+}
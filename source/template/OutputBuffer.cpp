@@ -0,0 +1,49 @@
+#include "template/OutputBuffer.hpp"
+#include "template/OutputSink.hpp"
+namespace slim
+{
+    namespace tpl
+    {
+        OutputBuffer::OutputBuffer(OutputSink *sink, size_t write_threshold)
+            : buf(), sink(sink), write_threshold(write_threshold), slots(), linked_size(0)
+            , link_content(false), link_static(sink && sink->gathers())
+        {}
+
+        void OutputBuffer::flush()
+        {
+            if (!sink) return;
+            write_buffered();
+            sink->flush();
+        }
+
+        std::string OutputBuffer::take()
+        {
+            if (slots.empty()) return std::move(buf);
+            std::string out;
+            out.reserve(size());
+            for_each_segment([&out](const char *data, size_t len) { out.append(data, len); });
+            buf.clear();
+            slots.clear();
+            linked_size = 0;
+            return out;
+        }
+
+        void OutputBuffer::write_buffered()
+        {
+            if (!sink) return;
+            if (slots.empty())
+            {
+                if (!buf.empty()) sink->write(buf.data(), buf.size());
+            }
+            else
+            {
+                segments.clear();
+                for_each_segment([this](const char *data, size_t len) { segments.push_back({data, len}); });
+                sink->write_segments(segments.data(), segments.size());
+            }
+            buf.clear();
+            slots.clear();
+            linked_size = 0;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#include "template/OutputSink.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <climits>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+namespace slim
+{
+    void OutputSink::write_segments(const OutputSegment *segments, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) write(segments[i].data, segments[i].len);
+    }
+
+    void CallbackSink::write(const char *data, size_t len)
+    {
+        write_func(data, len);
+    }
+    void CallbackSink::flush()
+    {
+        if (flush_func) flush_func();
+    }
+
+    void OStreamSink::write(const char *data, size_t len)
+    {
+        os.write(data, (std::streamsize)len);
+    }
+    void OStreamSink::flush()
+    {
+        os.flush();
+    }
+
+    void FdSink::write(const char *data, size_t len)
+    {
+        while (len > 0)
+        {
+        #ifdef _WIN32
+            auto ret = ::_write(fd, data, (unsigned)len);
+        #else
+            auto ret = ::write(fd, data, len);
+        #endif
+            if (ret < 0)
+            {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "FdSink write failed");
+            }
+            data += ret;
+            len -= (size_t)ret;
+        }
+    }
+
+    void FdSink::write_segments(const OutputSegment *segments, size_t count)
+    {
+    #ifdef _WIN32
+        OutputSink::write_segments(segments, count);
+    #else
+    #ifdef IOV_MAX
+        static const size_t MAX_IOV = IOV_MAX;
+    #else
+        static const size_t MAX_IOV = 1024;
+    #endif
+        iovec iov[64];
+        const size_t iov_count = std::min<size_t>(64, MAX_IOV);
+        size_t skip = 0; // Bytes of segments[0] already written
+        while (count > 0)
+        {
+            size_t n = 0;
+            for (; n < iov_count && n < count; ++n)
+            {
+                iov[n].iov_base = (void*)(segments[n].data + (n ? 0 : skip));
+                iov[n].iov_len = segments[n].len - (n ? 0 : skip);
+            }
+            auto ret = ::writev(fd, iov, (int)n);
+            if (ret < 0)
+            {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "FdSink write failed");
+            }
+            // Skip past the written data, which may end part way through a segment
+            auto written = (size_t)ret + skip;
+            skip = 0;
+            while (count > 0 && written >= segments->len)
+            {
+                written -= segments->len;
+                ++segments;
+                --count;
+            }
+            skip = written;
+        }
+    #endif
+    }
+    bool FdSink::gathers()const
+    {
+    #ifdef _WIN32
+        return false;
+    #else
+        return true;
+    #endif
+    }
+}
@@ -1,6 +1,7 @@
 #include "template/Parser.hpp"
 #include "template/Attributes.hpp"
 #include "template/Lexer.hpp"
+#include "template/Optimizer.hpp"
 #include "template/Template.hpp"
 #include "template/TemplatePart.hpp"
 #include "template/TemplateParts.hpp"
@@ -107,11 +108,11 @@ namespace slim
         };
 
         Parser::Parser(Lexer &lexer)
-            : lexer(lexer)
+            : lexer(lexer), optimize_tree(true)
         {}
 
         Parser::Parser(Lexer &lexer, const expr::LocalVarNames &local_vars)
-            : lexer(lexer), local_vars(local_vars)
+            : lexer(lexer), local_vars(local_vars), optimize_tree(true)
         {}
         Parser::~Parser()
         {}
@@ -122,6 +123,7 @@ namespace slim
             current_token = lexer.next_indent();
             parse_lines(-1, root);
             auto root_tpl = root.make_tpl();
+            if (optimize_tree) root_tpl = optimize(std::move(root_tpl));
             return Template(std::move(root_tpl));
         }
 
@@ -396,7 +398,12 @@ namespace slim
                 output.set_in_tag(false);
                 output << "/>";
             }
-            else if (!void_el) output << "</" + tag_name + ">";
+            else if (!void_el)
+            {
+                output << "</" + tag_name + ">";
+                //Send the head early when streaming, so the client can start fetching resources
+                if (tag_name == "head") output << slim::make_unique<TemplateFlush>();
+            }
             else error("HTML void elements can not have content");
             if (trailing_space) output << ' ';
         }
@@ -489,6 +496,7 @@ namespace slim
                 if (!func_call) error("Indented block after code line, but no method call to pass block to");
                 //add new local variables for block call
                 auto old_vars = local_vars;
+                local_vars.begin_frame();
                 for (auto &param : params)
                     local_vars.add(param->str());
                 //Pass the indented contents into a new block
@@ -497,7 +505,7 @@ namespace slim
                 //Create the executable template
                 auto block_tpl = block_frame.make_tpl();
                 //Turn it into a expr::Block and TemplateBlock AST node
-                auto block_expr = create_tpl_capture_block(std::move(params), std::move(block_tpl));
+                auto block_expr = create_tpl_capture_block(std::move(params), local_vars.frame_layout(), std::move(block_tpl));
                 //Put variables back
                 local_vars = old_vars;
                 //Add it as a block param to the function call
@@ -568,7 +576,35 @@ namespace slim
                         std::move(else_body)
                         );
                 }
-                else if (Token::EACH_START)
+                else if (current_token.type == Token::FLUSH)
+                {
+                    current_token = lexer.next_text_content();
+                    if (!current_token.str.empty())
+                        error("Unexpected content after 'flush'");
+                    current_token = lexer.next_indent();
+                    output << slim::make_unique<TemplateFlush>();
+                }
+                else if (current_token.type == Token::CACHE)
+                {
+                    std::unique_ptr<expr::ExpressionNode> key;
+                    bool had_do;
+                    std::vector<Ptr<Symbol>> params;
+                    parse_code_line_expr(&key, &had_do, &params);
+                    if (!had_do) error("Expected 'do' after cache key");
+                    if (!params.empty()) error("cache block does not take parameters");
+
+                    auto old_vars = local_vars;
+                    local_vars.begin_frame();
+                    OutputFrame block_frame;
+                    parse_lines(base_indent, block_frame);
+                    auto block_tpl = block_frame.make_tpl();
+                    auto digest = TemplateCacheBlock::body_digest(*block_tpl);
+                    auto block_expr = create_tpl_capture_block({}, local_vars.frame_layout(), std::move(block_tpl));
+                    local_vars = old_vars;
+
+                    output << slim::make_unique<TemplateCacheBlock>(std::move(key), std::move(block_expr), std::move(digest));
+                }
+                else if (current_token.type == Token::EACH_START)
                 {
                     std::unique_ptr<expr::ExpressionNode> expr;
                     bool had_do;
@@ -580,8 +616,11 @@ namespace slim
                     if (!func_call) error("Found 'do' at end of line, but does not follow method call");
 
                     //add new local variables for block call
+                    //TemplateEachExpr scope, then the block call scope
                     auto old_vars = local_vars;
+                    local_vars.begin_frame();
                     local_vars.add("output_buffer");
+                    local_vars.begin_frame();
                     for (auto &param : params)
                         local_vars.add(param->str());
                     //Pass the indented contents into a new block
@@ -590,7 +629,7 @@ namespace slim
                     //Create the executable template
                     auto block_tpl = block_frame.make_tpl();
                     //Turn it into a expr::Block and TemplateBlock AST node
-                    auto block_expr = create_tpl_output_block(std::move(params), std::move(block_tpl));
+                    auto block_expr = create_tpl_output_block(std::move(params), local_vars.frame_layout(), std::move(block_tpl));
                     //Put variables back
                     local_vars = old_vars;
                     //Add it as a block param to the function call
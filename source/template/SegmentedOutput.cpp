@@ -0,0 +1,36 @@
+#include "template/SegmentedOutput.hpp"
+#include "template/OutputBuffer.hpp"
+namespace slim
+{
+    SegmentedOutput::SegmentedOutput(std::unique_ptr<tpl::OutputBuffer> &&buffer)
+        : buffer(std::move(buffer))
+    {}
+    SegmentedOutput::SegmentedOutput(SegmentedOutput &&) = default;
+    SegmentedOutput& SegmentedOutput::operator = (SegmentedOutput &&) = default;
+    SegmentedOutput::~SegmentedOutput() {}
+
+    std::vector<OutputSegment> SegmentedOutput::segments()const
+    {
+        std::vector<OutputSegment> out;
+        out.reserve(buffer->get_slots().size() * 2 + 1);
+        buffer->for_each_segment([&out](const char *data, size_t len) { out.push_back({data, len}); });
+        return out;
+    }
+    size_t SegmentedOutput::size()const
+    {
+        return buffer->size();
+    }
+    std::string SegmentedOutput::str()const
+    {
+        std::string out;
+        out.reserve(size());
+        buffer->for_each_segment([&out](const char *data, size_t len) { out.append(data, len); });
+        return out;
+    }
+    void SegmentedOutput::write(OutputSink &sink)const
+    {
+        auto list = segments();
+        sink.write_segments(list.data(), list.size());
+        sink.flush();
+    }
+}
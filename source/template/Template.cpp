@@ -1,11 +1,117 @@
 #include "template/Template.hpp"
 #include "template/TemplatePart.hpp"
+#include "template/TemplateParts.hpp"
+#include "template/TemplateBlock.hpp"
+#include "template/OutputBuffer.hpp"
+#include "template/OutputSink.hpp"
+#include "template/SegmentedOutput.hpp"
+#include "template/Compiler.hpp"
+#include "template/VM.hpp"
+#include "expression/AstOp.hpp"
 #include "expression/Scope.hpp"
 #include "types/HtmlSafeString.hpp"
+#include "FragmentCache.hpp"
+#include "RenderArena.hpp"
+#include <sstream>
 namespace slim
 {
+    namespace
+    {
+        void write_stats(std::ostream &os, const std::string &site, const CachedMethod &cache)
+        {
+            auto stats = cache.stats();
+            if (!stats.misses && !stats.megamorphic) return;
+            os << site << ": hits " << stats.hits << ", misses " << stats.misses
+               << ", megamorphic " << stats.megamorphic << ", types " << stats.types << '\n';
+        }
+
+        /**Finds the MethodCall nodes in a template tree for Template::method_cache_stats.*/
+        class CacheStatsWriter
+        {
+        public:
+            explicit CacheStatsWriter(std::ostream &os) : os(os) {}
+
+            void part(const tpl::TemplatePart &part)
+            {
+                using namespace tpl;
+                if (auto list = dynamic_cast<const TemplatePartsList*>(&part))
+                {
+                    for (auto &child : list->get_parts()) this->part(*child);
+                }
+                else if (auto output = dynamic_cast<const TemplateOutputExpr*>(&part)) node(*output->get_expression());
+                else if (auto code = dynamic_cast<const TemplateCodeBlock*>(&part)) node(*code->get_expression());
+                else if (auto each = dynamic_cast<const TemplateEachExpr*>(&part)) node(*each->get_expression());
+                else if (auto attr = dynamic_cast<const TemplateTagAttr*>(&part)) nodes(attr->get_dynamic_values());
+                else if (auto splat = dynamic_cast<const TemplateTagSplatAttrs*>(&part))
+                {
+                    for (auto &i : splat->get_dynamic_attrs()) node(*i.second);
+                    nodes(splat->get_splat_attrs());
+                }
+                else if (auto for_expr = dynamic_cast<const TemplateForExpr*>(&part))
+                {
+                    node(*for_expr->get_expr());
+                    this->part(*for_expr->get_body());
+                }
+                else if (auto if_expr = dynamic_cast<const TemplateIfExpr*>(&part))
+                {
+                    node(*if_expr->get_if_expr().expr);
+                    this->part(*if_expr->get_if_expr().body);
+                    for (auto &elseif : if_expr->get_elseif_exprs())
+                    {
+                        node(*elseif.expr);
+                        this->part(*elseif.body);
+                    }
+                    if (if_expr->get_else_body()) this->part(*if_expr->get_else_body());
+                }
+                else if (auto cache = dynamic_cast<const TemplateCacheBlock*>(&part))
+                {
+                    node(*cache->get_key());
+                    node(*cache->get_body());
+                }
+            }
+        private:
+            std::ostream &os;
+
+            template<class T> void nodes(const std::vector<std::unique_ptr<T>> &nodes)
+            {
+                for (auto &child : nodes) node(*child);
+            }
+            void node(const expr::ExpressionNode &node)
+            {
+                using namespace expr;
+                if (auto call = dynamic_cast<const MethodCall*>(&node)) write_stats(os, call->to_string(), call->cache);
+                if (auto call = dynamic_cast<const FuncCall*>(&node)) nodes(call->args);
+
+                if (auto call = dynamic_cast<const MemberFuncCall*>(&node)) this->node(*call->lhs);
+                else if (auto ref = dynamic_cast<const ElementRefOp*>(&node)) this->node(*ref->lhs);
+                else if (auto nav = dynamic_cast<const ConstantNav*>(&node)) this->node(*nav->lhs);
+                else if (auto assign = dynamic_cast<const Assignment*>(&node)) this->node(*assign->expr);
+                else if (auto block = dynamic_cast<const Block*>(&node)) this->node(*block->get_code());
+                else if (auto unary = dynamic_cast<const UnaryOp*>(&node)) this->node(*unary->get_arg());
+                else if (auto binary = dynamic_cast<const BinaryOp*>(&node))
+                {
+                    this->node(*binary->get_lhs());
+                    this->node(*binary->get_rhs());
+                }
+                else if (auto cond = dynamic_cast<const Conditional*>(&node))
+                {
+                    this->node(*cond->get_cond());
+                    this->node(*cond->get_true_expr());
+                    this->node(*cond->get_false_expr());
+                }
+                else if (auto str = dynamic_cast<const InterpolatedString*>(&node))
+                {
+                    for (auto &i : str->get_nodes()) if (i.expr) this->node(*i.expr);
+                }
+                else if (auto regex = dynamic_cast<const InterpolatedRegex*>(&node)) this->node(*regex->get_src());
+                else if (auto tpl_block = dynamic_cast<const tpl::TemplateBlock*>(&node)) part(*tpl_block->tpl);
+            }
+        };
+    }
+
     Template::Template(std::unique_ptr<tpl::TemplatePart> &&root)
-        : root(std::move(root))
+        : root(std::move(root)), program(tpl::compile(*this->root)), exec_mode(EXEC_VM), render_arena(false)
+        , fragment_store()
     {}
 
     Template::~Template()
@@ -16,26 +122,91 @@ namespace slim
 
     std::string Template::render(ViewModelPtr model, bool doctype)const
     {
-        std::string buffer;
+        RenderArena::Scope arena(render_arena);
+        tpl::OutputBuffer buffer;
         if (doctype) buffer += "<!DOCTYPE html>\n";
         expr::Scope scope(model);
-        root->render(buffer, scope);
-        return buffer;
+        render_root(buffer, scope);
+        return buffer.take();
+    }
+    void Template::render(OutputSink &sink, ViewModelPtr model, bool doctype)const
+    {
+        RenderArena::Scope arena(render_arena);
+        tpl::OutputBuffer buffer(&sink);
+        if (doctype) buffer += "<!DOCTYPE html>\n";
+        expr::Scope scope(model);
+        render_root(buffer, scope);
+        buffer.flush();
+    }
+    SegmentedOutput Template::render_segments(ViewModelPtr model, bool doctype)const
+    {
+        RenderArena::Scope arena(render_arena);
+        auto buffer = slim::make_unique<tpl::OutputBuffer>();
+        buffer->set_link_content(true);
+        buffer->set_link_static(true);
+        if (doctype) *buffer += "<!DOCTYPE html>\n";
+        expr::Scope scope(model);
+        render_root(*buffer, scope);
+        return SegmentedOutput(std::move(buffer));
     }
     std::string Template::render_partial(expr::Scope &scope)
     {
-        std::string buffer;
-        root->render(buffer, scope);
-        return buffer;
+        RenderArena::Scope arena(render_arena);
+        tpl::OutputBuffer buffer;
+        render_root(buffer, scope);
+        return buffer.take();
     }
     std::string Template::render_layout(Template &layout, ViewModelPtr model, bool doctype)const
     {
         auto main_content = render(model, false);
         model->set_main_content(create_object<HtmlSafeString>(std::move(main_content)));
-        return layout.render(model, doctype);
+        RenderArena::Scope arena(layout.render_arena);
+        tpl::OutputBuffer buffer;
+        buffer.set_link_content(true);
+        if (doctype) buffer += "<!DOCTYPE html>\n";
+        expr::Scope scope(model);
+        layout.render_root(buffer, scope);
+        return buffer.take();
+    }
+    void Template::render_layout(OutputSink &sink, Template &layout, ViewModelPtr model, bool doctype)const
+    {
+        auto main_content = render(model, false);
+        model->set_main_content(create_object<HtmlSafeString>(std::move(main_content)));
+        RenderArena::Scope arena(layout.render_arena);
+        tpl::OutputBuffer buffer(&sink);
+        buffer.set_link_content(true);
+        if (doctype) buffer += "<!DOCTYPE html>\n";
+        expr::Scope scope(model);
+        layout.render_root(buffer, scope);
+        buffer.flush();
     }
     std::string Template::to_string()const
     {
         return root->to_string();
     }
+    std::string Template::disassemble()const
+    {
+        return program->disassemble();
+    }
+    std::string Template::method_cache_stats()const
+    {
+        std::stringstream ss;
+        for (size_t i = 0; i < program->site_names.size(); ++i)
+        {
+            write_stats(ss, "site " + std::to_string(i) + " " + program->site_names[i]->str(), program->site_caches[i]);
+        }
+        CacheStatsWriter(ss).part(*root);
+        return ss.str();
+    }
+
+    void Template::render_root(tpl::OutputBuffer &buffer, expr::Scope &scope)const
+    {
+        FragmentStore::Scope fragments(fragment_store.get());
+        if (exec_mode == EXEC_VM)
+        {
+            tpl::VM vm(*program, scope);
+            vm.render(buffer);
+        }
+        else root->render(buffer, scope);
+    }
 }
@@ -1,5 +1,6 @@
 #include "template/TemplateBlock.hpp"
 #include "template/TemplatePart.hpp"
+#include "template/OutputBuffer.hpp"
 #include "types/HtmlSafeString.hpp"
 #include "expression/AstOp.hpp"
 #include "expression/Scope.hpp"
@@ -20,33 +21,34 @@ namespace slim
 
         ObjectPtr TemplateCaptureBlock::eval(expr::Scope &scope)const
         {
-            std::string str;
-            tpl->render(str, scope);
-            return create_object<HtmlSafeString>(std::move(str));
+            OutputBuffer buffer;
+            tpl->render(buffer, scope);
+            return create_object<HtmlSafeString>(buffer.take());
         }
 
         ObjectPtr TemplateOutputBlock::eval(expr::Scope &scope)const
         {
-            static auto SYM_output_buffer = symbol("output_buffer");
-            auto &str = coerce<String>(scope.get(SYM_output_buffer))->get_value();
-            tpl->render(str, scope);
+            auto &buffer = coerce<OutputBufferObject>(scope.get(syms::output_buffer))->get_buffer();
+            tpl->render(buffer, scope);
             return NIL_VALUE;
         }
 
         std::unique_ptr<expr::ExpressionNode> create_tpl_capture_block(
             std::vector<SymPtr> &&param_names,
+            std::vector<SymPtr> &&locals,
             std::unique_ptr<TemplatePart> &&tpl)
         {
             auto tpl_block = slim::make_unique<TemplateCaptureBlock>(std::move(tpl));
-            return slim::make_unique<expr::Block>(std::move(param_names), std::move(tpl_block));
+            return slim::make_unique<expr::Block>(std::move(param_names), std::move(locals), std::move(tpl_block));
         }
 
         std::unique_ptr<expr::ExpressionNode> create_tpl_output_block(
             std::vector<SymPtr> &&param_names,
+            std::vector<SymPtr> &&locals,
             std::unique_ptr<TemplatePart> &&tpl)
         {
             auto tpl_block = slim::make_unique<TemplateOutputBlock>(std::move(tpl));
-            return slim::make_unique<expr::Block>(std::move(param_names), std::move(tpl_block));
+            return slim::make_unique<expr::Block>(std::move(param_names), std::move(locals), std::move(tpl_block));
         }
     }
 }
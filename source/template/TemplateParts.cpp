@@ -1,5 +1,7 @@
 #include "template/TemplateParts.hpp"
 #include "template/Attributes.hpp"
+#include "template/TemplateBlock.hpp"
+#include "expression/AstOp.hpp"
 #include "expression/Expression.hpp"
 #include "types/Array.hpp"
 #include "types/Boolean.hpp"
@@ -7,8 +9,13 @@
 #include "types/Hash.hpp"
 #include "types/Nil.hpp"
 #include "types/Proc.hpp"
+#include "types/String.hpp"
 #include "types/Symbol.hpp"
+#include "Error.hpp"
+#include "FragmentCache.hpp"
+#include "RenderDependencies.hpp"
 #include "Util.hpp"
+#include <cstdio>
 namespace slim
 {
     namespace tpl
@@ -22,10 +29,10 @@ namespace slim
         {
             return "<%= " + expression->to_string() + " %>";
         }
-        void TemplateOutputExpr::render(std::string & buffer, expr::Scope &scope) const
+        void TemplateOutputExpr::render(OutputBuffer &buffer, expr::Scope &scope) const
         {
             auto val = expression->eval(scope);
-            buffer += html_escape(val);
+            buffer.append_escaped(val.get());
         }
         
         TemplateCodeBlock::TemplateCodeBlock(std::unique_ptr<Expression>&& expression)
@@ -37,7 +44,7 @@ namespace slim
         {
             return "<% " + expression->to_string() + " %>";
         }
-        void TemplateCodeBlock::render(std::string & buffer, expr::Scope &scope) const
+        void TemplateCodeBlock::render(OutputBuffer &buffer, expr::Scope &scope) const
         {
             expression->eval(scope);
         }
@@ -51,15 +58,11 @@ namespace slim
         {
             return "<% " + expression->to_string() + " %>";
         }
-        void TemplateEachExpr::render(std::string & buffer, expr::Scope &scope) const
+        void TemplateEachExpr::render(OutputBuffer &buffer, expr::Scope &scope) const
         {
-            //TODO: This is somewhat a workaround because String always owns the std::string.
-            //It may be better just to always use the String object for template rendering
-            auto tmp = create_object<String>(std::move(buffer));
             expr::Scope new_scope(scope);
-            new_scope.set("output_buffer", tmp);
-            auto val = expression->eval(new_scope);
-            buffer = std::move(tmp->get_value());
+            new_scope.set(0, syms::output_buffer, create_object<OutputBufferObject>(buffer));
+            expression->eval(new_scope);
         }
 
         namespace
@@ -69,7 +72,7 @@ namespace slim
              */
             void add_attr_value(std::vector<Ptr<Object>> &out, Ptr<Object> value)
             {
-                if (auto arr = dynamic_cast<Array*>(value.get()))
+                if (auto arr = object_cast<Array>(value.get()))
                 {
                     for (auto val2 : arr->get_value())out.push_back(val2);
                 }
@@ -96,13 +99,26 @@ namespace slim
             buf += ")%>";
             return buf;
         }
-        void TemplateTagAttr::render(std::string &buffer, expr::Scope &scope)const
+        void TemplateTagAttr::render(OutputBuffer &buffer, expr::Scope &scope)const
+        {
+            std::vector<ObjectPtr> results;
+            for (auto &expr : dynamic_values) results.push_back(expr->eval(scope));
+            render_values(buffer, results.data());
+        }
+        void TemplateTagAttr::render_values(OutputBuffer &buffer, const ObjectPtr *results)const
+        {
+            render_attr(buffer, attr, static_values, results, dynamic_values.size());
+        }
+        void TemplateTagAttr::render_attr(
+            OutputBuffer &buffer,
+            const std::string &attr,
+            const std::vector<std::string> &static_values,
+            const ObjectPtr *results, size_t count)
         {
             std::vector<ObjectPtr> values;
-            for (auto &expr : dynamic_values)
+            for (size_t i = 0; i < count; ++i)
             {
-                auto val = expr->eval(scope);
-                add_attr_value(values, val);
+                add_attr_value(values, results[i]);
             }
 
             if (static_values.empty() && values.empty()) return;
@@ -137,65 +153,98 @@ namespace slim
         {
             return "<splat attrs>";
         }
-        void TemplateTagSplatAttrs::render(std::string &buffer, expr::Scope &scope)const
+        void TemplateTagSplatAttrs::render(OutputBuffer &buffer, expr::Scope &scope)const
         {
-            std::unordered_map<std::string, std::vector<Ptr<Object>>> attrs;
-            //Determine all attributes
-            for (auto &i : static_attrs)
-                attrs[i.first].push_back(make_value(i.second));
+            std::vector<ObjectPtr> results;
+            for (auto &i : dynamic_attrs) results.push_back(i.second->eval(scope));
+            for (auto &splat : splat_attrs) results.push_back(splat->eval(scope));
+            render_values(buffer, results.data());
+        }
 
-            for (auto &i : dynamic_attrs)
-            {
-                auto &attr = attrs[i.first];
-                auto val = i.second->eval(scope);
-                add_attr_value(attr, val);
-            }
+        namespace
+        {
+            const std::string &attr_name(const std::string &name) { return name; }
+            const std::string &attr_name(const TemplateTagSplatAttrs::Dynamic::value_type &attr) { return attr.first; }
 
-            for (auto &splat : splat_attrs)
+            template<class StaticAttrs, class DynamicAttrs>
+            void render_splat_attrs(
+                OutputBuffer &buffer,
+                const StaticAttrs &static_attrs,
+                const DynamicAttrs &dynamic_attrs,
+                size_t splat_count,
+                const ObjectPtr *results)
             {
-                auto hash = coerce<Hash>(splat->eval(scope));
-                for (auto &i : *hash)
+                std::unordered_map<std::string, std::vector<Ptr<Object>>> attrs;
+                //Determine all attributes
+                for (auto &i : static_attrs)
+                    attrs[i.first].push_back(make_value(i.second));
+
+                for (auto &i : dynamic_attrs)
                 {
-                    auto &attr = attrs[i.first->to_string()];
-                    auto val = i.second;
-                    add_attr_value(attr, val);
+                    auto &attr = attrs[attr_name(i)];
+                    add_attr_value(attr, *results++);
                 }
-            }
-            //Output attributes
-            for (auto &i : attrs)
-            {
-                const auto &name = html_escape(i.first);
-                auto &values = i.second;
 
-                if (values.empty()) continue; //empty / no value
-                else if (values.size() == 1)
+                for (size_t i = 0; i < splat_count; ++i)
                 {
-                    auto val = values[0];
-                    if (val == TRUE_VALUE) //true boolean attr
-                    {
-                        buffer += ' ';
-                        buffer += name;
-                    }
-                    else if (val == FALSE_VALUE || val == NIL_VALUE) //false boolean attr
+                    auto hash = coerce<Hash>(*results++);
+                    for (auto &i : *hash)
                     {
-                        continue;
+                        auto &attr = attrs[i.first->to_string()];
+                        auto val = i.second;
+                        add_attr_value(attr, val);
                     }
-                    else buffer += attr_str(name, {val->to_string()});
                 }
-                else
+                //Output attributes
+                for (auto &i : attrs)
                 {
-                    //array of values, e.g. "class"
-                    std::vector<std::string> strings;
-                    for (auto &j : values) strings.push_back(j->to_string());
-                    buffer += attr_str(name, strings);
+                    const auto &name = html_escape(i.first);
+                    auto &values = i.second;
+
+                    if (values.empty()) continue; //empty / no value
+                    else if (values.size() == 1)
+                    {
+                        auto val = values[0];
+                        if (val == TRUE_VALUE) //true boolean attr
+                        {
+                            buffer += ' ';
+                            buffer += name;
+                        }
+                        else if (val == FALSE_VALUE || val == NIL_VALUE) //false boolean attr
+                        {
+                            continue;
+                        }
+                        else buffer += attr_str(name, {val->to_string()});
+                    }
+                    else
+                    {
+                        //array of values, e.g. "class"
+                        std::vector<std::string> strings;
+                        for (auto &j : values) strings.push_back(j->to_string());
+                        buffer += attr_str(name, strings);
+                    }
                 }
             }
         }
 
+        void TemplateTagSplatAttrs::render_values(OutputBuffer &buffer, const ObjectPtr *results)const
+        {
+            render_splat_attrs(buffer, static_attrs, dynamic_attrs, splat_attrs.size(), results);
+        }
+        void TemplateTagSplatAttrs::render_attrs(
+            OutputBuffer &buffer,
+            const std::vector<std::pair<std::string, std::string>> &static_attrs,
+            const std::vector<std::string> &dynamic_names,
+            size_t splat_count,
+            const ObjectPtr *values)
+        {
+            render_splat_attrs(buffer, static_attrs, dynamic_names, splat_count, values);
+        }
+
         TemplateForExpr::TemplateForExpr(
             std::unique_ptr<Expression> &&expr,
             std::unique_ptr<TemplatePart> &&body,
-            std::vector<std::shared_ptr<Symbol>> &&param_names)
+            std::vector<Ptr<Symbol>> &&param_names)
             : expr(std::move(expr)), body(std::move(body)), param_names(std::move(param_names))
         {}
         TemplateForExpr::~TemplateForExpr()
@@ -210,11 +259,11 @@ namespace slim
             out += "<% end %>";
             return out;
         }
-        void TemplateForExpr::render(std::string &buffer, expr::Scope &scope) const
+        void TemplateForExpr::render(OutputBuffer &buffer, expr::Scope &scope) const
         {
             struct CallNode : public expr::ExpressionNode
             {
-                CallNode(const TemplatePart *body, std::string &buffer) : body(body), buffer(buffer) {}
+                CallNode(const TemplatePart *body, OutputBuffer &buffer) : body(body), buffer(buffer) {}
                 virtual std::string to_string()const override { std::terminate(); }
                 virtual ObjectPtr eval(expr::Scope &scope)const override
                 {
@@ -222,12 +271,12 @@ namespace slim
                     return NIL_VALUE;
                 }
                 const TemplatePart *body;
-                std::string &buffer;
+                OutputBuffer &buffer;
             };
             CallNode call(body.get(), buffer);
             auto result = expr->eval(scope);
             auto enumerator = coerce<Enumerator>(result);
-            auto proc = std::make_shared<BlockProc>(call, param_names, scope);
+            auto proc = create_object<BlockProc>(call, param_names, scope);
             enumerator->each({ proc });
         }
 
@@ -250,7 +299,7 @@ namespace slim
             out += "<% end %>";
             return out;
         }
-        void TemplateIfExpr::render(std::string & buffer, expr::Scope &scope) const
+        void TemplateIfExpr::render(OutputBuffer &buffer, expr::Scope &scope) const
         {
             if (if_expr.expr->eval(scope)->is_true())
             {
@@ -271,5 +320,80 @@ namespace slim
             }
         }
 
+        namespace
+        {
+            /**Outputs the stored fragment for key, or the result of render_body, which is then
+             * stored.
+             */
+            template<class RenderBody>
+            void render_cached(OutputBuffer &buffer, const std::string &digest, Object *key, RenderBody render_body)
+            {
+                std::string fragment;
+                if (!RenderDependencies::fingerprint(fragment, key))
+                {
+                    throw TypeError("cache key must be nil, true, false, a number, string or symbol, "
+                        "or an array or hash of these, not " + key->type_name());
+                }
+                auto store = FragmentStore::current();
+                if (!store)
+                {
+                    buffer += render_body();
+                    return;
+                }
+                auto store_key = digest + ':' + key->inspect();
+                if (store->get(store_key, &fragment))
+                {
+                    RenderDependencies::uncacheable(); // Output depends on the store contents
+                    buffer += fragment;
+                    return;
+                }
+                fragment = render_body();
+                store->put(store_key, fragment);
+                buffer += fragment;
+            }
+            std::string call_body(Proc *body)
+            {
+                return coerce<String>(body->call({}))->get_value();
+            }
+        }
+
+        TemplateCacheBlock::TemplateCacheBlock(
+            std::unique_ptr<Expression> &&key,
+            std::unique_ptr<Expression> &&body,
+            std::string &&digest)
+            : key(std::move(key)), body(std::move(body)), digest(std::move(digest))
+        {}
+        TemplateCacheBlock::~TemplateCacheBlock()
+        {}
+        std::string TemplateCacheBlock::to_string() const
+        {
+            auto block = static_cast<const expr::Block*>(body.get());
+            return "<% cache " + key->to_string() + " do " + block->get_code()->to_string() + " end %>";
+        }
+        void TemplateCacheBlock::render(OutputBuffer &buffer, expr::Scope &scope) const
+        {
+            auto key_value = key->eval(scope);
+            render_cached(buffer, digest, key_value.get(), [&] {
+                return call_body(coerce<Proc>(body->eval(scope)).get());
+            });
+        }
+        void TemplateCacheBlock::render_fragment(OutputBuffer &buffer, const std::string &digest, Object *key, Proc *body)
+        {
+            render_cached(buffer, digest, key, [&] { return call_body(body); });
+        }
+        std::string TemplateCacheBlock::body_digest(const TemplatePart &body)
+        {
+            //64 bit FNV-1a, which unlike std::hash is the same for every build, so fragments
+            //can be shared by processes using the same external store
+            uint64_t hash = 14695981039346656037ULL;
+            for (auto c : body.to_string())
+            {
+                hash ^= (unsigned char)c;
+                hash *= 1099511628211ULL;
+            }
+            char buf[17];
+            snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)hash);
+            return buf;
+        }
     }
 }
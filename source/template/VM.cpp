@@ -0,0 +1,512 @@
+#include "template/VM.hpp"
+#include "template/OutputBuffer.hpp"
+#include "template/TemplateBlock.hpp"
+#include "template/TemplateParts.hpp"
+#include "expression/Scope.hpp"
+#include "types/Array.hpp"
+#include "types/Hash.hpp"
+#include "types/HtmlSafeString.hpp"
+#include "types/Number.hpp"
+#include "types/Proc.hpp"
+#include "types/Range.hpp"
+#include "types/Regexp.hpp"
+#include "types/String.hpp"
+#include "types/ViewModel.hpp"
+#include "Operators.hpp"
+#include "RenderDependencies.hpp"
+#include <cmath>
+#include <sstream>
+namespace slim
+{
+    namespace tpl
+    {
+        namespace
+        {
+            const uint32_t NO_BLOCK = 0xFFFFFFFF;
+
+            /**Proc for a block compiled in to the VM Program.*/
+            class VMBlockProc : public Proc
+            {
+            public:
+                VMBlockProc(VM &vm, const Program::Block &block, uint32_t index, OutputBuffer *buffer)
+                    : vm(vm), block(block), index(index), buffer(buffer)
+                {}
+
+                virtual ObjectPtr call(const FunctionArgs &args)override
+                {
+                    if (args.size() != block.params.size())
+                    {
+                        std::stringstream ss;
+                        ss << "wrong number of arguments (" << args.size() << " for " << block.params.size() << ")";
+                        throw ArgumentError(this, "call", ss.str());
+                    }
+                    return vm.call_block(index, args, buffer);
+                }
+            private:
+                VM &vm;
+                const Program::Block &block;
+                uint32_t index;
+                OutputBuffer *buffer;
+            };
+
+            typedef std::vector<TaggedValue> Stack;
+            /**Binary arithmetic on the top two values. Numbers are computed inline, anything
+             * else calls the Object operator.
+             */
+            template<class F> void arithmetic(Stack &stack, F f, ObjectPtr(Object::*op)(Object*))
+            {
+                auto &lhs = stack[stack.size() - 2];
+                auto &rhs = stack.back();
+                if (lhs.is_number() && rhs.is_number()) lhs = f(lhs.number(), rhs.number());
+                else
+                {
+                    auto l = lhs.box(), r = rhs.box();
+                    lhs = (l.get()->*op)(r.get());
+                }
+                stack.pop_back();
+            }
+            /**Comparison of the top two values, using Number::cmp for two numbers.*/
+            template<class F> void compare(Stack &stack, F f, ObjectPtr(*op)(const Object*, const Object*))
+            {
+                auto &lhs = stack[stack.size() - 2];
+                auto &rhs = stack.back();
+                if (lhs.is_number() && rhs.is_number())
+                {
+                    auto a = lhs.number(), b = rhs.number();
+                    lhs = f(a < b ? -1 : (a > b ? 1 : 0));
+                }
+                else
+                {
+                    auto l = lhs.box(), r = rhs.box();
+                    lhs = op(l.get(), r.get());
+                }
+                stack.pop_back();
+            }
+        }
+
+        VM::VM(const Program &program, expr::Scope &scope)
+            : program(program), scope(scope), self(scope.self())
+            , slots(program.slot_count()), stack(), iterations(), active(program.blocks.size(), 0)
+        {
+            stack.reserve(32);
+        }
+        VM::~VM() {}
+
+        void VM::render(OutputBuffer &buffer)
+        {
+            run(0, buffer, NO_BLOCK);
+        }
+
+        ObjectPtr VM::call_block(uint32_t index, const FunctionArgs &args, OutputBuffer *buffer)
+        {
+            auto &block = program.blocks[index];
+            //Restores the VM state even if the block throws, as the exception may be caught by a
+            //method still within the render, such as an Enumerable stopping early.
+            struct Guard
+            {
+                VM &vm;
+                const Program::Block &block;
+                uint32_t index;
+                size_t stack_size, iterations_size;
+                std::vector<TaggedValue> saved;
+
+                ~Guard()
+                {
+                    vm.stack.resize(stack_size);
+                    vm.iterations.resize(iterations_size);
+                    --vm.active[index];
+                    for (size_t i = 0; i < saved.size(); ++i)
+                        vm.slots[block.locals[i].first] = std::move(saved[i]);
+                }
+            } guard{ *this, block, index, stack.size(), iterations.size(), {} };
+            if (active[index])
+            {
+                //Recursive call, keep the outer call locals
+                for (auto &local : block.locals) guard.saved.push_back(slots[local.first]);
+            }
+            ++active[index];
+
+            enter_block(block, args.data());
+            if (block.kind == Program::BLOCK_CAPTURE)
+            {
+                OutputBuffer capture;
+                run(block.entry, capture, index);
+                return create_object<HtmlSafeString>(capture.take());
+            }
+            else return run(block.entry, *buffer, index);
+        }
+
+        template<class T> void VM::enter_block(const Program::Block &block, const T *args)
+        {
+            for (auto &local : block.locals)
+            {
+                if (local.second == Program::NO_SLOT) slots[local.first] = nullptr;
+                else slots[local.first] = slots[local.second];
+            }
+            for (size_t i = 0; i < block.params.size(); ++i)
+                slots[block.params[i]] = args[i];
+        }
+
+        bool VM::begin_iteration(ObjectPtr collection, const Program::Block &block, Iteration *it)
+        {
+            //Exact types only, since a derived type may have its own "each" method
+            auto &type = typeid(*collection);
+            auto param_count = block.params.size();
+            if (type == typeid(Array) && param_count == 1) it->kind = Iteration::ARRAY;
+            else if (type == typeid(Hash) && param_count == 2) it->kind = Iteration::HASH;
+            else if (type == typeid(Range) && param_count == 1)
+            {
+                auto range = static_cast<Range*>(collection.get());
+                it->kind = Iteration::RANGE;
+                it->value = range->get_begin();
+                it->end = range->get_end();
+                it->exclude_end = range->get_exclude_end();
+            }
+            else return false;
+            it->collection = std::move(collection);
+            it->index = 0;
+            return true;
+        }
+
+        bool VM::next_iteration(Iteration &it, const Program::Block &block)
+        {
+            switch (it.kind)
+            {
+            case Iteration::ARRAY:
+            {
+                auto &arr = static_cast<Array*>(it.collection.get())->get_value();
+                if (it.index >= arr.size()) return false;
+                enter_block(block, &arr[it.index++]);
+                return true;
+            }
+            case Iteration::HASH:
+            {
+                auto hash = static_cast<Hash*>(it.collection.get());
+                if (it.index >= (size_t)(hash->end() - hash->begin())) return false;
+                auto &pair = *(hash->begin() + (ptrdiff_t)it.index++);
+                ObjectPtr args[2] = { pair.first, pair.second };
+                enter_block(block, args);
+                return true;
+            }
+            case Iteration::RANGE:
+            {
+                //Same as Range::each, which compares with end rather than counting
+                if (it.exclude_end ? !(it.value < it.end) : !(it.value <= it.end)) return false;
+                TaggedValue arg(it.value);
+                it.value += 1;
+                enter_block(block, &arg);
+                return true;
+            }
+            }
+            return false;
+        }
+
+        ObjectPtr VM::load_slot(uint32_t slot)
+        {
+            auto &val = slots[slot];
+            return val ? val.box() : scope.get(program.slot_names[slot]);
+        }
+        TaggedValue VM::load_slot_value(uint32_t slot)
+        {
+            auto &val = slots[slot];
+            return val ? val : TaggedValue(scope.get(program.slot_names[slot]));
+        }
+
+        ObjectPtr VM::make_block(uint32_t block, OutputBuffer *buffer)
+        {
+            return create_object<VMBlockProc>(*this, program.blocks[block], block, buffer);
+        }
+
+        bool VM::iter_begin(uint32_t block, ObjectPtr collection, OutputBuffer &buffer)
+        {
+            auto &each_block = program.blocks[block];
+            Iteration it;
+            if (begin_iteration(collection, each_block, &it))
+            {
+                if (!next_iteration(it, each_block)) return false;
+                iterations.push_back(std::move(it));
+                ++active[block];
+                return true;
+            }
+            else
+            {
+                auto proc = make_block(block, &buffer);
+                auto site = each_block.each_site;
+                auto method = program.site_caches[site].get(collection.get(), program.site_names[site]);
+                (*method)(collection.get(), { proc });
+                return false;
+            }
+        }
+
+        bool VM::iter_next(uint32_t block)
+        {
+            if (next_iteration(iterations.back(), program.blocks[block])) return true;
+            iterations.pop_back();
+            --active[block];
+            return false;
+        }
+
+        FunctionArgs VM::pop_args(uint32_t count)
+        {
+            FunctionArgs args;
+            args.reserve(count);
+            for (auto i = stack.end() - count; i != stack.end(); ++i) args.push_back(i->box());
+            stack.resize(stack.size() - count);
+            return args;
+        }
+        TaggedValue VM::pop()
+        {
+            auto ret = std::move(stack.back());
+            stack.pop_back();
+            return ret;
+        }
+
+        ObjectPtr VM::run(uint32_t pc, OutputBuffer &buffer, uint32_t block)
+        {
+            auto &code = program.code;
+            while (true)
+            {
+                auto &ins = code[pc++];
+                switch (ins.op)
+                {
+                case Instruction::TEXT:
+                    buffer.append_static(program.text[ins.a]);
+                    break;
+                case Instruction::FLUSH:
+                    buffer.flush();
+                    break;
+                case Instruction::OUTPUT:
+                {
+                    auto &val = stack.back();
+                    //Formatted numbers never need escaping
+                    if (val.get_tag() == TaggedValue::TAG_NUMBER) buffer += Number::format(val.number());
+                    else buffer.append_escaped(val.get());
+                    stack.pop_back();
+                    break;
+                }
+                case Instruction::POP:
+                    stack.pop_back();
+                    break;
+                case Instruction::RETURN:
+                    return ins.a ? pop().box() : NIL_VALUE;
+
+                case Instruction::PUSH_CONST:
+                    stack.push_back(program.constants[ins.a]);
+                    break;
+                case Instruction::PUSH_SELF:
+                    stack.push_back(self);
+                    break;
+                case Instruction::PUSH_OUTPUT_BUFFER:
+                    stack.push_back(create_object<OutputBufferObject>(buffer));
+                    break;
+                case Instruction::LOAD_SLOT:
+                    stack.push_back(load_slot_value(ins.a));
+                    break;
+                case Instruction::STORE_SLOT:
+                    slots[ins.a] = stack.back();
+                    break;
+                case Instruction::LOAD_VAR:
+                    stack.push_back(scope.get(program.symbols[ins.a]));
+                    break;
+                case Instruction::LOAD_ATTR:
+                    stack.push_back(self->get_attr(program.symbols[ins.a]));
+                    break;
+                case Instruction::LOAD_CONSTANT:
+                    stack.push_back(self->get_constant(program.symbols[ins.a]));
+                    break;
+                case Instruction::CONST_NAV:
+                    stack.back() = stack.back().get()->get_constant(program.symbols[ins.a]);
+                    break;
+
+                case Instruction::CALL_SELF:
+                {
+                    auto args = pop_args(ins.b);
+                    if (auto deps = RenderDependencies::current()) deps->call(self.get(), program.site_names[ins.a]);
+                    auto method = program.site_caches[ins.a].get(self.get(), program.site_names[ins.a]);
+                    stack.push_back((*method)(self.get(), args));
+                    break;
+                }
+                case Instruction::CALL:
+                {
+                    auto args = pop_args(ins.b);
+                    auto obj = pop().box();
+                    auto method = program.site_caches[ins.a].get(obj.get(), program.site_names[ins.a]);
+                    stack.push_back((*method)(obj.get(), args));
+                    break;
+                }
+                case Instruction::EL_REF:
+                {
+                    auto args = pop_args(ins.b);
+                    stack.back() = stack.back().box()->el_ref(args);
+                    break;
+                }
+                case Instruction::MAKE_ARRAY:
+                    stack.push_back(make_array(pop_args(ins.b)));
+                    break;
+                case Instruction::MAKE_HASH:
+                    stack.push_back(make_hash(pop_args(ins.b)));
+                    break;
+                case Instruction::MAKE_RANGE:
+                {
+                    auto end = pop().box();
+                    stack.back() = create_object<Range>(stack.back().box(), end, ins.a != 0);
+                    break;
+                }
+                case Instruction::MAKE_REGEX:
+                    stack.back() = create_object<Regexp>(coerce<String>(stack.back().box())->get_value(), (int)ins.a);
+                    break;
+                case Instruction::CONCAT:
+                {
+                    std::string str;
+                    for (auto i = stack.end() - ins.b; i != stack.end(); ++i) str += i->to_string();
+                    stack.resize(stack.size() - ins.b);
+                    stack.push_back(make_value(std::move(str)));
+                    break;
+                }
+                case Instruction::MAKE_BLOCK:
+                    stack.push_back(make_block(ins.a, &buffer));
+                    break;
+
+                case Instruction::NEGATE:
+                    if (stack.back().is_number()) stack.back() = -stack.back().number();
+                    else stack.back() = stack.back().box()->negate();
+                    break;
+                case Instruction::BIT_NOT:
+                    if (stack.back().is_number()) stack.back() = (double)~(int)stack.back().number();
+                    else stack.back() = stack.back().box()->bit_not();
+                    break;
+                case Instruction::LOGICAL_NOT:
+                    stack.back() = TaggedValue::from_bool(!stack.back().is_true());
+                    break;
+                case Instruction::MUL:
+                    arithmetic(stack, [](double a, double b) { return a * b; }, &Object::mul);
+                    break;
+                case Instruction::DIV:
+                    arithmetic(stack, [](double a, double b) { return a / b; }, &Object::div);
+                    break;
+                case Instruction::MOD:
+                    arithmetic(stack, [](double a, double b) { return std::fmod(a, b); }, &Object::mod);
+                    break;
+                case Instruction::POW:
+                    arithmetic(stack, [](double a, double b) { return std::pow(a, b); }, &Object::pow);
+                    break;
+                case Instruction::ADD:
+                    arithmetic(stack, [](double a, double b) { return a + b; }, &Object::add);
+                    break;
+                case Instruction::SUB:
+                    arithmetic(stack, [](double a, double b) { return a - b; }, &Object::sub);
+                    break;
+                //Same int conversions as Number
+                case Instruction::LSHIFT:
+                    arithmetic(stack, [](double a, double b) { return (double)((int)a << (int)b); }, &Object::bit_lshift);
+                    break;
+                case Instruction::RSHIFT:
+                    arithmetic(stack, [](double a, double b) { return (double)((int)a >> (int)b); }, &Object::bit_rshift);
+                    break;
+                case Instruction::BIT_AND:
+                    arithmetic(stack, [](double a, double b) { return (double)((int)a & (int)b); }, &Object::bit_and);
+                    break;
+                case Instruction::BIT_OR:
+                    arithmetic(stack, [](double a, double b) { return (double)((int)a | (int)b); }, &Object::bit_or);
+                    break;
+                case Instruction::BIT_XOR:
+                    arithmetic(stack, [](double a, double b) { return (double)((int)a ^ (int)b); }, &Object::bit_xor);
+                    break;
+                case Instruction::EQ:
+                case Instruction::NE:
+                {
+                    auto &lhs = stack[stack.size() - 2];
+                    auto &rhs = stack.back();
+                    bool eq;
+                    if (lhs.is_number() && rhs.is_number()) eq = lhs.number() == rhs.number();
+                    else
+                    {
+                        auto l = lhs.box(), r = rhs.box();
+                        eq = slim::eq(l.get(), r.get());
+                    }
+                    lhs = TaggedValue::from_bool(ins.op == Instruction::EQ ? eq : !eq);
+                    stack.pop_back();
+                    break;
+                }
+                case Instruction::CMP:
+                    compare(stack, [](int c) { return TaggedValue((double)c); }, &op_cmp);
+                    break;
+                case Instruction::LT:
+                    compare(stack, [](int c) { return TaggedValue::from_bool(c < 0); }, &op_lt);
+                    break;
+                case Instruction::LE:
+                    compare(stack, [](int c) { return TaggedValue::from_bool(c <= 0); }, &op_le);
+                    break;
+                case Instruction::GT:
+                    compare(stack, [](int c) { return TaggedValue::from_bool(c > 0); }, &op_gt);
+                    break;
+                case Instruction::GE:
+                    compare(stack, [](int c) { return TaggedValue::from_bool(c >= 0); }, &op_ge);
+                    break;
+
+                case Instruction::JUMP:
+                    pc = ins.a;
+                    break;
+                case Instruction::JUMP_IF_FALSE:
+                    if (!pop().is_true()) pc = ins.a;
+                    break;
+                case Instruction::JUMP_IF_FALSE_KEEP:
+                    if (!stack.back().is_true()) pc = ins.a;
+                    else stack.pop_back();
+                    break;
+                case Instruction::JUMP_IF_TRUE_KEEP:
+                    if (stack.back().is_true()) pc = ins.a;
+                    else stack.pop_back();
+                    break;
+                case Instruction::JUMP_IF_NIL_KEEP:
+                    if (stack.back().is_nil()) pc = ins.a;
+                    break;
+
+                case Instruction::ITER_BEGIN:
+                    if (!iter_begin(ins.a, pop().box(), buffer)) pc = ins.b;
+                    break;
+                case Instruction::ITER_NEXT:
+                    if (ins.a == block) return NIL_VALUE; //called as a Proc
+                    if (iter_next(ins.a)) pc = ins.b;
+                    break;
+
+                case Instruction::ATTR:
+                {
+                    auto values = pop_args(ins.b);
+                    program.attrs[ins.a]->render_values(buffer, values.data());
+                    break;
+                }
+                case Instruction::SPLAT_ATTRS:
+                {
+                    auto values = pop_args(ins.b);
+                    program.splat_attrs[ins.a]->render_values(buffer, values.data());
+                    break;
+                }
+                case Instruction::CACHE:
+                {
+                    auto body = pop().box();
+                    auto key = pop().box();
+                    TemplateCacheBlock::render_fragment(buffer, program.text[ins.a], key.get(), coerce<Proc>(body).get());
+                    break;
+                }
+
+                case Instruction::EVAL_NODE:
+                case Instruction::RENDER_PART:
+                {
+                    //Give the tree walker a scope with the locals currently in slots
+                    expr::Scope shadow(scope);
+                    for (auto slot : program.visible_slots[ins.b])
+                    {
+                        if (slots[slot]) shadow.set(program.slot_names[slot], slots[slot].box());
+                    }
+                    shadow.set(syms::output_buffer, create_object<OutputBufferObject>(buffer));
+                    if (ins.op == Instruction::EVAL_NODE)
+                        stack.push_back(program.nodes[ins.a]->eval(shadow));
+                    else program.parts[ins.a]->render(buffer, shadow);
+                    break;
+                }
+                }
+            }
+        }
+    }
+}
@@ -65,11 +65,11 @@ namespace slim
         return make_value(std::move(out));
     }
 
-    std::shared_ptr<Object> Array::assoc(const Object * a)
+    Ptr<Object> Array::assoc(const Object * a)
     {
         for (auto &i : arr)
         {
-            auto arr2 = dynamic_cast<Array*>(i.get());
+            auto arr2 = object_cast<Array>(i.get());
             if (arr2 && !arr2->arr.empty() && slim::eq(a, arr2->get_value().front().get()))
             {
                 return arr2->shared_from_this();
@@ -77,14 +77,14 @@ namespace slim
         }
         return NIL_VALUE;
     }
-    std::shared_ptr<Object> Array::at(const Number * n)
+    Ptr<Object> Array::at(const Number * n)
     {
         int i = (int)n->get_value();
         if (i < 0) i = ((int)arr.size()) + i;
         if (i < 0 || i >= (int)arr.size()) return NIL_VALUE;
         else return arr[(size_t)i];
     }
-    std::shared_ptr<Array> Array::compact()
+    Ptr<Array> Array::compact()
     {
         std::vector<ObjectPtr> compacted;
         for (auto &i : arr)
@@ -93,7 +93,7 @@ namespace slim
         }
         return make_value(std::move(compacted));
     }
-    std::shared_ptr<Number> Array::count(const FunctionArgs & args)
+    Ptr<Number> Array::count(const FunctionArgs & args)
     {
         if (args.empty()) return size();
         else return Enumerable::count(args);
@@ -106,17 +106,17 @@ namespace slim
         {
             for (auto &i : arr)
             {
-                proc->call({i});
+                if (!proc->iterate({i})) break;
             }
-            return shared_from_this();
+            return proc->end_iteration(shared_from_this());
         }
-        else return make_enumerator(this, { &Array::each, "each" });
+        else return make_enumerator(this, { &Array::each, syms::each });
     }
-    std::shared_ptr<Boolean> Array::empty_q()
+    Ptr<Boolean> Array::empty_q()
     {
         return make_value(arr.empty());
     }
-    std::shared_ptr<Object> Array::fetch(const FunctionArgs & args)
+    Ptr<Object> Array::fetch(const FunctionArgs & args)
     {
         if (args.empty() || args.size() > 2) throw ArgumentError(this, "fetch");
         int i = (int)as_number(args[0]);
@@ -124,7 +124,7 @@ namespace slim
         else if (args.size() == 2) return args[1];
         else throw IndexError("Index out of bounds");
     }
-    std::shared_ptr<Object> Array::first(const FunctionArgs & args)
+    Ptr<Object> Array::first(const FunctionArgs & args)
     {
         if (args.size() == 0)
         {
@@ -140,7 +140,7 @@ namespace slim
         }
         else throw ArgumentError(this, "first");
     }
-    std::shared_ptr<Array> Array::flatten(const FunctionArgs & args)
+    Ptr<Array> Array::flatten(const FunctionArgs & args)
     {
         std::vector<ObjectPtr> out;
         if (args.size() == 0) flatten_imp(out, -1);
@@ -156,12 +156,12 @@ namespace slim
     {
         for (auto &i : arr)
         {
-            auto arr2 = dynamic_cast<Array*>(i.get());
+            auto arr2 = object_cast<Array>(i.get());
             if (arr2 && level != 0) arr2->flatten_imp(out, level - 1);
             else out.push_back(i);
         }
     }
-    std::shared_ptr<Boolean> Array::frozen_q()
+    Ptr<Boolean> Array::frozen_q()
     {
         return TRUE_VALUE;
     }
@@ -173,11 +173,11 @@ namespace slim
         }
         return false;
     }
-    std::shared_ptr<Boolean> Array::include_q(const Object * obj)
+    Ptr<Boolean> Array::include_q(const Object * obj)
     {
         return make_value(include_q_imp(obj));
     }
-    std::shared_ptr<String> Array::join(const String * o_sep)
+    Ptr<String> Array::join(const String * o_sep)
     {
         auto sep = o_sep->get_value();
         std::stringstream ss;
@@ -185,7 +185,7 @@ namespace slim
         for (size_t i = 1; i < arr.size(); ++i) ss << sep << arr[i]->to_string();
         return make_value(ss.str());
     }
-    std::shared_ptr<Object> Array::last(const FunctionArgs & args)
+    Ptr<Object> Array::last(const FunctionArgs & args)
     {
         if (args.size() == 0)
         {
@@ -204,15 +204,15 @@ namespace slim
         else throw ArgumentError(this, "last");
     }
 
-    std::shared_ptr<Number> Array::size()
+    Ptr<Number> Array::size()
     {
         return make_value((double)arr.size());
     }
-    std::shared_ptr<Object> Array::rassoc(const Object * a)
+    Ptr<Object> Array::rassoc(const Object * a)
     {
         for (auto &i : arr)
         {
-            auto arr2 = dynamic_cast<Array*>(i.get());
+            auto arr2 = object_cast<Array>(i.get());
             if (arr2 && arr2->arr.size() >= 2 && slim::eq(a, arr2->get_value()[1].get()))
             {
                 return arr2->shared_from_this();
@@ -220,12 +220,12 @@ namespace slim
         }
         return NIL_VALUE;
     }
-    std::shared_ptr<Array> Array::reverse()
+    Ptr<Array> Array::reverse()
     {
         std::vector<ObjectPtr> out{arr.rbegin(), arr.rend()};
         return make_value(std::move(out));
     }
-    std::shared_ptr<Object> Array::rindex(const Object *obj)
+    Ptr<Object> Array::rindex(const Object *obj)
     {
         for (int i = (int)arr.size() - 1;  i >= 0; --i)
         {
@@ -233,13 +233,13 @@ namespace slim
         }
         return NIL_VALUE;
     }
-    std::shared_ptr<Array> Array::rotate(const FunctionArgs & args)
+    Ptr<Array> Array::rotate(const FunctionArgs & args)
     {
         int start = 1;
         if (args.size() == 1) start = (int)as_number(args[0]);
         else if (args.size() > 1) throw ArgumentError(this, "rotate");
         
-        if (arr.empty()) return std::static_pointer_cast<Array>(shared_from_this());
+        if (arr.empty()) return static_pointer_cast<Array>(shared_from_this());
 
         std::vector<ObjectPtr> out;
         while (start < 0)
@@ -260,14 +260,14 @@ namespace slim
         {
             for (auto it = arr.rbegin(); it != arr.rend(); ++it)
             {
-                proc->call({ *it });
+                if (!proc->iterate({ *it })) break;
             }
-            return shared_from_this();
+            return proc->end_iteration(shared_from_this());
         }
-        else return make_enumerator(this, { &Array::reverse_each, "reverse_each" });
+        else return make_enumerator(this, { &Array::reverse_each, syms::reverse_each });
     }
 
-    std::shared_ptr<Object> Array::slice(const FunctionArgs & args)
+    Ptr<Object> Array::slice(const FunctionArgs & args)
     {
         auto do_slice = [&](int start, int length) -> Ptr<Object>
         {
@@ -282,7 +282,7 @@ namespace slim
         };
         if (args.size() == 1)
         {
-            if (auto range = dynamic_cast<Range*>(args[0].get()))
+            if (auto range = object_cast<Range>(args[0].get()))
             {
                 int start, length;
                 if (range->get_beg_len(&start, &length, (int)arr.size()))
@@ -314,7 +314,7 @@ namespace slim
         if (proc)
         {
             std::vector<ObjectPtr> out = arr;
-            std::sort(out.begin(), out.end(), [proc](ObjectPtr a, ObjectPtr b) {
+            std::sort(out.begin(), out.end(), [proc](const ObjectPtr &a, const ObjectPtr &b) {
                 return coerce<Number>(proc->call({a, b}))->get_value() < 0;
             });
             return make_value(std::move(out));
@@ -332,15 +332,22 @@ namespace slim
         unpack<0>(args, &proc);
         if (proc)
         {
-            std::vector<ObjectPtr> out = arr;
-            std::sort(out.begin(), out.end(), [proc](ObjectPtr a, ObjectPtr b) {
-                return slim::cmp(proc->call({a}).get(), proc->call({b}).get()) < 0;
+            // Call the proc once per element, rather than for every comparison
+            typedef std::pair<ObjectPtr, ObjectPtr> Keyed;
+            std::vector<Keyed> keyed;
+            keyed.reserve(arr.size());
+            for (auto &i : arr) keyed.emplace_back(proc->call({i}), i);
+            std::sort(keyed.begin(), keyed.end(), [](const Keyed &a, const Keyed &b) {
+                return slim::cmp(a.first.get(), b.first.get()) < 0;
             });
+            std::vector<ObjectPtr> out;
+            out.reserve(keyed.size());
+            for (auto &i : keyed) out.push_back(std::move(i.second));
             return make_value(std::move(out));
         }
-        else return make_enumerator(this, { &Array::sort_by, "sort_by" });
+        else return make_enumerator(this, { &Array::sort_by, syms::sort_by });
     }
-    std::shared_ptr<Array> Array::take(const Number * n)
+    Ptr<Array> Array::take(const Number * n)
     {
         std::vector<ObjectPtr> out;
         auto count = (int)n->get_value();
@@ -348,7 +355,7 @@ namespace slim
         for (int i = 0; i < count && i < (int)arr.size(); ++i) out.push_back(arr[i]);
         return make_value(std::move(out));
     }
-    std::shared_ptr<Array> Array::uniq()
+    Ptr<Array> Array::uniq()
     {
         std::vector<ObjectPtr> out;
         for (auto &i : arr)
@@ -362,7 +369,7 @@ namespace slim
         }
         return make_value(std::move(out));
     }
-    std::shared_ptr<Array> Array::values_at(const FunctionArgs & args)
+    Ptr<Array> Array::values_at(const FunctionArgs & args)
     {
         std::vector<ObjectPtr> out;
         for (auto &arg : args)
@@ -374,6 +381,11 @@ namespace slim
         return make_value(std::move(out));
     }
 
+    void Array::share_refs()
+    {
+        for (auto &i : arr) if (i) i->share();
+    }
+
     const MethodTable & Array::method_table() const
     {
         static const MethodTable table = MethodTable(Object::method_table())
@@ -3,10 +3,12 @@
 #include "types/Array.hpp"
 #include "types/Hash.hpp"
 #include "types/Proc.hpp"
+#include "types/Range.hpp"
 #include "Function.hpp"
 #include <sstream>
 #include <algorithm>
 #include <deque>
+#include <typeinfo>
 
 namespace slim
 {
@@ -29,7 +31,9 @@ namespace slim
         const FunctionArgs &args,
         std::function<ObjectPtr(const FunctionArgs &args)> func)
     {
-        auto args2 = args;
+        FunctionArgs args2;
+        args2.reserve(args.size() + 1);
+        args2.insert(args2.end(), args.begin(), args.end());
         args2.push_back(create_object<FunctionProc>(func));
         return each(args2);
     }
@@ -44,58 +48,122 @@ namespace slim
         });
     }
 
+    ObjectPtr Enumerable::each_stoppable(
+        const FunctionArgs &args,
+        std::function<ObjectPtr(Proc *self, const FunctionArgs &args)> func)
+    {
+        Proc *self = nullptr;
+        auto proc = create_object<FunctionProc>([&self, &func](const FunctionArgs &args) {
+            return func(self, args);
+        });
+        self = proc.get();
+        FunctionArgs args2;
+        args2.reserve(args.size() + 1);
+        args2.insert(args2.end(), args.begin(), args.end());
+        args2.push_back(std::move(proc));
+        return each(args2);
+    }
+
+    namespace
+    {
+        template<class T, class F> ObjectPtr native_each(ObjectPtr self, F &f)
+        {
+            if (detail::NativeEach<T>::each(static_cast<T*>(self.get()), f)) return self;
+            else return NIL_VALUE;
+        }
+    }
+
+    template<class F> ObjectPtr Enumerable::for_each(const FunctionArgs &args, F f)
+    {
+        if (args.empty())
+        {
+            auto self = this_obj();
+            auto &type = typeid(*self);
+            if (type == typeid(Array)) return native_each<Array>(self, f);
+            if (type == typeid(Hash)) return native_each<Hash>(self, f);
+            if (type == typeid(Range)) return native_each<Range>(self, f);
+        }
+        return each_stoppable(args, [&f](Proc *self, const FunctionArgs &args) {
+            // Methods that forward to each without checking the proc may still call it
+            if (!self->stopped() && !f(args)) self->stop();
+            return NIL_VALUE;
+        });
+    }
+
+    template<class F> ObjectPtr Enumerable::for_each_single(const FunctionArgs &args, F f)
+    {
+        return for_each(args, [&f](const FunctionArgs &args) {
+            if (args.size() == 1) return f(args[0].get());
+            auto v = make_value(args);
+            return f(v.get());
+        });
+    }
+
+    ObjectPtr Enumerable::each_while(
+        const FunctionArgs &args,
+        std::function<bool(const FunctionArgs &args)> func)
+    {
+        return for_each(args, func);
+    }
+
+    ObjectPtr Enumerable::each_single_while(
+        const FunctionArgs &args,
+        std::function<bool(Object *arg)> func)
+    {
+        return for_each_single(args, func);
+    }
+
+    ObjectPtr Enumerable::each_single_forward(
+        const FunctionArgs &args,
+        Proc *proc,
+        std::function<ObjectPtr(Object *arg)> func)
+    {
+        return each_stoppable(args, [proc, &func](Proc *self, const FunctionArgs &args) {
+            auto v = args.size() == 1 ? args[0] : make_value(args);
+            auto ret = func(v.get());
+            if (proc->stopped()) self->stop();
+            return ret;
+        });
+    }
+
     Ptr<Boolean> Enumerable::all_q(const FunctionArgs &args)
     {
         Proc *proc = nullptr;
         unpack<0>(args, &proc);
-        try
+        bool all = true;
+        if (proc)
         {
-            if (proc)
-            {
-                each2({}, [proc](const FunctionArgs &args) {
-                    if(!proc->call(args)->is_true())
-                        throw SpecialFlowException();
-                    else return NIL_VALUE;
-                });
-            }
-            else
-            {
-                each2({}, [](const FunctionArgs &args) {
-                    if (args.size() == 1 && !args[0]->is_true())
-                        throw SpecialFlowException();
-                    else return NIL_VALUE;
-                });
-            }
-            return TRUE_VALUE;
+            for_each({}, [proc, &all](const FunctionArgs &args) {
+                return all = proc->call(args)->is_true();
+            });
         }
-        catch (const SpecialFlowException &) { return FALSE_VALUE; }
+        else
+        {
+            for_each({}, [&all](const FunctionArgs &args) {
+                return all = args.size() != 1 || args[0]->is_true();
+            });
+        }
+        return make_value(all);
     }
 
     Ptr<Boolean> Enumerable::any_q(const FunctionArgs &args)
     {
         Proc *proc = nullptr;
         unpack<0>(args, &proc);
-        try
+        bool any = false;
+        if (proc)
         {
-            if (proc)
-            {
-                each2({}, [proc](const FunctionArgs &args) {
-                    if (proc->call(args)->is_true())
-                        throw SpecialFlowException();
-                    else return NIL_VALUE;
-                });
-            }
-            else
-            {
-                each2({}, [](const FunctionArgs &args) {
-                    if ((args.size() > 1 || args[0]->is_true()))
-                        throw SpecialFlowException();
-                    else return NIL_VALUE;
-                });
-            }
-            return FALSE_VALUE;
+            for_each({}, [proc, &any](const FunctionArgs &args) {
+                return !(any = proc->call(args)->is_true());
+            });
         }
-        catch (const SpecialFlowException &) { return TRUE_VALUE; }
+        else
+        {
+            for_each({}, [&any](const FunctionArgs &args) {
+                return !(any = args.size() > 1 || args[0]->is_true());
+            });
+        }
+        return make_value(any);
     }
 
     Ptr<Number> Enumerable::count(const FunctionArgs &args)
@@ -103,26 +171,26 @@ namespace slim
         unsigned count = 0;
         if (args.empty())
         {
-            each2({}, [&count](const FunctionArgs &args) {
-                return ++count, NIL_VALUE;
+            for_each({}, [&count](const FunctionArgs &args) {
+                return ++count, true;
             });
         }
         else if (args.size() == 1)
         {
-            auto proc = dynamic_cast<Proc*>(args[0].get());
+            auto proc = object_cast<Proc>(args[0].get());
             if (proc)
             {
-                each2({}, [proc, &count](const FunctionArgs &args) {
+                for_each({}, [proc, &count](const FunctionArgs &args) {
                     if (proc->call(args)->is_true()) ++count;
-                    return NIL_VALUE;
+                    return true;
                 });
             }
             else
             {
                 auto itm = args[0].get();
-                each2({}, [itm, &count](const FunctionArgs &args) {
+                for_each({}, [itm, &count](const FunctionArgs &args) {
                     if (eq(itm, args[0].get())) ++count;
-                    return NIL_VALUE;
+                    return true;
                 });
             }
         }
@@ -134,10 +202,10 @@ namespace slim
     {
         auto ret = create_object<Array>();
         unsigned i = 0;
-        each_single([&ret, &i, n](Object *arg) {
+        for_each_single({}, [&ret, &i, n](Object *arg) {
             if (++i > n->get_value())
                 ret->push_back(arg);
-            return NIL_VALUE;
+            return true;
         });
         return ret;
     }
@@ -150,16 +218,16 @@ namespace slim
             auto ret = create_object<Array>();
             bool start = false;
             auto proc = coerce<Proc>(args[0].get());
-            each2({}, [proc, &ret, &start](const FunctionArgs &args) {
+            for_each({}, [proc, &ret, &start](const FunctionArgs &args) {
                 start = start || !proc->call(args)->is_true();
                 if (start)
                 {
                     if (args.size() == 1) ret->push_back(args[0]);
                     else ret->push_back(make_value(args));
                 }
-                return NIL_VALUE;
+                return !proc->stopped();
             });
-            return ret;
+            return proc->end_iteration(ret);
         }
         else throw ArgumentCountError(args.size(), 0, 1);
     }
@@ -168,16 +236,17 @@ namespace slim
     ObjectPtr Enumerable::each_with_index(const FunctionArgs &args)
     {
         Proc *proc = nullptr;
-        if (!args.empty()) proc = dynamic_cast<Proc*>(args.back().get());
+        if (!args.empty()) proc = object_cast<Proc>(args.back().get());
 
         if (proc)
         {
             auto args2 = args;
             args2.pop_back();
             unsigned i = 0;
-            return each_single(args2, [&i, proc](Object *arg) {
+            auto ret = each_single_forward(args2, proc, [&i, proc](Object *arg) {
                 return proc->call({ arg->shared_from_this(), make_value(i++) });
             });
+            return proc->end_iteration(ret);
         }
         else
         {
@@ -188,19 +257,20 @@ namespace slim
     ObjectPtr Enumerable::find(const FunctionArgs &args)
     {
         if (args.size() > 2) throw ArgumentCountError(args.size(), 0, 2);
-        auto proc = args.empty() ? nullptr : dynamic_cast<Proc*>(args.back().get());
+        auto proc = args.empty() ? nullptr : object_cast<Proc>(args.back().get());
         if (proc)
         {
-            try
-            {
-                each2({}, [proc](const FunctionArgs &args) {
-                    if (proc->call(args)->is_true())
-                        throw SpecialFlowException(args.size() == 1 ? args[0] : make_value(args));
-                    return NIL_VALUE;
-                });
-                return args.size() == 2 ? args.front() : NIL_VALUE;
-            }
-            catch (const SpecialFlowException &e) { return e.value; }
+            ObjectPtr found;
+            for_each({}, [proc, &found](const FunctionArgs &args) {
+                if (proc->call(args)->is_true())
+                {
+                    found = args.size() == 1 ? args[0] : make_value(args);
+                    return false;
+                }
+                return !proc->stopped();
+            });
+            if (!found) found = args.size() == 2 ? args.front() : NIL_VALUE;
+            return proc->end_iteration(found);
         }
         else
         {
@@ -213,46 +283,42 @@ namespace slim
     {
         if (args.empty()) return make_enumerator(this_obj(), this, &Enumerable::find_index, "find_index", args);
         if (args.size() > 1) throw ArgumentCountError(args.size(), 0, 1);
-        
-        try
+
+        unsigned i = 0;
+        bool found = false;
+        if (auto proc = object_cast<Proc>(args[0].get()))
         {
-            unsigned i = 0;
-            if (auto proc = dynamic_cast<Proc*>(args[0].get()))
-            {
-                each2({}, [&i, proc](const FunctionArgs &args) {
-                    if (proc->call(args)->is_true())
-                        throw SpecialFlowException(make_value(i));
-                    ++i;
-                    return NIL_VALUE;
-                });
-            }
-            else //find value
-            {
-                auto value = args[0].get();
-                each2({}, [&i, value](const FunctionArgs &args) {
-                    if (eq(value, args.size() == 1 ? args[0].get() : make_value(args).get()))
-                        throw SpecialFlowException(make_value(i));
-                    ++i;
-                    return NIL_VALUE;
-                });
-            }
-            return NIL_VALUE;
+            for_each({}, [&i, &found, proc](const FunctionArgs &args) {
+                if (proc->call(args)->is_true()) return !(found = true);
+                ++i;
+                return !proc->stopped();
+            });
+            if (!found) return proc->end_iteration(NIL_VALUE);
         }
-        catch (const SpecialFlowException &e) { return e.value; }
+        else //find value
+        {
+            auto value = args[0].get();
+            for_each({}, [&i, &found, value](const FunctionArgs &args) {
+                if (eq(value, args.size() == 1 ? args[0].get() : make_value(args).get()))
+                    return !(found = true);
+                ++i;
+                return true;
+            });
+        }
+        if (!found) return NIL_VALUE;
+        return make_value(i);
     }
 
     ObjectPtr Enumerable::first(const FunctionArgs &args)
     {
         if (args.empty())
         {
-            try
-            {
-                each_single([](Object *arg) -> ObjectPtr {
-                    throw SpecialFlowException(arg->shared_from_this());
-                });
-                return NIL_VALUE;
-            }
-            catch (const SpecialFlowException &e) { return e.value; }
+            ObjectPtr ret = NIL_VALUE;
+            for_each_single({}, [&ret](Object *arg) {
+                ret = arg->shared_from_this();
+                return false;
+            });
+            return ret;
         }
         else
         {
@@ -269,14 +335,14 @@ namespace slim
         if (proc)
         {
             auto arr = create_object<Array>();
-            each2({}, [&arr, proc](const FunctionArgs &args) {
+            for_each({}, [&arr, proc](const FunctionArgs &args) {
                 auto value = proc->call(args);
-                if (auto value_arr = dynamic_cast<Array*>(value.get()))
+                if (auto value_arr = object_cast<Array>(value.get()))
                     for (auto &i : *value_arr) arr->push_back(i);
                 else arr->push_back(value);
-                return NIL_VALUE;
+                return !proc->stopped();
             });
-            return arr;
+            return proc->end_iteration(arr);
         }
         else return make_enumerator(this_obj(), this, &Enumerable::flat_map, "flat_map");
     }
@@ -288,28 +354,29 @@ namespace slim
         if (proc)
         {
             auto hash = create_object<Hash>();
-            each2({}, [&hash, proc](const FunctionArgs &args) {
+            for_each({}, [&hash, proc](const FunctionArgs &args) {
                 auto key = proc->call(args);
                 auto arr = coerce<Array>(hash->get_or_create<Array>(key));
                 arr->push_back(args.size() == 1 ? args[0] : make_value(args));
-                return NIL_VALUE;
+                return !proc->stopped();
             });
-            return hash;
+            return proc->end_iteration(hash);
         }
         else return make_enumerator(this_obj(), this, &Enumerable::group_by, "group_by");
     }
 
     Ptr<Boolean> Enumerable::include_q(Object *obj)
     {
-        try
-        {
-            each_single([obj](Object *arg) {
-                if (arg->eq(obj)) throw SpecialFlowException(arg->shared_from_this());
-                return NIL_VALUE;
-            });
-            return FALSE_VALUE;
-        }
-        catch (const SpecialFlowException &) { return TRUE_VALUE; }
+        bool found = false;
+        for_each_single({}, [obj, &found](Object *arg) {
+            return !(found = arg->eq(obj));
+        });
+        return make_value(found);
+    }
+
+    ObjectPtr Enumerable::lazy()
+    {
+        return create_object<LazyEnumerator>(this_obj(), this);
     }
 
     ObjectPtr Enumerable::map(const FunctionArgs &args)
@@ -319,11 +386,12 @@ namespace slim
         if (proc)
         {
             auto ret = create_object<Array>();
-            each2({}, [ret, proc](const FunctionArgs &args) {
-                ret->push_back(proc->call(args));
-                return NIL_VALUE;
+            auto arr = ret.get();
+            for_each({}, [arr, proc](const FunctionArgs &args) {
+                arr->push_back(proc->call(args));
+                return !proc->stopped();
             });
-            return ret;
+            return proc->end_iteration(ret);
         }
         else return make_enumerator(this_obj(), this, &Enumerable::map, "map");
     }
@@ -339,7 +407,7 @@ namespace slim
             }
             else if (args.size() == 1)
             {
-                *proc = dynamic_cast<Proc*>(args[0].get());
+                *proc = object_cast<Proc>(args[0].get());
                 if (*proc) *n = 1;
                 else *n = (int)coerce<Number>(args[0])->get_value();
             }
@@ -357,22 +425,22 @@ namespace slim
             else if (n == 1)
             {
                 ObjectPtr min = nullptr;
-                self->each_single([&min, cmp](Object *nextp) {
+                self->each_single_while([&min, cmp](Object *nextp) {
                     auto next = nextp->shared_from_this();
                     if (!min) min = next;
                     else if (cmp(next, min)) min = next;
-                    return NIL_VALUE;
+                    return true;
                 });
                 return min ? min : NIL_VALUE;
             }
             else if (n > 1)
             {
                 std::deque<ObjectPtr> arr;
-                self->each_single([&arr, cmp, n](Object *nextp) {
+                self->each_single_while([&arr, cmp, n](Object *nextp) {
                     auto next = nextp->shared_from_this();
                     arr.insert(std::upper_bound(arr.begin(), arr.end(), next, cmp), next);
                     if (arr.size() > (size_t)n) arr.pop_back();
-                    return NIL_VALUE;
+                    return true;
                 });
                 return make_array({arr.begin(), arr.end()});
             }
@@ -447,7 +515,7 @@ namespace slim
         template<class T> ObjectPtr do_minmax(Enumerable *self, T cmp)
         {
             ObjectPtr min = nullptr, max = nullptr;
-            self->each_single([&min, &max, cmp](Object *nextp) {
+            self->each_single_while([&min, &max, cmp](Object *nextp) {
                 auto next = nextp->shared_from_this();
                 if (!min) min = max = next;
                 else
@@ -455,7 +523,7 @@ namespace slim
                     if (cmp(next, min) < 0) min = next;
                     if (cmp(next, max) > 0) max = next;
                 }
-                return NIL_VALUE;
+                return true;
             });
             return make_array({min ? min : NIL_VALUE, max ? max : NIL_VALUE});
         }
@@ -500,34 +568,22 @@ namespace slim
     {
         Proc *proc = nullptr;
         unpack<0>(args, &proc);
-        try
+        unsigned found = 0;
+        if (proc)
         {
-            bool found = false;
-            if (proc)
-            {
-                each2({}, [&found, proc](const FunctionArgs &args) {
-                    if (proc->call(args)->is_true())
-                    {
-                        if (found) throw SpecialFlowException();
-                        else found = true;
-                    }
-                    return NIL_VALUE;
-                });
-            }
-            else
-            {
-                each2({}, [&found](const FunctionArgs &args) {
-                    if ((args.size() > 1 || args[0]->is_true()))
-                    {
-                        if (found) throw SpecialFlowException();
-                        else found = true;
-                    }
-                    return NIL_VALUE;
-                });
-            }
-            return make_value(found);
+            for_each({}, [&found, proc](const FunctionArgs &args) {
+                if (proc->call(args)->is_true()) ++found;
+                return found < 2;
+            });
         }
-        catch (const SpecialFlowException &) { return FALSE_VALUE; }
+        else
+        {
+            for_each({}, [&found](const FunctionArgs &args) {
+                if (args.size() > 1 || args[0]->is_true()) ++found;
+                return found < 2;
+            });
+        }
+        return make_value(found == 1);
     }
 
     ObjectPtr Enumerable::partition(const FunctionArgs &args)
@@ -538,12 +594,12 @@ namespace slim
         {
             auto true_arr = create_object<Array>();
             auto false_arr = create_object<Array>();
-            each2({}, [proc, true_arr, false_arr](const FunctionArgs &args) {
+            for_each({}, [proc, true_arr, false_arr](const FunctionArgs &args) {
                 (proc->call(args)->is_true() ? true_arr : false_arr)->push_back(
                     args.size() == 1 ? args[0] : make_array(args));
-                return NIL_VALUE;
+                return !proc->stopped();
             });
-            return make_array({true_arr, false_arr});
+            return proc->end_iteration(make_array({true_arr, false_arr}));
         }
         else return make_enumerator(this_obj(), this, &Enumerable::partition, "partition");
     }
@@ -560,10 +616,10 @@ namespace slim
         }
         else throw ArgumentCountError(args.size(), 1, 2);
 
-        each_single({}, [&value, proc](Object *el) {
+        for_each_single({}, [&value, proc](Object *el) {
             if (value) value = proc->call({value, el ->shared_from_this()});
             else value = el->shared_from_this();
-            return NIL_VALUE;
+            return true;
         });
 
         return value ? value : NIL_VALUE;
@@ -576,12 +632,12 @@ namespace slim
         if (proc)
         {
             auto ret = create_object<Array>();
-            each2({}, [ret, proc](const FunctionArgs &args) {
+            for_each({}, [ret, proc](const FunctionArgs &args) {
                 if (!proc->call(args)->is_true())
                     ret->push_back(args.size() == 1 ? args[0] : make_value(args));
-                return NIL_VALUE;
+                return !proc->stopped();
             });
-            return ret;
+            return proc->end_iteration(ret);
         }
         else return make_enumerator(this_obj(), this, &Enumerable::reject, "reject", args);
     }
@@ -589,7 +645,7 @@ namespace slim
     ObjectPtr Enumerable::reverse_each(const FunctionArgs &args)
     {
         Proc *proc = nullptr;
-        if (!args.empty()) proc = dynamic_cast<Proc*>(args.back().get());
+        if (!args.empty()) proc = object_cast<Proc>(args.back().get());
         if (proc)
         {
             FunctionArgs args2 = {args.begin(), args.end() - 1};
@@ -606,12 +662,12 @@ namespace slim
         if (proc)
         {
             auto ret = create_object<Array>();
-            each2({}, [ret, proc](const FunctionArgs &args) {
+            for_each({}, [ret, proc](const FunctionArgs &args) {
                 if (proc->call(args)->is_true())
                     ret->push_back(args.size() == 1 ? args[0] : make_value(args));
-                return NIL_VALUE;
+                return !proc->stopped();
             });
-            return ret;
+            return proc->end_iteration(ret);
         }
         else return make_enumerator(this_obj(), this, &Enumerable::select, "select", args);
     }
@@ -631,16 +687,11 @@ namespace slim
         int n = (int)n_obj->get_value();
         if (n < 0) throw ArgumentError("negative array size");
         auto ret = create_object<Array>();
-        try
-        {
-            each_single([ret, n](Object *arg) -> ObjectPtr {
-                ret->push_back(arg->shared_from_this());
-                if (ret->get_value().size() >= (size_t)n)
-                    throw SpecialFlowException();
-                else return NIL_VALUE;
-            });
-        }
-        catch (const SpecialFlowException &) {}
+        if (n == 0) return ret;
+        for_each_single({}, [ret, n](Object *arg) {
+            ret->push_back(arg->shared_from_this());
+            return ret->get_value().size() < (size_t)n;
+        });
         return ret;
     }
 
@@ -651,17 +702,12 @@ namespace slim
         if (proc)
         {
             auto ret = create_object<Array>();
-            try
-            {
-                each2({}, [ret, proc](const FunctionArgs &args) {
-                    if (!proc->call(args)->is_true())
-                        throw SpecialFlowException();
-                    ret->push_back(args.size() == 1 ? args[0] : make_value(args));
-                    return NIL_VALUE;
-                });
-            }
-            catch (const SpecialFlowException &) {}
-            return ret;
+            for_each({}, [ret, proc](const FunctionArgs &args) {
+                if (!proc->call(args)->is_true()) return false;
+                ret->push_back(args.size() == 1 ? args[0] : make_value(args));
+                return !proc->stopped();
+            });
+            return proc->end_iteration(ret);
         }
         else return make_enumerator(this_obj(), this, &Enumerable::take_while, "take_while", args);
     }
@@ -669,11 +715,11 @@ namespace slim
     Ptr<Array> Enumerable::to_a(const FunctionArgs &args)
     {
         auto ret = create_object<Array>();
-        each2(args, [ret](const FunctionArgs &args)
+        for_each(args, [ret](const FunctionArgs &args)
         {
             if (args.size() == 1) ret->push_back(args[0]);
             else ret->push_back(make_value(args));
-            return NIL_VALUE;
+            return true;
         });
         return ret;
     }
@@ -681,7 +727,7 @@ namespace slim
     Ptr<Hash> Enumerable::to_h(const FunctionArgs &args)
     {
         auto ret = create_object<Hash>();
-        each2(args, [ret](const FunctionArgs &args)
+        for_each(args, [ret](const FunctionArgs &args)
         {
             if (args.size() == 2) ret->set(args[0], args[1]);
             else if (args.size() == 1)
@@ -699,7 +745,7 @@ namespace slim
                 }
             }
             else throw ArgumentCountError(args.size(), 2, 2);
-            return NIL_VALUE;
+            return true;
         });
         return ret;
     }
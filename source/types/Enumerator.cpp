@@ -24,7 +24,7 @@ namespace slim
 
         if (args.size() == 1)
         {
-            proc = dynamic_cast<Proc*>(args[0].get());
+            proc = object_cast<Proc>(args[0].get());
             if (!proc) offset = (int)coerce<Number>(args[0])->get_value();
         }
         else if (args.size() == 2)
@@ -37,47 +37,225 @@ namespace slim
         if (proc)
         {
             int i = offset;
-            return each_single({}, [&i, proc](Object *arg) {
+            auto ret = each_single_forward({}, proc, [&i, proc](Object *arg) {
                 return proc->call({ arg->shared_from_this(), make_value(i++) });
             });
+            return proc->end_iteration(ret);
         }
         else
         {
-            return make_enumerator(this, { &Enumerator::with_index, "with_index" }, {make_value(offset)});
+            return make_enumerator(this, { &Enumerator::with_index, syms::with_index }, {make_value(offset)});
         }
     }
 
     ObjectPtr MethodEnumerator::each(const FunctionArgs &args2)
     {
         Proc *proc = nullptr;
-        if (!args2.empty()) proc = dynamic_cast<Proc*>(args2.back().get());
+        if (!args2.empty()) proc = object_cast<Proc>(args2.back().get());
 
         if (proc)
         {
-            FunctionArgs all_args = args;
+            FunctionArgs all_args;
+            all_args.reserve(args.size() + args2.size());
+            all_args.insert(all_args.end(), args.begin(), args.end());
             all_args.insert(all_args.end(), args2.begin(), args2.end());
             return forward(forward_self.get(), all_args);
         }
         else
         {
-            return make_enumerator(this, { &Enumerator::each, "each" }, args2);
+            return make_enumerator(this, { &Enumerator::each, syms::each }, args2);
         }
     }
 
+    void MethodEnumerator::share_refs()
+    {
+        if (forward_self) forward_self->share();
+        for (auto &arg : args) if (arg) arg->share();
+    }
+
     ObjectPtr FunctionEnumerator::each(const FunctionArgs &args2)
     {
         Proc *proc = nullptr;
-        if (!args2.empty()) proc = dynamic_cast<Proc*>(args2.back().get());
+        if (!args2.empty()) proc = object_cast<Proc>(args2.back().get());
 
         if (proc)
         {
-            FunctionArgs all_args = args;
+            FunctionArgs all_args;
+            all_args.reserve(args.size() + args2.size());
+            all_args.insert(all_args.end(), args.begin(), args.end());
             all_args.insert(all_args.end(), args2.begin(), args2.end());
             return func(all_args);
         }
         else
         {
-            return make_enumerator(this, { &Enumerator::each, "each" }, args2);
+            return make_enumerator(this, { &Enumerator::each, syms::each }, args2);
+        }
+    }
+
+    void FunctionEnumerator::share_refs()
+    {
+        for (auto &arg : args) if (arg) arg->share();
+    }
+
+    LazyEnumerator::LazyEnumerator(ObjectPtr source_obj, Enumerable *source)
+        : source_obj(source_obj), source(source)
+    {}
+
+    void LazyEnumerator::share_refs()
+    {
+        if (source_obj) source_obj->share();
+        for (auto &stage : stages) if (stage.proc) stage.proc->share();
+    }
+
+    const MethodTable &LazyEnumerator::method_table()const
+    {
+        static const MethodTable table = MethodTable(Enumerator::method_table())
+            .add_all({
+                { &LazyEnumerator::map, "collect" },
+                { &LazyEnumerator::flat_map, "collect_concat" },
+                { &LazyEnumerator::with_index, "each_with_index" },
+                { &LazyEnumerator::select, "filter" },
+                { &LazyEnumerator::select, "find_all" },
+                { &LazyEnumerator::flat_map, "flat_map" },
+                { &LazyEnumerator::force, "force" },
+                { &LazyEnumerator::lazy, "lazy" },
+                { &LazyEnumerator::map, "map" },
+                { &LazyEnumerator::reject, "reject" },
+                { &LazyEnumerator::select, "select" },
+                { &LazyEnumerator::take, "take" },
+                { &LazyEnumerator::take_while, "take_while" },
+                { &LazyEnumerator::with_index, "with_index" }
+            });
+        return table;
+    }
+
+    namespace
+    {
+        Ptr<Proc> lazy_block(const FunctionArgs &args, const char *method)
+        {
+            if (args.size() > 1) throw ArgumentCountError(args.size(), 0, 0);
+            auto proc = args.empty() ? nullptr : object_cast<Proc>(args[0].get());
+            if (!proc) throw ArgumentError(std::string("tried to call lazy ") + method + " without a block");
+            return Ptr<Proc>(proc);
+        }
+    }
+
+    Ptr<LazyEnumerator> LazyEnumerator::add_stage(Stage::Kind kind, Ptr<Proc> proc, int n)
+    {
+        auto ret = create_object<LazyEnumerator>(source_obj, source);
+        ret->stages.reserve(stages.size() + 1);
+        ret->stages.insert(ret->stages.end(), stages.begin(), stages.end());
+        ret->stages.push_back({kind, std::move(proc), n});
+        return ret;
+    }
+
+    ObjectPtr LazyEnumerator::each(const FunctionArgs &args)
+    {
+        if (args.empty()) return shared_from_this();
+        if (args.size() > 1) throw ArgumentCountError(args.size(), 0, 1);
+        auto proc = coerce<Proc>(args[0].get());
+        for (auto &stage : stages)
+        {
+            if (stage.kind == Stage::TAKE && stage.n == 0) return shared_from_this();
+        }
+        std::vector<int> counts(stages.size(), 0);
+        source->each_while({}, [this, proc, &counts](const FunctionArgs &args) {
+            return push(0, args, counts, proc);
+        });
+        return proc->end_iteration(shared_from_this());
+    }
+
+    bool LazyEnumerator::push(size_t i, const FunctionArgs &args, std::vector<int> &counts, Proc *out)
+    {
+        if (i == stages.size()) return out->iterate(args);
+        auto &stage = stages[i];
+        switch (stage.kind)
+        {
+        case Stage::MAP:
+            return push(i + 1, { stage.proc->call(args) }, counts, out);
+        case Stage::SELECT:
+            return !stage.proc->call(args)->is_true() || push(i + 1, args, counts, out);
+        case Stage::REJECT:
+            return stage.proc->call(args)->is_true() || push(i + 1, args, counts, out);
+        case Stage::TAKE:
+            ++counts[i];
+            return push(i + 1, args, counts, out) && counts[i] < stage.n;
+        case Stage::TAKE_WHILE:
+            return stage.proc->call(args)->is_true() && push(i + 1, args, counts, out);
+        case Stage::FLAT_MAP:
+        {
+            auto value = stage.proc->call(args);
+            if (auto arr = object_cast<Array>(value.get()))
+            {
+                for (auto &x : arr->get_value())
+                {
+                    if (!push(i + 1, { x }, counts, out)) return false;
+                }
+                return true;
+            }
+            return push(i + 1, { value }, counts, out);
         }
+        case Stage::WITH_INDEX:
+        {
+            auto value = args.size() == 1 ? args[0] : make_value(args);
+            FunctionArgs indexed = { value, make_value(stage.n + counts[i]++) };
+            if (!stage.proc) return push(i + 1, indexed, counts, out);
+            stage.proc->call(indexed);
+            return push(i + 1, args, counts, out);
+        }
+        }
+        return false;
+    }
+
+    Ptr<Array> LazyEnumerator::force()
+    {
+        return to_a({});
+    }
+    Ptr<LazyEnumerator> LazyEnumerator::flat_map(const FunctionArgs &args)
+    {
+        return add_stage(Stage::FLAT_MAP, lazy_block(args, "flat_map"));
+    }
+    Ptr<LazyEnumerator> LazyEnumerator::lazy()
+    {
+        return Ptr<LazyEnumerator>(this);
+    }
+    Ptr<LazyEnumerator> LazyEnumerator::map(const FunctionArgs &args)
+    {
+        return add_stage(Stage::MAP, lazy_block(args, "map"));
+    }
+    Ptr<LazyEnumerator> LazyEnumerator::reject(const FunctionArgs &args)
+    {
+        return add_stage(Stage::REJECT, lazy_block(args, "reject"));
+    }
+    Ptr<LazyEnumerator> LazyEnumerator::select(const FunctionArgs &args)
+    {
+        return add_stage(Stage::SELECT, lazy_block(args, "select"));
+    }
+    Ptr<LazyEnumerator> LazyEnumerator::take(Number *n)
+    {
+        auto count = (int)n->get_value();
+        if (count < 0) throw ArgumentError("attempt to take negative size");
+        return add_stage(Stage::TAKE, nullptr, count);
+    }
+    Ptr<LazyEnumerator> LazyEnumerator::take_while(const FunctionArgs &args)
+    {
+        return add_stage(Stage::TAKE_WHILE, lazy_block(args, "take_while"));
+    }
+    Ptr<LazyEnumerator> LazyEnumerator::with_index(const FunctionArgs &args)
+    {
+        Proc *proc = nullptr;
+        int offset = 0;
+        if (args.size() == 1)
+        {
+            proc = object_cast<Proc>(args[0].get());
+            if (!proc) offset = (int)coerce<Number>(args[0])->get_value();
+        }
+        else if (args.size() == 2)
+        {
+            offset = (int)coerce<Number>(args[0])->get_value();
+            proc = coerce<Proc>(args[1]).get();
+        }
+        else if (args.size() >= 3) throw ArgumentCountError(args.size(), 0, 2);
+        return add_stage(Stage::WITH_INDEX, Ptr<Proc>(proc), offset);
     }
 }
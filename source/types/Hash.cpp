@@ -78,7 +78,7 @@ namespace slim
     }
 
 
-    std::shared_ptr<Hash> Hash::dup()
+    Ptr<Hash> Hash::dup()
     {
         auto ret = create_object<Hash>();
         ret->list = list;
@@ -102,11 +102,11 @@ namespace slim
         {
             for (auto &i : list)
             {
-                proc->call({ i.first, i.second });
+                if (!proc->iterate({ i.first, i.second })) break;
             }
-            return shared_from_this();
+            return proc->end_iteration(shared_from_this());
         }
-        else return make_enumerator(this,{ &Hash::each, "each" });
+        else return make_enumerator(this,{ &Hash::each, syms::each });
     }
     ObjectPtr Hash::each_key(const FunctionArgs &args)
     {
@@ -116,11 +116,11 @@ namespace slim
         {
             for (auto &i : list)
             {
-                proc->call({ i.first });
+                if (!proc->iterate({ i.first })) break;
             }
-            return shared_from_this();
+            return proc->end_iteration(shared_from_this());
         }
-        else return make_enumerator(this, { &Hash::each_key, "each_key" });
+        else return make_enumerator(this, { &Hash::each_key, syms::each_key });
     }
     ObjectPtr Hash::each_value(const FunctionArgs &args)
     {
@@ -130,11 +130,11 @@ namespace slim
         {
             for (auto &i : list)
             {
-                proc->call({ i.second });
+                if (!proc->iterate({ i.second })) break;
             }
-            return shared_from_this();
+            return proc->end_iteration(shared_from_this());
         }
-        else return make_enumerator(this, { &Hash::each_value, "each_value" });
+        else return make_enumerator(this, { &Hash::each_value, syms::each_value });
     }
 
     ObjectPtr Hash::empty_q()
@@ -152,7 +152,7 @@ namespace slim
         //TODO: Block
         return args[1];
     }
-    std::shared_ptr<Array> Hash::flatten(const FunctionArgs &args)
+    Ptr<Array> Hash::flatten(const FunctionArgs &args)
     {
         int level = 0;
         if (args.size() == 1) level = (int)as_number(args[0]);
@@ -180,7 +180,7 @@ namespace slim
         return FALSE_VALUE;
     }
 
-    std::shared_ptr<Hash> Hash::invert()
+    Ptr<Hash> Hash::invert()
     {
         auto out = create_object<Hash>(def_value);
         for (auto &i : list)
@@ -194,14 +194,14 @@ namespace slim
         return NIL_VALUE;
     }
 
-    std::shared_ptr<Array> Hash::keys()
+    Ptr<Array> Hash::keys()
     {
         std::vector<ObjectPtr> out;
         for (auto &i : list) out.push_back(i.first);
         return make_array(std::move(out));
     }
 
-    std::shared_ptr<Array> Hash::values()
+    Ptr<Array> Hash::values()
     {
         std::vector<ObjectPtr> out;
         for (auto &i : list) out.push_back(i.second);
@@ -213,7 +213,7 @@ namespace slim
         return make_value((double)map.size());
     }
 
-    std::shared_ptr<Hash> Hash::merge(Hash *other_hash)
+    Ptr<Hash> Hash::merge(Hash *other_hash)
     {
         //TODO: Block
         auto out = create_object<Hash>(def_value);
@@ -224,16 +224,27 @@ namespace slim
         return out;
     }
 
-    std::shared_ptr<Array> Hash::to_a()
+    Ptr<Array> Hash::to_a()
     {
         std::vector<ObjectPtr> out;
         for (auto &i : list)
             out.push_back(make_array({ i.first, i.second }));
         return make_array(std::move(out));
     }
-    std::shared_ptr<Hash> Hash::to_h()
+    Ptr<Hash> Hash::to_h()
     {
-        return std::static_pointer_cast<Hash>(shared_from_this());
+        return static_pointer_cast<Hash>(shared_from_this());
+    }
+
+    void Hash::share_refs()
+    {
+        // The map keys are the same objects as the list keys
+        if (def_value) def_value->share();
+        for (auto &i : list)
+        {
+            if (i.first) i.first->share();
+            if (i.second) i.second->share();
+        }
     }
 
     const MethodTable & Hash::method_table() const
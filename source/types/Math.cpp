@@ -117,7 +117,7 @@ namespace slim
     {
         return make_value(std::erfc(n->get_value()));
     }
-    //std::shared_ptr<Object> Math::frexp(Number *n)
+    //Ptr<Object> Math::frexp(Number *n)
     //{
     //    
     //}
@@ -135,7 +135,7 @@ namespace slim
     {
         return make_value(std::ldexp(x->get_value(), (int)exp->get_value()));
     }
-    std::shared_ptr<Array> Math::lgamma(Number *n)
+    Ptr<Array> Math::lgamma(Number *n)
     {
         double a = std::lgamma(n->get_value());
         double b = std::tgamma(n->get_value());
@@ -7,12 +7,16 @@
 
 namespace slim
 {
-    std::string Number::to_string()const
+    std::string Number::format(double v)
     {
         std::stringstream ss;
         ss << v;
         return ss.str();
     }
+    std::string Number::to_string()const
+    {
+        return format(v);
+    }
 
     const MethodTable &Number::method_table()const
     {
@@ -104,38 +108,38 @@ namespace slim
         return make_value(~(int)v);
     }
 
-    std::shared_ptr<Number> Number::to_f()
+    Ptr<Number> Number::to_f()
     {
-        return std::static_pointer_cast<Number>(shared_from_this());
+        return static_pointer_cast<Number>(shared_from_this());
     }
-    std::shared_ptr<Number> Number::to_i()
+    Ptr<Number> Number::to_i()
     {
         return make_value(std::trunc(v));
     }
 
-    std::shared_ptr<Number> Number::abs()
+    Ptr<Number> Number::abs()
     {
         return make_value(std::abs(v));
     }
 
-    std::shared_ptr<Number> Number::next_float()
+    Ptr<Number> Number::next_float()
     {
         auto v2 = std::nextafter(v, INFINITY);
         return make_value(v2);
     }
 
-    std::shared_ptr<Number> Number::prev_float()
+    Ptr<Number> Number::prev_float()
     {
         auto v2 = std::nextafter(v, -INFINITY);
         return make_value(v2);
     }
 
-    std::shared_ptr<Number> Number::ceil()
+    Ptr<Number> Number::ceil()
     {
         return make_value(std::ceil(v));
     }
 
-    std::shared_ptr<Number> Number::floor()
+    Ptr<Number> Number::floor()
     {
         return make_value(std::floor(v));
     }
@@ -146,13 +150,13 @@ namespace slim
         auto factor = std::pow(10.0, ndigits - std::ceil(std::log10(std::fabs(v))));
         return std::round(v * factor) / factor;
     }
-    std::shared_ptr<Number> Number::round(const FunctionArgs & args)
+    Ptr<Number> Number::round(const FunctionArgs & args)
     {
         double ndigits = 0;
         if (args.size() == 1) ndigits = as_number(args[0]);
         else if (args.size() > 1) throw ArgumentError(this, "round");
 
-        if (v == 0) return std::static_pointer_cast<Number>(shared_from_this());
+        if (v == 0) return static_pointer_cast<Number>(shared_from_this());
         if (ndigits == 0) return make_value(std::round(v));
         else if (ndigits > 0) return make_value(round_f(v, ndigits));
         else return make_value(std::round(round_f(v, -ndigits)));
@@ -186,35 +190,35 @@ namespace slim
         static const unsigned char CACHE_MAX = 100;
         struct CachedNumbers
         {
-            std::shared_ptr<Number> numbers[CACHE_MAX + 1];
+            Ptr<Number> numbers[CACHE_MAX + 1];
             CachedNumbers()
             {
                 for (int i = 0; i <= CACHE_MAX; ++i)
                     numbers[i] = create_object<Number>(i);
             }
         };
-        std::shared_ptr<Number> *cached_numbers()
+        Ptr<Number> *cached_numbers()
         {
             static CachedNumbers cache;
             return cache.numbers;
         }
     }
-    std::shared_ptr<Number> make_value(int v)
+    Ptr<Number> make_value(int v)
     {
         if (v >= 0 && v <= CACHE_MAX) return cached_numbers()[v];
         else return create_object<Number>(v);
     }
-    std::shared_ptr<Number> make_value(unsigned v)
+    Ptr<Number> make_value(unsigned v)
     {
         if (v >= 0 && v <= CACHE_MAX) return cached_numbers()[v];
         else return create_object<Number>(v);
     }
-    std::shared_ptr<Number> make_value(long long v)
+    Ptr<Number> make_value(long long v)
     {
         if (v >= 0 && v <= CACHE_MAX) return cached_numbers()[v];
         else return create_object<Number>((double)v);
     }
-    std::shared_ptr<Number> make_value(unsigned long long v)
+    Ptr<Number> make_value(unsigned long long v)
     {
         if (v >= 0 && v <= CACHE_MAX) return cached_numbers()[v];
         else return create_object<Number>((double)v);
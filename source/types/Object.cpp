@@ -10,9 +10,50 @@
 
 namespace slim
 {
-    const std::shared_ptr<Nil> NIL_VALUE = std::make_shared<Nil>();
-    const std::shared_ptr<Boolean> TRUE_VALUE = std::make_shared<Boolean>(true);
-    const std::shared_ptr<Boolean> FALSE_VALUE = std::make_shared<Boolean>(false);
+    namespace
+    {
+        template<class T> Ptr<T> make_permanent(T *obj)
+        {
+            obj->set_permanent();
+            return Ptr<T>(Object::init_type_flags(obj));
+        }
+    }
+    const Ptr<Nil> NIL_VALUE = make_permanent(new Nil());
+    const Ptr<Boolean> TRUE_VALUE = make_permanent(new Boolean(true));
+    const Ptr<Boolean> FALSE_VALUE = make_permanent(new Boolean(false));
+
+    namespace
+    {
+        /**Stored before each object, to find the arena it was allocated from.*/
+        struct alignas(16) AllocHeader
+        {
+            RenderArena *arena;
+        };
+    }
+    void *Object::operator new(size_t size)
+    {
+        size += sizeof(AllocHeader);
+        AllocHeader *header;
+        auto arena = RenderArena::current();
+        if (arena)
+        {
+            arena->retain();
+            header = static_cast<AllocHeader*>(arena->allocate(size));
+        }
+        else header = static_cast<AllocHeader*>(::operator new(size));
+        header->arena = arena;
+        return header + 1;
+    }
+    void Object::operator delete(void *p, size_t size)
+    {
+        auto header = static_cast<AllocHeader*>(p) - 1;
+        if (auto arena = header->arena)
+        {
+            arena->deallocate(header, size + sizeof(AllocHeader));
+            arena->release();
+        }
+        else ::operator delete(header);
+    }
 
     std::string Object::inspect()const
     {
@@ -117,7 +158,7 @@ namespace slim
         throw TypeError(this->inspect() + " is not a class/module");
     }
 
-    std::shared_ptr<String> Object::to_string_obj()
+    Ptr<String> Object::to_string_obj()
     {
         return make_value(to_string());
     }
@@ -138,7 +179,7 @@ namespace slim
 
     double as_number(const Object *obj)
     {
-        auto n = dynamic_cast<const Number*>(obj);
+        auto n = object_cast<Number>(obj);
         if (n) return n->get_value();
         else throw TypeError("Expected number, got " + obj->type_name());
     }
@@ -170,21 +211,21 @@ namespace slim
     }
 
     //to_f
-    std::shared_ptr<Number> Nil::to_f()
+    Ptr<Number> Nil::to_f()
     {
         return make_value(0.0);
     }
-    std::shared_ptr<Number> Boolean::to_f()
+    Ptr<Number> Boolean::to_f()
     {
         return make_value(b ? 1.0 : 0.0);
     }
 
     //to_i
-    std::shared_ptr<Number> Nil::to_i()
+    Ptr<Number> Nil::to_i()
     {
         return make_value(0.0);
     }
-    std::shared_ptr<Number> Boolean::to_i()
+    Ptr<Number> Boolean::to_i()
     {
         return make_value(b ? 1.0 : 0.0);
     }
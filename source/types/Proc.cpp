@@ -1,6 +1,7 @@
 #include "types/Proc.hpp"
 #include "expression/Ast.hpp"
 #include "expression/Scope.hpp"
+#include "types/Nil.hpp"
 #include "Function.hpp"
 #include <sstream>
 
@@ -15,11 +16,28 @@ namespace slim
         return table;
     }
 
+    ObjectPtr Proc::end_iteration(ObjectPtr ret)
+    {
+        if (!_stopped) return ret;
+        _stopped = false;
+        ret = stop_value ? std::move(stop_value) : NIL_VALUE;
+        stop_value = nullptr;
+        return ret;
+    }
+
+    BlockProc::BlockProc(
+        const expr::ExpressionNode &code,
+        const std::vector<SymPtr> &param_names,
+        expr::Scope &scope)
+        : code(code), param_names(param_names), locals(param_names), scope(scope)
+    {
+    }
     BlockProc::BlockProc(
         const expr::ExpressionNode &code,
         const std::vector<SymPtr> &param_names,
+        const std::vector<SymPtr> &locals,
         expr::Scope &scope)
-        : code(code), param_names(param_names), scope(scope)
+        : code(code), param_names(param_names), locals(locals), scope(scope)
     {
     }
 
@@ -32,8 +50,8 @@ namespace slim
             throw ArgumentError(this, "call", ss.str());
         }
         
-        expr::Scope new_scope(scope);
-        for (size_t i = 0; i < args.size(); ++i) new_scope.set(param_names[i], args[i]);
+        expr::Scope new_scope(scope, locals);
+        for (size_t i = 0; i < args.size(); ++i) new_scope.set((uint32_t)i, param_names[i], args[i]);
         
         auto result = code.eval(new_scope);
 
@@ -81,16 +81,20 @@ namespace slim
             if (exclude_end)
             {
                 for (auto i = _begin; i < _end; i += 1)
-                    proc->call({make_value(i)});
+                {
+                    if (!proc->iterate({make_value(i)})) break;
+                }
             }
             else
             {
                 for (auto i = _begin; i <= _end; i += 1)
-                    proc->call({make_value(i)});
+                {
+                    if (!proc->iterate({make_value(i)})) break;
+                }
             }
-            return shared_from_this();
+            return proc->end_iteration(shared_from_this());
         }
-        else return make_enumerator(this, {&Range::each, "each"});
+        else return make_enumerator(this, {&Range::each, syms::each});
     }
     Ptr<Object> Range::end()
     {
@@ -175,7 +179,7 @@ namespace slim
     Ptr<Object> Range::step(const FunctionArgs &args)
     {
         Proc *proc = nullptr;
-        if (args.size() == 1) proc = dynamic_cast<Proc*>(args[0].get());
+        if (args.size() == 1) proc = object_cast<Proc>(args[0].get());
         else if (args.size() == 2) proc = coerce<Proc>(args[1].get());
         else if (args.size() >= 3) throw ArgumentCountError(args.size(), 0, 2);
 
@@ -186,16 +190,20 @@ namespace slim
             if (exclude_end)
             {
                 for (auto i = _begin; i < _end; i += step)
-                    proc->call({make_value(i)});
+                {
+                    if (!proc->iterate({make_value(i)})) break;
+                }
             }
             else
             {
                 for (auto i = _begin; i <= _end; i += step)
-                    proc->call({make_value(i)});
+                {
+                    if (!proc->iterate({make_value(i)})) break;
+                }
             }
-            return shared_from_this();
+            return proc->end_iteration(shared_from_this());
         }
-        else return make_enumerator(this, {&Range::step, "step"}, args);
+        else return make_enumerator(this, {&Range::step, syms::step}, args);
     }
 
 
@@ -116,6 +116,10 @@ namespace slim
         }
         return out;
     }
+    void MatchData::share_refs()
+    {
+        if (regex) regex->share();
+    }
     const MethodTable & MatchData::method_table() const
     {
         static const auto table = MethodTable(Object::method_table(), {
@@ -169,7 +173,7 @@ namespace slim
     {
         if (args.size() == 1)
         {
-            auto cp = dynamic_cast<Regexp*>(args[0].get());
+            auto cp = object_cast<Regexp>(args[0].get());
             if (cp) return create_object<Regexp>(*cp);
         }
         std::string src;
@@ -206,7 +210,7 @@ namespace slim
     }
     bool Regexp::eq(const Object *rhs) const
     {
-        auto r2 = dynamic_cast<const Regexp*>(rhs);
+        auto r2 = object_cast<Regexp>(rhs);
         return r2 && src == r2->src && opts == r2->opts;
     }
     size_t Regexp::hash() const
@@ -222,7 +226,7 @@ namespace slim
         if (pos < 0 || pos >(int)str.size()) return nullptr;
 
         Ptr<MatchData> results(new MatchData(
-            std::static_pointer_cast<Regexp>(shared_from_this()),
+            static_pointer_cast<Regexp>(shared_from_this()),
             str));
         if (std::regex_search(
             results->str.cbegin() + pos, results->str.cend(),
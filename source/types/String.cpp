@@ -45,50 +45,50 @@ namespace slim
         return out;
     }
 
-    std::shared_ptr<Number> String::to_f()
+    Ptr<Number> String::to_f()
     {
         double d = 0;
         try { d = std::stod(v.c_str()); }
         catch (const std::exception &) {}
         return make_value(d);
     }
-    std::shared_ptr<Number> String::to_i()
+    Ptr<Number> String::to_i()
     {
         int i = 0;
         try { i = std::stoi(v.c_str()); }
         catch (const std::exception &) {}
         return make_value((double)i);
     }
-    std::shared_ptr<Symbol> String::to_sym()
+    Ptr<Symbol> String::to_sym()
     {
         return symbol(v);
     }
 
-    std::shared_ptr<String> String::html_safe()
+    Ptr<String> String::html_safe()
     {
-        return std::make_shared<HtmlSafeString>(v);
+        return create_object<HtmlSafeString>(v);
     }
 
     ObjectPtr String::el_ref(const FunctionArgs & args)
     {
         if (args.size() == 1)
         {
-            if (auto index = std::dynamic_pointer_cast<Number>(args[0]))
+            if (auto index = object_pointer_cast<Number>(args[0]))
             {
                 return do_slice((int)index->get_value(), 1);
             }
-            else if (auto regex = std::dynamic_pointer_cast<Regexp>(args[0]))
+            else if (auto regex = object_pointer_cast<Regexp>(args[0]))
             {
                 auto match = regex->do_match(v, 0);
                 if (match) return match->to_string_obj();
                 else return NIL_VALUE;
             }
-            else if (auto match_str = std::dynamic_pointer_cast<String>(args[0]))
+            else if (auto match_str = object_pointer_cast<String>(args[0]))
             {
                 if (v.find(match_str->v) != std::string::npos) return match_str;
                 else return NIL_VALUE;
             }
-            else if (auto range = std::dynamic_pointer_cast<Range>(args[0]))
+            else if (auto range = object_pointer_cast<Range>(args[0]))
             {
                 int start, length;
                 if (range->get_beg_len(&start, &length, (int)v.size()))
@@ -99,7 +99,7 @@ namespace slim
         }
         else if (args.size() == 2)
         {
-            if (auto regex = std::dynamic_pointer_cast<Regexp>(args[0]))
+            if (auto regex = object_pointer_cast<Regexp>(args[0]))
             {
                 auto match = regex->do_match(v, 0);
                 if (match) return match->el_ref({args[1]});
@@ -124,7 +124,7 @@ namespace slim
     }
 
     //Encoding/unicode
-    std::shared_ptr<Boolean> String::ascii_only_q()
+    Ptr<Boolean> String::ascii_only_q()
     {
         for (auto c : v) if (c < 0 || c >= 128) return FALSE_VALUE;
         return TRUE_VALUE;
@@ -140,7 +140,7 @@ namespace slim
     Ptr<Object> String::byteslice(const FunctionArgs &args)
     {
         Range *range;
-        if (args.size() == 1 && (range = dynamic_cast<Range*>(args[0].get())))
+        if (args.size() == 1 && (range = object_cast<Range>(args[0].get())))
         {
             int start, length;
             if (range->get_beg_len(&start, &length, (int)v.size()))
@@ -228,7 +228,7 @@ namespace slim
         return make_value(out);
     }
 
-    std::shared_ptr<String> String::capitalize()
+    Ptr<String> String::capitalize()
     {
         std::string ret = v;
         if (!ret.empty() && ret[0] >= 'a' && ret[0] <= 'z') ret[0] = (char)(ret[0] - 'a' + 'A');
@@ -249,7 +249,7 @@ namespace slim
         return make_value(0.0);
     }
 
-    std::shared_ptr<String> String::center(const FunctionArgs & args)
+    Ptr<String> String::center(const FunctionArgs & args)
     {
         int width;
         std::string padstr = " ";
@@ -267,7 +267,7 @@ namespace slim
         return make_value(new_str);
     }
 
-    std::shared_ptr<String> String::ljust(const FunctionArgs & args)
+    Ptr<String> String::ljust(const FunctionArgs & args)
     {
         int width;
         std::string padstr = " ";
@@ -280,7 +280,7 @@ namespace slim
         for (int i = 0; i < width - (int)v.size(); ++i) ret += padstr[i % padstr.size()];
         return make_value(ret);
     }
-    std::shared_ptr<String> String::rjust(const FunctionArgs & args)
+    Ptr<String> String::rjust(const FunctionArgs & args)
     {
         int width;
         std::string padstr = " ";
@@ -295,7 +295,7 @@ namespace slim
         return make_value(ret);
     }
 
-    std::shared_ptr<String> String::chomp(const FunctionArgs & args)
+    Ptr<String> String::chomp(const FunctionArgs & args)
     {
         if (args.empty())
         {
@@ -327,7 +327,7 @@ namespace slim
         else throw ArgumentError(this, "chomp");
     }
 
-    std::shared_ptr<String> String::downcase()
+    Ptr<String> String::downcase()
     {
         auto ret = v;
         std::transform(ret.begin(), ret.end(), ret.begin(), ::tolower);
@@ -340,18 +340,13 @@ namespace slim
         unpack<0>(args, &proc);
         if (proc)
         {
-            try
+            for (auto &i : v)
             {
-                for (auto &i : v)
-                    proc->call({ make_value((unsigned char)i) });
-                return shared_from_this();
-            }
-            catch (const BreakException &e)
-            {
-                return e.value;
+                if (!proc->iterate({ make_value((unsigned char)i) })) break;
             }
+            return proc->end_iteration(shared_from_this());
         }
-        else return make_enumerator(this, { &String::each_byte, "each_byte" });
+        else return make_enumerator(this, { &String::each_byte, syms::each_byte });
     }
     Ptr<Object> String::each_char(const FunctionArgs &args)
     {
@@ -359,23 +354,16 @@ namespace slim
         unpack<0>(args, &proc);
         if (proc)
         {
-            try
-            {
-                uint32_t cp;
-                unsigned cp_len;
-                for (size_t p = 0; p < v.size(); p += cp_len)
-                {
-                    utf8_decode(v.c_str() + p, &cp, &cp_len);
-                    proc->call({ make_value(v.substr(p, cp_len)) });
-                }
-                return shared_from_this();
-            }
-            catch (const BreakException &e)
+            uint32_t cp;
+            unsigned cp_len;
+            for (size_t p = 0; p < v.size(); p += cp_len)
             {
-                return e.value;
+                utf8_decode(v.c_str() + p, &cp, &cp_len);
+                if (!proc->iterate({ make_value(v.substr(p, cp_len)) })) break;
             }
+            return proc->end_iteration(shared_from_this());
         }
-        else return make_enumerator(this, { &String::each_char, "each_char" });
+        else return make_enumerator(this, { &String::each_char, syms::each_char });
     }
     Ptr<Object> String::each_codepoint(const FunctionArgs &args)
     {
@@ -383,23 +371,16 @@ namespace slim
         unpack<0>(args, &proc);
         if (proc)
         {
-            try
-            {
-                uint32_t cp;
-                unsigned cp_len;
-                for (size_t p = 0; p < v.size(); p += cp_len)
-                {
-                    utf8_decode(v.c_str() + p, &cp, &cp_len);
-                    proc->call({ make_value(cp) });
-                }
-                return shared_from_this();
-            }
-            catch (const BreakException &e)
+            uint32_t cp;
+            unsigned cp_len;
+            for (size_t p = 0; p < v.size(); p += cp_len)
             {
-                return e.value;
+                utf8_decode(v.c_str() + p, &cp, &cp_len);
+                if (!proc->iterate({ make_value(cp) })) break;
             }
+            return proc->end_iteration(shared_from_this());
         }
-        else return make_enumerator(this, { &String::each_codepoint, "each_codepoint" });
+        else return make_enumerator(this, { &String::each_codepoint, syms::each_codepoint });
     }
     ObjectPtr String::each_line(const FunctionArgs & args)
     {
@@ -409,7 +390,7 @@ namespace slim
         if (args.size() == 2) unpack(args, &sep, &proc);
         else if (args.size() == 1)
         {
-            proc = dynamic_cast<Proc*>(args[0].get());
+            proc = object_cast<Proc>(args[0].get());
             if (!proc) sep = coerce<String>(args[0])->get_value();
         }
         else if (args.size() > 0) throw ArgumentCountError(args.size(), 0, 2);
@@ -417,28 +398,24 @@ namespace slim
         if (proc)
         {
             auto lines = split_lines(sep);
-            try
-            {
-                for (auto &i : lines) proc->call({ make_value(i) });
-                return shared_from_this();
-            }
-            catch(const BreakException &e)
+            for (auto &i : lines)
             {
-                return e.value;
+                if (!proc->iterate({ make_value(i) })) break;
             }
+            return proc->end_iteration(shared_from_this());
         }
         else
         {
-            return make_enumerator(this, { &String::each_line, "each_line" }, args);
+            return make_enumerator(this, { &String::each_line, syms::each_line }, args);
         }
     }
 
-    std::shared_ptr<Boolean> String::empty_q()
+    Ptr<Boolean> String::empty_q()
     {
         return make_value(v.empty());
     }
 
-    std::shared_ptr<Boolean> String::end_with_q(const FunctionArgs & args)
+    Ptr<Boolean> String::end_with_q(const FunctionArgs & args)
     {
         for (auto &suffix : args)
         {
@@ -448,7 +425,7 @@ namespace slim
         return FALSE_VALUE;
     }
 
-    std::shared_ptr<Number> String::hex()
+    Ptr<Number> String::hex()
     {
         size_t p = 0;
         //optional sign
@@ -474,7 +451,7 @@ namespace slim
         return make_value(n);
     }
 
-    std::shared_ptr<Boolean> String::include_q(const String * rhs)
+    Ptr<Boolean> String::include_q(const String * rhs)
     {
         return make_value(v.find(rhs->v) != std::string::npos);
     }
@@ -487,13 +464,13 @@ namespace slim
 
         if (offset < 0) offset = ((int)v.size()) + offset;
         if (offset < 0 || offset > (int)v.size()) return NIL_VALUE;
-        if (auto regex = dynamic_cast<Regexp*>(pattern))
+        if (auto regex = object_cast<Regexp>(pattern))
         {
             auto match = regex->do_match(v, offset);
             if (match) return match->begin(make_value(0).get());
             else return NIL_VALUE;
         }
-        else if (auto substring = dynamic_cast<String*>(pattern))
+        else if (auto substring = object_cast<String>(pattern))
         {
             auto p = v.find(substring->get_value(), (size_t)offset);
             if (p != std::string::npos) return make_value((double)p);
@@ -502,7 +479,7 @@ namespace slim
         else throw ArgumentError("Expected String or Regexp");
     }
 
-    std::shared_ptr<Array> String::lines(const FunctionArgs & args)
+    Ptr<Array> String::lines(const FunctionArgs & args)
     {
         std::string sep = "\n";
         unpack<0>(args, &sep);
@@ -513,25 +490,25 @@ namespace slim
         return make_array(ret);
     }
 
-    std::shared_ptr<Number> String::ord()
+    Ptr<Number> String::ord()
     {
         if (v.empty()) throw ArgumentError(this, "ord");
         else return make_value((double)v[0]);
     }
 
-    std::shared_ptr<Array> String::partition(Object *obj)
+    Ptr<Array> String::partition(Object *obj)
     {
         return do_partition(false, obj);
     }
 
-    std::shared_ptr<String> String::reverse()
+    Ptr<String> String::reverse()
     {
         std::string ret;
         for (auto i = v.rbegin(); i != v.rend(); ++i) ret += *i;
         return make_value(ret);
     }
 
-    std::shared_ptr<Array> String::rpartition(Object *obj)
+    Ptr<Array> String::rpartition(Object *obj)
     {
         return do_partition(true, obj);
     }
@@ -544,14 +521,14 @@ namespace slim
 
         if (offset < 0) offset = ((int)v.size()) + offset;
         if (offset < 0) return NIL_VALUE;
-        if (auto regex = dynamic_cast<Regexp*>(pattern))
+        if (auto regex = object_cast<Regexp>(pattern))
         {
             if (offset >= (int)v.size()) offset = (int)v.size() - 1;
             auto match = regex->do_rmatch(v, offset + 1);
             if (match.size()) return make_value(static_cast<double>(match[1].first - v.begin())); //FIXME: long long?
             else return NIL_VALUE;
         }
-        else if (auto substring = dynamic_cast<String*>(pattern))
+        else if (auto substring = object_cast<String>(pattern))
         {
             auto p = v.rfind(substring->get_value(), (size_t)offset);
             if (p != std::string::npos) return make_value((double)p);
@@ -560,12 +537,12 @@ namespace slim
         else throw ArgumentError("Expected String or Regexp");
     }
 
-    std::shared_ptr<Number> String::size()
+    Ptr<Number> String::size()
     {
         return make_value((double)v.size());
     }
 
-    std::shared_ptr<Array> String::split(const FunctionArgs &args)
+    Ptr<Array> String::split(const FunctionArgs &args)
     {
         //TODO: Suppress trailing nulls
         //TODO: Negative limit trailing null suppression
@@ -583,7 +560,7 @@ namespace slim
 
         std::vector<std::string> out;
 
-        if (auto str_obj = dynamic_cast<String*>(pattern.get()))
+        if (auto str_obj = object_cast<String>(pattern.get()))
         {
             auto &str = str_obj->get_value();
             if (str.empty())
@@ -637,7 +614,7 @@ namespace slim
                 out.push_back(v.substr(p));
             }
         }
-        else if (auto regex_obj = dynamic_cast<Regexp*>(pattern.get()))
+        else if (auto regex_obj = object_cast<Regexp>(pattern.get()))
         {
             auto &regex = regex_obj->get();
             auto i = v.cbegin(), end = v.cend();
@@ -676,7 +653,7 @@ namespace slim
         return arr;
     }
 
-    std::shared_ptr<Boolean> String::start_with_q(const FunctionArgs & args)
+    Ptr<Boolean> String::start_with_q(const FunctionArgs & args)
     {
         for (auto &suffix : args)
         {
@@ -686,14 +663,14 @@ namespace slim
         return FALSE_VALUE;
     }
 
-    std::shared_ptr<String> String::strip()
+    Ptr<String> String::strip()
     {
         auto start = v.find_first_not_of(WHITESPACE);
         if (start == std::string::npos) return make_value("");
         auto end = v.find_last_not_of(WHITESPACE);
         return make_value(v.substr(start, end - start + 1));
     }
-    std::shared_ptr<String> String::lstrip()
+    Ptr<String> String::lstrip()
     {
         auto p = v.find_first_not_of(WHITESPACE);
         if (p == std::string::npos) return make_value("");
@@ -711,14 +688,14 @@ namespace slim
         if (pos) return regex->match({shared_from_this(), pos});
         else return regex->match({shared_from_this()});
     }
-    std::shared_ptr<String> String::rstrip()
+    Ptr<String> String::rstrip()
     {
         auto p = v.find_last_not_of(WHITESPACE);
         if (p == std::string::npos) return make_value("");
         else return make_value(v.substr(0, p + 1));
     }
 
-    std::shared_ptr<String> String::upcase()
+    Ptr<String> String::upcase()
     {
         auto ret = v;
         std::transform(ret.begin(), ret.end(), ret.begin(), ::toupper);
@@ -730,7 +707,7 @@ namespace slim
         typedef std::function<std::string(const std::string &, const std::smatch *)> ReplaceFunc;
         ReplaceFunc replace_func(Object *replace)
         {
-            if (auto str_obj = dynamic_cast<String*>(replace))
+            if (auto str_obj = object_cast<String>(replace))
             {
                 auto &str = str_obj->get_value();
                 struct Part
@@ -771,14 +748,14 @@ namespace slim
                     return out;
                 };
             }
-            else if (auto hash = dynamic_cast<Hash*>(replace))
+            else if (auto hash = object_cast<Hash>(replace))
             {
                 return [hash](const std::string &str, const std::smatch *) -> std::string
                 {
                     return hash->get(make_value(str))->to_string();
                 };
             }
-            else if (auto proc = dynamic_cast<Proc*>(replace))
+            else if (auto proc = object_cast<Proc>(replace))
             {
                 return [proc](const std::string &str, const std::smatch *) -> std::string
                 {
@@ -801,7 +778,7 @@ namespace slim
         Object *pattern, *replace;
         unpack(args, &pattern, &replace);
         auto f = replace_func(replace);
-        if (auto regex = dynamic_cast<Regexp*>(pattern))
+        if (auto regex = object_cast<Regexp>(pattern))
         {
             auto i = v.cbegin(), end = v.cend();
             std::string out;
@@ -817,7 +794,7 @@ namespace slim
             out.append(i, end);
             return make_value(out);
         }
-        else if (auto str_obj = dynamic_cast<String*>(pattern))
+        else if (auto str_obj = object_cast<String>(pattern))
         {
             auto &str = str_obj->get_value();
             size_t i = 0;
@@ -893,9 +870,9 @@ namespace slim
         return table;
     }
 
-    std::shared_ptr<Array> String::do_partition(bool reverse, Object *sep)
+    Ptr<Array> String::do_partition(bool reverse, Object *sep)
     {
-        if (auto str = dynamic_cast<String*>(sep))
+        if (auto str = object_cast<String>(sep))
         {
             auto p = reverse ? v.rfind(str->v) : v.find(str->v);
             if (p != std::string::npos)
@@ -6,8 +6,9 @@
 #include "Operators.hpp"
 #include "Function.hpp"
 #include "CachedMethod.hpp"
-#include <unordered_map>
+#include <atomic>
 #include <mutex>
+#include <vector>
 
 namespace slim
 {
@@ -77,25 +78,154 @@ namespace slim
             BinaryProcT(Op op) : op(op) {}
         };
     }
+    namespace
+    {
+        /**Concurrent string to symbol map.
+         *
+         * Split into shards, each an open addressing table of symbol pointers. Since symbols are
+         * never freed, lookups need no lock: they read the current table of the shard and
+         * compare the strings of the symbols found. Inserts lock the shard, and publish a new
+         * symbol with a single atomic store. Growing a shard publishes a new, larger table, and
+         * the old one is kept, since other threads may still be reading it.
+         */
+        class SymbolTable
+        {
+        public:
+            SymbolTable()
+            {
+                for (auto &shard : shards)
+                {
+                    shard.tables.emplace_back(new Table(INITIAL_SIZE));
+                    shard.table.store(shard.tables.back().get(), std::memory_order_release);
+                }
+            }
+            Symbol *find(const std::string &str, size_t hash)const
+            {
+                auto &shard = shards[hash % NUM_SHARDS];
+                return shard.table.load(std::memory_order_acquire)->find(str, hash / NUM_SHARDS);
+            }
+            /**Find a symbol, or add one from create. create is called with the shard locked.*/
+            template<class Create>
+            Symbol *insert(const std::string &str, size_t hash, Create create)
+            {
+                auto &shard = shards[hash % NUM_SHARDS];
+                std::unique_lock<std::mutex> lock(shard.mutex);
+                auto table = shard.table.load(std::memory_order_relaxed);
+                //Another thread may have added it since find
+                if (auto sym = table->find(str, hash / NUM_SHARDS)) return sym;
+
+                if ((shard.count + 1) * 2 > table->size())
+                {
+                    shard.tables.emplace_back(new Table(table->size() * 2));
+                    auto new_table = shard.tables.back().get();
+                    for (size_t i = 0; i < table->size(); ++i)
+                    {
+                        if (auto sym = table->slots[i].load(std::memory_order_relaxed))
+                            new_table->add(sym, std::hash<std::string>()(sym->str()) / NUM_SHARDS);
+                    }
+                    shard.table.store(new_table, std::memory_order_release);
+                    table = new_table;
+                }
+                auto sym = create();
+                table->add(sym, hash / NUM_SHARDS);
+                ++shard.count;
+                return sym;
+            }
+        private:
+            static const size_t NUM_SHARDS = 16;
+            static const size_t INITIAL_SIZE = 64;
+
+            struct Table
+            {
+                std::unique_ptr<std::atomic<Symbol*>[]> slots;
+                size_t mask;
+
+                explicit Table(size_t size)
+                    : slots(new std::atomic<Symbol*>[size]), mask(size - 1)
+                {
+                    for (size_t i = 0; i < size; ++i) slots[i].store(nullptr, std::memory_order_relaxed);
+                }
+                size_t size()const { return mask + 1; }
+                Symbol *find(const std::string &str, size_t hash)const
+                {
+                    for (size_t i = hash & mask;; i = (i + 1) & mask)
+                    {
+                        auto sym = slots[i].load(std::memory_order_acquire);
+                        if (!sym || sym->str() == str) return sym;
+                    }
+                }
+                void add(Symbol *sym, size_t hash)
+                {
+                    auto i = hash & mask;
+                    while (slots[i].load(std::memory_order_relaxed)) i = (i + 1) & mask;
+                    slots[i].store(sym, std::memory_order_release);
+                }
+            };
+            struct Shard
+            {
+                std::atomic<Table*> table;
+                /**Every table used by this shard, which are never freed.*/
+                std::vector<std::unique_ptr<Table>> tables;
+                size_t count = 0;
+                std::mutex mutex;
+            };
+            Shard shards[NUM_SHARDS];
+        };
+
+        /**Next Symbol::id. Constant initialised, so usable during static initialisation.*/
+        std::atomic<uint32_t> next_symbol_id(0);
+
+        /**Per thread cache of recently used symbols, indexed by the string hash.*/
+        const size_t SYMBOL_CACHE_SIZE = 256;
+        thread_local Symbol *symbol_cache[SYMBOL_CACHE_SIZE];
+    }
     SymPtr symbol(const std::string & str)
     {
-        static std::unordered_map<std::string, std::shared_ptr<Symbol>> map;
-        static std::mutex mutex;
-        std::unique_lock<std::mutex> lock(mutex);
-        auto x = map.emplace(str, nullptr);
-        if (x.second)
+        static SymbolTable table;
+        auto hash = std::hash<std::string>()(str);
+        auto &cached = symbol_cache[hash % SYMBOL_CACHE_SIZE];
+        if (cached && cached->str() == str) return SymPtr(cached);
+
+        auto sym = table.find(str, hash);
+        if (!sym)
         {
-            x.first->second.reset(new Symbol(make_value(str)));
+            sym = table.insert(str, hash, [&str] {
+                //Symbols are never freed, so must not hold memory from a render
+                RenderArena::Suspend suspend;
+                auto str_obj = make_value(str);
+                str_obj->set_permanent();
+                auto sym = Object::init_type_flags(new Symbol(str_obj));
+                sym->set_permanent();
+                return sym;
+            });
         }
-
-        return x.first->second;
+        cached = sym;
+        return SymPtr(sym);
     }
-    SymPtr symbol(std::shared_ptr<String> str)
+    SymPtr symbol(Ptr<String> str)
     {
         return symbol(str->get_value());
     }
 
-    Symbol::Symbol(std::shared_ptr<String> str) : _str(str) {}
+    namespace syms
+    {
+        const SymPtr self = symbol("self");
+        const SymPtr output_buffer = symbol("output_buffer");
+        const SymPtr to_proc = symbol("to_proc");
+        const SymPtr each = symbol("each");
+        const SymPtr each_byte = symbol("each_byte");
+        const SymPtr each_char = symbol("each_char");
+        const SymPtr each_codepoint = symbol("each_codepoint");
+        const SymPtr each_key = symbol("each_key");
+        const SymPtr each_line = symbol("each_line");
+        const SymPtr each_value = symbol("each_value");
+        const SymPtr reverse_each = symbol("reverse_each");
+        const SymPtr sort_by = symbol("sort_by");
+        const SymPtr step = symbol("step");
+        const SymPtr with_index = symbol("with_index");
+    }
+
+    Symbol::Symbol(Ptr<String> str) : _str(str), _id(next_symbol_id.fetch_add(1, std::memory_order_relaxed)) {}
     Symbol::~Symbol() {}
     std::string Symbol::to_string() const
     {
@@ -123,7 +253,7 @@ namespace slim
     }
     Ptr<Proc> Symbol::to_proc()
     {
-        auto this_ptr = std::dynamic_pointer_cast<Symbol>(shared_from_this());
+        auto this_ptr = object_pointer_cast<Symbol>(shared_from_this());
         auto &str = _str->get_value();
         if (str.size() == 1)
         {
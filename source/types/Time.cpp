@@ -367,7 +367,7 @@ namespace slim
 
             int month, day, hour, min, sec;
 
-            if (auto o_str = dynamic_cast<String*>(o_month))
+            if (auto o_str = object_cast<String>(o_month))
             {
                 auto &str = o_str->get_value();
                 if (str == "jan") month = 1;
@@ -428,7 +428,7 @@ namespace slim
                     throw ArgumentError(err);
                 return (str[0] - '0') * 10 + (str[1] - '0');
             };
-            if (auto n = dynamic_cast<Number*>(o))
+            if (auto n = object_cast<Number>(o))
             {
                 return (int)n->get_value();
             }
@@ -551,7 +551,7 @@ namespace slim
     }
     ObjectPtr Time::sub(Object *rhs)
     {
-        if (auto num = dynamic_cast<Number*>(rhs))
+        if (auto num = object_cast<Number>(rhs))
         {
             return create_object<Time>(v - (time_t)num->get_value()*TICKS_SECOND);
         }
@@ -5,6 +5,7 @@
 #include "types/Symbol.hpp"
 #include "Function.hpp"
 #include "FunctionHelpers.hpp"
+#include "RenderDependencies.hpp"
 
 namespace slim
 {
@@ -21,16 +22,28 @@ namespace slim
         return table;
     }
 
+    void ViewModel::share_refs()
+    {
+        // Values are already shared as they are stored, but this model may have been created
+        // during the render with values stored by a subclass directly.
+        for (auto &i : attrs) if (i.second) i.second->share();
+        for (auto &i : constants) if (i.second) i.second->share();
+        for (auto &i : content_for_store) if (i.second) i.second->share();
+        if (main_content) main_content->share();
+    }
 
     ObjectPtr ViewModel::get_constant(SymPtr name)
     {
         auto it = constants.find(name);
-        if (it != constants.end()) return it->second;
-        else throw NoConstantError(this, name);
+        if (it == constants.end()) throw NoConstantError(this, name);
+        if (auto deps = RenderDependencies::current())
+            deps->read(this, RenderDependencies::CONSTANT, name, it->second.get());
+        return it->second;
     }
 
     void ViewModel::add_constant(SymPtr name, ObjectPtr constant)
     {
+        if (constant) constant->share();
         constants[name] = constant;
     }
     void ViewModel::add_constant(const std::string &name, ObjectPtr constant)
@@ -42,11 +55,16 @@ namespace slim
     ObjectPtr ViewModel::get_attr(SymPtr name)
     {
         auto it = attrs.find(name);
-        return it != attrs.end() ? it->second : NIL_VALUE;
+        auto value = it != attrs.end() ? it->second : NIL_VALUE;
+        if (auto deps = RenderDependencies::current())
+            deps->read(this, RenderDependencies::ATTR, name, value.get());
+        return value;
     }
 
     void ViewModel::set_attr(SymPtr name, ObjectPtr value)
     {
+        // The model may outlive the render, and be used on other threads
+        if (value) value->share();
         attrs[name] = value;
     }
     void ViewModel::set_attr(const std::string &name, ObjectPtr value)
@@ -54,13 +72,17 @@ namespace slim
         set_attr(symbol(name), value);
     }
 
-    void ViewModel::content_for(SymPtr name, std::shared_ptr<Proc> proc)
+    void ViewModel::content_for(SymPtr name, Ptr<Proc> proc)
     {
-        content_for_store[name] = proc->call({});
+        RenderDependencies::uncacheable(); // Output is also stored in the model
+        auto content = proc->call({});
+        content->share();
+        content_for_store[name] = content;
     }
 
-    std::shared_ptr<HtmlSafeString> ViewModel::yield(const FunctionArgs &args)
+    Ptr<HtmlSafeString> ViewModel::yield(const FunctionArgs &args)
     {
+        RenderDependencies::uncacheable(); // Content is not an attribute
         SymPtr name;
         unpack<0>(args, &name);
         if (!name)
@@ -74,8 +96,9 @@ namespace slim
             else return create_object<HtmlSafeString>();
         }
     }
-    void ViewModel::set_main_content(std::shared_ptr<HtmlSafeString> content)
+    void ViewModel::set_main_content(Ptr<HtmlSafeString> content)
     {
+        if (content) content->share();
         main_content = content;
     }
 }
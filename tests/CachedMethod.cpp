@@ -0,0 +1,59 @@
+#include <boost/test/unit_test.hpp>
+#include "CachedMethod.hpp"
+#include "Template.hpp"
+#include "Value.hpp"
+#include "types/Array.hpp"
+#include "types/Hash.hpp"
+#include "types/ViewModel.hpp"
+
+using namespace slim;
+BOOST_AUTO_TEST_SUITE(TestCachedMethod)
+
+BOOST_AUTO_TEST_CASE(polymorphic)
+{
+    auto to_s = symbol("to_s");
+    std::vector<ObjectPtr> values = {
+        make_value(5.0), make_value("str"), make_array({}), create_object<Hash>(),
+        NIL_VALUE, TRUE_VALUE, symbol("sym") };
+    CachedMethod cache;
+    CachedMethod::set_count_hits(true);
+    for (int i = 0; i < 3; ++i)
+    {
+        for (auto &value : values)
+        {
+            auto method = cache.get(value.get(), to_s);
+            BOOST_REQUIRE(method);
+            BOOST_CHECK_EQUAL(value->to_string(), (*method)(value.get(), {})->to_string());
+        }
+    }
+    CachedMethod::set_count_hits(false);
+    auto stats = cache.stats();
+    size_t entries = CachedMethod::ENTRIES;
+    BOOST_CHECK_EQUAL(entries, stats.types);
+    BOOST_CHECK_EQUAL(entries, stats.misses);
+    BOOST_CHECK_EQUAL(entries * 2, stats.hits);
+    BOOST_CHECK_EQUAL((values.size() - entries) * 3, stats.megamorphic);
+
+    // Hits are not counted by default
+    cache.get(values[0].get(), to_s);
+    BOOST_CHECK_EQUAL(stats.hits, cache.stats().hits);
+}
+
+BOOST_AUTO_TEST_CASE(template_stats)
+{
+    auto tpl = parse_template(
+        "- @items.each do |x|\n"
+        "  = x.to_s\n");
+    auto model = create_view_model();
+    model->set_attr("items", make_array({make_value(1.0), make_value("a"), make_value(2.0)}));
+    for (auto mode : {Template::EXEC_VM, Template::EXEC_TREE})
+    {
+        tpl.set_exec_mode(mode);
+        tpl.render(model);
+    }
+    auto stats = tpl.method_cache_stats();
+    BOOST_CHECK(stats.find(" to_s: hits 0, misses 2, megamorphic 0, types 2\n") != std::string::npos);
+    BOOST_CHECK(stats.find("x.to_s(): hits 0, misses 2, megamorphic 0, types 2\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
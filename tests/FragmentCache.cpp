@@ -0,0 +1,174 @@
+#include <boost/test/unit_test.hpp>
+#include "FragmentCache.hpp"
+#include "MemoizingRenderer.hpp"
+#include "Template.hpp"
+#include "template/BinaryFormat.hpp"
+#include "template/Optimizer.hpp"
+#include "template/TemplatePart.hpp"
+#include "types/ViewModel.hpp"
+#include "Error.hpp"
+#include "Value.hpp"
+#include "TestAccumulator.hpp"
+#include <thread>
+
+using namespace slim;
+BOOST_AUTO_TEST_SUITE(TestFragmentCache)
+
+namespace
+{
+    const Template::ExecMode MODES[] = {Template::EXEC_TREE, Template::EXEC_VM};
+}
+
+BOOST_AUTO_TEST_CASE(store)
+{
+    LruFragmentStore::Options options;
+    options.shards = 1;
+    options.max_bytes = 32;
+    LruFragmentStore store(options);
+    std::string fragment;
+    BOOST_CHECK(!store.get("a", &fragment));
+    store.put("a", "<p>a</p>"); // 9 bytes
+    store.put("b", "<p>b</p>");
+    store.put("c", "<p>c</p>");
+    BOOST_CHECK(store.get("a", &fragment));
+    BOOST_CHECK_EQUAL("<p>a</p>", fragment);
+    store.put("d", "<p>d</p>"); // evicts b, the least recently used
+    BOOST_CHECK(!store.get("b", &fragment));
+    BOOST_CHECK(store.get("c", &fragment));
+    store.put("c", "<p>C</p>");
+    BOOST_CHECK(store.get("c", &fragment));
+    BOOST_CHECK_EQUAL("<p>C</p>", fragment);
+    store.put("big", std::string(40, 'x')); // larger than the store
+    BOOST_CHECK(!store.get("big", &fragment));
+
+    auto stats = store.stats();
+    BOOST_CHECK_EQUAL(3U, stats.hits);
+    BOOST_CHECK_EQUAL(3U, stats.misses);
+    BOOST_CHECK_EQUAL(1U, stats.evictions);
+    BOOST_CHECK_EQUAL(3U, stats.entries);
+    BOOST_CHECK_EQUAL(27U, stats.bytes);
+
+    auto keys = store.key_stats();
+    BOOST_REQUIRE_EQUAL(4U, keys.size());
+    BOOST_CHECK_EQUAL("c", keys[0].key);
+    BOOST_CHECK_EQUAL(2U, keys[0].hits);
+    BOOST_CHECK_EQUAL("a", keys[1].key);
+    BOOST_CHECK_EQUAL(1U, keys[1].hits);
+    BOOST_CHECK_EQUAL(1U, keys[1].misses);
+
+    store.put("c", std::string(40, 'x')); // replacing with a fragment too large to store
+    BOOST_CHECK(!store.get("c", &fragment));
+    BOOST_CHECK_EQUAL(2U, store.stats().entries);
+
+    store.clear();
+    BOOST_CHECK(!store.get("a", &fragment));
+    BOOST_CHECK_EQUAL(0U, store.stats().entries);
+    BOOST_CHECK_EQUAL(0U, store.stats().bytes);
+}
+
+BOOST_AUTO_TEST_CASE(ttl)
+{
+    LruFragmentStore::Options options;
+    options.ttl = std::chrono::milliseconds(50);
+    LruFragmentStore store(options);
+    std::string fragment;
+    store.put("a", "a");
+    BOOST_CHECK(store.get("a", &fragment));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BOOST_CHECK(!store.get("a", &fragment));
+    BOOST_CHECK_EQUAL(1U, store.stats().expirations);
+    BOOST_CHECK_EQUAL(0U, store.stats().entries);
+}
+
+BOOST_AUTO_TEST_CASE(cache_block)
+{
+    auto source =
+        "- cache [:item, @id] do\n"
+        "  p = @name\n"
+        "  ruby: @calls.store(1)\n"
+        "p = @name\n";
+    for (auto mode : MODES)
+    {
+        auto tpl = parse_template(source);
+        tpl.set_exec_mode(mode);
+        auto store = std::make_shared<LruFragmentStore>();
+        auto model = create_view_model();
+        auto calls = create_object<TestAccumulator>();
+        model->set_attr("calls", calls);
+        model->set_attr("id", make_value(1.0));
+        model->set_attr("name", make_value("<a>"));
+
+        // No store
+        BOOST_CHECK_EQUAL("<p>&lt;a&gt;</p><p>&lt;a&gt;</p>", tpl.render(model, false));
+        BOOST_CHECK_EQUAL(1U, calls->data.size());
+
+        tpl.set_fragment_store(store);
+        BOOST_CHECK_EQUAL("<p>&lt;a&gt;</p><p>&lt;a&gt;</p>", tpl.render(model, false));
+        model->set_attr("name", make_value("b"));
+        // The stored fragment, without evaluating the body
+        BOOST_CHECK_EQUAL("<p>&lt;a&gt;</p><p>b</p>", tpl.render(model, false));
+        BOOST_CHECK_EQUAL(2U, calls->data.size());
+        model->set_attr("id", make_value(2.0));
+        BOOST_CHECK_EQUAL("<p>b</p><p>b</p>", tpl.render(model, false));
+        BOOST_CHECK_EQUAL(3U, calls->data.size());
+
+        auto keys = store->key_stats();
+        BOOST_REQUIRE_EQUAL(2U, keys.size());
+        BOOST_CHECK(keys[0].key.find(":[:item, 1]") != std::string::npos);
+        BOOST_CHECK_EQUAL(1U, keys[0].hits);
+        BOOST_CHECK_EQUAL(1U, keys[0].misses);
+        BOOST_CHECK(keys[1].key.find(":[:item, 2]") != std::string::npos);
+
+        // A block with a different body does not share fragments
+        auto other = parse_template("- cache [:item, @id] do\n  p other\n");
+        other.set_exec_mode(mode);
+        other.set_fragment_store(store);
+        BOOST_CHECK_EQUAL("<p>other</p>", other.render(model, false));
+
+        model->set_attr("id", create_view_model());
+        BOOST_CHECK_THROW(tpl.render(model, false), TypeError);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(cache_block_structure)
+{
+    auto tpl = parse_template("- cache @id do\n  p = 1 + 2\n");
+    BOOST_CHECK_EQUAL(
+        "cache @id\n"
+        "  text \"<p>3</p>\"\n",
+        tpl::dump_tree(tpl.get_root()));
+    BOOST_CHECK(tpl.get_root().to_string().find("<% cache @id do %>") == 0);
+    BOOST_CHECK(tpl.disassemble().find("CACHE") != std::string::npos);
+
+    // Kept by the binary format
+    auto copy = tpl::binary::copy_tree(tpl.get_root());
+    BOOST_CHECK_EQUAL(tpl::dump_tree(tpl.get_root()), tpl::dump_tree(*copy));
+    auto data = save_template_binary(tpl);
+    auto loaded = load_template_binary(data.data(), data.size());
+    auto store = std::make_shared<LruFragmentStore>();
+    tpl.set_fragment_store(store);
+    loaded.set_fragment_store(store);
+    auto model = create_view_model();
+    tpl.render(model);
+    loaded.render(model);
+    BOOST_CHECK_EQUAL(1U, store->stats().hits);
+
+    BOOST_CHECK_THROW(parse_template("- cache @id\n  p x\n"), TemplateSyntaxError);
+    BOOST_CHECK_THROW(parse_template("- cache @id do |x|\n  p x\n"), TemplateSyntaxError);
+}
+
+BOOST_AUTO_TEST_CASE(memoized)
+{
+    // A fragment hit skips the reads of the body, so the render can not be memoized
+    auto tpl = std::make_shared<Template>(parse_template("- cache 1 do\n  p = @a\n"));
+    tpl->set_fragment_store(std::make_shared<LruFragmentStore>());
+    MemoizingRenderer renderer(tpl);
+    auto model = create_view_model();
+    model->set_attr("a", make_value("a"));
+    BOOST_CHECK_EQUAL("<p>a</p>", renderer.render(model, false));
+    model->set_attr("a", make_value("b"));
+    BOOST_CHECK_EQUAL("<p>a</p>", renderer.render(model, false));
+    BOOST_CHECK_EQUAL(1U, renderer.stats().uncacheable);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -45,7 +45,7 @@ BOOST_AUTO_TEST_CASE(try_unpack_arg_script_types)
     auto obj_b = make_value(55.5);
 
 
-    std::shared_ptr<Number> n_mem = make_value(40.0);
+    Ptr<Number> n_mem = make_value(40.0);
     auto n = n_mem.get();
     BOOST_CHECK_EQUAL(false, try_unpack_arg(obj_a, &n));
     BOOST_CHECK(n == n_mem.get());
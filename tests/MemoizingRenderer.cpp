@@ -0,0 +1,189 @@
+#include <boost/test/unit_test.hpp>
+#include "MemoizingRenderer.hpp"
+#include "Template.hpp"
+#include "types/Array.hpp"
+#include "types/Boolean.hpp"
+#include "types/ViewModel.hpp"
+#include "Value.hpp"
+
+using namespace slim;
+BOOST_AUTO_TEST_SUITE(TestMemoizingRenderer)
+
+namespace
+{
+    MemoizingRenderer::TemplatePtr make_template(const std::string &source, Template::ExecMode mode)
+    {
+        auto tpl = std::make_shared<Template>(parse_template(source));
+        tpl->set_exec_mode(mode);
+        return tpl;
+    }
+    const Template::ExecMode MODES[] = {Template::EXEC_TREE, Template::EXEC_VM};
+}
+
+BOOST_AUTO_TEST_CASE(dependencies)
+{
+    auto tpl = parse_template(
+        "- if @a\n"
+        "  p = @b\n"
+        "- else\n"
+        "  p = X\n"
+        "= to_s.size\n");
+    auto model = create_view_model();
+    model->set_attr("a", TRUE_VALUE);
+    model->set_attr("b", make_array({make_value(1.0), make_value("x")}));
+    model->add_constant("X", make_value(2.0));
+    auto other = create_view_model();
+    other->set_attr("a", TRUE_VALUE);
+    for (auto mode : MODES)
+    {
+        tpl.set_exec_mode(mode);
+        RenderDependencies deps(model.get());
+        {
+            RenderDependencies::Scope scope(deps);
+            tpl.render(model, false);
+            // Other models are not recorded
+            tpl.render(other, false);
+        }
+        BOOST_CHECK(!RenderDependencies::current());
+        auto &list = deps.dependencies();
+        BOOST_REQUIRE_EQUAL(3U, list.size());
+        BOOST_CHECK_EQUAL(RenderDependencies::ATTR, list[0].kind);
+        BOOST_CHECK_EQUAL("a", list[0].name->str());
+        BOOST_CHECK_EQUAL(RenderDependencies::ATTR, list[1].kind);
+        BOOST_CHECK_EQUAL("b", list[1].name->str());
+        BOOST_CHECK_EQUAL(RenderDependencies::CALL, list[2].kind);
+        BOOST_CHECK_EQUAL("to_s", list[2].name->str());
+        BOOST_CHECK(deps.is_cacheable());
+
+        std::string expected;
+        RenderDependencies::fingerprint(expected, TRUE_VALUE.get());
+        RenderDependencies::fingerprint(expected, model->get_attr(symbol("b")).get());
+        BOOST_CHECK(expected == deps.values());
+    }
+
+    std::string a, b;
+    BOOST_CHECK(RenderDependencies::fingerprint(a, make_value("1").get()));
+    BOOST_CHECK(RenderDependencies::fingerprint(b, make_value(1.0).get()));
+    BOOST_CHECK(a != b);
+    BOOST_CHECK(!RenderDependencies::fingerprint(a, create_view_model().get()));
+    BOOST_CHECK(!RenderDependencies::fingerprint(a, make_array({create_view_model()}).get()));
+}
+
+BOOST_AUTO_TEST_CASE(memoize)
+{
+    for (auto mode : MODES)
+    {
+        MemoizingRenderer renderer(make_template(
+            "- if @a\n"
+            "  p = @b\n"
+            "- else\n"
+            "  p = X\n", mode));
+        auto model = create_view_model();
+        model->set_attr("a", TRUE_VALUE);
+        model->set_attr("b", make_value("<b>"));
+        model->add_constant("X", make_value(2.0));
+
+        BOOST_CHECK_EQUAL("<!DOCTYPE html>\n<p>&lt;b&gt;</p>", renderer.render(model));
+        BOOST_CHECK_EQUAL("<p>&lt;b&gt;</p>", renderer.render(model, false));
+        model->set_attr("b", make_value("c"));
+        BOOST_CHECK_EQUAL("<p>c</p>", renderer.render(model, false));
+        // A different branch, so a different set of dependencies
+        model->set_attr("a", FALSE_VALUE);
+        BOOST_CHECK_EQUAL("<p>2</p>", renderer.render(model, false));
+        model->set_attr("b", make_value("ignored"));
+        BOOST_CHECK_EQUAL("<p>2</p>", renderer.render(model, false));
+        model->add_constant("X", make_value(3.0));
+        BOOST_CHECK_EQUAL("<p>3</p>", renderer.render(model, false));
+        // Other models with the same inputs
+        auto other = create_view_model();
+        other->set_attr("a", TRUE_VALUE);
+        other->set_attr("b", make_value("c"));
+        BOOST_CHECK_EQUAL("<p>c</p>", renderer.render(other, false));
+
+        auto stats = renderer.stats();
+        BOOST_CHECK_EQUAL(3U, stats.hits);
+        BOOST_CHECK_EQUAL(4U, stats.misses);
+        BOOST_CHECK_EQUAL(0U, stats.uncacheable);
+        BOOST_CHECK_EQUAL(4U, stats.entries);
+        BOOST_CHECK(stats.bytes > 0);
+
+        renderer.clear();
+        BOOST_CHECK_EQUAL("<p>c</p>", renderer.render(other, false));
+        BOOST_CHECK_EQUAL(5U, renderer.stats().misses);
+        BOOST_CHECK_EQUAL(1U, renderer.stats().entries);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(uncacheable)
+{
+    for (auto mode : MODES)
+    {
+        MemoizingRenderer::Options options;
+        options.impure_helpers = {"to_s"};
+        MemoizingRenderer renderer(make_template("- if @a\n  = to_s.size\n", mode), options);
+        auto model = create_view_model();
+        model->set_attr("a", TRUE_VALUE);
+        renderer.render(model);
+        renderer.render(model);
+        model->set_attr("a", FALSE_VALUE);
+        renderer.render(model);
+        renderer.render(model);
+        auto stats = renderer.stats();
+        BOOST_CHECK_EQUAL(1U, stats.hits);
+        BOOST_CHECK_EQUAL(3U, stats.misses);
+        BOOST_CHECK_EQUAL(2U, stats.uncacheable);
+
+        // Values that can not be fingerprinted
+        MemoizingRenderer obj_renderer(make_template("- if @obj\n  p x\n", mode));
+        model->set_attr("obj", create_view_model());
+        BOOST_CHECK_EQUAL("<p>x</p>", obj_renderer.render(model, false));
+        BOOST_CHECK_EQUAL("<p>x</p>", obj_renderer.render(model, false));
+        BOOST_CHECK_EQUAL(2U, obj_renderer.stats().uncacheable);
+
+        // content_for stores output in the model
+        MemoizingRenderer content_renderer(make_template("= content_for :head do\n  p x\n", mode));
+        content_renderer.render(model);
+        content_renderer.render(model);
+        BOOST_CHECK_EQUAL(2U, content_renderer.stats().uncacheable);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(max_bytes)
+{
+    MemoizingRenderer::Options options;
+    options.max_bytes = 200;
+    MemoizingRenderer renderer(make_template("p = @a\n", Template::EXEC_TREE), options);
+    auto model = create_view_model();
+    for (int i = 0; i < 20; ++i)
+    {
+        model->set_attr("a", make_value((double)i));
+        renderer.render(model);
+    }
+    auto stats = renderer.stats();
+    BOOST_CHECK(stats.bytes <= 200);
+    BOOST_CHECK(stats.entries > 1);
+    BOOST_CHECK_EQUAL(20U, stats.entries + stats.evictions);
+    // Most recent is still cached, oldest is not
+    renderer.render(model);
+    BOOST_CHECK_EQUAL(1U, renderer.stats().hits);
+    model->set_attr("a", make_value(0.0));
+    renderer.render(model);
+    BOOST_CHECK_EQUAL(1U, renderer.stats().hits);
+
+    // Larger than the cap
+    model->set_attr("a", make_value(std::string(300, 'x')));
+    BOOST_CHECK_EQUAL("<p>" + std::string(300, 'x') + "</p>", renderer.render(model, false));
+    renderer.render(model, false);
+    BOOST_CHECK_EQUAL(1U, renderer.stats().hits);
+    BOOST_CHECK(renderer.stats().bytes <= 200);
+
+    // The recorded inputs are counted, not just the output and values
+    renderer.clear();
+    model->set_attr("a", make_value("y"));
+    renderer.render(model, false); // "<p>y</p>"
+    BOOST_CHECK(renderer.stats().bytes > 8 + 1 + sizeof(RenderDependencies::Dependency));
+    renderer.clear();
+    BOOST_CHECK_EQUAL(0U, renderer.stats().bytes);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,182 @@
+#include <boost/test/unit_test.hpp>
+#include "RenderArena.hpp"
+#include "Template.hpp"
+#include "types/Array.hpp"
+#include "types/Hash.hpp"
+#include "types/HtmlSafeString.hpp"
+#include "types/String.hpp"
+#include "types/ViewModel.hpp"
+#include "Value.hpp"
+#include <thread>
+
+using namespace slim;
+BOOST_AUTO_TEST_SUITE(TestRenderArena)
+
+BOOST_AUTO_TEST_CASE(scope)
+{
+    BOOST_CHECK(!RenderArena::current());
+    {
+        RenderArena::Scope arena;
+        auto current = RenderArena::current();
+        BOOST_REQUIRE(current);
+        {
+            RenderArena::Scope nested;
+            BOOST_CHECK_EQUAL(current, RenderArena::current());
+            RenderArena::Suspend suspend;
+            BOOST_CHECK(!RenderArena::current());
+        }
+        BOOST_CHECK_EQUAL(current, RenderArena::current());
+        {
+            RenderArena::Scope disabled(false);
+            BOOST_CHECK_EQUAL(current, RenderArena::current());
+        }
+    }
+    BOOST_CHECK(!RenderArena::current());
+    RenderArena::Scope disabled(false);
+    BOOST_CHECK(!RenderArena::current());
+}
+
+BOOST_AUTO_TEST_CASE(allocate)
+{
+    RenderArena::Scope scope;
+    auto arena = RenderArena::current();
+    BOOST_CHECK_EQUAL(0U, arena->chunk_count());
+
+    auto a = make_value("a");
+    BOOST_CHECK_EQUAL(1U, arena->chunk_count());
+    FunctionArgs args = {a, a};
+    BOOST_CHECK(args.get_allocator().get_arena() == arena);
+
+    // Freed blocks are reused
+    auto b = make_value("b");
+    auto p = b.get();
+    b.reset();
+    auto c = make_value("c");
+    BOOST_CHECK_EQUAL(p, c.get());
+
+    // Large allocations use the heap
+    std::vector<int, RenderAllocator<int>> large(10000, 5);
+    BOOST_CHECK_EQUAL(1U, arena->chunk_count());
+
+    std::vector<ObjectPtr> objects;
+    for (int i = 0; i < 10000; ++i) objects.push_back(make_value((double)i));
+    BOOST_CHECK(arena->chunk_count() > 1);
+    BOOST_CHECK_EQUAL(9999.0, as_number(objects.back()));
+}
+
+BOOST_AUTO_TEST_CASE(escape)
+{
+    // Objects that outlive the arena scope stay valid
+    ObjectPtr str, arr;
+    {
+        RenderArena::Scope scope;
+        str = make_value("escaped");
+        arr = make_array({str, make_value(5.0)});
+    }
+    BOOST_CHECK(!RenderArena::current());
+    BOOST_CHECK_EQUAL("[\"escaped\", 5]", arr->inspect());
+
+    // Including when released on another thread
+    std::thread thread([&] { arr.reset(); });
+    thread.join();
+    BOOST_CHECK_EQUAL("escaped", str->to_string());
+    str.reset();
+}
+
+BOOST_AUTO_TEST_CASE(render)
+{
+    auto tpl = parse_template(
+        "= content_for :head do\n"
+        "  title = @title\n"
+        "ul\n"
+        "  - @items.each do |item|\n"
+        "    li = \"#{item} #{[item, item * 2].map { |x| x + 1 }}\"\n");
+    BOOST_CHECK(!tpl.get_render_arena());
+    auto create_model = [] {
+        auto model = create_view_model();
+        model->set_attr("title", make_value("Title"));
+        model->set_attr("items", make_array({make_value(1.0), make_value(2.0)}));
+        return model;
+    };
+    auto model = create_model();
+    auto expected = tpl.render(model);
+    auto expected_head = model->yield({symbol("head")})->to_string();
+
+    tpl.set_render_arena(true);
+    for (auto mode : {Template::EXEC_VM, Template::EXEC_TREE})
+    {
+        tpl.set_exec_mode(mode);
+        model = create_model();
+        BOOST_CHECK_EQUAL(expected, tpl.render(model));
+        // content_for output was stored in the ViewModel, and outlives the render
+        BOOST_CHECK_EQUAL(expected_head, model->yield({symbol("head")})->to_string());
+        BOOST_CHECK(model->yield({symbol("head")})->is_shared());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(long_lived)
+{
+    RenderArena::Scope scope;
+    auto arena = RenderArena::current();
+    // Templates loaded during a render do not use the arena
+    auto tpl = parse_template("p = 'literal'\np = [1, 'two'].size + 1\n");
+    auto data = save_template_binary(tpl);
+    auto copy = load_template_binary(data.data(), data.size());
+    ViewModelPtr constants;
+    {
+        RenderArena::Suspend suspend;
+        constants = create_view_model();
+    }
+    auto specialized = specialize_template(tpl, constants);
+    BOOST_CHECK_EQUAL(0U, arena->chunk_count());
+
+    // Values stored in a model may be used on other threads
+    auto value = make_value("value");
+    BOOST_CHECK(!value->is_shared());
+    auto model = create_view_model();
+    model->set_attr("value", value);
+    BOOST_CHECK(value->is_shared());
+    BOOST_CHECK_EQUAL("<p>literal</p><p>3</p>", specialized.render(model, false));
+}
+
+BOOST_AUTO_TEST_CASE(shared_nested)
+{
+    ViewModelPtr model;
+    {
+        RenderArena::Suspend suspend;
+        model = create_view_model();
+    }
+    Ptr<String> str;
+    Ptr<Array> inner;
+    Ptr<Hash> hash;
+    {
+        // Built during a render, e.g. by a helper, then stored in the model
+        RenderArena::Scope scope;
+        str = make_value("nested");
+        inner = make_array({str, make_value(2.0)});
+        hash = make_hash({make_value("key"), inner});
+        model->set_attr("value", make_array({inner, hash}));
+    }
+    BOOST_CHECK(str->is_shared());
+    BOOST_CHECK(inner->is_shared());
+    BOOST_CHECK(hash->is_shared());
+    BOOST_CHECK(inner->get_value()[1]->is_shared());
+
+    // Both threads add and remove references to the nested objects
+    auto read = [&] {
+        for (int i = 0; i < 10000; ++i)
+        {
+            auto value = coerce<Array>(model->get_attr(symbol("value")));
+            auto first = coerce<Array>(value->get_value()[0]);
+            ObjectPtr elements[] = {first->get_value()[0], first->get_value()[1], value->get_value()[1]};
+        }
+    };
+    std::thread a(read), b(read);
+    a.join();
+    b.join();
+    BOOST_CHECK_EQUAL(
+        "[[\"nested\", 2], {\"key\" => [\"nested\", 2]}]",
+        model->get_attr(symbol("value"))->inspect());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,99 @@
+#include <boost/test/unit_test.hpp>
+#include "SmallVector.hpp"
+#include "Value.hpp"
+#include <string>
+
+using namespace slim;
+BOOST_AUTO_TEST_SUITE(TestSmallVector)
+
+BOOST_AUTO_TEST_CASE(inline_storage)
+{
+    SmallVector<std::string, 2> v;
+    BOOST_CHECK(v.empty());
+    BOOST_CHECK(v.is_inline());
+    v.push_back("a");
+    v.push_back("b");
+    BOOST_CHECK(v.is_inline());
+    BOOST_CHECK_EQUAL(2U, v.capacity());
+
+    v.push_back(v[0]); // Refers to an element that moves
+    BOOST_CHECK(!v.is_inline());
+    BOOST_REQUIRE_EQUAL(3U, v.size());
+    BOOST_CHECK_EQUAL("a", v[0]);
+    BOOST_CHECK_EQUAL("b", v[1]);
+    BOOST_CHECK_EQUAL("a", v.back());
+
+    v.pop_back();
+    v.pop_back();
+    BOOST_CHECK_EQUAL(1U, v.size());
+    v.clear();
+    BOOST_CHECK(v.empty());
+
+    SmallVector<std::string, 4> reserved;
+    reserved.reserve(4);
+    BOOST_CHECK(reserved.is_inline());
+    reserved.reserve(5);
+    BOOST_CHECK(!reserved.is_inline());
+    BOOST_CHECK_THROW(reserved.at(0), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(insert_erase)
+{
+    SmallVector<int, 4> v = {1, 2, 3};
+    int more[] = {10, 11, 12};
+    v.insert(v.begin() + 1, more, more + 3);
+    BOOST_CHECK((v == SmallVector<int, 4>{1, 10, 11, 12, 2, 3}));
+    v.insert(v.end(), 4);
+    v.erase(v.begin(), v.begin() + 2);
+    BOOST_CHECK((v == SmallVector<int, 4>{11, 12, 2, 3, 4}));
+    v.erase(v.begin() + 1);
+    BOOST_CHECK((v == SmallVector<int, 4>{11, 2, 3, 4}));
+    v.resize(2);
+    BOOST_CHECK((v == SmallVector<int, 4>{11, 2}));
+    v.resize(5, 7);
+    BOOST_CHECK((v == SmallVector<int, 4>{11, 2, 7, 7, 7}));
+
+    SmallVector<int, 4> range(v.begin() + 1, v.end() - 1);
+    BOOST_CHECK((range == SmallVector<int, 4>{2, 7, 7}));
+
+    // A range within the vector, that moves when it grows
+    SmallVector<std::string, 2> self = {"a", "b"};
+    self.insert(self.end(), self.begin(), self.end());
+    BOOST_CHECK((self == SmallVector<std::string, 2>{"a", "b", "a", "b"}));
+    self.insert(self.begin() + 1, self.begin(), self.begin() + 3);
+    BOOST_CHECK((self == SmallVector<std::string, 2>{"a", "a", "b", "a", "b", "a", "b"}));
+}
+
+BOOST_AUTO_TEST_CASE(copy_move)
+{
+    auto obj = make_value("x");
+    {
+        FunctionArgs a = {obj, obj};
+        BOOST_CHECK_EQUAL(3, obj.use_count());
+        FunctionArgs b = a;
+        BOOST_CHECK_EQUAL(5, obj.use_count());
+        FunctionArgs c = std::move(a); // Inline elements are moved individually
+        BOOST_CHECK(a.empty());
+        BOOST_CHECK_EQUAL(5, obj.use_count());
+
+        for (int i = 0; i < 4; ++i) c.push_back(obj);
+        BOOST_CHECK(!c.is_inline());
+        auto data = c.data();
+        FunctionArgs d = std::move(c); // Allocated storage is taken
+        BOOST_CHECK_EQUAL(data, d.data());
+        BOOST_CHECK(c.empty());
+        BOOST_CHECK(c.is_inline());
+
+        b = d;
+        BOOST_CHECK_EQUAL(13, obj.use_count());
+        d = std::move(c);
+        BOOST_CHECK(d.empty());
+        BOOST_CHECK_EQUAL(7, obj.use_count());
+        b.swap(d);
+        BOOST_CHECK(b.empty());
+        BOOST_CHECK_EQUAL(6U, d.size());
+    }
+    BOOST_CHECK_EQUAL(1, obj.use_count());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,182 @@
+#include <boost/test/unit_test.hpp>
+#include "TemplateRegistry.hpp"
+#include "template/Template.hpp"
+#include "types/ViewModel.hpp"
+#include "Error.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdlib.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace slim;
+BOOST_AUTO_TEST_SUITE(TestTemplateRegistry)
+
+namespace
+{
+    /**Temporary template directory, removed on destruction.*/
+    struct TempDir
+    {
+        std::string path;
+        std::vector<std::string> files;
+        TempDir()
+        {
+            char buf[] = "/tmp/slim_registry_XXXXXX";
+            BOOST_REQUIRE(mkdtemp(buf));
+            path = buf;
+        }
+        ~TempDir()
+        {
+            for (auto &file : files) remove(file.c_str());
+            rmdir(path.c_str());
+        }
+        /**Write a file, replacing it by rename like many editors do.*/
+        void write(const std::string &name, const std::string &content)
+        {
+            auto file = path + "/" + name;
+            auto tmp = path + "/.tmp";
+            {
+                std::ofstream os(tmp, std::ios::binary);
+                os << content;
+            }
+            BOOST_REQUIRE(rename(tmp.c_str(), file.c_str()) == 0);
+            if (std::find(files.begin(), files.end(), file) == files.end()) files.push_back(file);
+        }
+    };
+    std::string render(const TemplateRegistry::TemplatePtr &tpl)
+    {
+        return tpl->render(create_view_model(), false);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(get)
+{
+    TempDir dir;
+    dir.write("index.html.slim", "p index");
+    TemplateRegistry::Options options;
+    options.watch = false;
+    options.check_interval = std::chrono::milliseconds(-1);
+    TemplateRegistry registry(dir.path, options);
+    BOOST_CHECK(!registry.is_watching());
+
+    auto a = registry.get("index");
+    BOOST_CHECK_EQUAL("<p>index</p>", render(a));
+    auto b = registry.get("index");
+    BOOST_CHECK_EQUAL(a.get(), b.get());
+    BOOST_CHECK_THROW(registry.get("missing"), std::runtime_error);
+    // Still loaded once it exists
+    dir.write("missing.html.slim", "p found");
+    BOOST_CHECK_EQUAL("<p>found</p>", render(registry.get("missing")));
+
+    auto stats = registry.stats();
+    BOOST_CHECK_EQUAL(1U, stats.hits);
+    BOOST_CHECK_EQUAL(2U, stats.misses);
+    BOOST_CHECK_EQUAL(0U, stats.reloads);
+}
+
+BOOST_AUTO_TEST_CASE(names)
+{
+    TempDir dir;
+    dir.write("index.html.slim", "p index");
+    TemplateRegistry::Options options;
+    options.watch = false;
+    TemplateRegistry registry(dir.path + "/", options);
+    BOOST_CHECK_EQUAL("<p>index</p>", render(registry.get("./index")));
+    BOOST_CHECK_THROW(registry.get("../index"), std::runtime_error);
+    BOOST_CHECK_THROW(registry.get("a/../../index"), std::runtime_error);
+    BOOST_CHECK_THROW(registry.get("a/.."), std::runtime_error);
+    BOOST_CHECK_THROW(registry.get("a\\..\\index"), std::runtime_error);
+    BOOST_CHECK_THROW(registry.get(dir.path + "/index"), std::runtime_error);
+    BOOST_CHECK_EQUAL(1U, registry.stats().misses);
+}
+
+BOOST_AUTO_TEST_CASE(refresh)
+{
+    TempDir dir;
+    dir.write("index.html.slim", "p version 1");
+    TemplateRegistry::Options options;
+    options.watch = false;
+    options.check_interval = std::chrono::milliseconds(-1);
+    TemplateRegistry registry(dir.path, options);
+
+    auto old_tpl = registry.get("index");
+    BOOST_CHECK_EQUAL(0U, registry.refresh());
+
+    dir.write("index.html.slim", "p version 2 with a different size");
+    BOOST_CHECK_EQUAL(1U, registry.refresh());
+    // Holders of the old version are unaffected
+    BOOST_CHECK_EQUAL("<p>version 1</p>", render(old_tpl));
+    BOOST_CHECK_EQUAL("<p>version 2 with a different size</p>", render(registry.get("index")));
+
+    // Invalid change keeps the previous version
+    dir.write("index.html.slim", "p = (");
+    BOOST_CHECK_EQUAL(0U, registry.refresh());
+    BOOST_CHECK_EQUAL("<p>version 2 with a different size</p>", render(registry.get("index")));
+
+    auto stats = registry.stats();
+    BOOST_CHECK_EQUAL(1U, stats.reloads);
+    BOOST_CHECK_EQUAL(1U, stats.reload_errors);
+}
+
+BOOST_AUTO_TEST_CASE(check_interval)
+{
+    TempDir dir;
+    dir.write("index.html.slim", "p version 1");
+    TemplateRegistry::Options options;
+    options.watch = false;
+    options.check_interval = std::chrono::milliseconds(0);
+    TemplateRegistry registry(dir.path, options);
+
+    BOOST_CHECK_EQUAL("<p>version 1</p>", render(registry.get("index")));
+    dir.write("index.html.slim", "p version 2 with a different size");
+    BOOST_CHECK_EQUAL("<p>version 2 with a different size</p>", render(registry.get("index")));
+    BOOST_CHECK_EQUAL(1U, registry.stats().reloads);
+}
+
+#ifdef __linux__
+BOOST_AUTO_TEST_CASE(watch)
+{
+    TempDir dir;
+    dir.write("index.html.slim", "p version 1");
+    TemplateRegistry registry(dir.path);
+    BOOST_CHECK(registry.is_watching());
+
+    BOOST_CHECK_EQUAL("<p>version 1</p>", render(registry.get("index")));
+    dir.write("index.html.slim", "p version 2 with a different size");
+    std::string html;
+    for (int i = 0; i < 200; ++i)
+    {
+        html = render(registry.get("index"));
+        if (html != "<p>version 1</p>") break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK_EQUAL("<p>version 2 with a different size</p>", html);
+    BOOST_CHECK_EQUAL(1U, registry.stats().reloads);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(threads)
+{
+    TempDir dir;
+    dir.write("index.html.slim", "p index");
+    TemplateRegistry registry(dir.path);
+    std::vector<std::thread> threads;
+    std::atomic<int> errors(0);
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 100; ++j)
+            {
+                if (render(registry.get("index")) != "<p>index</p>") ++errors;
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    BOOST_CHECK_EQUAL(0, errors.load());
+    auto stats = registry.stats();
+    BOOST_CHECK_EQUAL(400U, stats.hits + stats.misses);
+    BOOST_CHECK_EQUAL(1U, stats.misses);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,5 +1,9 @@
 #include <boost/test/unit_test.hpp>
 #include "Util.hpp"
+#include "HtmlEscape.hpp"
+#include "types/HtmlSafeString.hpp"
+#include "types/Number.hpp"
+#include "Value.hpp"
 
 BOOST_AUTO_TEST_SUITE(TestUtil)
 
@@ -10,4 +14,75 @@ BOOST_AUTO_TEST_CASE(html_escape)
         slim::html_escape("& < > \" '"));
 }
 
+namespace
+{
+    std::string reference_escape(const std::string &str)
+    {
+        std::string buf;
+        for (auto c : str)
+        {
+            switch (c)
+            {
+            case '&': buf += "&amp;"; break;
+            case '<': buf += "&lt;"; break;
+            case '>': buf += "&gt;"; break;
+            case '"': buf += "&quot;"; break;
+            case '\'': buf += "&#39;"; break;
+            default: buf += c; break;
+            }
+        }
+        return buf;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(html_escape_impls)
+{
+    std::vector<std::pair<const char*, slim::detail::HtmlEscapeFunc>> impls = {
+        { "scalar", &slim::detail::html_escape_append_scalar },
+        { "sse2", slim::detail::html_escape_sse2() },
+        { "avx2", slim::detail::html_escape_avx2() }
+    };
+    //Lengths around the 16 and 32 byte block sizes, with special characters at every position
+    const std::string specials = "&<>\"'";
+    std::vector<std::string> inputs = { "", "a", "&", "plain text with no special characters at all" };
+    for (size_t len = 1; len <= 70; ++len)
+    {
+        for (size_t pos = 0; pos < len; ++pos)
+        {
+            std::string str(len, 'x');
+            str[pos] = specials[(len + pos) % specials.size()];
+            inputs.push_back(str);
+        }
+        std::string all;
+        for (size_t i = 0; i < len; ++i) all += specials[i % specials.size()];
+        inputs.push_back(all);
+    }
+    //Bytes that are not ASCII, or are near the special characters
+    const char bytes[] = "\xFF\x80\x25\x27\x3B\x3C\x3D\x3E\x3F\x21\x22\x23\x26\x00\xA6\xBC\xBE and \xE2\x82\xAC <b>";
+    inputs.emplace_back(bytes, sizeof(bytes) - 1);
+
+    for (auto &impl : impls)
+    {
+        if (!impl.second) continue;
+        BOOST_TEST_CONTEXT(impl.first)
+        {
+            for (auto &input : inputs)
+            {
+                std::string out = "prefix";
+                impl.second(out, input.data(), input.size());
+                BOOST_CHECK_EQUAL("prefix" + reference_escape(input), out);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(html_escape_append_object)
+{
+    std::string out;
+    slim::html_escape_append(out, slim::make_value("<a>").get());
+    slim::html_escape_append(out, slim::create_object<slim::HtmlSafeString>("<b>").get());
+    slim::html_escape_append(out, slim::make_value(5.0).get());
+    BOOST_CHECK_EQUAL("&lt;a&gt;<b>5", out);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
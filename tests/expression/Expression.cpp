@@ -64,6 +64,37 @@ BOOST_AUTO_TEST_CASE(variables)
     BOOST_CHECK_THROW(eval("unset", scope), NoMethodError); //not a variable, so considered a function
 }
 
+BOOST_AUTO_TEST_CASE(scope_slots)
+{
+    Scope root(create_view_model());
+    root.set(1, symbol("a"), make_value(1.0));
+    BOOST_CHECK_EQUAL(1.0, as_number(root.get(0, 1, symbol("a"))));
+    BOOST_CHECK_EQUAL(1.0, as_number(root.get(symbol("a"))));
+
+    Scope block(root, {symbol("x"), symbol("a")});
+    block.set(0, symbol("x"), make_value(2.0));
+    // "a" has a slot in block, but is not yet assigned
+    BOOST_CHECK_EQUAL(1.0, as_number(block.get(0, 1, symbol("a"))));
+    BOOST_CHECK_EQUAL(1.0, as_number(block.get(1, 1, symbol("a"))));
+    block.set(1, symbol("a"), make_value(3.0));
+    BOOST_CHECK_EQUAL(3.0, as_number(block.get(0, 1, symbol("a"))));
+    BOOST_CHECK_EQUAL(3.0, as_number(block.get(symbol("a"))));
+    BOOST_CHECK_EQUAL(1.0, as_number(root.get(symbol("a"))));
+
+    // Slots that do not match, such as for variables set by name, fall back to the name
+    Scope shadow(block);
+    shadow.set(symbol("x"), make_value(4.0));
+    BOOST_CHECK_EQUAL(4.0, as_number(shadow.get(1, 0, symbol("x"))));
+    BOOST_CHECK_EQUAL(3.0, as_number(shadow.get(0, 0, symbol("a"))));
+    BOOST_CHECK_EQUAL(2.0, as_number(block.get(5, 0, symbol("x"))));
+    BOOST_CHECK_THROW(block.get(0, 0, symbol("missing")), std::runtime_error);
+
+    // More variables than are stored inline
+    for (int i = 0; i < 10; ++i) block.set((uint32_t)i + 2, symbol("v" + std::to_string(i)), make_value((double)i));
+    for (int i = 0; i < 10; ++i) BOOST_CHECK_EQUAL((double)i, as_number(block.get(0, (uint32_t)i + 2, symbol("v" + std::to_string(i)))));
+    BOOST_CHECK_EQUAL(2.0, as_number(block.get(0, 0, symbol("x"))));
+}
+
 BOOST_AUTO_TEST_CASE(operators)
 {
     //unary
@@ -370,5 +370,39 @@ BOOST_AUTO_TEST_CASE(statement)
     BOOST_CHECK_EQUAL("a = @x.foo(6)", parse_stmt("a = @x.foo 6"));
 }
 
+BOOST_AUTO_TEST_CASE(variable_slots)
+{
+    LocalVarNames vars;
+    vars.add("a");
+    vars.add("b");
+    vars.begin_frame();
+    vars.add("x");
+    vars.add("a");
+    vars.add("a");
+    auto var = [&](const std::string &src) -> std::pair<uint32_t, uint32_t>
+    {
+        Lexer lexer(src);
+        Parser parser(vars, lexer);
+        auto node = parser.full_expression();
+        auto v = dynamic_cast<Variable*>(node.get());
+        BOOST_REQUIRE(v);
+        return {v->depth, v->slot};
+    };
+    BOOST_CHECK(var("x") == std::make_pair(0U, 0U));
+    BOOST_CHECK(var("a") == std::make_pair(0U, 1U)); // inner "a" shadows the outer one
+    BOOST_CHECK(var("b") == std::make_pair(1U, 2U));
+    BOOST_CHECK(var("self") == std::make_pair(1U, 0U));
+    BOOST_CHECK(vars.frame_layout() == (std::vector<SymPtr>{symbol("x"), symbol("a")}));
+
+    // Assignments are always to the current frame
+    std::string src = "b = 5";
+    Lexer lexer(src);
+    Parser parser(vars, lexer);
+    auto node = parser.statement();
+    auto assign = dynamic_cast<Assignment*>(node.get());
+    BOOST_REQUIRE(assign);
+    BOOST_CHECK_EQUAL(2U, assign->slot);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,96 @@
+#include <boost/test/unit_test.hpp>
+#include "Template.hpp"
+#include "template/CppGenerator.hpp"
+#include "types/Array.hpp"
+#include "types/Hash.hpp"
+#include "types/HtmlSafeString.hpp"
+#include "types/ViewModel.hpp"
+#include "Error.hpp"
+#include "Value.hpp"
+#include <fstream>
+#include <sstream>
+
+// Generated by slimc, see slim_compile_templates in CMakeLists.txt
+#include "page.html.hpp"
+#include "layout.html.hpp"
+
+using namespace slim;
+BOOST_AUTO_TEST_SUITE(TestAot)
+
+namespace
+{
+    std::string read_template(const std::string &name)
+    {
+        std::ifstream is(std::string(SLIM_SOURCE_DIR "/tests/template/aot/") + name, std::ios::binary);
+        std::stringstream ss;
+        ss << is.rdbuf();
+        return ss.str();
+    }
+
+    ObjectPtr make_item(double id, const std::string &name, double price, std::vector<ObjectPtr> &&tags)
+    {
+        return make_hash({
+            symbol("id"), make_value(id),
+            symbol("name"), make_value(name),
+            symbol("price"), make_value(price),
+            symbol("tags"), make_array(std::move(tags))});
+    }
+    ViewModelPtr create_model(std::vector<ObjectPtr> &&items)
+    {
+        auto model = create_view_model();
+        model->set_attr("title", make_value("Test Page <1>"));
+        model->set_attr("heading_class", make_value("big"));
+        model->set_attr("items", make_array(std::move(items)));
+        return model;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(generated)
+{
+    auto tpl = parse_template(read_template("page.html.slim"));
+    std::vector<ViewModelPtr> models = {
+        create_model({}),
+        create_model({
+            make_item(1, "First & best", 75, {make_value("new"), make_value("<hot>")}),
+            make_item(2, "Second", 20, {})})
+    };
+    for (auto &model : models)
+    {
+        // Built with TEST, so also throws if different to the tree walking interpreter
+        auto expected = tpl.render(model);
+        BOOST_CHECK_EQUAL(expected, aot_tests::render_page(model));
+        BOOST_CHECK_EQUAL(expected, aot_tests::render_page(model, true));
+        BOOST_CHECK_EQUAL(tpl.render(model, false), aot_tests::render_page(model, false));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(layout)
+{
+    auto model = create_model({make_item(1, "Item", 5, {})});
+    auto view = parse_template(read_template("page.html.slim"));
+    auto layout = parse_template(read_template("layout.html.slim"));
+    auto expected = view.render_layout(layout, model);
+
+    model = create_model({make_item(1, "Item", 5, {})});
+    model->set_main_content(create_object<HtmlSafeString>(aot_tests::render_page(model, false)));
+    BOOST_CHECK_EQUAL(expected, aot_tests::render_layout(model));
+}
+
+BOOST_AUTO_TEST_CASE(generate_cpp)
+{
+    tpl::CppOptions options;
+    options.function_name = "render_test";
+    options.name_space = "views";
+    auto tpl = parse_template("p Hello \"world\"\n- if @x\n  p = @x\n");
+    auto cpp = tpl::generate_cpp(tpl, "", options);
+    BOOST_CHECK(cpp.find("namespace views") != std::string::npos);
+    BOOST_CHECK(cpp.find("std::string render_test(slim::ViewModelPtr model, bool doctype)") != std::string::npos);
+    BOOST_CHECK(cpp.find("buffer.append_static(\"<p>Hello \\\"world\\\"</p>\", 20);") != std::string::npos);
+    BOOST_CHECK(cpp.find("goto L") != std::string::npos);
+    BOOST_CHECK(cpp.find("SOURCE") == std::string::npos);
+
+    auto header = tpl::generate_cpp_header(options);
+    BOOST_CHECK(header.find("std::string render_test(slim::ViewModelPtr model, bool doctype = true);") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,145 @@
+#include <boost/test/unit_test.hpp>
+#include "Template.hpp"
+#include "template/BinaryFormat.hpp"
+#include "types/Array.hpp"
+#include "types/Math.hpp"
+#include "types/ViewModel.hpp"
+#include "Error.hpp"
+#include "Value.hpp"
+#include <cstdio>
+#include <cstring>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace slim;
+BOOST_AUTO_TEST_SUITE(TestBinary)
+
+/**Save and reload a template, checking it is unchanged and renders the same.*/
+std::string round_trip(const std::string &source, ViewModelPtr model)
+{
+    auto tpl = parse_template(source);
+    auto data = save_template_binary(tpl);
+    auto loaded = load_template_binary(data.data(), data.size());
+    BOOST_CHECK_EQUAL(tpl.to_string(), loaded.to_string());
+    BOOST_CHECK_EQUAL(tpl.disassemble(), loaded.disassemble());
+    auto expected = tpl.render(model, false);
+    auto actual = loaded.render(model, false);
+    BOOST_CHECK_EQUAL(expected, actual);
+    return actual;
+}
+std::string repeat(const std::string &str, size_t n)
+{
+    std::string out;
+    for (size_t i = 0; i < n; ++i) out += str;
+    return out;
+}
+std::string round_trip(const std::string &source)
+{
+    return round_trip(source, create_view_model());
+}
+
+BOOST_AUTO_TEST_CASE(parts)
+{
+    auto model = create_view_model();
+    model->set_attr("x", make_value(2.0));
+    model->set_attr("items", make_array({make_value("a"), make_value("<b>")}));
+    BOOST_CHECK_EQUAL("<p>text</p>", round_trip("p text"));
+    BOOST_CHECK_EQUAL("<head></head><p>a</p>", round_trip("head\n- flush\np a"));
+    BOOST_CHECK_EQUAL("<p>4</p>", round_trip("p = @x * 2", model));
+    BOOST_CHECK_EQUAL("<p>two</p>", round_trip(
+        "- if @x == 1\n"
+        "  p one\n"
+        "- elsif @x == 2\n"
+        "  p two\n"
+        "- else\n"
+        "  p other\n", model));
+    BOOST_CHECK_EQUAL("<p>no</p>", round_trip("- if @x > 5\n  p yes\n- else\n  p no\n", model));
+    BOOST_CHECK_EQUAL("<ul><li>0 a</li><li>1 &lt;b&gt;</li></ul>", round_trip(
+        "ul\n"
+        "  - @items.each_with_index do |item, i|\n"
+        "    li #{i} #{item}\n", model));
+    BOOST_CHECK_EQUAL("<p>5</p>", round_trip("ruby: y = @x + 3\np = y", model));
+    BOOST_CHECK_EQUAL("<p>main</p>", round_trip(
+        "= content_for :head do\n"
+        "  - [1, 2].each do |x|\n"
+        "    p = x\n"
+        "p main\n", model));
+    BOOST_CHECK_EQUAL("<p class=\"a b\" id=\"2\"></p>", round_trip("p.a class=@items[0].sub('a', 'b') id=@x", model));
+    BOOST_CHECK_EQUAL("<p data-x=\"2\" class=\"c\"></p>", round_trip("p *{'data-x' => @x} class='c'", model));
+}
+
+BOOST_AUTO_TEST_CASE(expressions)
+{
+    auto model = create_view_model();
+    model->set_attr("a", make_value("<b>"));
+    model->set_attr("n", make_value(5.0));
+    model->add_constant("Math", create_object<Math>());
+    BOOST_CHECK_EQUAL("<p>10 2 1 25 true false -5 -6 [5, 6]</p>", round_trip(
+        "p = \"#{@n * 2} #{@n - 3} #{@n % 2} #{@n ** 2} #{@n >= 5} #{!@n} #{-@n} #{~@n} #{[@n, @n + 1]}\"", model));
+    BOOST_CHECK_EQUAL("<p>3</p>", round_trip("p = [1, 2, 3][-1]", model));
+    BOOST_CHECK_EQUAL("<p>5 nil</p>", round_trip("p = \"#{{a: 5, 'b' => nil}[:a]} #{{a: nil}[:a].inspect}\"", model));
+    BOOST_CHECK_EQUAL("<p>a</p>", round_trip("p = @missing || 'a'", model));
+    BOOST_CHECK_EQUAL("<p></p>", round_trip("p = @missing&.size", model));
+    BOOST_CHECK_EQUAL("<p>yes</p>", round_trip("p = @n > 2 ? 'yes' : 'no'", model));
+    BOOST_CHECK_EQUAL("<p>true true</p>", round_trip("p = \"#{'abc'.match(/x/) == nil} #{'a5'.match(/#{@n}/) != nil}\"", model));
+    BOOST_CHECK_EQUAL("<p>[1, 2, 3] [1, 2]</p>", round_trip("p = \"#{(1..3).to_a} #{(1...3).to_a}\"", model));
+    BOOST_CHECK_EQUAL("<p>[2, 4]</p>", round_trip("p = [1, 2].map { |x| x * 2 }", model));
+    BOOST_CHECK_EQUAL("<p>:sym 1.5</p>", round_trip("p = \"#{:sym.inspect} #{1.5}\"", model));
+    BOOST_CHECK_EQUAL("<p>1</p>", round_trip("p = Math::PI.floor - 2", model));
+}
+
+BOOST_AUTO_TEST_CASE(invalid)
+{
+    auto data = save_template_binary(parse_template("p = @x.upcase"));
+    BOOST_CHECK_THROW(load_template_binary("", 0), Error);
+    BOOST_CHECK_THROW(load_template_binary("SLIMTPX", 8), Error);
+
+    auto version = data;
+    version[8] = 99;
+    BOOST_CHECK_THROW(load_template_binary(version.data(), version.size()), Error);
+    for (size_t len = 0; len < data.size(); ++len)
+    {
+        BOOST_CHECK_THROW(load_template_binary(data.data(), len), Error);
+    }
+    auto extra = data + "x";
+    BOOST_CHECK_THROW(load_template_binary(extra.data(), extra.size()), Error);
+
+    // Nesting deep enough to overflow the stack while reading
+    auto deep = save_template_binary(parse_template("p = " + repeat("-(", 2000) + "@x" + std::string(2000, ')')));
+    BOOST_CHECK_THROW(load_template_binary(deep.data(), deep.size()), Error);
+
+    // An assignment to a huge variable slot
+    auto assign = save_template_binary(parse_template("ruby: x = @x\np = x"));
+    const char slot_1[] = {tpl::binary::NODE_ASSIGNMENT, 0, 0, 0, 0, 1, 0, 0, 0, tpl::binary::NODE_ATTRIBUTE};
+    size_t found = 0;
+    for (size_t i = 0; i + sizeof(slot_1) <= assign.size(); ++i)
+    {
+        if (assign[i] == slot_1[0] && memcmp(&assign[i + 5], slot_1 + 5, sizeof(slot_1) - 5) == 0)
+        {
+            memset(&assign[i + 5], 0xF0, 4);
+            ++found;
+        }
+    }
+    BOOST_REQUIRE_EQUAL(1U, found);
+    BOOST_CHECK_THROW(load_template_binary(assign.data(), assign.size()), Error);
+}
+
+BOOST_AUTO_TEST_CASE(file)
+{
+    char path[] = "/tmp/slim_binary_XXXXXX";
+    int fd = mkstemp(path);
+    BOOST_REQUIRE(fd >= 0);
+    close(fd);
+
+    auto model = create_view_model();
+    model->set_attr("x", make_value("<x>"));
+    auto tpl = parse_template("p = @x");
+    save_template_binary_file(tpl, path);
+    auto loaded = load_template_binary_file(path);
+    BOOST_CHECK_EQUAL("<p>&lt;x&gt;</p>", loaded.render(model, false));
+    remove(path);
+
+    BOOST_CHECK_THROW(load_template_binary_file(path), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
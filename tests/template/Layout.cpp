@@ -1,8 +1,12 @@
 #include <boost/test/unit_test.hpp>
 #include "Template.hpp"
+#include "template/OutputBuffer.hpp"
+#include "template/OutputSink.hpp"
 #include "types/ViewModel.hpp"
 #include "types/HtmlSafeString.hpp"
 #include "Util.hpp"
+#include "Value.hpp"
+#include <algorithm>
 
 using namespace slim;
 using namespace slim::tpl;
@@ -50,4 +54,69 @@ BOOST_AUTO_TEST_CASE(yield)
         , html);
 }
 
+BOOST_AUTO_TEST_CASE(link_content)
+{
+    OutputBuffer buffer;
+    buffer.set_link_content(true);
+    auto big = create_object<HtmlSafeString>(std::string(OutputBuffer::LINK_MIN_SIZE, 'x'));
+    buffer += "<a>";
+    buffer.append_escaped(big.get());
+    buffer.append_escaped(create_object<HtmlSafeString>("<small>").get());
+    buffer.append_escaped(make_value(std::string(OutputBuffer::LINK_MIN_SIZE, '<')).get());
+    buffer.append_escaped(big.get());
+    BOOST_REQUIRE_EQUAL(2U, buffer.get_slots().size());
+    BOOST_CHECK_EQUAL(3U, buffer.get_slots()[0].offset);
+    BOOST_CHECK(buffer.get_slots()[0].content.get() == big.get());
+
+    std::vector<std::pair<const char*, size_t>> segments;
+    buffer.for_each_segment([&](const char *data, size_t len) { segments.emplace_back(data, len); });
+    BOOST_REQUIRE_EQUAL(4U, segments.size());
+    BOOST_CHECK(segments[1].first == big->get_value().data());
+    BOOST_CHECK(segments[3].first == big->get_value().data());
+
+    auto expected = "<a>" + big->get_value() + "<small>";
+    for (size_t i = 0; i < OutputBuffer::LINK_MIN_SIZE; ++i) expected += "&lt;";
+    expected += big->get_value();
+    BOOST_CHECK_EQUAL(expected.size(), buffer.size());
+    BOOST_CHECK_EQUAL(expected, buffer.take());
+    BOOST_CHECK(buffer.get_slots().empty());
+}
+
+BOOST_AUTO_TEST_CASE(linked_yield)
+{
+    std::string item(100, 'x');
+    std::string source = "- (0...@count).each do |i|\n  p = @item\n= content_for :side do\n  - (0...@count).each do |i|\n    span = @item\n";
+    auto tpl = parse_template(source);
+    auto layout = parse_template("head = yield :side\nbody = yield\n");
+    auto mv = create_view_model();
+    mv->set_attr("count", make_value(50.0));
+    mv->set_attr("item", make_value(item));
+
+    std::string main, side;
+    for (int i = 0; i < 50; ++i)
+    {
+        main += "<p>" + item + "</p>";
+        side += "<span>" + item + "</span>";
+    }
+    auto expected = "<!DOCTYPE html>\n<head>" + side + "</head><body>" + main + "</body>";
+    for (auto mode : {Template::EXEC_TREE, Template::EXEC_VM})
+    {
+        tpl.set_exec_mode(mode);
+        layout.set_exec_mode(mode);
+        BOOST_CHECK_EQUAL(expected, tpl.render_layout(layout, mv));
+
+        // Content is written to the sink as is
+        std::string out;
+        std::vector<size_t> writes;
+        CallbackSink sink([&](const char *data, size_t len) {
+            out.append(data, len);
+            writes.push_back(len);
+        });
+        tpl.render_layout(sink, layout, mv);
+        BOOST_CHECK_EQUAL(expected, out);
+        BOOST_CHECK(std::find(writes.begin(), writes.end(), main.size()) != writes.end());
+        BOOST_CHECK(std::find(writes.begin(), writes.end(), side.size()) != writes.end());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,154 @@
+#include <boost/test/unit_test.hpp>
+#include "Template.hpp"
+#include "template/BinaryFormat.hpp"
+#include "template/Lexer.hpp"
+#include "template/Optimizer.hpp"
+#include "template/Parser.hpp"
+#include "template/TemplatePart.hpp"
+#include "types/Array.hpp"
+#include "types/Boolean.hpp"
+#include "types/ViewModel.hpp"
+#include "Error.hpp"
+#include "Value.hpp"
+
+using namespace slim;
+using namespace slim::tpl;
+BOOST_AUTO_TEST_SUITE(TestTplOptimizer)
+
+std::string dump(const std::string &source)
+{
+    return dump_tree(parse_template(source).get_root());
+}
+/**Renders both the optimized and unoptimized template, which should always give the same output.*/
+std::string render(const std::string &source, ViewModelPtr model)
+{
+    Lexer lexer(source.c_str(), source.c_str() + source.size());
+    Parser parser(lexer);
+    parser.set_optimize(false);
+    auto expected = parser.parse().render(model, false);
+    auto tpl = parse_template(source);
+    for (auto mode : {Template::EXEC_TREE, Template::EXEC_VM})
+    {
+        tpl.set_exec_mode(mode);
+        BOOST_CHECK_EQUAL(expected, tpl.render(model, false));
+    }
+    return expected;
+}
+std::string render(const std::string &source)
+{
+    return render(source, create_view_model());
+}
+
+BOOST_AUTO_TEST_CASE(constant_output)
+{
+    BOOST_CHECK_EQUAL("text \"<p>static &lt;b&gt;</p><p>7</p>\"\n", dump("p = \"static <b>\"\np = 1 + 2 * 3\n"));
+    BOOST_CHECK_EQUAL("<p>static &lt;b&gt;</p><p>7</p>", render("p = \"static <b>\"\np = 1 + 2 * 3\n"));
+    BOOST_CHECK_EQUAL("text \"n: 8 true a\"\n", dump("= \"n: #{2 * 4} #{1 < 2} #{:a}\""));
+    BOOST_CHECK_EQUAL("text \"<a href=\\\"/ab\\\"></a>\"\n", dump("a href=(\"/a\" + \"b\")"));
+    BOOST_CHECK_EQUAL("<a></a><a checked></a>", render("a checked=(1 > 2)\na checked=(1 < 2)\n"));
+
+    // Partially constant
+    BOOST_CHECK_EQUAL(
+        "list\n"
+        "  text \"<p>\"\n"
+        "  output \"n: 8 #{@x}\"\n"
+        "  text \"</p>\"\n",
+        dump("p = \"n: #{2 * 4} #{@x}\""));
+    BOOST_CHECK_EQUAL("output (@x + 3)\n", dump("= @x + (1 + 2)"));
+    BOOST_CHECK_EQUAL("output @x\n", dump("= true && @x"));
+    BOOST_CHECK_EQUAL("output @x\n", dump("= nil || @x"));
+    BOOST_CHECK_EQUAL("output @x\n", dump("= 1 > 2 ? 5 : @x"));
+    // Not constant
+    BOOST_CHECK_EQUAL("output [1, 2].size()\n", dump("= [1, 2].size"));
+    BOOST_CHECK_EQUAL("output (1 .. 2)\n", dump("= 1..2"));
+
+    auto model = create_view_model();
+    model->set_attr("x", make_value("<x>"));
+    BOOST_CHECK_EQUAL("<p>n: 8 &lt;x&gt;</p>", render("p = \"n: #{2 * 4} #{@x}\"", model));
+}
+
+BOOST_AUTO_TEST_CASE(dead_branches)
+{
+    BOOST_CHECK_EQUAL("text \"<img/>\"\n", dump("- if true\n  img\n- else\n  hr\n"));
+    BOOST_CHECK_EQUAL("text \"<hr/>\"\n", dump("- if 1 > 2\n  img\n- else\n  hr\n"));
+    BOOST_CHECK_EQUAL("text \"\"\n", dump("- if nil\n  img\n"));
+    BOOST_CHECK_EQUAL(
+        "if @a\n"
+        "  text \"<img/>\"\n"
+        "else\n"
+        "  text \"<br/>\"\n",
+        dump("- if false\n  hr\n- elsif @a\n  img\n- elsif 1\n  br\n- else\n  hr\n"));
+    BOOST_CHECK_EQUAL(
+        "list\n"
+        "  text \"<p>\"\n"
+        "  if @a\n"
+        "    text \"<img/>\"\n"
+        "  elsif @b\n"
+        "    text \"<br/>\"\n"
+        "  text \"</p>\"\n",
+        dump("p\n  - if @a\n    img\n  - elsif nil\n    hr\n  - elsif @b\n    br\n"));
+
+    auto model = create_view_model();
+    model->set_attr("a", make_value(false));
+    model->set_attr("b", make_value(true));
+    BOOST_CHECK_EQUAL("<p><br/></p>", render("p\n  - if @a\n    img\n  - elsif nil\n    hr\n  - elsif @b\n    br\n", model));
+    BOOST_CHECK_EQUAL("<p>1</p><p>2</p>", render("- [1, 2].each do |x|\n  - if true\n    p = x\n"));
+}
+
+BOOST_AUTO_TEST_CASE(errors)
+{
+    // Left for the render to raise
+    BOOST_CHECK_EQUAL("output (1 + \"a\")\n", dump("= 1 + 'a'"));
+    auto tpl = parse_template("- if false\n  = 1 + 'a'\n= 1 + 'a'\n");
+    BOOST_CHECK_THROW(tpl.render(create_view_model()), ScriptError);
+}
+
+BOOST_AUTO_TEST_CASE(specialize)
+{
+    auto source =
+        "- if FEATURE\n"
+        "  p = \"#{Site::NAME} (#{LIMIT * 2})\"\n"
+        "- else\n"
+        "  p = @text\n"
+        "- if MISSING\n"
+        "  br\n"
+        "= ITEMS.size\n";
+    auto tpl = parse_template(source);
+    auto site = create_view_model();
+    site->add_constant("NAME", make_value("<Site>"));
+    auto model = create_view_model();
+    model->add_constant("FEATURE", TRUE_VALUE);
+    model->add_constant("LIMIT", make_value(5.0));
+    model->add_constant("Site", site);
+    model->add_constant("ITEMS", make_array({make_value(1.0)}));
+
+    auto specialized = specialize_template(tpl, model);
+    BOOST_CHECK_EQUAL(
+        "list\n"
+        "  text \"<p>&lt;Site&gt; (10)</p>\"\n"
+        "  if MISSING\n"
+        "    text \"<br/>\"\n"
+        "  output [1].size()\n",
+        dump_tree(specialized.get_root()));
+    BOOST_CHECK_THROW(save_template_binary(specialized), Error); // ITEMS
+    // The original is unchanged
+    BOOST_CHECK(dump_tree(tpl.get_root()).find("FEATURE") != std::string::npos);
+
+    model->add_constant("MISSING", FALSE_VALUE);
+    for (auto mode : {Template::EXEC_TREE, Template::EXEC_VM})
+    {
+        tpl.set_exec_mode(mode);
+        specialized.set_exec_mode(mode);
+        BOOST_CHECK_EQUAL("<p>&lt;Site&gt; (10)</p>1", specialized.render(model, false));
+        BOOST_CHECK_EQUAL(tpl.render(model, false), specialized.render(model, false));
+    }
+
+    model->add_constant("FEATURE", FALSE_VALUE);
+    model->set_attr("text", make_value("x"));
+    auto other = specialize_template(tpl, model);
+    BOOST_CHECK_EQUAL("<p>x</p>1", other.render(model, false));
+    // Copies inlined objects by reference
+    BOOST_CHECK_EQUAL(dump_tree(specialized.get_root()), dump_tree(*binary::copy_tree(specialized.get_root())));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
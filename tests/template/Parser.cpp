@@ -8,11 +8,13 @@ using namespace slim;
 using namespace slim::tpl;
 BOOST_AUTO_TEST_SUITE(TestTplParser)
 
+/**The parsed tree, without tpl::optimize (see TestTplOptimizer).*/
 std::string parse_str(const char *str)
 {
     Lexer lexer(str, str + strlen(str));
     lexer.file_name("inline_test.html.slim");
     Parser parser(lexer);
+    parser.set_optimize(false);
     return parser.parse().to_string();
 }
 
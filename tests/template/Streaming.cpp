@@ -0,0 +1,238 @@
+#include <boost/test/unit_test.hpp>
+#include "Template.hpp"
+#include "template/OutputSink.hpp"
+#include "template/OutputBuffer.hpp"
+#include "template/SegmentedOutput.hpp"
+#include "types/ViewModel.hpp"
+#include "Value.hpp"
+#include <sstream>
+#include <thread>
+#ifndef _WIN32
+    #include <unistd.h>
+#endif
+
+using namespace slim;
+using namespace slim::tpl;
+BOOST_AUTO_TEST_SUITE(TestStreaming)
+
+/**Records each chunk written between flushes.*/
+struct ChunkRecorder
+{
+    std::vector<std::string> chunks;
+    std::string pending;
+    CallbackSink sink;
+
+    ChunkRecorder()
+        : sink(
+            [this](const char *data, size_t len) { pending.append(data, len); },
+            [this]() { chunks.push_back(std::move(pending)); pending.clear(); })
+    {}
+};
+
+BOOST_AUTO_TEST_CASE(render_to_sink)
+{
+    auto tpl = parse_template("p Hello World\n");
+    ChunkRecorder out;
+    tpl.render(out.sink, create_view_model());
+    BOOST_CHECK_EQUAL(1U, out.chunks.size());
+    BOOST_CHECK_EQUAL("", out.pending);
+    BOOST_CHECK_EQUAL("<!DOCTYPE html>\n<p>Hello World</p>", out.chunks[0]);
+
+    std::stringstream ss;
+    OStreamSink os_sink(ss);
+    tpl.render(os_sink, create_view_model(), false);
+    BOOST_CHECK_EQUAL("<p>Hello World</p>", ss.str());
+}
+
+BOOST_AUTO_TEST_CASE(flush_after_head)
+{
+    auto tpl = parse_template(
+        "html\n"
+        "  head\n"
+        "    title Test\n"
+        "  body\n"
+        "    p Content\n");
+    ChunkRecorder out;
+    tpl.render(out.sink, create_view_model(), false);
+    BOOST_REQUIRE_EQUAL(2U, out.chunks.size());
+    BOOST_CHECK_EQUAL("<html><head><title>Test</title></head>", out.chunks[0]);
+    BOOST_CHECK_EQUAL("<body><p>Content</p></body></html>", out.chunks[1]);
+
+    //Same output when rendering to a string
+    BOOST_CHECK_EQUAL(out.chunks[0] + out.chunks[1], tpl.render(create_view_model(), false));
+}
+
+BOOST_AUTO_TEST_CASE(flush_control_line)
+{
+    auto tpl = parse_template(
+        "p Before\n"
+        "- flush\n"
+        "p After\n"
+        "- [1, 2].each do |x|\n"
+        "  = x\n"
+        "  - flush\n");
+    ChunkRecorder out;
+    tpl.render(out.sink, create_view_model(), false);
+    BOOST_REQUIRE_EQUAL(4U, out.chunks.size());
+    BOOST_CHECK_EQUAL("<p>Before</p>", out.chunks[0]);
+    BOOST_CHECK_EQUAL("<p>After</p>1", out.chunks[1]);
+    BOOST_CHECK_EQUAL("2", out.chunks[2]);
+    BOOST_CHECK_EQUAL("", out.chunks[3]);
+
+    BOOST_CHECK_EQUAL("<p>Before</p><p>After</p>12", tpl.render(create_view_model(), false));
+
+    BOOST_CHECK_THROW(parse_template("- flush now\n"), TemplateSyntaxError);
+}
+
+BOOST_AUTO_TEST_CASE(flush_in_capture)
+{
+    //Flush points inside a captured block have no effect on the sink
+    auto tpl = parse_template(
+        "= content_for :x do\n"
+        "  p a\n"
+        "  - flush\n"
+        "  p b\n"
+        "= yield :x\n");
+    ChunkRecorder out;
+    tpl.render(out.sink, create_view_model(), false);
+    BOOST_REQUIRE_EQUAL(1U, out.chunks.size());
+    BOOST_CHECK_EQUAL("<p>a</p><p>b</p>", out.chunks[0]);
+}
+
+BOOST_AUTO_TEST_CASE(layout)
+{
+    auto tpl = parse_template("p main\n");
+    auto layout = parse_template(
+        "head\n"
+        "  title layout\n"
+        "=yield\n");
+    ChunkRecorder out;
+    tpl.render_layout(out.sink, layout, create_view_model());
+    BOOST_REQUIRE_EQUAL(2U, out.chunks.size());
+    BOOST_CHECK_EQUAL("<!DOCTYPE html>\n<head><title>layout</title></head>", out.chunks[0]);
+    BOOST_CHECK_EQUAL("<p>main</p>", out.chunks[1]);
+}
+
+BOOST_AUTO_TEST_CASE(write_threshold)
+{
+    std::vector<std::string> writes;
+    int flushes = 0;
+    CallbackSink sink(
+        [&](const char *data, size_t len) { writes.emplace_back(data, len); },
+        [&]() { ++flushes; });
+    OutputBuffer buffer(&sink, 4);
+    buffer += "ab";
+    BOOST_CHECK(writes.empty());
+    buffer += "cd";
+    BOOST_REQUIRE_EQUAL(1U, writes.size());
+    BOOST_CHECK_EQUAL("abcd", writes[0]);
+    BOOST_CHECK_EQUAL(0, flushes);
+    buffer += "e";
+    buffer.flush();
+    BOOST_REQUIRE_EQUAL(2U, writes.size());
+    BOOST_CHECK_EQUAL("e", writes[1]);
+    BOOST_CHECK_EQUAL(1, flushes);
+    buffer.flush();
+    BOOST_CHECK_EQUAL(2U, writes.size());
+    BOOST_CHECK_EQUAL(2, flushes);
+}
+
+BOOST_AUTO_TEST_CASE(segments)
+{
+    std::string text(OutputBuffer::STATIC_LINK_MIN_SIZE, 't');
+    auto tpl = parse_template("p " + text + "\n- (0...3).each do |i|\n  span = i\n  p " + text + "\n");
+    auto model = create_view_model();
+    for (auto mode : {Template::EXEC_TREE, Template::EXEC_VM})
+    {
+        tpl.set_exec_mode(mode);
+        auto expected = tpl.render(model, false);
+        auto out = tpl.render_segments(model, false);
+        BOOST_CHECK_EQUAL(expected, out.str());
+        BOOST_CHECK_EQUAL(expected.size(), out.size());
+
+        // Static text is not copied, so each render refers to the same text
+        auto segments = out.segments();
+        auto again = tpl.render_segments(model, false).segments();
+        BOOST_REQUIRE_EQUAL(segments.size(), again.size());
+        size_t linked = 0;
+        for (size_t i = 0; i < segments.size(); ++i)
+        {
+            if (std::string(segments[i].data, segments[i].len).find("<span>") != std::string::npos)
+                BOOST_CHECK(segments[i].data != again[i].data);
+            else if (segments[i].data == again[i].data) ++linked;
+        }
+        BOOST_CHECK_EQUAL(4U, linked);
+
+        // Short static text is copied along with the dynamic output
+        std::string dynamic;
+        for (auto &segment : segments)
+        {
+            auto str = std::string(segment.data, segment.len);
+            if (str.find("<span>") != std::string::npos) dynamic += str;
+        }
+        BOOST_CHECK_EQUAL("<span>0<span>1<span>2", dynamic);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(gather_sink)
+{
+    struct GatherSink : public OutputSink
+    {
+        std::string out;
+        std::vector<size_t> counts;
+        virtual void write(const char *data, size_t len)override { out.append(data, len); }
+        virtual void write_segments(const OutputSegment *segments, size_t count)override
+        {
+            counts.push_back(count);
+            OutputSink::write_segments(segments, count);
+        }
+        virtual bool gathers()const override { return true; }
+    };
+    std::string text(OutputBuffer::STATIC_LINK_MIN_SIZE, 't');
+    auto tpl = parse_template("p " + text + "\n- flush\np = @x\np " + text + "\n");
+    auto model = create_view_model();
+    model->set_attr("x", make_value("<x>"));
+    for (auto mode : {Template::EXEC_TREE, Template::EXEC_VM})
+    {
+        tpl.set_exec_mode(mode);
+        GatherSink sink;
+        tpl.render(sink, model, false);
+        BOOST_CHECK_EQUAL(tpl.render(model, false), sink.out);
+        // Each flush point writes its segments with a single call
+        BOOST_CHECK(sink.counts == std::vector<size_t>({1, 2}));
+    }
+}
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE(fd_sink)
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, pipe(fds));
+    std::string read;
+    std::thread reader([&] {
+        char buf[4096];
+        ssize_t len;
+        while ((len = ::read(fds[0], buf, sizeof(buf))) > 0) read.append(buf, (size_t)len);
+    });
+
+    // Larger than a pipe buffer and IOV_MAX segments, so writev returns part way
+    std::string text(100, 't');
+    auto tpl = parse_template("- (0...@count).each do |i|\n  p = i\n  p " + text + "\n");
+    auto model = create_view_model();
+    model->set_attr("count", make_value(5000.0));
+    std::string expected;
+    {
+        FdSink sink(fds[1]);
+        tpl.render(sink, model, false);
+        expected = tpl.render(model, false);
+        tpl.render_segments(model, false).write(sink);
+    }
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+    BOOST_CHECK_EQUAL(expected.size() * 2, read.size());
+    BOOST_CHECK(expected + expected == read);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
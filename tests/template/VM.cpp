@@ -0,0 +1,198 @@
+#include <boost/test/unit_test.hpp>
+#include "Template.hpp"
+#include "types/Array.hpp"
+#include "types/ViewModel.hpp"
+#include "types/HtmlSafeString.hpp"
+#include "Error.hpp"
+#include "Value.hpp"
+#include <cmath>
+
+using namespace slim;
+BOOST_AUTO_TEST_SUITE(TestVM)
+
+/**Render with both the VM and the tree walker, which should always give the same output.*/
+std::string render_both(const std::string &source, ViewModelPtr model)
+{
+    auto tpl = parse_template(source);
+    tpl.set_exec_mode(Template::EXEC_TREE);
+    auto expected = tpl.render(model, false);
+    tpl.set_exec_mode(Template::EXEC_VM);
+    auto actual = tpl.render(model, false);
+    BOOST_CHECK_EQUAL(expected, actual);
+    return actual;
+}
+std::string render_both(const std::string &source)
+{
+    return render_both(source, create_view_model());
+}
+
+BOOST_AUTO_TEST_CASE(exec_mode)
+{
+    auto tpl = parse_template("p test");
+    BOOST_CHECK(tpl.get_exec_mode() == Template::EXEC_VM);
+    tpl.set_exec_mode(Template::EXEC_TREE);
+    BOOST_CHECK(tpl.get_exec_mode() == Template::EXEC_TREE);
+}
+
+BOOST_AUTO_TEST_CASE(output)
+{
+    auto model = create_view_model();
+    model->set_attr("a", make_value("<b>"));
+    model->set_attr("n", make_value(5.0));
+    BOOST_CHECK_EQUAL("<p>text</p>", render_both("p text", model));
+    BOOST_CHECK_EQUAL("<p>&lt;b&gt;</p>", render_both("p = @a", model));
+    BOOST_CHECK_EQUAL("<p>10 2 1 25 true [5, 6]</p>", render_both(
+        "p = \"#{@n * 2} #{@n - 3} #{@n % 2} #{@n ** 2} #{@n >= 5} #{[@n, @n + 1]}\"", model));
+    BOOST_CHECK_EQUAL("<p>x-&lt;b&gt;</p>", render_both("p x-#{@a}", model));
+    BOOST_CHECK_EQUAL("<p>3</p>", render_both("p = [1, 2, 3][-1]", model));
+    BOOST_CHECK_EQUAL("<p>5</p>", render_both("p = {a: 5}[:a]", model));
+    BOOST_CHECK_EQUAL("<p>a</p>", render_both("p = @missing || 'a'", model));
+    BOOST_CHECK_EQUAL("<p></p>", render_both("p = @missing && 'a'", model));
+    BOOST_CHECK_EQUAL("<p></p>", render_both("p = @missing&.size", model));
+    BOOST_CHECK_EQUAL("<p>3</p>", render_both("p = @a&.size", model));
+    BOOST_CHECK_EQUAL("<p>yes</p>", render_both("p = @n > 2 ? 'yes' : 'no'", model));
+    BOOST_CHECK_EQUAL("<p>true</p>", render_both("p = 'abc'.match(/b/) != nil", model));
+    BOOST_CHECK_EQUAL("<p>[1, 2, 3]</p>", render_both("p = (1..3).to_a", model));
+}
+
+BOOST_AUTO_TEST_CASE(conditional)
+{
+    auto tpl =
+        "- if @x == 1\n"
+        "  p one\n"
+        "- elsif @x == 2\n"
+        "  p two\n"
+        "- else\n"
+        "  p other\n";
+    auto model = create_view_model();
+    model->set_attr("x", make_value(1.0));
+    BOOST_CHECK_EQUAL("<p>one</p>", render_both(tpl, model));
+    model->set_attr("x", make_value(2.0));
+    BOOST_CHECK_EQUAL("<p>two</p>", render_both(tpl, model));
+    model->set_attr("x", make_value(3.0));
+    BOOST_CHECK_EQUAL("<p>other</p>", render_both(tpl, model));
+    BOOST_CHECK_EQUAL("", render_both("- if false\n  p x\n", model));
+}
+
+BOOST_AUTO_TEST_CASE(each)
+{
+    BOOST_CHECK_EQUAL("<p>1</p><p>5</p>", render_both("- [1, 5].each do |x|\n  p = x\n"));
+    BOOST_CHECK_EQUAL("", render_both("- [].each do |x|\n  p = x\n"));
+    BOOST_CHECK_EQUAL("<p>a=5</p><p>b=15</p>",
+        render_both("- {a: 5, b: 15}.each do |k, v|\n  p #{k}=#{v}\n"));
+    BOOST_CHECK_EQUAL("<p>1</p><p>2</p><p>3</p>", render_both("- (1..3).each do |x|\n  p = x\n"));
+    BOOST_CHECK_EQUAL("<p>1</p><p>2</p>", render_both("- (1...3).each do |x|\n  p = x\n"));
+    BOOST_CHECK_EQUAL("<p>1</p><p>2</p>", render_both("- (1..2.5).each do |x|\n  p = x\n"));
+    // Not natively iterated
+    BOOST_CHECK_EQUAL("<p>0: a</p><p>1: b</p>",
+        render_both("- ['a', 'b'].each_with_index do |x, i|\n  p #{i}: #{x}\n"));
+    BOOST_CHECK_EQUAL("<p>3</p><p>7</p>",
+        render_both("- [[1, 2], [3, 4]].each do |x|\n  p = x[0] + x[1]\n"));
+    // Nested, and inner loop using outer variable
+    BOOST_CHECK_EQUAL("<p>1a</p><p>1b</p><p>2a</p><p>2b</p>",
+        render_both("- [1, 2].each do |x|\n  - ['a', 'b'].each do |y|\n    p #{x}#{y}\n"));
+
+    auto model = create_view_model();
+    model->set_attr("items", make_array({make_value(1.0), make_value(2.0)}));
+    BOOST_CHECK_EQUAL("<p>1</p><p>2</p>", render_both("- @items.each do |x|\n  p = x\n", model));
+    BOOST_CHECK_EQUAL("", render_both("- @missing&.each do |x|\n  p = x\n", model));
+    // Lazy chains are iterated without building arrays
+    BOOST_CHECK_EQUAL("<p>20</p><p>40</p>", render_both(
+        "- (1..1000000000).lazy.select { |x| x % 10 == 0 }.map { |x| x * 2 }.take(2).each do |x|\n  p = x\n"));
+}
+
+BOOST_AUTO_TEST_CASE(local_variables)
+{
+    BOOST_CHECK_EQUAL("<p>15</p>", render_both("ruby: x = 5 * 3\np = x\n"));
+    // Assignments within a block are local to the block
+    BOOST_CHECK_EQUAL("<p>0</p>", render_both(
+        "ruby: x = 0\n"
+        "- [1, 2, 3].each do |i|\n"
+        "  ruby: x = x + i\n"
+        "p = x\n"));
+    // Block local is not visible after the block
+    BOOST_CHECK_EQUAL("<p>1</p><p>2</p><p>5</p>", render_both(
+        "ruby: i = 5\n"
+        "- [1, 2].each do |i|\n"
+        "  p = i\n"
+        "p = i\n"));
+    // Locals declared within a block
+    BOOST_CHECK_EQUAL("<p>2</p><p>4</p>", render_both(
+        "- [1, 2].each do |i|\n"
+        "  ruby: y = i * 2\n"
+        "  p = y\n"));
+    // Expression blocks see template locals
+    BOOST_CHECK_EQUAL("<p>[11, 12]</p>", render_both(
+        "ruby: n = 10\n"
+        "p = [1, 2].map { |x| x + n }\n"));
+}
+
+BOOST_AUTO_TEST_CASE(capture)
+{
+    auto tpl = parse_template(
+        "= content_for :head do\n"
+        "  - [1, 2].each do |x|\n"
+        "    p = x\n"
+        "p main\n");
+    auto model = create_view_model();
+    BOOST_CHECK_EQUAL("<p>main</p>", tpl.render(model, false));
+    BOOST_CHECK_EQUAL("<p>1</p><p>2</p>", model->yield({symbol("head")})->get_value());
+}
+
+BOOST_AUTO_TEST_CASE(attributes)
+{
+    auto model = create_view_model();
+    model->set_attr("cls", make_value("x"));
+    BOOST_CHECK_EQUAL("<p id=\"a\" class=\"x\"></p>", render_both("p class=@cls id='a'", model));
+    BOOST_CHECK_EQUAL("<p class=\"c x\"></p>", render_both("p.c class=@cls", model));
+    BOOST_CHECK_EQUAL("<p class=\"c d a b\"></p>", render_both("p.c *{class: ['a', 'b']} class='d'", model));
+    BOOST_CHECK_EQUAL("<p></p>", render_both("p class=nil", model));
+}
+
+BOOST_AUTO_TEST_CASE(numbers)
+{
+    auto model = create_view_model();
+    model->set_attr("n", make_value(7.0));
+    model->set_attr("nan", make_value(NAN));
+    // Inline numbers mixed with Number objects from the model
+    BOOST_CHECK_EQUAL("<p>15 -7 3.5 1 49 2 28 1 7 5 -8</p>", render_both(
+        "p = \"#{@n * 2 + 1} #{-@n} #{@n / 2} #{@n % 2} #{@n ** 2} #{@n - 5} #{@n << 2} #{@n >> 2} #{@n & 15} #{@n ^ 2} #{~@n}\"", model));
+    BOOST_CHECK_EQUAL("<p>true false true -1 0 1</p>", render_both(
+        "p = \"#{@n == 7} #{@n != 7} #{@n < 8} #{@n <=> 8} #{@n <=> 7} #{@n <=> 6}\"", model));
+    // Same as Number::cmp for NaN
+    BOOST_CHECK_EQUAL("<p>false true false true</p>", render_both(
+        "p = \"#{@nan == @nan} #{@nan <= 1} #{@nan < 1} #{@nan >= 1}\"", model));
+    BOOST_CHECK_EQUAL("<p>true false</p>", render_both("p = \"#{1 == 1.0} #{1 == '1'}\"", model));
+    // Range loop counters, stored in locals and passed to methods
+    BOOST_CHECK_EQUAL("<p>1 2 [1]</p><p>2 4 [1, 2]</p><p>3 6 [1, 2, 3]</p>", render_both(
+        "- (1..3).each do |i|\n"
+        "  ruby: y = i * 2\n"
+        "  p = \"#{i} #{y} #{(1..i).to_a}\"\n", model));
+    BOOST_CHECK_EQUAL("<p>0.5</p><p>1.5</p>", render_both("- (0.5...2).each do |x|\n  p = x\n", model));
+    BOOST_CHECK_EQUAL("<p>yes</p>", render_both("- if @n > 5 && !(@n > 10)\n  p yes\n", model));
+    BOOST_CHECK_EQUAL("<p>[2, 3]</p>", render_both("p = [1, 2].map { |x| x + 1 }", model));
+}
+
+BOOST_AUTO_TEST_CASE(errors)
+{
+    auto tpl = parse_template("- [1].each do |a, b|\n  p = a\n");
+    BOOST_CHECK_THROW(tpl.render(create_view_model(), false), ArgumentError);
+    // Hash each params mismatch, falls back to calling each
+    tpl = parse_template("- {a: 5}.each do |x|\n  p = x\n");
+    BOOST_CHECK_THROW(tpl.render(create_view_model(), false), ArgumentError);
+    tpl = parse_template("p = 1 + nil\n");
+    BOOST_CHECK_THROW(tpl.render(create_view_model(), false), TypeError);
+    tpl = parse_template("p = 1 < 'a'\n");
+    BOOST_CHECK_THROW(tpl.render(create_view_model(), false), UnorderableTypeError);
+}
+
+BOOST_AUTO_TEST_CASE(disassemble)
+{
+    auto tpl = parse_template("- [1, 2].each do |x|\n  p = x\n");
+    auto code = tpl.disassemble();
+    BOOST_CHECK(code.find("ITER_BEGIN") != std::string::npos);
+    BOOST_CHECK(code.find("LOAD_SLOT 0 (x)") != std::string::npos);
+    BOOST_CHECK(code.find("OUTPUT") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
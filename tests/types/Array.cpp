@@ -38,7 +38,7 @@ std::string eval(Ptr<ViewModel> model, const std::string &str)
     return eval(str, scope);
 }
 
-std::shared_ptr<Array> make_array2(const std::vector<double> &arr)
+Ptr<Array> make_array2(const std::vector<double> &arr)
 {
     std::vector<ObjectPtr> arr2;
     for (auto d : arr) arr2.push_back(make_value(d));
@@ -5,6 +5,7 @@
 #include "expression/Scope.hpp"
 #include "types/Array.hpp"
 #include "types/Number.hpp"
+#include "types/Proc.hpp"
 #include "types/String.hpp"
 #include "../TestAccumulator.hpp"
 #include "Error.hpp"
@@ -378,5 +379,76 @@ BOOST_AUTO_TEST_CASE(to_h)
     BOOST_CHECK_THROW(eval("[[1, 2, 3]].to_h"), ArgumentError);
 }
 
+BOOST_AUTO_TEST_CASE(early_exit)
+{
+    // Would not finish if the iteration did not stop
+    BOOST_CHECK_EQUAL("true", eval("(1..1000000000).any? {|x| x > 5}"));
+    BOOST_CHECK_EQUAL("false", eval("(1..1000000000).all? {|x| x < 5}"));
+    BOOST_CHECK_EQUAL("false", eval("(1..1000000000).none? {|x| x > 5}"));
+    BOOST_CHECK_EQUAL("false", eval("(1..1000000000).one? {|x| x > 5}"));
+    BOOST_CHECK_EQUAL("6", eval("(1..1000000000).find {|x| x > 5}"));
+    BOOST_CHECK_EQUAL("5", eval("(1..1000000000).find_index {|x| x > 5}"));
+    BOOST_CHECK_EQUAL("5", eval("(1..1000000000).find_index(6)"));
+    BOOST_CHECK_EQUAL("[1, 2]", eval("(1..1000000000).take(2)"));
+    BOOST_CHECK_EQUAL("[1, 2]", eval("(1..1000000000).take_while {|x| x < 3}"));
+    BOOST_CHECK_EQUAL("[1, 2]", eval("(1..1000000000).step.first(2)"));
+    BOOST_CHECK_EQUAL("true", eval("(1..1000000000).step.include?(3)"));
+    // Through enumerators and methods that forward the proc
+    BOOST_CHECK_EQUAL("[4, 3]", eval("(1..1000000000).each_with_index.find {|x, i| i == 3}"));
+    BOOST_CHECK_EQUAL("true", eval("(1..1000000000).each.with_index.any? {|x, i| i == 3}"));
+    BOOST_CHECK_EQUAL("[1, 2]", eval("(1..1000000000).map.first(2)"));
+    BOOST_CHECK_EQUAL("[[1, 0]]", eval("(1..1000000000).each_with_index.take(1)"));
+}
+
+BOOST_AUTO_TEST_CASE(proc_stop)
+{
+    // A stopped proc ends the iteration, with the stop value as the result of the method
+    auto arr = make_array({make_value(1), make_value(2), make_value(3)});
+    int calls = 0;
+    Proc *self = nullptr;
+    auto proc = create_object<FunctionProc>([&calls, &self](const FunctionArgs &args) {
+        if (++calls == 2) self->stop(make_value("stopped"));
+        return NIL_VALUE;
+    });
+    self = proc.get();
+    BOOST_CHECK_EQUAL("\"stopped\"", arr->each({proc})->inspect());
+    BOOST_CHECK_EQUAL(2, calls);
+    BOOST_CHECK(!proc->stopped());
+
+    calls = 0;
+    BOOST_CHECK_EQUAL("\"stopped\"", arr->each_with_index({proc})->inspect());
+    BOOST_CHECK_EQUAL(2, calls);
+    BOOST_CHECK(!proc->stopped());
+}
+
+namespace
+{
+    /**Array that only yields its first element, to check each is used for derived types.*/
+    class FirstOnlyArray : public Array
+    {
+    public:
+        using Array::Array;
+        virtual ObjectPtr each(const FunctionArgs &args)override
+        {
+            auto proc = coerce<Proc>(args.back());
+            proc->iterate({ get_value().front() });
+            return proc->end_iteration(shared_from_this());
+        }
+    };
+}
+BOOST_AUTO_TEST_CASE(native_each)
+{
+    auto identity = create_object<FunctionProc>([](const FunctionArgs &args) { return args[0]; });
+    std::vector<ObjectPtr> values = {make_value(3), make_value(1), make_value(2)};
+    BOOST_CHECK_EQUAL("[3, 1, 2]", make_array(values)->map({identity})->inspect());
+    BOOST_CHECK_EQUAL("[3]", create_object<FirstOnlyArray>(values)->map({identity})->inspect());
+
+    // sort_by calls the proc once per element
+    int calls = 0;
+    auto key = create_object<FunctionProc>([&calls](const FunctionArgs &args) { return ++calls, args[0]; });
+    BOOST_CHECK_EQUAL("[1, 2, 3]", make_array(values)->sort_by({key})->inspect());
+    BOOST_CHECK_EQUAL(3, calls);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -4,6 +4,7 @@
 #include "expression/Lexer.hpp"
 #include "expression/Scope.hpp"
 #include "types/Array.hpp"
+#include "types/Enumerator.hpp"
 #include "types/Number.hpp"
 #include "types/String.hpp"
 #include "../TestAccumulator.hpp"
@@ -73,5 +74,33 @@ BOOST_AUTO_TEST_CASE(enumerable)
     BOOST_CHECK_THROW(eval("[[1, 2, 3]].each.to_h"), ArgumentError);
 }
 
+BOOST_AUTO_TEST_CASE(lazy)
+{
+    // Infinite in practice, so must be fused and stop early
+    BOOST_CHECK_EQUAL("[6, 12, 18]",
+        eval("(1..1000000000).lazy.select{|x| x % 3 == 0}.map{|x| x * 2}.take(3).to_a"));
+    BOOST_CHECK_EQUAL("[1, 2, 4]", eval("(1..1000000000).lazy.reject{|x| x % 3 == 0}.first(3)"));
+    BOOST_CHECK_EQUAL("[1, 2, 3]", eval("(1..1000000000).lazy.take_while{|x| x < 4}.force"));
+    BOOST_CHECK_EQUAL("[1, 1, 2, 2]", eval("(1..1000000000).lazy.flat_map{|x| [x, x]}.first(4)"));
+    BOOST_CHECK_EQUAL("[[5, 0], [6, 1]]", eval("[5, 6, 7].lazy.with_index.take(2).to_a"));
+    BOOST_CHECK_EQUAL("[6, 7]", eval("[5, 6, 7].lazy.with_index(1){|x, i| x}.map{|x| x + 1}.take(2).force"));
+    BOOST_CHECK_EQUAL("[[\"a\", 1]]", eval("{a: 1, b: 2}.lazy.select{|k, v| v < 2}.map{|k, v| [k.to_s, v]}.to_a"));
+    BOOST_CHECK_EQUAL("[]", eval("[1, 2].lazy.take(0).to_a"));
+    BOOST_CHECK_EQUAL("[1, 2]", eval("[1, 2].lazy.lazy.to_a"));
+
+    auto model = create_view_model();
+    auto data = create_object<TestAccumulator>();
+    model->set_attr("data", data);
+    // Each stage is its own enumerator, the source is unchanged
+    auto arr = make_array({make_value(1.0), make_value(2.0)});
+    model->set_attr("lazy", arr->lazy());
+    BOOST_CHECK_EQUAL("[[2, 4], [1, 2]]", eval(model, "[@lazy.map{|y| y * 2}.to_a, @lazy.to_a]"));
+    eval(model, "(1..1000000000).lazy.map{|x| [@data.store(x), x][1]}.select{|x| x % 2 == 0}.first(2)");
+    BOOST_CHECK_EQUAL("[1, 2, 3, 4]", data->check());
+
+    BOOST_CHECK_THROW(eval("[1].lazy.map"), ArgumentError);
+    BOOST_CHECK_THROW(eval("[1].lazy.take(-1)"), ArgumentError);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -29,7 +29,7 @@ std::string eval(const std::string &str)
     return eval(str, scope);
 }
 
-std::shared_ptr<Hash> make_hash2(const std::vector<std::pair<std::string, double>> &map)
+Ptr<Hash> make_hash2(const std::vector<std::pair<std::string, double>> &map)
 {
     auto map2 = create_object<Hash>();
     for (auto &i : map)
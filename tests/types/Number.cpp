@@ -1,4 +1,5 @@
 #include <boost/test/unit_test.hpp>
+#include <cmath>
 #include "expression/Parser.hpp"
 #include "expression/Ast.hpp"
 #include "expression/Lexer.hpp"
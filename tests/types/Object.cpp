@@ -4,6 +4,9 @@
 #include "expression/Lexer.hpp"
 #include "expression/Scope.hpp"
 #include "types/Object.hpp"
+#include "types/Array.hpp"
+#include "types/HtmlSafeString.hpp"
+#include "Value.hpp"
 #include <regex>
 
 using namespace slim;
@@ -80,4 +83,90 @@ BOOST_AUTO_TEST_CASE(test)
     BOOST_CHECK_EQUAL("1", eval("{self => 1, @b => 2}[self]"));
     BOOST_CHECK_EQUAL("2", eval("{self => 1, @b => 2}[@b]"));
 }
+
+/**Records destruction.*/
+class Counted : public Test
+{
+public:
+    explicit Counted(int *destroyed) : destroyed(destroyed) {}
+    ~Counted() { ++*destroyed; }
+private:
+    int *destroyed;
+};
+
+BOOST_AUTO_TEST_CASE(ref_count)
+{
+    int destroyed = 0;
+    {
+        auto obj = create_object<Counted>(&destroyed);
+        BOOST_CHECK(obj->is_shared());
+        BOOST_CHECK_EQUAL(1, obj.use_count());
+        ObjectPtr base = obj;
+        BOOST_CHECK_EQUAL(2, obj.use_count());
+        auto self = base->shared_from_this();
+        BOOST_CHECK_EQUAL(3, obj.use_count());
+        auto cast = static_pointer_cast<Counted>(std::move(self));
+        BOOST_CHECK(!self);
+        BOOST_CHECK_EQUAL(3, obj.use_count());
+        BOOST_CHECK(dynamic_pointer_cast<Counted>(base) == obj);
+        BOOST_CHECK(!dynamic_pointer_cast<Number>(base));
+        base.reset();
+        cast.reset();
+        BOOST_CHECK_EQUAL(1, obj.use_count());
+        BOOST_CHECK_EQUAL(0, destroyed);
+    }
+    BOOST_CHECK_EQUAL(1, destroyed);
+
+    // Objects created with a render arena use plain counts until shared
+    {
+        RenderArena::Scope arena;
+        auto obj = create_object<Counted>(&destroyed);
+        BOOST_CHECK(!obj->is_shared());
+        auto copy = obj;
+        BOOST_CHECK_EQUAL(2, obj.use_count());
+        obj->share();
+        BOOST_CHECK(obj->is_shared());
+        copy.reset();
+        BOOST_CHECK_EQUAL(1, obj.use_count());
+    }
+    BOOST_CHECK_EQUAL(2, destroyed);
+}
+
+/**A user type derived from a built-in type.*/
+class DerivedString : public String
+{
+public:
+    using String::String;
+};
+
+BOOST_AUTO_TEST_CASE(type_flags)
+{
+    auto num = make_value(5.0);
+    BOOST_CHECK(num->get_type_flags() & Object::TYPE_KNOWN);
+    BOOST_CHECK_EQUAL(num.get(), object_cast<Number>(num.get()));
+    BOOST_CHECK(!object_cast<String>(num.get()));
+    BOOST_CHECK(!object_cast<Array>(NIL_VALUE.get()));
+    BOOST_CHECK(object_cast<Nil>(NIL_VALUE.get()));
+    BOOST_CHECK(object_cast<Symbol>(symbol("a").get()));
+    BOOST_CHECK(!object_cast<Number>((Object*)nullptr));
+
+    ObjectPtr safe = create_object<HtmlSafeString>("safe");
+    BOOST_CHECK(object_cast<String>(safe.get()));
+    BOOST_CHECK(object_cast<HtmlSafeString>(safe.get()));
+    BOOST_CHECK(!object_cast<HtmlSafeString>(make_value("str").get()));
+
+    // Other types use RTTI, but still get the flags of built-in bases
+    ObjectPtr derived = create_object<DerivedString>("derived");
+    BOOST_CHECK(object_cast<String>(derived.get()));
+    BOOST_CHECK(object_cast<DerivedString>(derived.get()));
+    BOOST_CHECK(!object_cast<DerivedString>(safe.get()));
+    BOOST_CHECK(!object_cast<Enumerable>(derived.get()));
+    BOOST_CHECK(object_cast<Enumerable>(make_array({}).get()));
+
+    // Objects not made by create_object have no flags, and also use RTTI
+    String local("local");
+    BOOST_CHECK_EQUAL(0, local.get_type_flags());
+    BOOST_CHECK_EQUAL(&local, object_cast<String>(static_cast<Object*>(&local)));
+    BOOST_CHECK(!object_cast<Number>(static_cast<Object*>(&local)));
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,9 @@
 #include "expression/Lexer.hpp"
 #include "expression/Scope.hpp"
 #include "types/Symbol.hpp"
+#include "Function.hpp"
+#include "Value.hpp"
+#include <thread>
 
 using namespace slim;
 using namespace slim::expr;
@@ -74,4 +77,60 @@ BOOST_AUTO_TEST_CASE(to_proc)
     BOOST_CHECK_EQUAL("[4, 1]", eval("['test', 'x'].map(&:size)"));
     BOOST_CHECK_EQUAL("[4, 1]", eval("['test', 'x'].map(&:size)"));
 }
+
+BOOST_AUTO_TEST_CASE(well_known)
+{
+    BOOST_CHECK_EQUAL(symbol("self"), syms::self);
+    BOOST_CHECK_EQUAL(symbol("output_buffer"), syms::output_buffer);
+    BOOST_CHECK_EQUAL(symbol("to_proc"), syms::to_proc);
+    BOOST_CHECK_EQUAL(symbol("each"), syms::each);
+    BOOST_CHECK_EQUAL(symbol("with_index"), syms::with_index);
+
+    auto model = create_view_model();
+    Scope scope(model);
+    BOOST_CHECK_EQUAL(model, scope.get(syms::self));
+}
+
+BOOST_AUTO_TEST_CASE(concurrent)
+{
+    // Enough new symbols to grow the table while other threads look them up
+    const int COUNT = 2000;
+    std::vector<std::vector<SymPtr>> results(4);
+    std::vector<std::thread> threads;
+    for (auto &result : results)
+    {
+        threads.emplace_back([&result] {
+            for (int i = 0; i < COUNT; ++i) result.push_back(symbol("concurrent_" + std::to_string(i)));
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    for (int i = 0; i < COUNT; ++i)
+    {
+        auto expected = symbol("concurrent_" + std::to_string(i));
+        BOOST_CHECK_EQUAL("concurrent_" + std::to_string(i), expected->str());
+        for (auto &result : results) BOOST_CHECK_EQUAL(expected, result[(size_t)i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(id)
+{
+    auto a = symbol("symbol_id_a"), b = symbol("symbol_id_b");
+    BOOST_CHECK_NE(a->id(), b->id());
+    BOOST_CHECK_EQUAL(a->id(), symbol("symbol_id_a")->id());
+
+    // MethodTable is keyed by id
+    struct Methods
+    {
+        static ObjectPtr first() { return make_value(1.0); }
+        static ObjectPtr second() { return make_value(2.0); }
+    };
+    MethodTable table = { { &Methods::first, b }, { &Methods::first, a } };
+    MethodTable extended(table, { { &Methods::second, a } });
+    BOOST_CHECK_EQUAL(2U, extended.size());
+    BOOST_REQUIRE(table.find(a) && extended.find(a) && extended.find(b));
+    BOOST_CHECK_EQUAL(1.0, as_number((*table.find(a))(nullptr, {})));
+    BOOST_CHECK_EQUAL(2.0, as_number((*extended.find(a))(nullptr, {})));
+    BOOST_CHECK_EQUAL(1.0, as_number((*extended.find(b))(nullptr, {})));
+    BOOST_CHECK(!extended.find(symbol("symbol_id_missing")));
+}
 BOOST_AUTO_TEST_SUITE_END()
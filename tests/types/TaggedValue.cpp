@@ -0,0 +1,62 @@
+#include <boost/test/unit_test.hpp>
+#include "types/TaggedValue.hpp"
+#include "types/String.hpp"
+#include "Value.hpp"
+
+using namespace slim;
+BOOST_AUTO_TEST_SUITE(TestTaggedValue)
+
+BOOST_AUTO_TEST_CASE(immediates)
+{
+    TaggedValue empty;
+    BOOST_CHECK(!empty);
+    BOOST_CHECK(!empty.box());
+
+    TaggedValue nil(NIL_VALUE);
+    BOOST_CHECK(nil);
+    BOOST_CHECK(nil.is_nil());
+    BOOST_CHECK(!nil.is_true());
+    BOOST_CHECK_EQUAL(NIL_VALUE, nil.box());
+
+    BOOST_CHECK_EQUAL(TaggedValue::TAG_TRUE, TaggedValue(TRUE_VALUE).get_tag());
+    BOOST_CHECK_EQUAL(TaggedValue::TAG_FALSE, TaggedValue::from_bool(false).get_tag());
+    BOOST_CHECK_EQUAL(FALSE_VALUE, TaggedValue::from_bool(false).box());
+    BOOST_CHECK(TaggedValue::from_bool(true).is_true());
+
+    TaggedValue num(2.5);
+    BOOST_CHECK_EQUAL(TaggedValue::TAG_NUMBER, num.get_tag());
+    BOOST_CHECK(num.is_number());
+    BOOST_CHECK(num.is_true());
+    BOOST_CHECK_EQUAL(2.5, num.number());
+    BOOST_CHECK_EQUAL("2.5", num.to_string());
+    BOOST_CHECK_EQUAL(2.5, coerce<Number>(num.box())->get_value());
+}
+
+BOOST_AUTO_TEST_CASE(objects)
+{
+    auto obj = make_value(5.0);
+    TaggedValue num(obj);
+    BOOST_CHECK_EQUAL(TaggedValue::TAG_OBJECT, num.get_tag());
+    BOOST_CHECK(num.is_number());
+    BOOST_CHECK_EQUAL(5.0, num.number());
+    BOOST_CHECK_EQUAL(obj, num.box());
+
+    TaggedValue str(make_value("text"));
+    BOOST_CHECK(!str.is_number());
+    BOOST_CHECK_EQUAL("text", str.to_string());
+
+    // Copy and assign between objects and immediates
+    TaggedValue a = str;
+    BOOST_CHECK_EQUAL(str.get(), a.get());
+    a = 1.0;
+    BOOST_CHECK_EQUAL(1.0, a.number());
+    a = num;
+    BOOST_CHECK_EQUAL(obj.get(), a.get());
+    a = TaggedValue();
+    BOOST_CHECK(!a);
+    a = std::move(str);
+    BOOST_CHECK_EQUAL("text", a.to_string());
+    BOOST_CHECK_EQUAL(2, obj.use_count());
+}
+
+BOOST_AUTO_TEST_SUITE_END()